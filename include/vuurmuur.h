@@ -36,9 +36,6 @@
 #include <time.h> /* for logging */
 #include <stdarg.h>
 #include <arpa/inet.h> /* included for check_ip function */
-#include <sys/ipc.h>   /* inter process communication */
-#include <sys/sem.h>   /* semaphore */
-#include <sys/shm.h>   /* shared memory */
 #include <dlfcn.h>     /* for the dynamic plugin loader */
 #include <regex.h>     /* for input validation */
 #include <net/if.h>    /* used for getting interface info from the system */
@@ -140,6 +137,11 @@
 #define VRMR_DEFAULT_MODPROBE_LOCATION "/sbin/modprobe"
 #define VRMR_DEFAULT_TC_LOCATION "/sbin/tc"
 
+#define VRMR_IPTCAP_CACHE_LOCATION "/var/run/vuurmuur_iptcaps.cache"
+#define VRMR_IP6TCAP_CACHE_LOCATION "/var/run/vuurmuur_ip6tcaps.cache"
+#define VRMR_TRAFVOL_LOCATION "/var/lib/vuurmuur/trafvol"
+#define VRMR_METRICS_LOCATION "/var/lib/vuurmuur/metrics"
+
 #define VRMR_DEFAULT_BACKEND "textdir"
 
 #define VRMR_DEFAULT_DYN_INT_CHECK FALSE
@@ -165,6 +167,15 @@
 /* default we log blocklist violations */
 #define VRMR_DEFAULT_LOG_BLOCKLIST true
 
+/* default we don't keep a term index of the traffic log */
+#define VRMR_DEFAULT_LOG_TERM_INDEX false
+
+/* default we don't write metrics to VRMR_METRICS_LOCATION */
+#define VRMR_DEFAULT_METRICS false
+
+/* default we wait 500ms for more reload requests before reloading */
+#define VRMR_DEFAULT_RELOAD_DEBOUNCE 500
+
 #define VRMR_DEFAULT_LOG_INVALID TRUE /* default we log INVALID traffic */
 #define VRMR_DEFAULT_LOG_NO_SYN TRUE  /* default we log new TCP but no SYN */
 #define VRMR_DEFAULT_LOG_PROBES TRUE  /* default we log probes like XMAS */
@@ -265,17 +276,6 @@
 #define ATTR_FMT_PRINTF(x, y)
 #endif
 
-#if defined(__GNU_LIBRARY__) && !defined(_SEM_SEMUN_UNDEFINED)
-/* use semun from sys/sem.h */
-#else
-union semun {
-    int val;
-    struct semid_ds *buf;
-    unsigned short int *array;
-    struct seminfo *__buf;
-};
-#endif
-
 /*
     linked list
 */
@@ -301,6 +301,25 @@ struct vrmr_list {
         .len = 0, .top = NULL, .bot = NULL, .remove = (free_func),             \
     }
 
+/*
+    vector
+
+    Growable array of pointers. Used instead of vrmr_list for containers
+    that are mostly appended to and iterated over: one allocation for the
+    whole container instead of one node per element.
+*/
+struct vrmr_vector {
+    unsigned int len;  /* number of elements in use */
+    unsigned int size; /* number of slots allocated */
+    void **data;
+
+    void (*remove)(void *data);
+};
+#define VRMR_VECTOR_INITIALIZER(free_func)                                     \
+    {                                                                          \
+        .len = 0, .size = 0, .data = NULL, .remove = (free_func),              \
+    }
+
 /*
     hash function
 */
@@ -319,8 +338,126 @@ struct vrmr_hash_table {
     /* the number of cells in the table */
     unsigned int cells;
 
-    /* the table itself. its an array of vrmr_lists */
-    struct vrmr_list *table;
+    /* the table itself. its an array of vrmr_vectors */
+    struct vrmr_vector *table;
+};
+
+/*
+    map
+
+    Open addressing hash map with the key stored in the slot. The key type
+    is fixed on setup. String keys only store the pointer, the string itself
+    is owned by the data.
+*/
+enum vrmr_map_key_type {
+    VRMR_MAP_KEY_IP = 0,
+    VRMR_MAP_KEY_PORTPROTO,
+    VRMR_MAP_KEY_STRING,
+    VRMR_MAP_KEY_TUPLE,
+    VRMR_MAP_KEY_CONNGROUP,
+};
+
+struct vrmr_map_key {
+    union {
+        struct {
+            uint8_t family;
+            uint8_t addr[16];
+        } ip;
+        struct {
+            uint16_t port;
+            uint8_t protocol;
+        } portproto;
+        const char *string;
+        struct {
+            uint8_t family;
+            uint8_t protocol;
+            uint16_t src_port;
+            uint16_t dst_port;
+            uint8_t src[16];
+            uint8_t dst[16];
+        } tuple;
+        /* interned names of a connection group, see vrmr_intern() */
+        struct {
+            const char *sername;
+            const char *fromname;
+            const char *toname;
+            int status;
+        } conngroup;
+    };
+};
+
+struct vrmr_map_slot {
+    uint32_t hash; /* 0: empty slot */
+    uint32_t dist; /* distance from the home slot */
+    struct vrmr_map_key key;
+    void *data;
+};
+
+struct vrmr_map {
+    enum vrmr_map_key_type type;
+    unsigned int size;  /* number of slots, a power of 2 */
+    unsigned int cells; /* number of entries */
+    struct vrmr_map_slot *slots;
+};
+
+struct vrmr_map_stats {
+    unsigned int size;
+    unsigned int cells;
+    double load;
+    double avg_probe;
+    unsigned int max_probe;
+};
+
+/*
+    services index
+
+    Finds the service of a logged packet or a connection. For TCP and UDP
+    the destination ports 0-65535 are split into sorted, non-overlapping
+    segments, each with the services that cover it in list order, so a
+    lookup is a binary search plus a check of the source port of those
+    candidates. ICMP and the other protocols use the map.
+*/
+struct vrmr_services_segment {
+    uint16_t low;  /* first destination port of the segment */
+    uint16_t high; /* last destination port of the segment */
+    unsigned int first; /* first candidate in 'candidates' */
+    unsigned int count; /* number of candidates */
+};
+
+struct vrmr_services_ports {
+    struct vrmr_services_segment *segments;
+    unsigned int segments_len;
+    struct vrmr_service **candidates;
+    unsigned int candidates_len;
+};
+
+struct vrmr_services_index {
+    struct vrmr_services_ports tcp;
+    struct vrmr_services_ports udp;
+    struct vrmr_map map; /* icmp type or protocol to service */
+};
+
+/*
+    name index
+
+    Maps the name of an object in one of the model lists (zones, services,
+    interfaces, rules) to the object itself. The index only stores pointers,
+    the list owns the data. The names are interned, so a lookup compares
+    pointers instead of strings. A zeroed index is a valid empty index.
+*/
+struct vrmr_name_index_entry {
+    struct vrmr_name_index_entry *next;
+    unsigned int hash;
+    void *data;
+    const char *name; /* interned, see vrmr_intern() */
+};
+
+struct vrmr_name_index {
+    /* number of rows, grows with the number of cells */
+    unsigned int rows;
+    unsigned int cells;
+
+    struct vrmr_name_index_entry **table;
 };
 
 /*
@@ -370,34 +507,10 @@ struct vrmr_portdata {
     int dst_high;
 };
 
-#define vrmr_lock(x) vrmr_shm_lock(1, (x))
-#define vrmr_unlock(x) vrmr_shm_lock(0, (x))
-
-/* shared memory */
-struct vrmr_shm_table {
-    int sem_id;
-
-    struct {
-        char name[256];
-        pid_t pid;
-        int connected;
-
-        /* username (for logging) */
-        char username[32];
-
-    } configtool;
-
-    int config_changed;
-    int backend_changed;
-
-    int reload_result;
-    int reload_progress; /* in per cent */
-};
-
 /*  RR is Reload Result
 
-    it is used for the IPC with SHM between Vuurmuur,
-    Vuurmuur_log and Vuurmuur_conf
+    it is used for the IPC between Vuurmuur, Vuurmuur_log and the config
+    tools, see control.c
 */
 enum vrmr_reload_result
 {
@@ -406,7 +519,129 @@ enum vrmr_reload_result
     VRMR_RR_READY,
     VRMR_RR_SUCCES,
     VRMR_RR_NOCHANGES,
-    VRMR_RR_RESULT_ACK,
+};
+
+/*  RQ is Reload reQuest
+
+    why a reload was requested. The requests that are joined into one
+    reload add up, so these are bits.
+*/
+enum vrmr_reload_request
+{
+    VRMR_RQ_USER = 0x01,    /* a config tool, on the control socket */
+    VRMR_RQ_SIGNAL = 0x02,  /* SIGHUP */
+    VRMR_RQ_DYNAMIC = 0x04, /* the address of a dynamic interface changed */
+};
+
+/* control sockets of the daemons */
+#define VRMR_CONTROL_VUURMUUR "/var/run/vuurmuur.ctl"
+#define VRMR_CONTROL_VUURMUUR_LOG "/var/run/vuurmuur_log.ctl"
+
+#define VRMR_CONTROL_MAX_CLIENTS 16
+#define VRMR_CONTROL_MAX_INFO 16
+#define VRMR_CONTROL_MAX_PHASES 16
+
+/* a client of the control socket, daemon side */
+struct vrmr_control_conn {
+    int fd;
+    bool subscribed;
+    unsigned int waiting; /* id of the reload the client waits for */
+    char user[32];
+    char name[128];
+    size_t in_len;
+    char in[512];
+};
+
+struct vrmr_control {
+    int fd;   /* listening socket */
+    int epfd; /* listening socket and clients */
+    char path[108];
+    struct vrmr_control_conn conns[VRMR_CONTROL_MAX_CLIENTS];
+
+    /* reloads are numbered. Requests join the pending reload, which starts
+     * 'debounce_ms' after the first of them. Set after
+     * vrmr_control_listen(). */
+    unsigned int last_id;
+    unsigned int pending_id;
+    unsigned int running_id;
+    unsigned int debounce_ms;
+    unsigned int requests; /* all requests, joined ones included */
+    struct timespec pending_start;
+    unsigned int pending_requests; /* VRMR_RQ_* bits */
+    char pending_reasons[128];
+    unsigned int reload_requests; /* VRMR_RQ_* bits of the running reload */
+    char reasons[128];            /* of the running or last reload */
+    struct timespec start;
+    char reload_error[256]; /* first error of the running reload */
+
+    /* duration of the phases of the last reload, see vrmr_control_progress */
+    uint64_t phase_mark_ms;
+    unsigned int phases_len;
+    struct {
+        char name[32];
+        uint64_t ms;
+    } phases[VRMR_CONTROL_MAX_PHASES];
+
+    /* for the 'status' command */
+    unsigned int reloads;
+    unsigned int reloads_failed;
+    int last_result;
+    uint64_t last_duration_ms;
+    time_t last_time;
+    char last_error[256];
+
+    unsigned int info_len;
+    struct {
+        char key[32];
+        char value[64];
+    } info[VRMR_CONTROL_MAX_INFO];
+
+    /* commands of the daemon itself, e.g. 'block'. Set after
+     * vrmr_control_listen(). Returns 0 if 'cmd' is unknown, 1 if it was
+     * done and -1 with the reason in 'err' if it failed. */
+    int (*command)(void *ctx, const char *user, const char *cmd,
+            const char *args, char *err, size_t size);
+    void *command_ctx;
+};
+
+/* the config tool side */
+struct vrmr_control_client {
+    int fd;
+    size_t in_len;
+    char in[1024];
+};
+
+enum vrmr_control_event_type {
+    VRMR_CONTROL_EV_OK = 0,
+    VRMR_CONTROL_EV_ERROR,
+    VRMR_CONTROL_EV_PONG,
+    VRMR_CONTROL_EV_RELOAD,
+    VRMR_CONTROL_EV_PROGRESS,
+    VRMR_CONTROL_EV_DONE,
+    VRMR_CONTROL_EV_INFO,
+    VRMR_CONTROL_EV_END,
+};
+
+struct vrmr_control_event {
+    enum vrmr_control_event_type type;
+    unsigned int id;  /* of the reload */
+    int progress;     /* in per cent */
+    int result;       /* VRMR_RR_* */
+    uint64_t ms;      /* since the start of the reload */
+    char key[32];     /* of an info event */
+    char text[256];   /* phase, error message or info value */
+};
+
+/*
+    metrics in the prometheus text format, see metrics.c
+*/
+#define VRMR_METRICS_INTERVAL 15
+
+struct vrmr_metrics {
+    FILE *fp;
+    char path[256];
+    char tmp_path[256];
+    char last_name[64]; /* last metric that got its HELP and TYPE */
 };
 
 /* in this structure we register the print functions. */
@@ -520,6 +755,10 @@ struct vrmr_config {
     uint16_t nfgrp;
 
     bool log_blocklist;
+    bool log_term_index;
+
+    /* write metrics in the prometheus text format, see metrics.c */
+    bool metrics;
 
     /* logfile locations */
     char debuglog_location[VRMR_LOG_PATH_SIZE];
@@ -564,6 +803,7 @@ struct vrmr_config {
                                    dynamic interfaces */
     unsigned int dynamic_changes_interval; /* check every x seconds for changes
                                               in the dynamic interfaces */
+    unsigned int reload_debounce; /* ms to wait for more reload requests */
 
     char load_modules;              /* load modules if needed? 1: yes, 0: no */
     unsigned int modules_wait_time; /* time to wait in 1/10 th of a second */
@@ -590,6 +830,8 @@ struct vrmr_config {
 struct vrmr_interfaces {
     /* the list with interfaces */
     struct vrmr_list list;
+    /* name -> interface index for the list */
+    struct vrmr_name_index index;
 
     /* is at least one of the interfaces active? */
     char active_interfaces;
@@ -603,16 +845,22 @@ struct vrmr_interfaces {
 struct vrmr_services {
     /* the list with services */
     struct vrmr_list list;
+    /* name -> service index for the list */
+    struct vrmr_name_index index;
 };
 
 struct vrmr_zones {
     /* the list with zones */
     struct vrmr_list list;
+    /* name -> zone index for the list */
+    struct vrmr_name_index index;
 };
 
 struct vrmr_rules {
     /* the list with rules */
     struct vrmr_list list;
+    /* rule index, keyed by vrmr_rules_index_key() */
+    struct vrmr_name_index index;
 
     /* list of chain names that are defined by the rules */
     struct vrmr_list custom_chain_list;
@@ -661,13 +909,6 @@ struct vrmr_rule_options {
     char comment[128];
     char rule_comment; /* 0 = rule has no comment, 1 = rule has a comment */
 
-    /* Port forwarding */
-    char remoteport; /* 0 = don't use remoteport, 1 = use remote port */
-    struct vrmr_list RemoteportList;
-
-    char listenport;
-    struct vrmr_list ListenportList;
-
     /* redirect */
     int redirectport;
 
@@ -709,6 +950,14 @@ struct vrmr_rule_options {
     uint8_t prio;            /* priority */
 
     char random; /* adds --random to the DNAT/SNAT/??? target */
+
+    /* Port forwarding. The fields are compared by rules_options_equal() in
+       rules.c, add new fields to its table. */
+    char remoteport; /* 0 = don't use remoteport, 1 = use remote port */
+    struct vrmr_list RemoteportList;
+
+    char listenport;
+    struct vrmr_list ListenportList;
 };
 
 /* protect rule types */
@@ -746,13 +995,42 @@ struct vrmr_interface_counters {
     uint64_t forwardout_packets;
     uint64_t forwardout_bytes;
 
-    /* for the accounting rules for IPTrafVol */
+    /* for the accounting rules, see vrmr_trafvol_update */
     uint64_t acc_in_packets;
     uint64_t acc_in_bytes;
     uint64_t acc_out_packets;
     uint64_t acc_out_bytes;
 };
 
+/*
+    counters of an interface as collected by the counter provider
+    (lib/counters.c)
+*/
+struct vrmr_counters_iface {
+    char device[VRMR_MAX_INTERFACE];
+
+    /* link counters from rtnetlink */
+    bool link_found;
+    bool up;
+    uint64_t rx_bytes;
+    uint64_t rx_packets;
+    uint64_t tx_bytes;
+    uint64_t tx_packets;
+
+    /* counters of the interface accounting rules in the filter table */
+    bool ipt_found;
+    struct vrmr_interface_counters ipt;
+};
+
+struct vrmr_counters {
+    /* time of the last update, used to update at most once per second */
+    time_t link_tick;
+    time_t ipt_tick;
+
+    struct vrmr_vector list; /* struct vrmr_counters_iface */
+    struct vrmr_map index;   /* device -> struct vrmr_counters_iface */
+};
+
 struct vrmr_interface {
     /* this should always be on top */
     int type;
@@ -785,6 +1063,8 @@ struct vrmr_interface {
         1: yes
     */
     char dynamic;
+    /* the IPv6 address is dynamic too, see vrmr_get_dynamic_ip6() */
+    char dynamic6;
 
     /* protect rules for the interface */
     struct vrmr_list ProtectList;
@@ -877,7 +1157,7 @@ struct vrmr_service {
 
     int vrmr_hash_port;
 
-    struct vrmr_list PortrangeList;
+    struct vrmr_vector PortrangeList; /* struct vrmr_portdata */
 
     char broadcast; /* 1: broadcasting service, 0: not */
 };
@@ -885,7 +1165,7 @@ struct vrmr_service {
     {                                                                          \
         .type = VRMR_TYPE_SERVICE, .name = "", .active = 0, .status = 0,       \
         .helper = "", .vrmr_hash_port = 0,                                     \
-        .PortrangeList = VRMR_LIST_INITIALIZER(free), .broadcast = 0,          \
+        .PortrangeList = VRMR_VECTOR_INITIALIZER(free), .broadcast = 0,        \
     }
 
 struct vrmr_rules_chaincount {
@@ -975,20 +1255,67 @@ struct vrmr_rule {
 
     struct vrmr_rule_options *opt;
 
+    /* hash of the rule as stored in the backend, see vrmr_rules_hash() */
+    uint32_t hash;
+
     struct vrmr_rule_cache rulecache;
 
     char filtered; /* used by vuurmuur_conf */
 };
 
+/* fields a filter expression can test, see vrmr_filter_compile() */
+enum vrmr_filter_field {
+    VRMR_FILTER_ANY = 0, /* a word without field, matches any field */
+    VRMR_FILTER_SERVICE,
+    VRMR_FILTER_FROM,
+    VRMR_FILTER_TO,
+    VRMR_FILTER_ZONE, /* from or to */
+    VRMR_FILTER_ACTION,
+    VRMR_FILTER_SRC,
+    VRMR_FILTER_DST,
+    VRMR_FILTER_IP, /* src or dst */
+    VRMR_FILTER_SPORT,
+    VRMR_FILTER_DPORT,
+    VRMR_FILTER_PORT, /* sport or dport */
+    VRMR_FILTER_PROTO,
+    VRMR_FILTER_IN,
+    VRMR_FILTER_OUT,
+    VRMR_FILTER_PREFIX,
+};
+
+/* the fields of a connection or log line a filter is evaluated against.
+ * Fields that don't apply are NULL, or -1 for the numbers. */
+struct vrmr_filter_record {
+    const char *service;
+    const char *from;
+    const char *to;
+    const char *action;
+    const char *src_ip;
+    const char *dst_ip;
+    const char *in;
+    const char *out;
+    const char *prefix;
+    int src_port;
+    int dst_port;
+    int protocol;
+
+    /* text only matched by words without a field, e.g. a plain log line */
+    const char *line;
+};
+
+struct vrmr_filter_node;
+
 struct vrmr_filter {
-    char str[32];
+    char str[64];
 
     /* are we matching the string or only _not_
        the string? */
     char neg;
 
-    char reg_active;
-    regex_t reg;
+    /* the compiled str, NULL if there is no filter */
+    struct vrmr_filter_node *expr;
+    /* bitmask of the fields the expression uses: 1 << field */
+    uint32_t fields;
 };
 
 /* connection status from conntrack */
@@ -1026,9 +1353,10 @@ struct vrmr_conntrack_entry {
 
     /*  the service
 
-        sername is a pointer to service->name unless service is NULL
+        sername, fromname and toname are interned, see vrmr_intern(), so
+        they can be compared by pointer.
     */
-    char *sername;
+    const char *sername;
     struct vrmr_service *service;
 
     /*  this is for hashing the service. It is also supplied in
@@ -1043,12 +1371,12 @@ struct vrmr_conntrack_entry {
     int src_port;
 
     /* from/source */
-    char *fromname;
+    const char *fromname;
     struct vrmr_zone *from;
     char src_ip[46];
 
     /* to/destination */
-    char *toname;
+    const char *toname;
     struct vrmr_zone *to;
     char dst_ip[46];
     char orig_dst_ip[46]; /* ip before nat correction */
@@ -1069,7 +1397,15 @@ struct vrmr_conntrack_entry {
     uint64_t to_dst_packets;
     uint64_t to_dst_bytes;
 
+    /* bits and packets per second (both directions) between the last two
+     * samples of the counters, only set by struct vrmr_conntrack_table */
+    uint64_t bps;
+    uint64_t pps;
+
     char helper[30];
+
+    /* position in the list of a struct vrmr_conntrack_table */
+    unsigned int list_pos;
 };
 
 struct vrmr_conntrack_stats {
@@ -1108,12 +1444,70 @@ struct vrmr_conntrack_request {
     /* sorting, relevant for grouping */
     char sort_in_out_fwd;
     char sort_conn_status;
+    char sort_rate;
 
     char draw_acc_data;
     char draw_details;
     char ipv6;
 };
 
+/* the kernel only sends the counters with the destroy event, so refresh
+ * them from a dump this often (seconds) when accounting data or rates are
+ * drawn */
+#define VRMR_CONN_TABLE_ACC_RESYNC 10
+
+/*
+    live connection table
+
+    Seeded by one dump and kept current from the conntrack events. 'list'
+    holds the entries to display: the groups when grouping connections,
+    otherwise the flows themselves.
+*/
+struct vrmr_conntrack_table {
+    /* event subscription, NULL if that failed: we dump on every update */
+    struct mnl_socket *nl;
+
+    struct vrmr_map flows;  /* original tuple -> flow */
+    struct vrmr_map groups; /* service, from, to and status -> group */
+
+    /* struct vrmr_conntrack_entry, sorted on cnt if 'sorted' is set */
+    struct vrmr_vector list;
+    bool sorted;
+
+    struct vrmr_conntrack_stats stats;
+
+    /* request settings the table was built with */
+    char group_conns;
+    char unknown_ip_as_net;
+    char use_filter;
+    char filter_neg;
+    char filter_str[32];
+
+    bool need_resync;
+    bool need_rebuild; /* settings changed: flush before the dump */
+    uint32_t generation;
+    time_t synced; /* time of the last dump */
+};
+
+/*
+    connection counter
+
+    The total comes from the kernel's own counter. The protocol breakdown
+    is a tally seeded by one dump and kept current from the NEW and DESTROY
+    events.
+*/
+struct vrmr_conntrack_counter {
+    /* event subscription, NULL if that failed: we dump on every update */
+    struct mnl_socket *nl;
+
+    uint32_t tcp;
+    uint32_t udp;
+    uint32_t other;
+
+    bool need_seed;
+    time_t seeded; /* time of the last dump */
+};
+
 /*
     Iptables Capabilities
 */
@@ -1494,6 +1888,14 @@ struct vrmr_log_record {
 };
 #define conn_rec lu.conn_r
 
+/* lookups of vrmr_log_record_get_names() and how many found an object */
+struct vrmr_log_lookups {
+    uint64_t zones;
+    uint64_t zone_hits;
+    uint64_t services;
+    uint64_t service_hits;
+};
+
 /*
     libvuurmuur.c
 */
@@ -1508,7 +1910,6 @@ void *vrmr_service_malloc(void);
 void *vrmr_interface_malloc();
 /*@null@*/
 void *vrmr_rule_option_malloc();
-int vrmr_shm_lock(int, int);
 char *libvuurmuur_get_version(void);
 int vrmr_regex_setup(int action, struct vrmr_regex *reg);
 
@@ -1537,18 +1938,63 @@ unsigned int vrmr_hash_ipaddress(const void *key);
 unsigned int vrmr_hash_string(const void *key);
 
 void vrmr_print_table_service(const struct vrmr_hash_table *hash_table);
-int vrmr_init_zonedata_hashtable(unsigned int n_rows, struct vrmr_list *,
-        unsigned int (*hash)(const void *key),
-        int (*match)(const void *string1, const void *string2),
-        struct vrmr_hash_table *hash_table);
-int vrmr_init_services_hashtable(unsigned int n_rows, struct vrmr_list *,
-        unsigned int (*hash)(const void *key),
-        int (*match)(const void *string1, const void *string2),
-        struct vrmr_hash_table *hash_table);
+int vrmr_init_zonedata_hashtable(struct vrmr_list *, struct vrmr_map *);
+int vrmr_init_services_hashtable(
+        struct vrmr_list *, struct vrmr_services_index *);
+void vrmr_services_index_cleanup(struct vrmr_services_index *);
 void *vrmr_search_service_in_hash(const int src, const int dst,
-        const int protocol, const struct vrmr_hash_table *serhash);
+        const int protocol, const struct vrmr_services_index *serhash);
 void *vrmr_search_zone_in_hash_with_ipv4(
-        const char *ipaddress, const struct vrmr_hash_table *zonehash);
+        const char *ipaddress, const struct vrmr_map *zonehash);
+
+unsigned int vrmr_hash_name(const char *name);
+
+/*
+    map
+*/
+int vrmr_map_setup(struct vrmr_map *, enum vrmr_map_key_type,
+        unsigned int expected);
+void vrmr_map_cleanup(struct vrmr_map *);
+int vrmr_map_insert(
+        struct vrmr_map *, const struct vrmr_map_key *, const void *data);
+int vrmr_map_remove(
+        struct vrmr_map *, const struct vrmr_map_key *, const void *data);
+void *vrmr_map_search(const struct vrmr_map *, const struct vrmr_map_key *);
+void *vrmr_map_search_match(const struct vrmr_map *,
+        const struct vrmr_map_key *,
+        int (*match)(const void *data, const void *ctx), const void *ctx);
+int vrmr_map_contains(const struct vrmr_map *, const struct vrmr_map_key *,
+        const void *data);
+void *vrmr_map_iter(const struct vrmr_map *, unsigned int *iter);
+void vrmr_map_get_stats(const struct vrmr_map *, struct vrmr_map_stats *);
+int vrmr_map_key_ip(struct vrmr_map_key *, const char *ipaddress);
+void vrmr_map_key_portproto(struct vrmr_map_key *, uint16_t, uint8_t);
+void vrmr_map_key_string(struct vrmr_map_key *, const char *);
+void vrmr_map_key_conngroup(struct vrmr_map_key *, const char *sername,
+        const char *fromname, const char *toname, int status);
+void vrmr_map_key_tuple(struct vrmr_map_key *, uint8_t family,
+        uint8_t protocol, const void *src, const void *dst, uint16_t src_port,
+        uint16_t dst_port);
+
+/*
+    intern
+*/
+const char *vrmr_intern(const char *);
+const char *vrmr_intern_lookup(const char *);
+const char *vrmr_intern_ref(const char *);
+void vrmr_intern_release(const char *);
+void vrmr_intern_cleanup(void);
+
+int vrmr_name_index_insert(
+        struct vrmr_name_index *idx, const char *name, void *data);
+int vrmr_name_index_remove(
+        struct vrmr_name_index *idx, const char *name, const void *data);
+void *vrmr_name_index_search(
+        const struct vrmr_name_index *idx, const char *name);
+void *vrmr_name_index_search_match(const struct vrmr_name_index *idx,
+        const char *name, int (*match)(const void *data, const void *ctx),
+        const void *ctx);
+void vrmr_name_index_cleanup(struct vrmr_name_index *idx);
 
 /*
     query.c
@@ -1572,6 +2018,8 @@ int vrmr_read_zonedata(struct vrmr_ctx *, struct vrmr_zones *,
         struct vrmr_interfaces *, const char *, int, struct vrmr_zone *,
         struct vrmr_regex *);
 void *vrmr_search_zonedata(const struct vrmr_zones *, const char *);
+int vrmr_zones_set_name(
+        struct vrmr_zones *, struct vrmr_zone *, const char *name);
 void vrmr_destroy_zonedatalist(struct vrmr_zones *);
 int vrmr_count_zones(struct vrmr_zones *, int, char *, char *);
 int vrmr_new_zone(struct vrmr_ctx *, struct vrmr_zones *, char *, int);
@@ -1610,6 +2058,8 @@ int vrmr_init_services(struct vrmr_ctx *, /*@out@*/ struct vrmr_services *,
         struct vrmr_regex *);
 int vrmr_insert_service(struct vrmr_ctx *, struct vrmr_services *, char *);
 void *vrmr_search_service(const struct vrmr_services *, const char *);
+int vrmr_services_set_name(
+        struct vrmr_services *, struct vrmr_service *, const char *name);
 int vrmr_read_service(struct vrmr_ctx *, char *, struct vrmr_service *);
 void vrmr_services_print_list(const struct vrmr_services *);
 int vrmr_split_portrange(char *, int *, int *);
@@ -1640,6 +2090,7 @@ char *vrmr_list_to_portopts(struct vrmr_list *, /*@null@*/ char *);
 int vrmr_portopts_to_list(const char *opt, struct vrmr_list *);
 int vrmr_check_active(struct vrmr_ctx *, char *data, int type);
 int vrmr_get_dynamic_ip(char *device, char *answer_ptr, size_t size);
+int vrmr_get_dynamic_ip6(const char *device, char *answer_ptr, size_t size);
 int vrmr_check_ipv4address(const char *network, const char *netmask,
         const char *ipaddress, char quiet);
 int vrmr_get_mac_address(struct vrmr_ctx *, const char *hostname,
@@ -1663,6 +2114,7 @@ int vrmr_set_proc_entry(struct vrmr_config *, const char *proc_entry,
 int vrmr_rules_analyze_rule(struct vrmr_rule *, struct vrmr_rule_cache *,
         struct vrmr_services *, struct vrmr_zones *, struct vrmr_interfaces *,
         struct vrmr_config *);
+int vrmr_rules_get_word(const char *, size_t *, char *, size_t);
 int vrmr_rules_parse_line(char *, struct vrmr_rule *, struct vrmr_regex *);
 int vrmr_rules_init_list(struct vrmr_ctx *, struct vrmr_config *cfg,
         /*@out@*/ struct vrmr_rules *, struct vrmr_regex *);
@@ -1674,10 +2126,14 @@ char *vrmr_rules_assemble_options_string(
 int vrmr_rules_compare_options(
         struct vrmr_rule_options *, struct vrmr_rule_options *, char *);
 void *vrmr_search_rule(struct vrmr_rules *, struct vrmr_rule *);
+void vrmr_rules_index_key(const struct vrmr_rule *, char *key, size_t size);
+int vrmr_rules_reindex(struct vrmr_rules *);
 int vrmr_rules_read_options(const char *, struct vrmr_rule_options *);
+void vrmr_rules_options_cache_cleanup(void);
 struct vrmr_rule *rules_create_protect_rule(
         char *, /*@null@*/ char *, char *, /*@null@*/ char *);
 char *vrmr_rules_assemble_rule(struct vrmr_rule *);
+int vrmr_rules_hash(struct vrmr_rule *);
 int vrmr_rules_save_list(
         struct vrmr_ctx *, struct vrmr_rules *, struct vrmr_config *);
 int vrmr_rules_get_custom_chains(struct vrmr_rules *);
@@ -1738,8 +2194,8 @@ int vrmr_logstdoutprint_error(int errorlevel, const char *head, char *fmt, ...)
 int vrmr_log_record_build_line(
         struct vrmr_log_record *log_record, char *outline, size_t size);
 int vrmr_log_record_get_names(struct vrmr_log_record *log_record,
-        struct vrmr_hash_table *zone_hash,
-        struct vrmr_hash_table *service_hash);
+        struct vrmr_map *zone_hash, struct vrmr_services_index *service_hash,
+        /*@null@*/ struct vrmr_log_lookups *lookups);
 void vrmr_log_record_parse_prefix(
         struct vrmr_log_record *log_record, const char *prefix);
 
@@ -1752,7 +2208,7 @@ DIR *vuurmuur_tryopendir(const struct vrmr_config *cnf, const char *name);
 DIR *vuurmuur_opendir(const struct vrmr_config *, const char *);
 int vrmr_stat_ok(const struct vrmr_config *, const char *, char, char, char);
 int vrmr_check_pidfile(char *pidfile_location, pid_t *thepid);
-int vrmr_create_pidfile(char *pidfile_location, int shm_id);
+int vrmr_create_pidfile(char *pidfile_location);
 int vrmr_remove_pidfile(char *pidfile_location);
 FILE *vrmr_rules_file_open(const struct vrmr_config *cnf, const char *path,
         const char *mode, int caller);
@@ -1760,8 +2216,7 @@ int vrmr_rules_file_close(FILE *file, const char *path);
 int vrmr_pipe_command(struct vrmr_config *, char *, char);
 int libvuurmuur_exec_command(
         struct vrmr_config *, const char *, const char **, char **);
-void vrmr_shm_update_progress(int semid, int *shm_progress, int set_percent);
-pid_t get_vuurmuur_pid(char *vuurmuur_pidfile_location, int *shmid);
+pid_t get_vuurmuur_pid(char *vuurmuur_pidfile_location);
 int vrmr_create_tempfile(char *);
 void vrmr_sanitize_path(char *, size_t);
 
@@ -1788,7 +2243,7 @@ void vrmr_deinit(struct vrmr_ctx *);
 void vrmr_enable_logprint(struct vrmr_config *cnf);
 int vrmr_load(struct vrmr_ctx *vctx);
 int vrmr_create_log_hash(
-        struct vrmr_ctx *, struct vrmr_hash_table *, struct vrmr_hash_table *);
+        struct vrmr_ctx *, struct vrmr_services_index *, struct vrmr_map *);
 
 /*
     backendapi.c
@@ -1801,6 +2256,8 @@ int vrmr_backends_unload(struct vrmr_config *cfg, struct vrmr_ctx *ctx);
     interfaces.c
 */
 void *vrmr_search_interface(const struct vrmr_interfaces *, const char *);
+int vrmr_interfaces_set_name(
+        struct vrmr_interfaces *, struct vrmr_interface *, const char *name);
 void *vrmr_search_interface_by_ip(struct vrmr_interfaces *, const char *);
 void vrmr_interfaces_print_list(const struct vrmr_interfaces *interfaces);
 int vrmr_read_interface_info(
@@ -1820,6 +2277,18 @@ int vrmr_get_iface_stats_from_ipt(struct vrmr_config *cfg,
         const char *iface_name, const char *chain, uint64_t *recv_packets,
         uint64_t *recv_bytes, uint64_t *trans_packets, uint64_t *trans_bytes);
 int vrmr_validate_interfacename(const char *, regex_t *);
+
+/*
+    counters.c
+*/
+void vrmr_counters_setup(struct vrmr_counters *);
+void vrmr_counters_cleanup(struct vrmr_counters *);
+struct vrmr_counters_iface *vrmr_counters_get(
+        struct vrmr_counters *, const char *device);
+int vrmr_counters_update_links(struct vrmr_counters *, bool force);
+int vrmr_counters_get_link(const char *device, struct vrmr_counters_iface *);
+int vrmr_counters_update_ipt(
+        struct vrmr_config *, struct vrmr_counters *, bool force);
 void vrmr_destroy_interfaceslist(struct vrmr_interfaces *interfaces);
 int vrmr_interfaces_get_rules(
         struct vrmr_ctx *, struct vrmr_interface *iface_ptr);
@@ -1849,10 +2318,10 @@ unsigned int vrmr_conn_hash_name(const void *key);
 int vrmr_conn_match_name(const void *ser1, const void *ser2);
 void vrmr_conn_list_print(const struct vrmr_list *conn_list);
 int vrmr_conn_get_connections(struct vrmr_config *, unsigned int,
-        struct vrmr_hash_table *, struct vrmr_hash_table *, struct vrmr_list *,
+        struct vrmr_services_index *, struct vrmr_map *, struct vrmr_vector *,
         struct vrmr_list *, struct vrmr_conntrack_request *,
         struct vrmr_conntrack_stats *);
-void vrmr_conn_list_cleanup(struct vrmr_list *conn_dlist);
+void vrmr_conn_list_cleanup(struct vrmr_vector *conn_list);
 void vrmr_connreq_setup(struct vrmr_conntrack_request *connreq);
 void vrmr_connreq_cleanup(struct vrmr_conntrack_request *connreq);
 int vrmr_conntrack_ct2lr(
@@ -1862,6 +2331,176 @@ int vrmr_conn_kill_connection_api(const int family, const char *src_ip,
 bool vrmr_conn_check_api(void);
 int vrmr_conn_count_connections_api(
         uint32_t *tcp, uint32_t *udp, uint32_t *other);
+int vrmr_conn_count_total(uint32_t *total);
+int vrmr_conn_counter_setup(struct vrmr_conntrack_counter *counter);
+void vrmr_conn_counter_cleanup(struct vrmr_conntrack_counter *counter);
+int vrmr_conn_counter_get(struct vrmr_conntrack_counter *counter,
+        uint32_t *total, uint32_t *tcp, uint32_t *udp, uint32_t *other);
+int vrmr_conn_table_setup(struct vrmr_conntrack_table *table);
+void vrmr_conn_table_cleanup(struct vrmr_conntrack_table *table);
+int vrmr_conn_table_update(struct vrmr_conntrack_table *table,
+        struct vrmr_services_index *serhash, struct vrmr_map *zonehash,
+        struct vrmr_list *zonelist, struct vrmr_conntrack_request *req);
+unsigned int vrmr_conn_table_top_rate(const struct vrmr_conntrack_table *table,
+        struct vrmr_conntrack_entry **top, unsigned int n);
+
+/*
+    traffic volume store
+*/
+/* sample the counters this often (seconds) */
+#define VRMR_TRAFVOL_INTERVAL 60
+
+/* number of records kept per period */
+#define VRMR_TRAFVOL_HOURS (24 * 8)
+#define VRMR_TRAFVOL_DAYS 400
+#define VRMR_TRAFVOL_MONTHS 120
+
+enum vrmr_trafvol_period {
+    VRMR_TRAFVOL_HOUR = 0,
+    VRMR_TRAFVOL_DAY,
+    VRMR_TRAFVOL_MONTH,
+};
+
+struct vrmr_trafvol_record {
+    int64_t bucket; /* hour, day or month number, see vrmr_trafvol_bucket */
+    uint64_t in_bytes;
+    uint64_t out_bytes;
+};
+
+int64_t vrmr_trafvol_bucket(enum vrmr_trafvol_period, const struct tm *);
+int vrmr_trafvol_update(struct vrmr_config *, struct vrmr_interfaces *,
+        struct vrmr_counters *, const char *dir);
+int vrmr_trafvol_get(const char *dir, const char *device,
+        enum vrmr_trafvol_period, int64_t first, unsigned int n, uint64_t *in,
+        uint64_t *out);
+
+/*
+    log index and search
+*/
+/* lines per index point */
+#define VRMR_LOGINDEX_STRIDE 1024
+/* max threads used by vrmr_log_search */
+#define VRMR_LOGSEARCH_MAX_THREADS 8
+
+struct vrmr_logindex_point {
+    uint64_t offset; /* of the first line of the stride */
+    uint64_t stamp;  /* year count << 32 | time stamp of that line */
+};
+
+struct vrmr_logindex {
+    char logfile[PATH_MAX];
+    int fd;
+    dev_t dev;
+    ino_t ino;
+
+    uint64_t size;  /* bytes indexed, ends after a newline */
+    uint64_t lines; /* lines indexed */
+    uint64_t last_stamp;
+
+    struct vrmr_logindex_point *points;
+    uint64_t points_len;
+    uint64_t points_size;
+    bool dirty; /* changed since it was saved */
+};
+
+int vrmr_logindex_open(struct vrmr_logindex *, const char *logfile);
+void vrmr_logindex_close(struct vrmr_logindex *);
+int vrmr_logindex_update(struct vrmr_logindex *);
+int vrmr_logindex_line_offset(
+        struct vrmr_logindex *, uint64_t line, uint64_t *offset);
+int vrmr_logindex_parse_time(const char *str, struct tm *tm);
+int vrmr_logindex_find_time(
+        struct vrmr_logindex *, const struct tm *tm, uint64_t *line);
+int64_t vrmr_log_search(const char *path, const char *pattern, unsigned int max,
+        void (*cb)(const char *line, size_t len, void *ctx), void *ctx);
+
+/*
+    term index of the traffic log
+*/
+/* max lines per block of the index */
+#define VRMR_LOGTERMS_BLOCK_LINES 4096
+/* max seconds before a block is written out */
+#define VRMR_LOGTERMS_BLOCK_TIME 60
+
+enum vrmr_logterm_type {
+    VRMR_LOGTERM_ACTION = 0,
+    VRMR_LOGTERM_SERVICE,
+    VRMR_LOGTERM_FROM,
+    VRMR_LOGTERM_TO,
+    VRMR_LOGTERM_SRC,
+    VRMR_LOGTERM_DST,
+    VRMR_LOGTERM_TYPES,
+};
+
+struct vrmr_logterms_posting {
+    uint64_t hash; /* of the term type and value */
+    uint64_t offset; /* of the line in the log */
+};
+
+struct vrmr_logterms {
+    char path[PATH_MAX]; /* of the index segment */
+    int fd;
+
+    /* the block that is being collected */
+    struct vrmr_logterms_posting *postings;
+    unsigned int postings_len;
+    unsigned int postings_size;
+    unsigned int lines;
+    uint64_t first_offset;
+    uint64_t end_offset;
+    time_t first_time;
+    time_t last_time;
+};
+
+int vrmr_logterms_open(struct vrmr_logterms *, const char *logfile);
+int vrmr_logterms_add(struct vrmr_logterms *, uint64_t offset, size_t len,
+        const struct vrmr_log_record *);
+int vrmr_logterms_flush(struct vrmr_logterms *);
+void vrmr_logterms_close(struct vrmr_logterms *);
+bool vrmr_logterms_is_query(const char *str);
+int64_t vrmr_logterms_query(const char *logfile, const char *query,
+        unsigned int max, void (*cb)(const char *line, size_t len, void *ctx),
+        void *ctx);
+
+/*
+    control.c
+*/
+int vrmr_control_listen(struct vrmr_control *, const char *path);
+void vrmr_control_close(struct vrmr_control *);
+int vrmr_control_fd(const struct vrmr_control *);
+void vrmr_control_handle(struct vrmr_control *);
+unsigned int vrmr_control_reload_request(
+        struct vrmr_control *, unsigned int request, const char *reason);
+int vrmr_control_reload_timeout(const struct vrmr_control *);
+bool vrmr_control_reload_pending(const struct vrmr_control *);
+unsigned int vrmr_control_reload_start(struct vrmr_control *);
+void vrmr_control_progress(
+        struct vrmr_control *, int percent, const char *phase);
+void vrmr_control_reload_done(struct vrmr_control *, int result);
+void vrmr_control_set_info(struct vrmr_control *, const char *key,
+        const char *fmt, ...) ATTR_FMT_PRINTF(3, 4);
+int vrmr_control_connect(struct vrmr_control_client *, const char *path,
+        const char *user, const char *name);
+void vrmr_control_disconnect(struct vrmr_control_client *);
+int vrmr_control_send(struct vrmr_control_client *, const char *cmd);
+int vrmr_control_read(struct vrmr_control_client *,
+        struct vrmr_control_event *, int timeout);
+int vrmr_control_ping(struct vrmr_control_client *);
+int vrmr_control_command(struct vrmr_control_client *, const char *cmd,
+        int timeout, char *err, size_t size);
+
+/*
+    metrics.c
+*/
+int vrmr_metrics_open(struct vrmr_metrics *, const char *dir, const char *name);
+void vrmr_metrics_u64(struct vrmr_metrics *, const char *name,
+        const char *type, const char *help, const char *labels,
+        uint64_t value);
+void vrmr_metrics_double(struct vrmr_metrics *, const char *name,
+        const char *type, const char *help, const char *labels, double value);
+void vrmr_metrics_control(
+        struct vrmr_metrics *, const char *prefix, const struct vrmr_control *);
+int vrmr_metrics_close(struct vrmr_metrics *);
 
 /*
     linked list
@@ -1883,6 +2522,23 @@ int vrmr_list_node_is_top(struct vrmr_list_node *d_node);
 int vrmr_list_node_is_bot(struct vrmr_list_node *d_node);
 int vrmr_list_cleanup(struct vrmr_list *ATTR_NONNULL);
 
+/*
+    vector
+*/
+void vrmr_vector_setup(
+        /*@out@*/ struct vrmr_vector *ATTR_NONNULL,
+        /*@null@*/ void (*remove)(void *data));
+int vrmr_vector_reserve(struct vrmr_vector *ATTR_NONNULL, unsigned int size);
+int vrmr_vector_append(struct vrmr_vector *ATTR_NONNULL, const void *data);
+int vrmr_vector_prepend(struct vrmr_vector *ATTR_NONNULL, const void *data);
+int vrmr_vector_insert(
+        struct vrmr_vector *ATTR_NONNULL, unsigned int pos, const void *data);
+int vrmr_vector_remove(struct vrmr_vector *ATTR_NONNULL, unsigned int pos);
+int vrmr_vector_remove_unordered(
+        struct vrmr_vector *ATTR_NONNULL, unsigned int pos);
+int vrmr_vector_find(const struct vrmr_vector *ATTR_NONNULL, const void *data);
+void vrmr_vector_cleanup(struct vrmr_vector *ATTR_NONNULL);
+
 /*
     iptcap.c
 */
@@ -1901,6 +2557,9 @@ void iptcap_load_helper_module(struct vrmr_config *cnf, const char *helper);
 */
 void vrmr_filter_setup(struct vrmr_filter *filter);
 void vrmr_filter_cleanup(struct vrmr_filter *filter);
+int vrmr_filter_compile(struct vrmr_filter *filter, const char *str);
+bool vrmr_filter_match(const struct vrmr_filter *filter,
+        const struct vrmr_filter_record *rec);
 
 /*
     util.c
@@ -567,6 +567,28 @@ int vrmr_init_config(struct vrmr_config *cnf)
     } else
         return (VRMR_CNF_E_UNKNOWN_ERR);
 
+    /* RELOAD_DEBOUNCE */
+    result = vrmr_ask_configfile(
+            cnf, "RELOAD_DEBOUNCE", answer, cnf->configfile, sizeof(answer));
+    if (result == 1) {
+        /* ok, found */
+        result = atoi(answer);
+        if (result < 0 || result > 60000) {
+            vrmr_warning("Warning",
+                    "RELOAD_DEBOUNCE (%d) must be between 0 and 60000, using "
+                    "default (%u).",
+                    result, VRMR_DEFAULT_RELOAD_DEBOUNCE);
+            cnf->reload_debounce = VRMR_DEFAULT_RELOAD_DEBOUNCE;
+
+            retval = VRMR_CNF_W_ILLEGAL_VAR;
+        } else {
+            cnf->reload_debounce = (unsigned int)result;
+        }
+    } else if (result == 0) {
+        cnf->reload_debounce = VRMR_DEFAULT_RELOAD_DEBOUNCE;
+    } else
+        return (VRMR_CNF_E_UNKNOWN_ERR);
+
     /* DROP_INVALID */
     result = vrmr_ask_configfile(
             cnf, "DROP_INVALID", answer, cnf->configfile, sizeof(answer));
@@ -635,6 +657,51 @@ int vrmr_init_config(struct vrmr_config *cnf)
     } else
         return (VRMR_CNF_E_UNKNOWN_ERR);
 
+    /* LOG_TERM_INDEX */
+    result = vrmr_ask_configfile(
+            cnf, "LOG_TERM_INDEX", answer, cnf->configfile, sizeof(answer));
+    if (result == 1) {
+        /* ok, found */
+        if (strcasecmp(answer, "yes") == 0) {
+            cnf->log_term_index = true;
+        } else if (strcasecmp(answer, "no") == 0) {
+            cnf->log_term_index = false;
+        } else {
+            vrmr_warning("Warning",
+                    "'%s' is not a valid value for option LOG_TERM_INDEX.",
+                    answer);
+            cnf->log_term_index = VRMR_DEFAULT_LOG_TERM_INDEX;
+
+            retval = VRMR_CNF_W_ILLEGAL_VAR;
+        }
+    } else if (result == 0) {
+        /* if this is missing, we use the default */
+        cnf->log_term_index = VRMR_DEFAULT_LOG_TERM_INDEX;
+    } else
+        return (VRMR_CNF_E_UNKNOWN_ERR);
+
+    /* METRICS */
+    result = vrmr_ask_configfile(
+            cnf, "METRICS", answer, cnf->configfile, sizeof(answer));
+    if (result == 1) {
+        /* ok, found */
+        if (strcasecmp(answer, "yes") == 0) {
+            cnf->metrics = true;
+        } else if (strcasecmp(answer, "no") == 0) {
+            cnf->metrics = false;
+        } else {
+            vrmr_warning("Warning",
+                    "'%s' is not a valid value for option METRICS.", answer);
+            cnf->metrics = VRMR_DEFAULT_METRICS;
+
+            retval = VRMR_CNF_W_ILLEGAL_VAR;
+        }
+    } else if (result == 0) {
+        /* if this is missing, we use the default */
+        cnf->metrics = VRMR_DEFAULT_METRICS;
+    } else
+        return (VRMR_CNF_E_UNKNOWN_ERR);
+
     /* LOG_INVALID */
     result = vrmr_ask_configfile(
             cnf, "LOG_INVALID", answer, cnf->configfile, sizeof(answer));
@@ -1576,6 +1643,9 @@ int vrmr_write_configfile(char *file_location, struct vrmr_config *cfg)
             cfg->dynamic_changes_check ? "Yes" : "No");
     fprintf(fp, "# Check every x seconds.\n");
     fprintf(fp, "DYN_INT_INTERVAL=\"%u\"\n\n", cfg->dynamic_changes_interval);
+    fprintf(fp, "# Wait x milliseconds for more changes before reloading, so "
+                "they\n# are applied together.\n");
+    fprintf(fp, "RELOAD_DEBOUNCE=\"%u\"\n\n", cfg->reload_debounce);
 
     fprintf(fp, "# LOG_POLICY controls the logging of the default policy.\n");
     fprintf(fp, "LOG_POLICY=\"%s\"\n\n", cfg->log_policy ? "Yes" : "No");
@@ -1585,6 +1655,13 @@ int vrmr_write_configfile(char *file_location, struct vrmr_config *cfg)
     fprintf(fp, "# LOG_BLOCKLIST enables/disables logging of items on the "
                 "blocklist.\n");
     fprintf(fp, "LOG_BLOCKLIST=\"%s\"\n\n", cfg->log_blocklist ? "Yes" : "No");
+    fprintf(fp, "# LOG_TERM_INDEX enables/disables the term index of the "
+                "traffic log,\n# used for fast searches in the log viewer.\n");
+    fprintf(fp, "LOG_TERM_INDEX=\"%s\"\n\n",
+            cfg->log_term_index ? "Yes" : "No");
+    fprintf(fp, "# METRICS enables/disables writing reload and log metrics "
+                "for prometheus\n# to " VRMR_METRICS_LOCATION ".\n");
+    fprintf(fp, "METRICS=\"%s\"\n\n", cfg->metrics ? "Yes" : "No");
 
     fprintf(fp, "# LOG_INVALID enables/disables logging of INVALID traffic.\n");
     fprintf(fp, "LOG_INVALID=\"%s\"\n\n", cfg->log_invalid ? "Yes" : "No");
@@ -1675,6 +1752,8 @@ int vrmr_init(struct vrmr_ctx *ctx, const char *toolname)
 void vrmr_deinit(struct vrmr_ctx *ctx)
 {
     (void)vrmr_regex_setup(0, &ctx->reg);
+    vrmr_rules_options_cache_cleanup();
+    vrmr_intern_cleanup();
 }
 
 void vrmr_enable_logprint(struct vrmr_config *cnf ATTR_UNUSED)
@@ -1738,7 +1817,7 @@ int vrmr_load(struct vrmr_ctx *vctx)
 }
 
 int vrmr_create_log_hash(struct vrmr_ctx *vctx,
-        struct vrmr_hash_table *service_hash, struct vrmr_hash_table *zone_hash)
+        struct vrmr_services_index *service_hash, struct vrmr_map *zone_hash)
 {
     /* insert the interfaces as VRMR_TYPE_FIREWALL's into the zonelist as
      * 'firewall', so this appears in to log as 'firewall(interface)' */
@@ -1754,16 +1833,12 @@ int vrmr_create_log_hash(struct vrmr_ctx *vctx,
         return (-1);
     }
 
-    if (vrmr_init_zonedata_hashtable(vctx->zones.list.len * 3,
-                &vctx->zones.list, vrmr_hash_ipaddress, vrmr_compare_ipaddress,
-                zone_hash) < 0) {
+    if (vrmr_init_zonedata_hashtable(&vctx->zones.list, zone_hash) < 0) {
         vrmr_error(-1, "Error", "vrmr_init_zonedata_hashtable failed");
         return (-1);
     }
 
-    if (vrmr_init_services_hashtable(vctx->services.list.len * 500,
-                &vctx->services.list, vrmr_hash_port, vrmr_compare_ports,
-                service_hash) < 0) {
+    if (vrmr_init_services_hashtable(&vctx->services.list, service_hash) < 0) {
         vrmr_error(-1, "Error", "vrmr_init_services_hashtable failed");
         return (-1);
     }
@@ -22,15 +22,26 @@
 #include "conntrack.h"
 #include "vuurmuur.h"
 
-static void free_conntrack_entry(struct vrmr_conntrack_entry *ce)
+static void free_conntrack_entry_names(struct vrmr_conntrack_entry *ce)
+{
+    vrmr_intern_release(ce->fromname);
+    vrmr_intern_release(ce->toname);
+    vrmr_intern_release(ce->sername);
+}
+
+/* interns 'name' into 'dst', see struct vrmr_conntrack_entry */
+static int conn_intern(const char **dst, const char *name)
 {
-    if (ce->from == NULL)
-        free(ce->fromname);
-    if (ce->to == NULL)
-        free(ce->toname);
-    if (ce->service == NULL)
-        free(ce->sername);
+    if (!(*dst = vrmr_intern(name))) {
+        vrmr_error(-1, "Error", "interning '%s' failed", name);
+        return (-1);
+    }
+    return (0);
+}
 
+static void free_conntrack_entry(struct vrmr_conntrack_entry *ce)
+{
+    free_conntrack_entry_names(ce);
     free(ce);
 }
 
@@ -42,29 +53,20 @@ static void free_conntrack_entry(struct vrmr_conntrack_entry *ce)
 static int filtered_connection(
         struct vrmr_conntrack_entry *cd_ptr, struct vrmr_filter *filter)
 {
-    char line[512] = "";
-
     assert(cd_ptr && filter);
 
-    snprintf(line, sizeof(line), "%d %s %s %s %d %d %d %s %s", cd_ptr->cnt,
-            cd_ptr->sername, cd_ptr->fromname, cd_ptr->toname, cd_ptr->src_port,
-            cd_ptr->dst_port, cd_ptr->protocol, cd_ptr->src_ip, cd_ptr->dst_ip);
-
-    /*  check the regex
+    const struct vrmr_filter_record rec = {
+            .service = cd_ptr->sername,
+            .from = cd_ptr->fromname,
+            .to = cd_ptr->toname,
+            .src_ip = cd_ptr->src_ip,
+            .dst_ip = cd_ptr->dst_ip,
+            .src_port = cd_ptr->src_port,
+            .dst_port = cd_ptr->dst_port,
+            .protocol = cd_ptr->protocol,
+    };
 
-        If the regex matches, the line is not filtered, so we return 0.
-    */
-    if (regexec(&filter->reg, line, 0, NULL, 0) == 0) {
-        if (filter->neg == FALSE)
-            return (0);
-        else
-            return (1);
-    } else {
-        if (filter->neg == FALSE)
-            return (1);
-        else
-            return (0);
-    }
+    return (vrmr_filter_match(filter, &rec) ? 0 : 1);
 }
 
 /*  vrmr_conn_hash_name
@@ -102,8 +104,8 @@ int vrmr_conn_match_name(const void *ser1, const void *ser2)
 
 /*  hash_conntrackdata
 
-    Hashes conntrackdata. It does this by creating seperate
-    hashes for sername, fromname and toname.
+    Hashes conntrackdata. The names are interned, so it hashes the
+    pointers of sername, fromname and toname.
 
     Returns the hash.
 */
@@ -111,15 +113,15 @@ static unsigned int conn_hash_conntrackdata(const void *key)
 {
     assert(key);
 
-    struct vrmr_conntrack_entry *cd_ptr = (struct vrmr_conntrack_entry *)key;
+    const struct vrmr_conntrack_entry *cd_ptr = key;
 
     /*  from and to have different weight, so firewall -> internet
         is not the same as internet -> firewall
     */
-    unsigned int retval = vrmr_conn_hash_name(cd_ptr->sername);
-    retval = retval + vrmr_conn_hash_name(cd_ptr->fromname) / 2;
-    retval = retval + vrmr_conn_hash_name(cd_ptr->toname) / 3;
-    return (retval);
+    uintptr_t retval = (uintptr_t)cd_ptr->sername;
+    retval = retval * 31 + (uintptr_t)cd_ptr->fromname;
+    retval = retval * 31 + (uintptr_t)cd_ptr->toname;
+    return ((unsigned int)(retval ^ (retval >> 17)));
 }
 
 /*  match_conntrackdata
@@ -133,13 +135,12 @@ static int conn_match_conntrackdata(const void *check, const void *hash)
             (struct vrmr_conntrack_entry *)check;
     struct vrmr_conntrack_entry *hash_cd = (struct vrmr_conntrack_entry *)hash;
 
-    if (strncmp(check_cd->sername, hash_cd->sername, VRMR_MAX_SERVICE) == 0) {
+    /* the names are interned */
+    if (check_cd->sername == hash_cd->sername) {
         // service matches
-        if (strncmp(check_cd->fromname, hash_cd->fromname,
-                    VRMR_MAX_HOST_NET_ZONE) == 0) {
+        if (check_cd->fromname == hash_cd->fromname) {
             // from host also matches
-            if (strncmp(check_cd->toname, hash_cd->toname,
-                        VRMR_MAX_HOST_NET_ZONE) == 0) {
+            if (check_cd->toname == hash_cd->toname) {
                 if (check_cd->connect_status == hash_cd->connect_status) {
                     // they all match-> return 1
                     return (1);
@@ -152,29 +153,17 @@ static int conn_match_conntrackdata(const void *check, const void *hash)
     return (0);
 }
 
-/*  conn_dlist_destroy
+/*  vrmr_conn_list_cleanup
 
-    Destroys the list.
+    Frees the entries of the list and the list itself.
 */
-void vrmr_conn_list_cleanup(struct vrmr_list *conn_dlist)
+void vrmr_conn_list_cleanup(struct vrmr_vector *conn_list)
 {
-    struct vrmr_list_node *d_node = NULL;
-    struct vrmr_conntrack_entry *cd_ptr = NULL;
+    for (unsigned int i = 0; i < conn_list->len; i++)
+        free_conntrack_entry(conn_list->data[i]);
 
-    for (d_node = conn_dlist->top; d_node; d_node = d_node->next) {
-        cd_ptr = d_node->data;
-
-        if (cd_ptr->from == NULL)
-            free(cd_ptr->fromname);
-        if (cd_ptr->to == NULL)
-            free(cd_ptr->toname);
-        if (cd_ptr->service == NULL)
-            free(cd_ptr->sername);
-
-        free(cd_ptr);
-    }
-
-    vrmr_list_cleanup(conn_dlist);
+    conn_list->len = 0;
+    vrmr_vector_cleanup(conn_list);
 }
 
 static void update_stats(const struct vrmr_conntrack_entry *ce,
@@ -302,8 +291,8 @@ struct vrmr_conntrack_api_entry {
         -1: (serious) error
 */
 static int conn_data_to_entry(const struct vrmr_conntrack_api_entry *cae,
-        struct vrmr_conntrack_entry *ce, struct vrmr_hash_table *serhash,
-        struct vrmr_hash_table *zonehash, struct vrmr_list *zonelist,
+        struct vrmr_conntrack_entry *ce, struct vrmr_services_index *serhash,
+        struct vrmr_map *zonehash, struct vrmr_list *zonelist,
         struct vrmr_conntrack_request *req)
 {
     char service_name[VRMR_MAX_SERVICE] = "", *zone_name_ptr = NULL;
@@ -336,16 +325,16 @@ static int conn_data_to_entry(const struct vrmr_conntrack_api_entry *cae,
                 snprintf(service_name, sizeof(service_name), "proto %d",
                         cae->protocol);
 
-            if (!(ce->sername = strdup(service_name))) {
-                vrmr_error(-1, "Error", "strdup() failed: %s", strerror(errno));
+            if (conn_intern(&ce->sername, service_name) < 0)
                 return (-1);
-            }
         } else {
             /* found! */
-            ce->sername = ce->service->name;
+            if (conn_intern(&ce->sername, ce->service->name) < 0)
+                return (-1);
         }
     } else {
-        ce->sername = ce->service->name;
+        if (conn_intern(&ce->sername, ce->service->name) < 0)
+            return (-1);
     }
 
     /* for hashing and display */
@@ -374,34 +363,23 @@ static int conn_data_to_entry(const struct vrmr_conntrack_api_entry *cae,
         vrmr_debug(HIGH, "unknown ip: '%s'.", ce->src_ip);
 
         if (req->unknown_ip_as_net == FALSE) {
-            if (!(ce->fromname = strdup(ce->src_ip))) {
-                vrmr_error(-1, "Error",
-                        "strdup() "
-                        "failed: %s",
-                        strerror(errno));
+            if (conn_intern(&ce->fromname, ce->src_ip) < 0)
                 return (-1);
-            }
         } else {
             if (!(zone_name_ptr = vrmr_get_network_for_ipv4(
                           ce->src_ip, zonelist))) {
-                if (!(ce->fromname = strdup(ce->src_ip))) {
-                    vrmr_error(-1, "Internal Error", "malloc failed: %s",
-                            strerror(errno));
+                if (conn_intern(&ce->fromname, ce->src_ip) < 0)
                     return (-1);
-                }
             } else {
-                if (!(ce->fromname = strdup(zone_name_ptr))) {
-                    vrmr_error(-1, "Internal Error", "strdup failed: %s",
-                            strerror(errno));
-                    free(zone_name_ptr);
-                    return (-1);
-                }
-
+                int r = conn_intern(&ce->fromname, zone_name_ptr);
                 free(zone_name_ptr);
+                if (r < 0)
+                    return (-1);
             }
         }
     } else {
-        ce->fromname = ce->from->name;
+        if (conn_intern(&ce->fromname, ce->from->name) < 0)
+            return (-1);
     }
 
     /* dst ip */
@@ -413,33 +391,23 @@ static int conn_data_to_entry(const struct vrmr_conntrack_api_entry *cae,
         ce->to = vrmr_search_zone_in_hash_with_ipv4(ce->dst_ip, zonehash);
     if (ce->to == NULL) {
         if (req->unknown_ip_as_net == FALSE) {
-            if (!(ce->toname = strdup(ce->dst_ip))) {
-                vrmr_error(-1, "Internal Error", "strdup failed: %s",
-                        strerror(errno));
+            if (conn_intern(&ce->toname, ce->dst_ip) < 0)
                 return (-1);
-            }
         } else {
             if (!(zone_name_ptr = vrmr_get_network_for_ipv4(
                           ce->dst_ip, zonelist))) {
-                if (!(ce->toname = strdup(ce->dst_ip))) {
-                    vrmr_error(-1, "Internal Error", "strdup failed: %s",
-                            strerror(errno));
+                if (conn_intern(&ce->toname, ce->dst_ip) < 0)
                     return (-1);
-                }
             } else {
-                if (!(ce->toname = strdup(zone_name_ptr))) {
-                    vrmr_error(-1, "Internal Error", "strdup failed: %s",
-                            strerror(errno));
-
-                    free(zone_name_ptr);
-                    return (-1);
-                }
-
+                int r = conn_intern(&ce->toname, zone_name_ptr);
                 free(zone_name_ptr);
+                if (r < 0)
+                    return (-1);
             }
         }
     } else {
-        ce->toname = ce->to->name;
+        if (conn_intern(&ce->toname, ce->to->name) < 0)
+            return (-1);
     }
 
     vrmr_debug(MEDIUM, "status cae->status %u", cae->status);
@@ -681,12 +649,12 @@ skip:
 
 struct dump_cb_ctx {
     struct vrmr_config *cnf;
-    struct vrmr_hash_table *serhash;
-    struct vrmr_hash_table *zonehash;
+    struct vrmr_services_index *serhash;
+    struct vrmr_map *zonehash;
     struct vrmr_list *zonelist;
     struct vrmr_conntrack_request *req;
     struct vrmr_conntrack_stats *connstat_ptr;
-    struct vrmr_list *conn_dlist;
+    struct vrmr_vector *conn_list;
     struct vrmr_hash_table *conn_hash;
 };
 
@@ -744,7 +712,7 @@ static int dump_cb(
             /*  NOT found in the hash */
 
             /* append the new cd to the list */
-            if (vrmr_list_append(ctx->conn_dlist, ce) == NULL) {
+            if (vrmr_vector_append(ctx->conn_list, ce) < 0) {
                 vrmr_error(-1, "Internal Error", "unable to append into list");
                 free_conntrack_entry(ce);
                 return NFCT_CB_STOP;
@@ -753,6 +721,7 @@ static int dump_cb(
             /* and insert it into the hash */
             if (vrmr_hash_insert(ctx->conn_hash, ce) != 0) {
                 vrmr_error(-1, "Internal Error", "unable to insert into hash");
+                ctx->conn_list->len--; /* drop it from the list again */
                 free_conntrack_entry(ce);
                 return NFCT_CB_STOP;
             }
@@ -764,8 +733,8 @@ static int dump_cb(
 }
 
 static int vrmr_conn_get_connections_api(struct vrmr_config *cnf,
-        struct vrmr_hash_table *serv_hash, struct vrmr_hash_table *zone_hash,
-        struct vrmr_list *conn_dlist, struct vrmr_hash_table *conn_hash,
+        struct vrmr_services_index *serv_hash, struct vrmr_map *zone_hash,
+        struct vrmr_vector *conn_list, struct vrmr_hash_table *conn_hash,
         struct vrmr_list *zone_list, struct vrmr_conntrack_request *req,
         struct vrmr_conntrack_stats *connstat_ptr)
 {
@@ -793,7 +762,7 @@ static int vrmr_conn_get_connections_api(struct vrmr_config *cnf,
             .cnf = cnf,
             .serhash = serv_hash,
             .zonehash = zone_hash,
-            .conn_dlist = conn_dlist,
+            .conn_list = conn_list,
             .zonelist = zone_list,
             .req = req,
             .connstat_ptr = connstat_ptr,
@@ -813,8 +782,8 @@ static int vrmr_conn_get_connections_api(struct vrmr_config *cnf,
 }
 
 int vrmr_conn_get_connections(struct vrmr_config *cnf,
-        const unsigned int prev_conn_cnt, struct vrmr_hash_table *serv_hash,
-        struct vrmr_hash_table *zone_hash, struct vrmr_list *conn_dlist,
+        const unsigned int prev_conn_cnt, struct vrmr_services_index *serv_hash,
+        struct vrmr_map *zone_hash, struct vrmr_vector *conn_list,
         struct vrmr_list *zone_list, struct vrmr_conntrack_request *req,
         struct vrmr_conntrack_stats *connstat_ptr)
 {
@@ -840,7 +809,7 @@ int vrmr_conn_get_connections(struct vrmr_config *cnf,
     }
 
     retval = vrmr_conn_get_connections_api(cnf, serv_hash, zone_hash,
-            conn_dlist, &conn_hash, zone_list, req, connstat_ptr);
+            conn_list, &conn_hash, zone_list, req, connstat_ptr);
     if (retval == 0) {
         vrmr_hash_cleanup(&conn_hash);
         return (retval);
@@ -994,3 +963,938 @@ int vrmr_conn_count_connections_api(
     }
     return retval;
 }
+
+/*  conn_events_subscribe
+
+    Opens a non-blocking socket subscribed to the conntrack event 'groups'.
+
+    Returns the socket, or NULL on error.
+*/
+static struct mnl_socket *conn_events_subscribe(unsigned int groups)
+{
+    struct mnl_socket *nl = mnl_socket_open(NETLINK_NETFILTER);
+    if (nl == NULL) {
+        vrmr_warning("Warning", "mnl_socket_open failed: %s", strerror(errno));
+        return (NULL);
+    }
+    if (mnl_socket_bind(nl, groups, MNL_SOCKET_AUTOPID) < 0) {
+        vrmr_warning("Warning", "mnl_socket_bind failed: %s", strerror(errno));
+        mnl_socket_close(nl);
+        return (NULL);
+    }
+
+    int fd = mnl_socket_get_fd(nl);
+    int flags = fcntl(fd, F_GETFL);
+    if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+        vrmr_warning(
+                "Warning", "setting O_NONBLOCK failed: %s", strerror(errno));
+        mnl_socket_close(nl);
+        return (NULL);
+    }
+    return (nl);
+}
+
+/*  vrmr_conn_count_total
+
+    Gets the number of connections from the counter the kernel keeps,
+    which is a lot cheaper than counting a dump.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_conn_count_total(uint32_t *total)
+{
+    char line[512] = "";
+    unsigned long v = 0;
+    FILE *fp = NULL;
+
+    assert(total);
+
+    if ((fp = fopen("/proc/sys/net/netfilter/nf_conntrack_count", "r"))) {
+        int result = -1;
+        if (fgets(line, (int)sizeof(line), fp) != NULL &&
+                sscanf(line, "%lu", &v) == 1) {
+            *total = (uint32_t)v;
+            result = 0;
+        }
+        (void)fclose(fp);
+        return (result);
+    }
+
+    /* the first column of the per cpu lines holds the global number of
+     * entries, in hex */
+    if ((fp = fopen("/proc/net/stat/nf_conntrack", "r"))) {
+        int result = -1;
+        if (fgets(line, (int)sizeof(line), fp) != NULL &&
+                fgets(line, (int)sizeof(line), fp) != NULL &&
+                sscanf(line, "%lx", &v) == 1) {
+            *total = (uint32_t)v;
+            result = 0;
+        }
+        (void)fclose(fp);
+        return (result);
+    }
+    return (-1);
+}
+
+static int conn_counter_event_cb(const struct nlmsghdr *nlh, void *data)
+{
+    struct vrmr_conntrack_counter *counter = data;
+    uint32_t *cnt = NULL;
+
+    struct nf_conntrack *ct = nfct_new();
+    if (ct == NULL)
+        return MNL_CB_OK;
+    nfct_nlmsg_parse(nlh, ct);
+
+    switch (nfct_get_attr_u8(ct, ATTR_L4PROTO)) {
+        case IPPROTO_TCP:
+            cnt = &counter->tcp;
+            break;
+        case IPPROTO_UDP:
+            cnt = &counter->udp;
+            break;
+        default:
+            cnt = &counter->other;
+            break;
+    }
+    nfct_destroy(ct);
+
+    if ((nlh->nlmsg_type & 0xFF) == IPCTNL_MSG_CT_DELETE) {
+        if (*cnt > 0)
+            (*cnt)--;
+    } else {
+        (*cnt)++;
+    }
+    return MNL_CB_OK;
+}
+
+/* processes the pending events, or discards them if 'process' is false */
+static int conn_counter_read_events(
+        struct vrmr_conntrack_counter *counter, bool process)
+{
+    char buf[MNL_SOCKET_BUFFER_SIZE];
+
+    for (;;) {
+        int ret = mnl_socket_recvfrom(counter->nl, buf, sizeof(buf));
+        if (ret == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return (0);
+            if (errno == ENOBUFS) {
+                counter->need_seed = true;
+                continue;
+            }
+            vrmr_error(-1, "Error", "mnl_socket_recvfrom failed: %s",
+                    strerror(errno));
+            return (-1);
+        }
+
+        if (process && mnl_cb_run(buf, ret, 0, 0, conn_counter_event_cb,
+                               counter) == -1) {
+            vrmr_error(-1, "Error", "mnl_cb_run failed: %s", strerror(errno));
+            return (-1);
+        }
+    }
+}
+
+/*  vrmr_conn_counter_setup
+
+    Subscribes to the conntrack NEW and DESTROY events. If that fails the
+    counter still works, but it dumps on every update.
+*/
+int vrmr_conn_counter_setup(struct vrmr_conntrack_counter *counter)
+{
+    assert(counter);
+
+    memset(counter, 0, sizeof(*counter));
+    counter->need_seed = true;
+    counter->nl = conn_events_subscribe(
+            NF_NETLINK_CONNTRACK_NEW | NF_NETLINK_CONNTRACK_DESTROY);
+    return (0);
+}
+
+void vrmr_conn_counter_cleanup(struct vrmr_conntrack_counter *counter)
+{
+    assert(counter);
+
+    if (counter->nl != NULL)
+        mnl_socket_close(counter->nl);
+    memset(counter, 0, sizeof(*counter));
+}
+
+/*  vrmr_conn_counter_get
+
+    The total is the kernel's counter, the protocol breakdown comes from
+    the tally. 'other' is what is left of the total after tcp and udp, so
+    the numbers always add up.
+
+    The tally is reseeded from a dump when events were lost. It also drifts
+    if events are not delivered at all (net.netfilter.nf_conntrack_events
+    set to 0), so it is reseeded when it is far off from the kernel's
+    counter, at most once a minute.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_conn_counter_get(struct vrmr_conntrack_counter *counter,
+        uint32_t *total, uint32_t *tcp, uint32_t *udp, uint32_t *other)
+{
+    uint32_t kernel_total = 0;
+
+    assert(counter && total && tcp && udp && other);
+
+    bool have_total = (vrmr_conn_count_total(&kernel_total) == 0);
+
+    if (counter->nl == NULL)
+        counter->need_seed = true;
+    else if (!counter->need_seed && conn_counter_read_events(counter, true) < 0)
+        return (-1);
+
+    if (have_total && !counter->need_seed &&
+            time(NULL) - counter->seeded >= 60) {
+        uint64_t sum = (uint64_t)counter->tcp + counter->udp + counter->other;
+        uint64_t diff = (sum > kernel_total) ? sum - kernel_total
+                                             : kernel_total - sum;
+        if (diff > kernel_total / 10 + 100)
+            counter->need_seed = true;
+    }
+
+    if (counter->need_seed) {
+        if (counter->nl != NULL && conn_counter_read_events(counter, false) < 0)
+            return (-1);
+        counter->need_seed = false;
+        counter->seeded = time(NULL);
+
+        if (vrmr_conn_count_connections_api(
+                    &counter->tcp, &counter->udp, &counter->other) < 0) {
+            counter->need_seed = true;
+            return (-1);
+        }
+    }
+
+    *tcp = counter->tcp;
+    *udp = counter->udp;
+    if (!have_total)
+        kernel_total = counter->tcp + counter->udp + counter->other;
+    *total = kernel_total;
+    *other = (kernel_total > counter->tcp + counter->udp)
+                     ? kernel_total - counter->tcp - counter->udp
+                     : 0;
+    return (0);
+}
+
+/*
+    Live connection table
+
+    The flows are keyed on their original tuple. An event for a known flow
+    replaces it, so a changed status or name moves it to the right group.
+
+    Each flow remembers the counters of the previous dump to compute its
+    rates. Groups carry the sum of the rates of their flows.
+*/
+struct conn_table_group {
+    struct vrmr_map_key key; /* service, from, to and status */
+    struct vrmr_conntrack_entry entry;
+};
+
+struct conn_table_flow {
+    struct vrmr_map_key key;
+    struct conn_table_group *group; /* NULL if not grouping */
+    uint32_t generation;            /* of the last dump or event */
+
+    /* previous sample of the counters */
+    uint64_t sample_ms;
+    uint64_t sample_bytes;
+    uint64_t sample_packets;
+
+    struct vrmr_conntrack_entry entry;
+};
+
+struct conn_table_ctx {
+    struct vrmr_conntrack_table *table;
+    struct vrmr_services_index *serhash;
+    struct vrmr_map *zonehash;
+    struct vrmr_list *zonelist;
+    struct vrmr_conntrack_request *req;
+    int retval;
+};
+
+static void conn_table_key(struct nf_conntrack *ct, struct vrmr_map_key *key)
+{
+    uint8_t family = nfct_get_attr_u8(ct, ATTR_L3PROTO);
+    uint8_t protocol = nfct_get_attr_u8(ct, ATTR_L4PROTO);
+    uint16_t sp = 0, dp = 0;
+
+    switch (protocol) {
+        case IPPROTO_TCP:
+        case IPPROTO_UDP:
+            sp = nfct_get_attr_u16(ct, ATTR_ORIG_PORT_SRC);
+            dp = nfct_get_attr_u16(ct, ATTR_ORIG_PORT_DST);
+            break;
+        case IPPROTO_ICMP:
+        case IPPROTO_ICMPV6:
+            sp = nfct_get_attr_u16(ct, ATTR_ICMP_ID);
+            dp = (uint16_t)(nfct_get_attr_u8(ct, ATTR_ICMP_TYPE) << 8 |
+                            nfct_get_attr_u8(ct, ATTR_ICMP_CODE));
+            break;
+    }
+
+    if (family == AF_INET6) {
+        struct nfct_attr_grp_ipv6 addrs;
+        memset(&addrs, 0, sizeof(addrs));
+        nfct_get_attr_grp(ct, ATTR_GRP_ORIG_IPV6, &addrs);
+        vrmr_map_key_tuple(
+                key, AF_INET6, protocol, addrs.src, addrs.dst, sp, dp);
+    } else {
+        uint32_t src = nfct_get_attr_u32(ct, ATTR_ORIG_IPV4_SRC);
+        uint32_t dst = nfct_get_attr_u32(ct, ATTR_ORIG_IPV4_DST);
+        vrmr_map_key_tuple(key, AF_INET, protocol, &src, &dst, sp, dp);
+    }
+}
+
+/* undo update_stats for an entry that leaves the table. The name widths
+ * are high water marks, they are reset on resync. */
+static void conn_table_stats_remove(const struct vrmr_conntrack_entry *ce,
+        struct vrmr_conntrack_stats *connstat_ptr)
+{
+    connstat_ptr->conn_total--;
+
+    if (ce->from != NULL && ce->from->type == VRMR_TYPE_FIREWALL)
+        connstat_ptr->conn_out--;
+    else if (ce->to != NULL && ce->to->type == VRMR_TYPE_FIREWALL)
+        connstat_ptr->conn_in--;
+    else
+        connstat_ptr->conn_fw--;
+
+    if (ce->connect_status == VRMR_CONN_CONNECTING)
+        connstat_ptr->stat_connect--;
+    else if (ce->connect_status == VRMR_CONN_DISCONNECTING)
+        connstat_ptr->stat_closing--;
+    else if (ce->connect_status == VRMR_CONN_CONNECTED)
+        connstat_ptr->stat_estab--;
+    else
+        connstat_ptr->stat_other--;
+}
+
+static int conn_table_list_add(
+        struct vrmr_conntrack_table *table, struct vrmr_conntrack_entry *ce)
+{
+    ce->list_pos = table->list.len;
+    if (vrmr_vector_append(&table->list, ce) < 0)
+        return (-1);
+
+    table->sorted = false;
+    return (0);
+}
+
+static void conn_table_list_del(
+        struct vrmr_conntrack_table *table, struct vrmr_conntrack_entry *ce)
+{
+    unsigned int pos = ce->list_pos;
+
+    assert(pos < table->list.len && table->list.data[pos] == ce);
+
+    (void)vrmr_vector_remove_unordered(&table->list, pos);
+    if (pos < table->list.len) {
+        struct vrmr_conntrack_entry *moved = table->list.data[pos];
+        moved->list_pos = pos;
+    }
+    table->sorted = false;
+}
+
+static void conn_table_group_free(struct conn_table_group *group)
+{
+    free_conntrack_entry_names(&group->entry);
+    free(group);
+}
+
+static int conn_table_group_add(
+        struct vrmr_conntrack_table *table, struct conn_table_flow *flow)
+{
+    struct vrmr_conntrack_entry *ce = &flow->entry;
+    struct vrmr_map_key key;
+
+    vrmr_map_key_conngroup(&key, ce->sername, ce->fromname, ce->toname,
+            ce->connect_status);
+
+    struct conn_table_group *group = vrmr_map_search(&table->groups, &key);
+    if (group == NULL) {
+        if (!(group = calloc(1, sizeof(*group)))) {
+            vrmr_error(-1, "Error", "calloc() failed: %s", strerror(errno));
+            return (-1);
+        }
+
+        /* the first flow of the group is used for the details */
+        group->entry = *ce;
+        group->entry.cnt = 0;
+        group->entry.use_acc = 0;
+        group->entry.to_src_packets = group->entry.to_src_bytes = 0;
+        group->entry.to_dst_packets = group->entry.to_dst_bytes = 0;
+        group->entry.bps = group->entry.pps = 0;
+
+        group->entry.sername = vrmr_intern_ref(ce->sername);
+        group->entry.fromname = vrmr_intern_ref(ce->fromname);
+        group->entry.toname = vrmr_intern_ref(ce->toname);
+        group->key = key;
+
+        if (vrmr_map_insert(&table->groups, &group->key, group) < 0) {
+            conn_table_group_free(group);
+            return (-1);
+        }
+        if (conn_table_list_add(table, &group->entry) < 0) {
+            (void)vrmr_map_remove(&table->groups, &group->key, group);
+            conn_table_group_free(group);
+            return (-1);
+        }
+    }
+
+    group->entry.cnt++;
+    group->entry.to_src_packets += ce->to_src_packets;
+    group->entry.to_src_bytes += ce->to_src_bytes;
+    group->entry.to_dst_packets += ce->to_dst_packets;
+    group->entry.to_dst_bytes += ce->to_dst_bytes;
+    group->entry.bps += ce->bps;
+    group->entry.pps += ce->pps;
+    if (ce->use_acc)
+        group->entry.use_acc = 1;
+
+    flow->group = group;
+    table->sorted = false;
+    return (0);
+}
+
+static void conn_table_group_del(
+        struct vrmr_conntrack_table *table, struct conn_table_flow *flow)
+{
+    struct conn_table_group *group = flow->group;
+    const struct vrmr_conntrack_entry *ce = &flow->entry;
+
+    flow->group = NULL;
+
+    group->entry.cnt--;
+    group->entry.to_src_packets -= ce->to_src_packets;
+    group->entry.to_src_bytes -= ce->to_src_bytes;
+    group->entry.to_dst_packets -= ce->to_dst_packets;
+    group->entry.to_dst_bytes -= ce->to_dst_bytes;
+    group->entry.bps -= ce->bps;
+    group->entry.pps -= ce->pps;
+    table->sorted = false;
+
+    if (group->entry.cnt == 0) {
+        (void)vrmr_map_remove(&table->groups, &group->key, group);
+        conn_table_list_del(table, &group->entry);
+        conn_table_group_free(group);
+    }
+}
+
+static void conn_table_flow_free(struct conn_table_flow *flow)
+{
+    free_conntrack_entry_names(&flow->entry);
+    free(flow);
+}
+
+static void conn_table_flow_unlink(
+        struct vrmr_conntrack_table *table, struct conn_table_flow *flow)
+{
+    conn_table_stats_remove(&flow->entry, &table->stats);
+
+    if (flow->group != NULL)
+        conn_table_group_del(table, flow);
+    else
+        conn_table_list_del(table, &flow->entry);
+
+    (void)vrmr_map_remove(&table->flows, &flow->key, flow);
+    conn_table_flow_free(flow);
+}
+
+static uint64_t conn_table_now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000);
+}
+
+/* take a new sample of the counters of 'flow' and compute the rates since
+ * the sample of 'old' */
+static void conn_table_flow_rate(struct conn_table_flow *flow,
+        const struct conn_table_flow *old, uint64_t now_ms)
+{
+    struct vrmr_conntrack_entry *ce = &flow->entry;
+    uint64_t bytes = ce->to_src_bytes + ce->to_dst_bytes;
+    uint64_t packets = ce->to_src_packets + ce->to_dst_packets;
+
+    if (old != NULL && bytes >= old->sample_bytes &&
+            packets >= old->sample_packets && now_ms < old->sample_ms + 500) {
+        /* too close to the previous sample for a meaningful rate */
+        flow->sample_ms = old->sample_ms;
+        flow->sample_bytes = old->sample_bytes;
+        flow->sample_packets = old->sample_packets;
+        ce->bps = old->entry.bps;
+        ce->pps = old->entry.pps;
+        return;
+    }
+
+    if (old != NULL && bytes >= old->sample_bytes &&
+            packets >= old->sample_packets) {
+        uint64_t elapsed = now_ms - old->sample_ms;
+        ce->bps = (bytes - old->sample_bytes) * 8 * 1000 / elapsed;
+        ce->pps = (packets - old->sample_packets) * 1000 / elapsed;
+    }
+    /* else: first sample or the counters were reset */
+
+    flow->sample_ms = now_ms;
+    flow->sample_bytes = bytes;
+    flow->sample_packets = packets;
+}
+
+/*  conn_table_process
+
+    Adds, replaces or removes the flow for one dumped conntrack entry or
+    one event.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int conn_table_process(
+        struct conn_table_ctx *ctx, uint32_t type, struct nf_conntrack *ct)
+{
+    struct vrmr_conntrack_table *table = ctx->table;
+    struct vrmr_map_key key;
+
+    conn_table_key(ct, &key);
+    struct conn_table_flow *old = vrmr_map_search(&table->flows, &key);
+
+    if (type == NFCT_T_DESTROY) {
+        if (old != NULL)
+            conn_table_flow_unlink(table, old);
+        return (0);
+    }
+
+    struct vrmr_conntrack_api_entry cae;
+    memset(&cae, 0, sizeof(cae));
+    if (vrmr_conntrack_ct2ae(type, ct, &cae) == 0) {
+        if (old != NULL)
+            conn_table_flow_unlink(table, old);
+        return (0);
+    }
+
+    struct conn_table_flow *flow = calloc(1, sizeof(*flow));
+    if (flow == NULL) {
+        vrmr_error(-1, "Error", "calloc() failed: %s", strerror(errno));
+        return (-1);
+    }
+    flow->key = key;
+
+    if (conn_data_to_entry(&cae, &flow->entry, ctx->serhash, ctx->zonehash,
+                ctx->zonelist, ctx->req) < 0) {
+        vrmr_error(-1, "Error", "conn_data_to_entry() failed");
+        conn_table_flow_free(flow);
+        return (-1);
+    }
+
+    /*  we ignore the local loopback connections
+        and connections that are filtered */
+    if (strncmp(flow->entry.fromname, "127.", 4) == 0 ||
+            strncmp(flow->entry.toname, "127.", 4) == 0 ||
+            (table->use_filter == TRUE &&
+                    filtered_connection(&flow->entry, &ctx->req->filter) ==
+                            1)) {
+        conn_table_flow_free(flow);
+        if (old != NULL)
+            conn_table_flow_unlink(table, old);
+        return (0);
+    }
+
+    if (old != NULL && !flow->entry.use_acc) {
+        /* update events don't carry the counters, keep the ones we have */
+        flow->entry.use_acc = old->entry.use_acc;
+        flow->entry.to_src_packets = old->entry.to_src_packets;
+        flow->entry.to_src_bytes = old->entry.to_src_bytes;
+        flow->entry.to_dst_packets = old->entry.to_dst_packets;
+        flow->entry.to_dst_bytes = old->entry.to_dst_bytes;
+        flow->entry.bps = old->entry.bps;
+        flow->entry.pps = old->entry.pps;
+        flow->sample_ms = old->sample_ms;
+        flow->sample_bytes = old->sample_bytes;
+        flow->sample_packets = old->sample_packets;
+    } else {
+        conn_table_flow_rate(flow, old, conn_table_now_ms());
+    }
+    if (old != NULL)
+        conn_table_flow_unlink(table, old);
+
+    flow->entry.cnt = 1;
+    flow->generation = table->generation;
+    if (vrmr_map_insert(&table->flows, &flow->key, flow) < 0) {
+        conn_table_flow_free(flow);
+        return (-1);
+    }
+    int result = (table->group_conns == TRUE)
+                         ? conn_table_group_add(table, flow)
+                         : conn_table_list_add(table, &flow->entry);
+    if (result < 0) {
+        (void)vrmr_map_remove(&table->flows, &flow->key, flow);
+        conn_table_flow_free(flow);
+        return (-1);
+    }
+
+    update_stats(&flow->entry, &table->stats);
+    return (0);
+}
+
+static int conn_table_dump_cb(
+        enum nf_conntrack_msg_type type, struct nf_conntrack *ct, void *data)
+{
+    struct conn_table_ctx *ctx = data;
+
+    if (conn_table_process(ctx, type, ct) < 0) {
+        ctx->retval = -1;
+        return NFCT_CB_STOP;
+    }
+    return NFCT_CB_CONTINUE;
+}
+
+static int conn_table_event_cb(const struct nlmsghdr *nlh, void *data)
+{
+    struct conn_table_ctx *ctx = data;
+    uint32_t type = NFCT_T_UPDATE;
+
+    if ((nlh->nlmsg_type & 0xFF) == IPCTNL_MSG_CT_DELETE)
+        type = NFCT_T_DESTROY;
+    else if (nlh->nlmsg_flags & (NLM_F_CREATE | NLM_F_EXCL))
+        type = NFCT_T_NEW;
+
+    struct nf_conntrack *ct = nfct_new();
+    if (ct == NULL) {
+        vrmr_error(-1, "Error", "nfct_new failed");
+        return MNL_CB_ERROR;
+    }
+    nfct_nlmsg_parse(nlh, ct);
+
+    int result = conn_table_process(ctx, type, ct);
+    nfct_destroy(ct);
+    return (result < 0) ? MNL_CB_ERROR : MNL_CB_OK;
+}
+
+/*  conn_table_read_events
+
+    Processes the pending events, or discards them if 'ctx' is NULL. If the
+    kernel dropped events because we didn't keep up, the table is flagged
+    for a resync.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int conn_table_read_events(
+        struct vrmr_conntrack_table *table, struct conn_table_ctx *ctx)
+{
+    char buf[MNL_SOCKET_BUFFER_SIZE];
+
+    for (;;) {
+        int ret = mnl_socket_recvfrom(table->nl, buf, sizeof(buf));
+        if (ret == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return (0);
+            if (errno == ENOBUFS) {
+                vrmr_debug(LOW, "conntrack events lost, resyncing");
+                table->need_resync = true;
+                continue;
+            }
+            vrmr_error(-1, "Error", "mnl_socket_recvfrom failed: %s",
+                    strerror(errno));
+            return (-1);
+        }
+
+        if (ctx == NULL)
+            continue;
+
+        if (mnl_cb_run(buf, ret, 0, 0, conn_table_event_cb, ctx) == -1) {
+            vrmr_error(-1, "Error", "mnl_cb_run failed: %s", strerror(errno));
+            return (-1);
+        }
+    }
+}
+
+static int conn_table_sort_by_cnt(const void *a, const void *b)
+{
+    const struct vrmr_conntrack_entry *s0 =
+            *(const struct vrmr_conntrack_entry **)a;
+    const struct vrmr_conntrack_entry *s1 =
+            *(const struct vrmr_conntrack_entry **)b;
+    if (s1->cnt == s0->cnt)
+        return 0;
+    else
+        return s0->cnt > s1->cnt ? -1 : 1;
+}
+
+static void conn_table_flush(struct vrmr_conntrack_table *table)
+{
+    unsigned int iter = 0, flows = table->flows.cells;
+    void *data;
+
+    while ((data = vrmr_map_iter(&table->flows, &iter)) != NULL)
+        conn_table_flow_free(data);
+    iter = 0;
+    while ((data = vrmr_map_iter(&table->groups, &iter)) != NULL)
+        conn_table_group_free(data);
+
+    vrmr_map_cleanup(&table->flows);
+    vrmr_map_cleanup(&table->groups);
+    table->list.len = 0;
+    memset(&table->stats, 0, sizeof(table->stats));
+
+    /* size for the previous number of flows */
+    (void)vrmr_map_setup(&table->flows, VRMR_MAP_KEY_TUPLE, flows);
+    (void)vrmr_map_setup(&table->groups, VRMR_MAP_KEY_CONNGROUP, 0);
+}
+
+/* remove the flows that were not in the last dump */
+static int conn_table_sweep(struct vrmr_conntrack_table *table)
+{
+    struct vrmr_vector stale = VRMR_VECTOR_INITIALIZER(NULL);
+    struct conn_table_flow *flow;
+    unsigned int iter = 0;
+
+    while ((flow = vrmr_map_iter(&table->flows, &iter)) != NULL) {
+        if (flow->generation != table->generation &&
+                vrmr_vector_append(&stale, flow) < 0) {
+            vrmr_vector_cleanup(&stale);
+            return (-1);
+        }
+    }
+    for (unsigned int i = 0; i < stale.len; i++)
+        conn_table_flow_unlink(table, stale.data[i]);
+
+    vrmr_vector_cleanup(&stale);
+    return (0);
+}
+
+/*  conn_table_resync
+
+    Updates the table from a full dump. If the settings changed the table
+    is rebuilt from scratch, otherwise the flows are updated in place so
+    they keep their previous sample, and the ones that are gone are
+    removed.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int conn_table_resync(
+        struct vrmr_conntrack_table *table, struct conn_table_ctx *ctx)
+{
+    struct vrmr_conntrack_request *req = ctx->req;
+
+    if (table->need_rebuild) {
+        conn_table_flush(table);
+
+        table->group_conns = req->group_conns;
+        table->unknown_ip_as_net = req->unknown_ip_as_net;
+        table->use_filter = req->use_filter;
+        table->filter_neg = req->filter.neg;
+        strlcpy(table->filter_str, req->filter.str, sizeof(table->filter_str));
+        table->need_rebuild = false;
+    }
+
+    /* the dump is newer than anything queued */
+    if (table->nl != NULL && conn_table_read_events(table, NULL) < 0)
+        return (-1);
+
+    table->need_resync = false;
+    table->synced = time(NULL);
+    table->generation++;
+
+    struct nf_conntrack *ct = nfct_new();
+    if (ct == NULL) {
+        vrmr_error(-1, "Error", "nfct_new failed");
+        return (-1);
+    }
+    struct nfct_handle *h = nfct_open(CONNTRACK, 0);
+    if (h == NULL) {
+        vrmr_error(-1, "Error", "nfct_open failed");
+        nfct_destroy(ct);
+        return (-1);
+    }
+
+    nfct_callback_register(h, NFCT_T_ALL, conn_table_dump_cb, ctx);
+    int ret = nfct_query(h, NFCT_Q_DUMP, ct);
+    if (ret != 0) {
+        vrmr_error(-1, "Error", "nfct_query failed: %d", ret);
+        ctx->retval = -1;
+    }
+
+    nfct_close(h);
+    nfct_destroy(ct);
+
+    if (ctx->retval == 0 && conn_table_sweep(table) < 0)
+        ctx->retval = -1;
+    return (ctx->retval);
+}
+
+/*  vrmr_conn_table_setup
+
+    Subscribes to the conntrack events. If that fails the table still
+    works, but it is rebuilt from a dump on every update.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_conn_table_setup(struct vrmr_conntrack_table *table)
+{
+    assert(table);
+
+    memset(table, 0, sizeof(*table));
+    vrmr_vector_setup(&table->list, NULL);
+    if (vrmr_map_setup(&table->flows, VRMR_MAP_KEY_TUPLE, 0) < 0 ||
+            vrmr_map_setup(&table->groups, VRMR_MAP_KEY_CONNGROUP, 0) < 0)
+        return (-1);
+    table->need_resync = true;
+    table->need_rebuild = true;
+
+    table->nl = conn_events_subscribe(NF_NETLINK_CONNTRACK_NEW |
+                                      NF_NETLINK_CONNTRACK_UPDATE |
+                                      NF_NETLINK_CONNTRACK_DESTROY);
+    return (0);
+}
+
+void vrmr_conn_table_cleanup(struct vrmr_conntrack_table *table)
+{
+    assert(table);
+
+    if (table->nl != NULL)
+        mnl_socket_close(table->nl);
+
+    conn_table_flush(table);
+    vrmr_map_cleanup(&table->flows);
+    vrmr_map_cleanup(&table->groups);
+    vrmr_vector_cleanup(&table->list);
+    memset(table, 0, sizeof(*table));
+}
+
+/*  vrmr_conn_table_update
+
+    Brings the table up to date by processing the pending events. A full
+    dump is only done on the first call, after the request settings
+    changed, after events were lost, and for the counters (see
+    VRMR_CONN_TABLE_ACC_RESYNC).
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_conn_table_update(struct vrmr_conntrack_table *table,
+        struct vrmr_services_index *serhash, struct vrmr_map *zonehash,
+        struct vrmr_list *zonelist, struct vrmr_conntrack_request *req)
+{
+    assert(table && serhash && zonehash && req);
+
+    struct conn_table_ctx ctx = {
+            .table = table,
+            .serhash = serhash,
+            .zonehash = zonehash,
+            .zonelist = zonelist,
+            .req = req,
+            .retval = 0,
+    };
+
+    if (table->group_conns != req->group_conns ||
+            table->unknown_ip_as_net != req->unknown_ip_as_net ||
+            table->use_filter != req->use_filter ||
+            (req->use_filter == TRUE &&
+                    (table->filter_neg != req->filter.neg ||
+                            strcmp(table->filter_str, req->filter.str) != 0)))
+        table->need_rebuild = table->need_resync = true;
+
+    if (table->nl == NULL)
+        table->need_resync = true;
+    if ((req->draw_acc_data == TRUE || req->sort_rate == TRUE) &&
+            time(NULL) - table->synced >= VRMR_CONN_TABLE_ACC_RESYNC)
+        table->need_resync = true;
+
+    if (!table->need_resync && conn_table_read_events(table, &ctx) < 0)
+        return (-1);
+
+    if (table->need_resync && conn_table_resync(table, &ctx) < 0)
+        return (-1);
+
+    if (table->group_conns == TRUE && !table->sorted) {
+        qsort(table->list.data, table->list.len, sizeof(void *),
+                conn_table_sort_by_cnt);
+        for (unsigned int i = 0; i < table->list.len; i++) {
+            struct vrmr_conntrack_entry *ce = table->list.data[i];
+            ce->list_pos = i;
+        }
+    }
+    table->sorted = true;
+    return (0);
+}
+
+/* min-heap on bps, the root is the slowest of the top */
+static void conn_top_sift_down(
+        struct vrmr_conntrack_entry **heap, unsigned int len, unsigned int i)
+{
+    for (;;) {
+        unsigned int min = i, l = 2 * i + 1, r = 2 * i + 2;
+
+        if (l < len && heap[l]->bps < heap[min]->bps)
+            min = l;
+        if (r < len && heap[r]->bps < heap[min]->bps)
+            min = r;
+        if (min == i)
+            return;
+
+        struct vrmr_conntrack_entry *tmp = heap[i];
+        heap[i] = heap[min];
+        heap[min] = tmp;
+        i = min;
+    }
+}
+
+/*  vrmr_conn_table_top_rate
+
+    Fills 'top' with the 'n' entries of the list with the highest bps,
+    fastest first. Uses a bounded heap, so the list is not sorted.
+
+    Returns the number of entries in 'top'.
+*/
+unsigned int vrmr_conn_table_top_rate(const struct vrmr_conntrack_table *table,
+        struct vrmr_conntrack_entry **top, unsigned int n)
+{
+    unsigned int len = 0;
+
+    assert(table && top);
+
+    for (unsigned int i = 0; i < table->list.len && n > 0; i++) {
+        struct vrmr_conntrack_entry *ce = table->list.data[i];
+
+        if (len < n) {
+            /* sift up */
+            unsigned int c = len++;
+            top[c] = ce;
+            while (c > 0 && top[(c - 1) / 2]->bps > top[c]->bps) {
+                struct vrmr_conntrack_entry *tmp = top[c];
+                top[c] = top[(c - 1) / 2];
+                top[(c - 1) / 2] = tmp;
+                c = (c - 1) / 2;
+            }
+        } else if (ce->bps > top[0]->bps) {
+            top[0] = ce;
+            conn_top_sift_down(top, len, 0);
+        }
+    }
+
+    /* heap sort: moving the slowest to the back gives fastest first */
+    for (unsigned int end = len; end > 1; end--) {
+        struct vrmr_conntrack_entry *tmp = top[0];
+        top[0] = top[end - 1];
+        top[end - 1] = tmp;
+        conn_top_sift_down(top, end - 1, 0);
+    }
+    return (len);
+}
@@ -0,0 +1,1015 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2019 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+    Control socket of the daemons
+
+    Vuurmuur and Vuurmuur_log listen on a unix stream socket. The config
+    tools connect to it to request reloads, follow their progress and query
+    the state of the daemon. The protocol is line based text, a client sends:
+
+        hello <user> <name>     introduce the client, answered with 'ok'.
+                                The user the daemon logs is the owner of
+                                the connecting process, <user> is ignored
+        reload                  request a reload, answered with 'reload <id>'
+                                followed by its progress and result
+        subscribe               get the progress and result of all reloads
+        status                  'info <key> <value>' lines, then 'end'
+        ping                    answered with 'pong'
+
+    Other commands go to the command handler of the daemon, they are
+    answered with 'ok' or 'error <message>'. Vuurmuur has:
+
+        block <item>            block an ipaddress, host or group right away
+        unblock <item>          undo a 'block'
+
+    and the daemon sends, besides the answers:
+
+        progress <id> <percent> <ms> <phase>
+        done <id> <success|nochanges|error> <ms> [error message]
+        error <message>
+
+    where <ms> is the time since the start of the reload. Reload requests
+    that come in while a reload is pending join it, so a burst of requests
+    from several clients leads to a single reload. The daemon waits
+    'debounce_ms' after the first request before it starts the reload, so
+    requests that come in right after each other are joined as well. A
+    client that sees 'done' for the id it got with 'reload' knows its
+    change is applied.
+*/
+
+#include "config.h"
+#include "vuurmuur.h"
+
+#include <poll.h>
+#include <pwd.h>
+#include <stdarg.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+static uint64_t control_ms_since(const struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)(now.tv_sec - start->tv_sec) * 1000 +
+            (uint64_t)((now.tv_nsec - start->tv_nsec) / 1000000));
+}
+
+static const char *control_result_str(int result)
+{
+    if (result == VRMR_RR_SUCCES)
+        return ("success");
+    else if (result == VRMR_RR_NOCHANGES)
+        return ("nochanges");
+    return ("error");
+}
+
+static int control_result_parse(const char *str)
+{
+    if (strcmp(str, "success") == 0)
+        return (VRMR_RR_SUCCES);
+    else if (strcmp(str, "nochanges") == 0)
+        return (VRMR_RR_NOCHANGES);
+    return (VRMR_RR_ERROR);
+}
+
+static int control_addr(const char *path, struct sockaddr_un *addr)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlcpy(addr->sun_path, path, sizeof(addr->sun_path)) >=
+            sizeof(addr->sun_path)) {
+        vrmr_error(-1, "Error", "control socket path '%s' too long", path);
+        return (-1);
+    }
+    return (0);
+}
+
+/*
+    server
+*/
+
+/* the errors are recorded while a reload is running, see
+ * vrmr_control_reload_start() */
+static struct vrmr_control *capture_ctl = NULL;
+static int (*capture_next)(int, const char *, char *, ...) = NULL;
+
+static int control_capture_error(
+        int errorcode, const char *head, char *fmt, ...)
+{
+    char msg[8192];
+    va_list ap;
+
+    va_start(ap, fmt);
+    vsnprintf(msg, sizeof(msg), fmt, ap);
+    va_end(ap);
+
+    /* the first error is the cause, the ones after it tend to follow from
+     * it */
+    if (capture_ctl != NULL && capture_ctl->reload_error[0] == '\0') {
+        (void)strlcpy(capture_ctl->reload_error, msg,
+                sizeof(capture_ctl->reload_error));
+    }
+    return (capture_next(errorcode, head, "%s", msg));
+}
+
+static void control_conn_close(
+        struct vrmr_control *ctl, struct vrmr_control_conn *conn)
+{
+    if (conn->name[0] != '\0')
+        vrmr_info("Info", "Configtool disconnected: %s.", conn->name);
+
+    (void)epoll_ctl(ctl->epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    memset(conn, 0, sizeof(*conn));
+    conn->fd = -1;
+}
+
+/* a client that doesn't keep up with the events is dropped, we never block
+ * on them */
+static void control_conn_send(struct vrmr_control *ctl,
+        struct vrmr_control_conn *conn, const char *fmt, ...)
+        ATTR_FMT_PRINTF(3, 4);
+static void control_conn_send(struct vrmr_control *ctl,
+        struct vrmr_control_conn *conn, const char *fmt, ...)
+{
+    char line[512];
+    va_list ap;
+
+    if (conn->fd < 0)
+        return;
+
+    va_start(ap, fmt);
+    int len = vsnprintf(line, sizeof(line) - 1, fmt, ap);
+    va_end(ap);
+    if (len < 0)
+        return;
+    if (len > (int)sizeof(line) - 2)
+        len = (int)sizeof(line) - 2;
+    line[len++] = '\n';
+
+    if (send(conn->fd, line, (size_t)len, MSG_NOSIGNAL | MSG_DONTWAIT) !=
+            (ssize_t)len) {
+        vrmr_debug(LOW, "dropping control client %d", conn->fd);
+        control_conn_close(ctl, conn);
+    }
+}
+
+static void control_status(
+        struct vrmr_control *ctl, struct vrmr_control_conn *conn)
+{
+    unsigned int clients = 0;
+
+    for (int i = 0; i < VRMR_CONTROL_MAX_CLIENTS; i++) {
+        if (ctl->conns[i].fd >= 0)
+            clients++;
+    }
+
+    control_conn_send(ctl, conn, "info pid %ld", (long)getpid());
+    control_conn_send(ctl, conn, "info version %s", VUURMUUR_VERSION);
+    control_conn_send(ctl, conn, "info clients %u", clients);
+    control_conn_send(ctl, conn, "info reloads %u", ctl->reloads);
+    control_conn_send(ctl, conn, "info reload_requests %u", ctl->requests);
+    control_conn_send(
+            ctl, conn, "info reloads_failed %u", ctl->reloads_failed);
+    control_conn_send(ctl, conn, "info reload_pending %u", ctl->pending_id);
+    control_conn_send(ctl, conn, "info reload_running %u", ctl->running_id);
+    if (ctl->reloads > 0) {
+        control_conn_send(ctl, conn, "info last_result %s",
+                control_result_str(ctl->last_result));
+        control_conn_send(ctl, conn, "info last_duration_ms %" PRIu64,
+                ctl->last_duration_ms);
+        control_conn_send(ctl, conn, "info last_reload_time %ld",
+                (long)ctl->last_time);
+        control_conn_send(
+                ctl, conn, "info last_reload_reasons %s", ctl->reasons);
+    }
+    if (ctl->last_error[0] != '\0')
+        control_conn_send(ctl, conn, "info last_error %s", ctl->last_error);
+    for (unsigned int i = 0; i < ctl->info_len; i++) {
+        control_conn_send(ctl, conn, "info %s %s", ctl->info[i].key,
+                ctl->info[i].value);
+    }
+    control_conn_send(ctl, conn, "end");
+}
+
+static void control_command(
+        struct vrmr_control *ctl, struct vrmr_control_conn *conn, char *line)
+{
+    char *args = strchr(line, ' ');
+    if (args != NULL)
+        *args++ = '\0';
+    else
+        args = line + strlen(line);
+
+    if (strcmp(line, "hello") == 0) {
+        char *name = strchr(args, ' ');
+        if (name != NULL)
+            *name++ = '\0';
+        else
+            name = args;
+
+        /* the user comes from the socket credentials, not the client */
+        if (strcmp(args, conn->user) != 0)
+            vrmr_debug(LOW, "control client %d: says it is '%s', but is '%s'",
+                    conn->fd, args, conn->user);
+        (void)strlcpy(conn->name, name, sizeof(conn->name));
+        vrmr_info("Info", "Configtool connected: %s (user: %s).", conn->name,
+                conn->user);
+        control_conn_send(ctl, conn, "ok");
+    } else if (strcmp(line, "reload") == 0) {
+        vrmr_audit("IPC: reload requested (user: %s).", conn->user);
+
+        conn->waiting =
+                vrmr_control_reload_request(ctl, VRMR_RQ_USER, conn->user);
+        control_conn_send(ctl, conn, "reload %u", conn->waiting);
+    } else if (strcmp(line, "subscribe") == 0) {
+        conn->subscribed = true;
+        control_conn_send(ctl, conn, "ok");
+    } else if (strcmp(line, "status") == 0) {
+        control_status(ctl, conn);
+    } else if (strcmp(line, "ping") == 0) {
+        control_conn_send(ctl, conn, "pong");
+    } else {
+        char err[256] = "";
+        int r = 0;
+
+        if (ctl->command != NULL)
+            r = ctl->command(ctl->command_ctx, conn->user, line, args, err,
+                    sizeof(err));
+        if (r == 0)
+            control_conn_send(ctl, conn, "error unknown command '%s'", line);
+        else if (r < 0)
+            control_conn_send(ctl, conn, "error %s",
+                    err[0] ? err : "command failed");
+        else
+            control_conn_send(ctl, conn, "ok");
+    }
+}
+
+static void control_conn_read(
+        struct vrmr_control *ctl, struct vrmr_control_conn *conn)
+{
+    while (conn->fd >= 0) {
+        ssize_t r = recv(conn->fd, conn->in + conn->in_len,
+                sizeof(conn->in) - conn->in_len - 1, MSG_DONTWAIT);
+        if (r == 0 || (r < 0 && errno != EAGAIN && errno != EINTR)) {
+            control_conn_close(ctl, conn);
+            return;
+        }
+        if (r < 0)
+            return;
+        conn->in_len += (size_t)r;
+        conn->in[conn->in_len] = '\0';
+
+        char *line = conn->in, *nl;
+        while (conn->fd >= 0 && (nl = strchr(line, '\n')) != NULL) {
+            *nl = '\0';
+            if (nl > line && nl[-1] == '\r')
+                nl[-1] = '\0';
+            control_command(ctl, conn, line);
+            line = nl + 1;
+        }
+        if (conn->fd < 0)
+            return;
+
+        conn->in_len -= (size_t)(line - conn->in);
+        memmove(conn->in, line, conn->in_len);
+        if (conn->in_len == sizeof(conn->in) - 1) {
+            vrmr_debug(LOW, "control client %d: line too long", conn->fd);
+            control_conn_close(ctl, conn);
+            return;
+        }
+    }
+}
+
+/*  control_peer_user
+
+    Looks up the owner of the process on the other end of 'fd' from the
+    socket credentials, so the audit log doesn't depend on what the client
+    claims to be.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int control_peer_user(int fd, char *user, size_t size)
+{
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    struct passwd pwd, *result = NULL;
+    char buf[1024];
+
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0) {
+        vrmr_error(-1, "Error", "getting control client credentials failed: %s",
+                strerror(errno));
+        return (-1);
+    }
+
+    if (getpwuid_r(cred.uid, &pwd, buf, sizeof(buf), &result) == 0 &&
+            result != NULL)
+        (void)strlcpy(user, pwd.pw_name, size);
+    else
+        (void)snprintf(user, size, "uid %u", (unsigned int)cred.uid);
+
+    vrmr_debug(LOW, "control client %d: pid %d, uid %u (%s)", fd,
+            (int)cred.pid, (unsigned int)cred.uid, user);
+    return (0);
+}
+
+static void control_accept(struct vrmr_control *ctl)
+{
+    int fd;
+
+    while ((fd = accept4(ctl->fd, NULL, NULL,
+                    SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        struct vrmr_control_conn *conn = NULL;
+        for (int i = 0; i < VRMR_CONTROL_MAX_CLIENTS; i++) {
+            if (ctl->conns[i].fd < 0) {
+                conn = &ctl->conns[i];
+                break;
+            }
+        }
+        if (conn == NULL) {
+            vrmr_warning("Warning", "too many control clients, max %d.",
+                    VRMR_CONTROL_MAX_CLIENTS);
+            close(fd);
+            continue;
+        }
+
+        char user[sizeof(conn->user)];
+        if (control_peer_user(fd, user, sizeof(user)) < 0) {
+            close(fd);
+            continue;
+        }
+
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.ptr = conn;
+        if (epoll_ctl(ctl->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            vrmr_error(-1, "Error", "epoll_ctl failed: %s", strerror(errno));
+            close(fd);
+            continue;
+        }
+        memset(conn, 0, sizeof(*conn));
+        conn->fd = fd;
+        (void)strlcpy(conn->user, user, sizeof(conn->user));
+    }
+}
+
+/*  vrmr_control_listen
+
+    Creates the control socket at 'path'. A stale socket of a daemon that
+    is no longer running is replaced.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_control_listen(struct vrmr_control *ctl, const char *path)
+{
+    struct sockaddr_un addr;
+    struct epoll_event ev;
+
+    assert(ctl && path);
+
+    memset(ctl, 0, sizeof(*ctl));
+    ctl->fd = ctl->epfd = -1;
+    for (int i = 0; i < VRMR_CONTROL_MAX_CLIENTS; i++)
+        ctl->conns[i].fd = -1;
+
+    if (control_addr(path, &addr) < 0)
+        return (-1);
+    (void)strlcpy(ctl->path, path, sizeof(ctl->path));
+
+    ctl->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (ctl->fd < 0) {
+        vrmr_error(-1, "Error", "creating control socket failed: %s",
+                strerror(errno));
+        return (-1);
+    }
+
+    /* only replace the socket if nobody is listening on it */
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe >= 0) {
+        if (connect(probe, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+            vrmr_error(-1, "Error", "control socket '%s' is in use", path);
+            close(probe);
+            vrmr_control_close(ctl);
+            return (-1);
+        }
+        close(probe);
+    }
+    (void)unlink(path);
+
+    /* reloading is for root only. Create the socket with the right mode
+     * so there is no window in which others can connect to it. */
+    mode_t old_umask = umask(077);
+    int r = bind(ctl->fd, (struct sockaddr *)&addr, sizeof(addr));
+    int bind_errno = errno;
+    (void)umask(old_umask);
+    if (r < 0) {
+        vrmr_error(-1, "Error", "binding control socket '%s' failed: %s", path,
+                strerror(bind_errno));
+        ctl->path[0] = '\0';
+        vrmr_control_close(ctl);
+        return (-1);
+    }
+    if (chmod(path, 0600) < 0 || listen(ctl->fd, 16) < 0) {
+        vrmr_error(-1, "Error", "setting up control socket '%s' failed: %s",
+                path, strerror(errno));
+        vrmr_control_close(ctl);
+        return (-1);
+    }
+
+    ctl->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (ctl->epfd < 0) {
+        vrmr_error(-1, "Error", "epoll_create1 failed: %s", strerror(errno));
+        vrmr_control_close(ctl);
+        return (-1);
+    }
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    if (epoll_ctl(ctl->epfd, EPOLL_CTL_ADD, ctl->fd, &ev) < 0) {
+        vrmr_error(-1, "Error", "epoll_ctl failed: %s", strerror(errno));
+        vrmr_control_close(ctl);
+        return (-1);
+    }
+
+    vrmr_debug(LOW, "listening on control socket '%s'", path);
+    return (0);
+}
+
+/*  vrmr_control_close
+
+    Disconnects the clients and removes the control socket.
+*/
+void vrmr_control_close(struct vrmr_control *ctl)
+{
+    assert(ctl);
+
+    for (int i = 0; i < VRMR_CONTROL_MAX_CLIENTS; i++) {
+        if (ctl->conns[i].fd >= 0 && ctl->epfd >= 0)
+            control_conn_close(ctl, &ctl->conns[i]);
+    }
+    if (ctl->fd >= 0) {
+        close(ctl->fd);
+        ctl->fd = -1;
+        if (ctl->path[0] != '\0')
+            (void)unlink(ctl->path);
+    }
+    if (ctl->epfd >= 0) {
+        close(ctl->epfd);
+        ctl->epfd = -1;
+    }
+    if (capture_ctl == ctl) {
+        vrprint.error = capture_next;
+        capture_ctl = NULL;
+    }
+}
+
+/*  vrmr_control_fd
+
+    The fd to wait on: it becomes readable when vrmr_control_handle() has
+    work to do.
+*/
+int vrmr_control_fd(const struct vrmr_control *ctl)
+{
+    return (ctl->epfd);
+}
+
+/*  vrmr_control_handle
+
+    Accepts new clients and handles their commands. Never blocks.
+*/
+void vrmr_control_handle(struct vrmr_control *ctl)
+{
+    struct epoll_event events[VRMR_CONTROL_MAX_CLIENTS + 1];
+    int n;
+
+    if (ctl->epfd < 0)
+        return;
+
+    while ((n = epoll_wait(ctl->epfd, events,
+                    VRMR_CONTROL_MAX_CLIENTS + 1, 0)) > 0) {
+        for (int i = 0; i < n; i++) {
+            struct vrmr_control_conn *conn = events[i].data.ptr;
+
+            if (conn == NULL)
+                control_accept(ctl);
+            else if (conn->fd >= 0)
+                control_conn_read(ctl, conn);
+        }
+    }
+}
+
+/* add 'reason' to the comma separated 'reasons', once */
+static void control_add_reason(char *reasons, size_t size, const char *reason)
+{
+    size_t len = strlen(reason);
+
+    for (const char *s = reasons; (s = strstr(s, reason)) != NULL; s += len) {
+        if ((s == reasons || s[-1] == ' ') && (s[len] == ',' || !s[len]))
+            return;
+    }
+
+    if (reasons[0] != '\0')
+        (void)strlcat(reasons, ", ", size);
+    if (strlcat(reasons, reason, size) >= size)
+        (void)strlcpy(reasons + size - 4, "...", 4);
+}
+
+/*  vrmr_control_reload_request
+
+    Requests a reload because of 'request', one of VRMR_RQ_*. 'reason' is
+    what is logged and shown in the status, e.g. a user or 'SIGHUP'. The
+    request joins the pending reload if there is one, or starts a new
+    one that is due after the debounce time.
+
+    Returns the id of the reload that will apply the change.
+*/
+unsigned int vrmr_control_reload_request(
+        struct vrmr_control *ctl, unsigned int request, const char *reason)
+{
+    assert(ctl && reason);
+
+    if (ctl->pending_id == 0) {
+        ctl->pending_id = ++ctl->last_id;
+        ctl->pending_requests = 0;
+        ctl->pending_reasons[0] = '\0';
+        clock_gettime(CLOCK_MONOTONIC, &ctl->pending_start);
+    }
+    ctl->requests++;
+    ctl->pending_requests |= request;
+    control_add_reason(
+            ctl->pending_reasons, sizeof(ctl->pending_reasons), reason);
+
+    vrmr_debug(LOW, "reload %u requested: %s", ctl->pending_id, reason);
+    return (ctl->pending_id);
+}
+
+/*  vrmr_control_reload_timeout
+
+    Returns the time in ms until the pending reload is due, 0 if it is due
+    now or -1 if no reload is pending. Meant as timeout for epoll_wait().
+*/
+int vrmr_control_reload_timeout(const struct vrmr_control *ctl)
+{
+    if (ctl->pending_id == 0)
+        return (-1);
+
+    uint64_t ms = control_ms_since(&ctl->pending_start);
+    if (ms >= ctl->debounce_ms)
+        return (0);
+    return ((int)(ctl->debounce_ms - ms));
+}
+
+/*  vrmr_control_reload_pending
+
+    Returns true if a reload was requested and is due: the debounce time
+    since the first request passed.
+*/
+bool vrmr_control_reload_pending(const struct vrmr_control *ctl)
+{
+    return (vrmr_control_reload_timeout(ctl) == 0);
+}
+
+/* send a reload event to the clients that wait for the reload or follow
+ * all of them */
+static void control_reload_event(struct vrmr_control *ctl, const char *line)
+{
+    for (int i = 0; i < VRMR_CONTROL_MAX_CLIENTS; i++) {
+        struct vrmr_control_conn *conn = &ctl->conns[i];
+
+        if (conn->fd >= 0 &&
+                (conn->subscribed || conn->waiting == ctl->running_id))
+            control_conn_send(ctl, conn, "%s", line);
+    }
+}
+
+/*  vrmr_control_reload_start
+
+    Starts the pending reload, or a new one if none was requested so
+    subscribers see those too. Until
+    vrmr_control_reload_done() the errors that are printed are recorded.
+
+    Returns the id of the reload.
+*/
+unsigned int vrmr_control_reload_start(struct vrmr_control *ctl)
+{
+    char line[64];
+
+    if (ctl->pending_id != 0) {
+        ctl->running_id = ctl->pending_id;
+        ctl->reload_requests = ctl->pending_requests;
+        (void)strlcpy(ctl->reasons, ctl->pending_reasons, sizeof(ctl->reasons));
+    } else {
+        ctl->running_id = ++ctl->last_id;
+        ctl->reload_requests = 0;
+        (void)strlcpy(ctl->reasons, "unknown", sizeof(ctl->reasons));
+    }
+    ctl->pending_id = 0;
+    vrmr_debug(LOW, "reload %u: %s", ctl->running_id, ctl->reasons);
+    ctl->reload_error[0] = '\0';
+    ctl->phase_mark_ms = 0;
+    ctl->phases_len = 0;
+    clock_gettime(CLOCK_MONOTONIC, &ctl->start);
+
+    if (capture_ctl == NULL && vrprint.error != NULL) {
+        capture_next = vrprint.error;
+        capture_ctl = ctl;
+        vrprint.error = control_capture_error;
+    }
+
+    snprintf(line, sizeof(line), "progress %u 0 0 start", ctl->running_id);
+    control_reload_event(ctl, line);
+    return (ctl->running_id);
+}
+
+/*  vrmr_control_progress
+
+    Tells the clients the reload finished 'phase' and is 'percent' done.
+    The time since the previous phase is kept as the duration of 'phase'
+    for the metrics. Does nothing if no reload was started.
+*/
+void vrmr_control_progress(
+        struct vrmr_control *ctl, int percent, const char *phase)
+{
+    char line[128];
+
+    if (ctl->running_id == 0)
+        return;
+
+    uint64_t ms = control_ms_since(&ctl->start);
+    vrmr_debug(HIGH, "reload %u: %d%% %s (%" PRIu64 "ms)", ctl->running_id,
+            percent, phase, ms);
+
+    if (ctl->phases_len < VRMR_CONTROL_MAX_PHASES) {
+        unsigned int i = ctl->phases_len++;
+        (void)strlcpy(ctl->phases[i].name, phase, sizeof(ctl->phases[i].name));
+        ctl->phases[i].ms = ms - ctl->phase_mark_ms;
+    }
+    ctl->phase_mark_ms = ms;
+
+    snprintf(line, sizeof(line), "progress %u %d %" PRIu64 " %s",
+            ctl->running_id, percent, ms, phase);
+    control_reload_event(ctl, line);
+}
+
+/*  vrmr_control_reload_done
+
+    Finishes the running reload with 'result', a VRMR_RR_* code, and tells
+    the clients.
+*/
+void vrmr_control_reload_done(struct vrmr_control *ctl, int result)
+{
+    char line[384];
+
+    if (ctl->running_id == 0)
+        return;
+
+    if (capture_ctl == ctl) {
+        vrprint.error = capture_next;
+        capture_ctl = NULL;
+    }
+
+    ctl->last_duration_ms = control_ms_since(&ctl->start);
+    ctl->last_result = result;
+    ctl->last_time = time(NULL);
+    ctl->reloads++;
+    if (result == VRMR_RR_ERROR) {
+        ctl->reloads_failed++;
+        (void)strlcpy(ctl->last_error,
+                ctl->reload_error[0] ? ctl->reload_error : "unknown error",
+                sizeof(ctl->last_error));
+    }
+
+    snprintf(line, sizeof(line), "done %u %s %" PRIu64 "%s%s", ctl->running_id,
+            control_result_str(result), ctl->last_duration_ms,
+            result == VRMR_RR_ERROR ? " " : "",
+            result == VRMR_RR_ERROR ? ctl->last_error : "");
+    control_reload_event(ctl, line);
+
+    for (int i = 0; i < VRMR_CONTROL_MAX_CLIENTS; i++) {
+        if (ctl->conns[i].waiting == ctl->running_id)
+            ctl->conns[i].waiting = 0;
+    }
+    ctl->running_id = 0;
+}
+
+/*  vrmr_control_set_info
+
+    Sets 'key' for the 'status' command, e.g. the number of rules.
+*/
+void vrmr_control_set_info(
+        struct vrmr_control *ctl, const char *key, const char *fmt, ...)
+{
+    va_list ap;
+    unsigned int i;
+
+    for (i = 0; i < ctl->info_len; i++) {
+        if (strcmp(ctl->info[i].key, key) == 0)
+            break;
+    }
+    if (i == ctl->info_len) {
+        if (ctl->info_len == VRMR_CONTROL_MAX_INFO) {
+            vrmr_debug(LOW, "no room for control info '%s'", key);
+            return;
+        }
+        ctl->info_len++;
+        (void)strlcpy(ctl->info[i].key, key, sizeof(ctl->info[i].key));
+    }
+
+    va_start(ap, fmt);
+    vsnprintf(ctl->info[i].value, sizeof(ctl->info[i].value), fmt, ap);
+    va_end(ap);
+}
+
+/*
+    client
+*/
+
+/*  vrmr_control_connect
+
+    Connects to the control socket at 'path' and introduces the client as
+    'name', run by 'user'.
+
+    Returncodes:
+         0: ok
+        -1: error, e.g. the daemon isn't running
+*/
+int vrmr_control_connect(struct vrmr_control_client *client, const char *path,
+        const char *user, const char *name)
+{
+    struct sockaddr_un addr;
+    struct vrmr_control_event ev;
+    char line[256];
+
+    assert(client && path && user && name);
+
+    memset(client, 0, sizeof(*client));
+    client->fd = -1;
+
+    if (control_addr(path, &addr) < 0)
+        return (-1);
+
+    client->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (client->fd < 0) {
+        vrmr_error(-1, "Error", "creating socket failed: %s", strerror(errno));
+        return (-1);
+    }
+    if (connect(client->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        vrmr_debug(LOW, "connecting to '%s' failed: %s", path, strerror(errno));
+        vrmr_control_disconnect(client);
+        return (-1);
+    }
+
+    /* the user has no spaces, the name may have them */
+    snprintf(line, sizeof(line), "hello %s %s", user[0] ? user : "unknown",
+            name);
+    if (vrmr_control_send(client, line) < 0 ||
+            vrmr_control_read(client, &ev, 5000) != 1 ||
+            ev.type != VRMR_CONTROL_EV_OK) {
+        vrmr_debug(LOW, "no answer from '%s'", path);
+        vrmr_control_disconnect(client);
+        return (-1);
+    }
+    return (0);
+}
+
+/*  vrmr_control_disconnect
+
+    Closes the connection. Safe to call when not connected.
+*/
+void vrmr_control_disconnect(struct vrmr_control_client *client)
+{
+    if (client->fd >= 0)
+        close(client->fd);
+    client->fd = -1;
+    client->in_len = 0;
+}
+
+/*  vrmr_control_send
+
+    Sends command 'cmd', without the newline.
+
+    Returncodes:
+         0: ok
+        -1: error, the connection is closed
+*/
+int vrmr_control_send(struct vrmr_control_client *client, const char *cmd)
+{
+    char line[512];
+
+    if (client->fd < 0 || strchr(cmd, '\n') != NULL)
+        return (-1);
+
+    int len = snprintf(line, sizeof(line), "%s\n", cmd);
+    if (len < 0 || len >= (int)sizeof(line))
+        return (-1);
+    if (send(client->fd, line, (size_t)len, MSG_NOSIGNAL) != (ssize_t)len) {
+        vrmr_debug(LOW, "send failed: %s", strerror(errno));
+        vrmr_control_disconnect(client);
+        return (-1);
+    }
+    return (0);
+}
+
+/* parse 'line' into 'ev'. Returns false for lines we don't know. */
+static bool control_parse_event(char *line, struct vrmr_control_event *ev)
+{
+    char word[16] = "", arg[16] = "";
+    int n = 0;
+
+    memset(ev, 0, sizeof(*ev));
+
+    if (strcmp(line, "ok") == 0) {
+        ev->type = VRMR_CONTROL_EV_OK;
+    } else if (strcmp(line, "pong") == 0) {
+        ev->type = VRMR_CONTROL_EV_PONG;
+    } else if (strcmp(line, "end") == 0) {
+        ev->type = VRMR_CONTROL_EV_END;
+    } else if (strncmp(line, "error ", 6) == 0) {
+        ev->type = VRMR_CONTROL_EV_ERROR;
+        (void)strlcpy(ev->text, line + 6, sizeof(ev->text));
+    } else if (sscanf(line, "reload %u", &ev->id) == 1) {
+        ev->type = VRMR_CONTROL_EV_RELOAD;
+    } else if (sscanf(line, "progress %u %d %" SCNu64 " %n", &ev->id,
+                       &ev->progress, &ev->ms, &n) == 3 &&
+               n > 0) {
+        ev->type = VRMR_CONTROL_EV_PROGRESS;
+        (void)strlcpy(ev->text, line + n, sizeof(ev->text));
+    } else if (sscanf(line, "done %u %15s %" SCNu64 "%n", &ev->id, arg,
+                       &ev->ms, &n) == 3 &&
+               n > 0) {
+        ev->type = VRMR_CONTROL_EV_DONE;
+        ev->result = control_result_parse(arg);
+        ev->progress = 100;
+        if (line[n] == ' ')
+            (void)strlcpy(ev->text, line + n + 1, sizeof(ev->text));
+    } else if (sscanf(line, "info %31s %n", ev->key, &n) == 1 && n > 0) {
+        ev->type = VRMR_CONTROL_EV_INFO;
+        (void)strlcpy(ev->text, line + n, sizeof(ev->text));
+    } else {
+        (void)sscanf(line, "%15s", word);
+        vrmr_debug(LOW, "unknown control event '%s'", word);
+        return (false);
+    }
+    return (true);
+}
+
+/*  vrmr_control_read
+
+    Waits max 'timeout' ms (-1: forever) for the next event from the
+    daemon.
+
+    Returncodes:
+         1: got an event
+         0: timed out
+        -1: error, the connection is closed
+*/
+int vrmr_control_read(struct vrmr_control_client *client,
+        struct vrmr_control_event *ev, int timeout)
+{
+    struct timespec start;
+
+    if (client->fd < 0)
+        return (-1);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (1) {
+        char *nl = memchr(client->in, '\n', client->in_len);
+        if (nl != NULL) {
+            *nl = '\0';
+            bool known = control_parse_event(client->in, ev);
+            client->in_len -= (size_t)(nl + 1 - client->in);
+            memmove(client->in, nl + 1, client->in_len);
+            if (known)
+                return (1);
+            continue;
+        }
+        if (client->in_len == sizeof(client->in)) {
+            vrmr_debug(LOW, "control line too long");
+            vrmr_control_disconnect(client);
+            return (-1);
+        }
+
+        int wait = -1;
+        if (timeout >= 0) {
+            uint64_t waited = control_ms_since(&start);
+            if (waited >= (uint64_t)timeout)
+                return (0);
+            wait = timeout - (int)waited;
+        }
+
+        struct pollfd pfd = {.fd = client->fd, .events = POLLIN};
+        int r = poll(&pfd, 1, wait);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r < 0) {
+            vrmr_control_disconnect(client);
+            return (-1);
+        }
+        if (r == 0)
+            return (0);
+
+        ssize_t len = recv(client->fd, client->in + client->in_len,
+                sizeof(client->in) - client->in_len, 0);
+        if (len <= 0) {
+            if (len < 0 && errno == EINTR)
+                continue;
+            vrmr_control_disconnect(client);
+            return (-1);
+        }
+        client->in_len += (size_t)len;
+    }
+}
+
+/*  vrmr_control_ping
+
+    Checks if the daemon still answers.
+
+    Returncodes:
+         0: ok
+        -1: error, the connection is closed
+*/
+int vrmr_control_ping(struct vrmr_control_client *client)
+{
+    struct vrmr_control_event ev;
+
+    if (vrmr_control_send(client, "ping") < 0)
+        return (-1);
+
+    /* skip the events of reloads we are following */
+    while (1) {
+        int r = vrmr_control_read(client, &ev, 5000);
+        if (r != 1) {
+            vrmr_control_disconnect(client);
+            return (-1);
+        }
+        if (ev.type == VRMR_CONTROL_EV_PONG)
+            return (0);
+    }
+}
+
+/*  vrmr_control_command
+
+    Sends 'cmd', e.g. 'block 1.2.3.4', and waits max 'timeout' ms for the
+    answer. If the daemon refuses, its message goes into 'err'.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_control_command(struct vrmr_control_client *client, const char *cmd,
+        int timeout, char *err, size_t size)
+{
+    struct vrmr_control_event ev;
+
+    assert(client && cmd && err);
+
+    if (vrmr_control_send(client, cmd) < 0) {
+        (void)strlcpy(err, "sending the command failed", size);
+        return (-1);
+    }
+
+    /* skip the events of reloads we are following */
+    while (1) {
+        int r = vrmr_control_read(client, &ev, timeout);
+        if (r == 0) {
+            (void)strlcpy(err, "timed out", size);
+            return (-1);
+        } else if (r < 0) {
+            (void)strlcpy(err, "connection lost", size);
+            return (-1);
+        }
+        if (ev.type == VRMR_CONTROL_EV_OK)
+            return (0);
+        if (ev.type == VRMR_CONTROL_EV_ERROR) {
+            (void)strlcpy(err, ev.text, size);
+            return (-1);
+        }
+    }
+}
@@ -0,0 +1,452 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2019 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "config.h"
+#include "vuurmuur.h"
+
+#include <libmnl/libmnl.h>
+#include <linux/if.h>
+#include <linux/if_link.h>
+#include <linux/rtnetlink.h>
+
+/*
+    Interface counter provider.
+
+    Link counters come from a single RTM_GETLINK dump, the iptables counters
+    of the interface accounting rules (see pre_rules_interface_counters_ipv4)
+    from a single listing of the filter table. Both are cached per second,
+    so callers can ask for them per interface without forking or re-reading
+    anything.
+*/
+
+static struct vrmr_counters_iface *counters_get_or_add(
+        struct vrmr_counters *counters, const char *device)
+{
+    struct vrmr_counters_iface *entry = vrmr_counters_get(counters, device);
+    if (entry != NULL)
+        return (entry);
+
+    if (!(entry = calloc(1, sizeof(*entry)))) {
+        vrmr_error(-1, "Error", "calloc failed: %s", strerror(errno));
+        return (NULL);
+    }
+    strlcpy(entry->device, device, sizeof(entry->device));
+
+    if (vrmr_vector_append(&counters->list, entry) < 0) {
+        free(entry);
+        return (NULL);
+    }
+
+    struct vrmr_map_key key;
+    vrmr_map_key_string(&key, entry->device);
+    if (vrmr_map_insert(&counters->index, &key, entry) < 0) {
+        /* the vector owns the entry */
+        return (NULL);
+    }
+    return (entry);
+}
+
+void vrmr_counters_setup(struct vrmr_counters *counters)
+{
+    assert(counters);
+
+    memset(counters, 0, sizeof(*counters));
+    vrmr_vector_setup(&counters->list, free);
+    (void)vrmr_map_setup(&counters->index, VRMR_MAP_KEY_STRING, 0);
+}
+
+void vrmr_counters_cleanup(struct vrmr_counters *counters)
+{
+    assert(counters);
+
+    vrmr_map_cleanup(&counters->index);
+    vrmr_vector_cleanup(&counters->list);
+    counters->link_tick = 0;
+    counters->ipt_tick = 0;
+}
+
+/*  vrmr_counters_get
+
+    Returns the counters for 'device' or NULL if the device was not seen in
+    any of the updates.
+*/
+struct vrmr_counters_iface *vrmr_counters_get(
+        struct vrmr_counters *counters, const char *device)
+{
+    struct vrmr_map_key key;
+
+    assert(counters && device);
+
+    vrmr_map_key_string(&key, device);
+    return (vrmr_map_search(&counters->index, &key));
+}
+
+/*
+    rtnetlink
+*/
+
+struct link_cb_ctx {
+    const char *name;
+    const struct rtnl_link_stats64 *stats64;
+    const struct rtnl_link_stats *stats;
+};
+
+static int link_attr_cb(const struct nlattr *attr, void *data)
+{
+    struct link_cb_ctx *ctx = data;
+
+    switch (mnl_attr_get_type(attr)) {
+        case IFLA_IFNAME:
+            if (mnl_attr_validate(attr, MNL_TYPE_STRING) == 0)
+                ctx->name = mnl_attr_get_str(attr);
+            break;
+        case IFLA_STATS64:
+            if (mnl_attr_get_payload_len(attr) >=
+                    sizeof(struct rtnl_link_stats64))
+                ctx->stats64 = mnl_attr_get_payload(attr);
+            break;
+        case IFLA_STATS:
+            if (mnl_attr_get_payload_len(attr) >=
+                    sizeof(struct rtnl_link_stats))
+                ctx->stats = mnl_attr_get_payload(attr);
+            break;
+    }
+    return (MNL_CB_OK);
+}
+
+struct link_req_ctx {
+    struct vrmr_counters *counters;     /* dump: entries are added here */
+    struct vrmr_counters_iface *single; /* single request: filled here */
+    int found;
+};
+
+/* fill the entry for the link in a RTM_NEWLINK message */
+static int link_data_cb(const struct nlmsghdr *nlh, void *data)
+{
+    struct link_req_ctx *req = data;
+    const struct ifinfomsg *ifm = mnl_nlmsg_get_payload(nlh);
+    struct link_cb_ctx ctx = {NULL, NULL, NULL};
+    struct vrmr_counters_iface *entry = req->single;
+
+    if (nlh->nlmsg_type != RTM_NEWLINK)
+        return (MNL_CB_OK);
+
+    if (mnl_attr_parse(nlh, sizeof(*ifm), link_attr_cb, &ctx) != MNL_CB_OK ||
+            ctx.name == NULL)
+        return (MNL_CB_OK);
+
+    if (entry == NULL) {
+        if (!(entry = counters_get_or_add(req->counters, ctx.name)))
+            return (MNL_CB_ERROR);
+    } else {
+        strlcpy(entry->device, ctx.name, sizeof(entry->device));
+    }
+    req->found = 1;
+
+    entry->link_found = true;
+    entry->up = (ifm->ifi_flags & IFF_UP) ? true : false;
+    if (ctx.stats64 != NULL) {
+        entry->rx_bytes = ctx.stats64->rx_bytes;
+        entry->rx_packets = ctx.stats64->rx_packets;
+        entry->tx_bytes = ctx.stats64->tx_bytes;
+        entry->tx_packets = ctx.stats64->tx_packets;
+    } else if (ctx.stats != NULL) {
+        entry->rx_bytes = ctx.stats->rx_bytes;
+        entry->rx_packets = ctx.stats->rx_packets;
+        entry->tx_bytes = ctx.stats->tx_bytes;
+        entry->tx_packets = ctx.stats->tx_packets;
+    }
+    return (MNL_CB_OK);
+}
+
+/*  link_request
+
+    Sends a RTM_GETLINK request, for all links if 'ifname' is NULL, and
+    processes the answer.
+
+    Returncodes:
+         0: ok
+         1: interface not found (single request only)
+        -1: error
+*/
+static int link_request(const char *ifname, struct link_req_ctx *ctx)
+{
+    char buf[MNL_SOCKET_BUFFER_SIZE];
+    struct mnl_socket *nl = NULL;
+    int retval = 0;
+
+    struct nlmsghdr *nlh = mnl_nlmsg_put_header(buf);
+    nlh->nlmsg_type = RTM_GETLINK;
+    nlh->nlmsg_flags = NLM_F_REQUEST | (ifname ? 0 : NLM_F_DUMP);
+    unsigned int seq = nlh->nlmsg_seq = (unsigned int)time(NULL);
+
+    struct ifinfomsg *ifm = mnl_nlmsg_put_extra_header(nlh, sizeof(*ifm));
+    ifm->ifi_family = AF_UNSPEC;
+    if (ifname != NULL)
+        mnl_attr_put_strz(nlh, IFLA_IFNAME, ifname);
+
+    if (!(nl = mnl_socket_open(NETLINK_ROUTE))) {
+        vrmr_error(-1, "Error", "mnl_socket_open failed: %s", strerror(errno));
+        return (-1);
+    }
+    if (mnl_socket_bind(nl, 0, MNL_SOCKET_AUTOPID) < 0) {
+        vrmr_error(-1, "Error", "mnl_socket_bind failed: %s", strerror(errno));
+        mnl_socket_close(nl);
+        return (-1);
+    }
+    unsigned int portid = mnl_socket_get_portid(nl);
+
+    if (mnl_socket_sendto(nl, nlh, nlh->nlmsg_len) < 0) {
+        vrmr_error(-1, "Error", "mnl_socket_sendto failed: %s",
+                strerror(errno));
+        mnl_socket_close(nl);
+        return (-1);
+    }
+
+    ssize_t ret;
+    while ((ret = mnl_socket_recvfrom(nl, buf, sizeof(buf))) > 0) {
+        int r = mnl_cb_run(buf, (size_t)ret, seq, portid, link_data_cb, ctx);
+        if (r == MNL_CB_STOP)
+            break;
+        if (r == MNL_CB_ERROR) {
+            if (ifname != NULL && (errno == ENODEV || errno == EINVAL)) {
+                retval = 1;
+            } else {
+                vrmr_error(-1, "Error", "mnl_cb_run failed: %s",
+                        strerror(errno));
+                retval = -1;
+            }
+            break;
+        }
+        /* a single request is answered by a single message */
+        if (ifname != NULL)
+            break;
+    }
+    if (ret < 0) {
+        vrmr_error(-1, "Error", "mnl_socket_recvfrom failed: %s",
+                strerror(errno));
+        retval = -1;
+    }
+
+    mnl_socket_close(nl);
+
+    if (retval == 0 && ifname != NULL && ctx->found == 0)
+        retval = 1;
+    return (retval);
+}
+
+/*  vrmr_counters_update_links
+
+    Updates the link counters of all interfaces with one RTM_GETLINK dump.
+    Nothing is done if the counters were already updated this second,
+    unless 'force' is set.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_counters_update_links(struct vrmr_counters *counters, bool force)
+{
+    assert(counters);
+
+    time_t now = time(NULL);
+    if (!force && counters->link_tick == now)
+        return (0);
+
+    for (unsigned int i = 0; i < counters->list.len; i++) {
+        struct vrmr_counters_iface *entry = counters->list.data[i];
+        entry->link_found = false;
+        entry->up = false;
+    }
+
+    struct link_req_ctx ctx = {.counters = counters, .single = NULL};
+    if (link_request(NULL, &ctx) < 0)
+        return (-1);
+
+    counters->link_tick = now;
+    return (0);
+}
+
+/*  vrmr_counters_get_link
+
+    Gets the link counters of a single interface without dumping all of
+    them.
+
+    Returncodes:
+         0: ok
+         1: interface not found
+        -1: error
+*/
+int vrmr_counters_get_link(
+        const char *device, struct vrmr_counters_iface *entry)
+{
+    assert(device && entry);
+
+    memset(entry, 0, sizeof(*entry));
+
+    if (strlen(device) >= IFNAMSIZ)
+        return (1);
+
+    struct link_req_ctx ctx = {.counters = NULL, .single = entry};
+    return (link_request(device, &ctx));
+}
+
+/*
+    iptables
+*/
+
+/* store the counters of one rule from the filter table listing */
+static int ipt_store_rule(struct vrmr_counters *counters, const char *chain,
+        const char *target, const char *in, const char *out, uint64_t packets,
+        uint64_t bytes)
+{
+    struct vrmr_counters_iface *entry = NULL;
+    const char *device = NULL;
+    int incoming = 0;
+
+    /* only rules for one interface */
+    if (in[0] != '*' && out[0] == '*') {
+        device = in;
+        incoming = 1;
+    } else if (in[0] == '*' && out[0] != '*') {
+        device = out;
+    } else {
+        return (0);
+    }
+
+    if (strncmp(chain, "ACC-", 4) == 0) {
+        /* the accounting chain itself: RETURN rules per direction */
+        if (strcmp(target, "RETURN") != 0 || strcmp(chain + 4, device) != 0)
+            return (0);
+    } else {
+        /* jumps from the builtin chains into the accounting chain */
+        if (strncmp(target, "ACC-", 4) != 0 || strcmp(target + 4, device) != 0)
+            return (0);
+    }
+
+    if (!(entry = counters_get_or_add(counters, device)))
+        return (-1);
+    entry->ipt_found = true;
+
+    struct vrmr_interface_counters *cnt = &entry->ipt;
+    if (strcmp(chain, "INPUT") == 0 && incoming) {
+        cnt->input_packets = packets;
+        cnt->input_bytes = bytes;
+    } else if (strcmp(chain, "OUTPUT") == 0 && !incoming) {
+        cnt->output_packets = packets;
+        cnt->output_bytes = bytes;
+    } else if (strcmp(chain, "FORWARD") == 0) {
+        if (incoming) {
+            cnt->forwardin_packets = packets;
+            cnt->forwardin_bytes = bytes;
+        } else {
+            cnt->forwardout_packets = packets;
+            cnt->forwardout_bytes = bytes;
+        }
+    } else if (strncmp(chain, "ACC-", 4) == 0) {
+        if (incoming) {
+            cnt->acc_in_packets = packets;
+            cnt->acc_in_bytes = bytes;
+        } else {
+            cnt->acc_out_packets = packets;
+            cnt->acc_out_bytes = bytes;
+        }
+    }
+    return (0);
+}
+
+/*  vrmr_counters_update_ipt
+
+    Updates the iptables counters of all interfaces by listing the whole
+    filter table once. Nothing is done if the counters were already updated
+    this second, unless 'force' is set.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_counters_update_ipt(
+        struct vrmr_config *cfg, struct vrmr_counters *counters, bool force)
+{
+    char line[512] = "", chain[64] = "", command[256] = "";
+    FILE *p = NULL;
+
+    assert(cfg && counters);
+
+    time_t now = time(NULL);
+    if (!force && counters->ipt_tick == now)
+        return (0);
+
+    for (unsigned int i = 0; i < counters->list.len; i++) {
+        struct vrmr_counters_iface *entry = counters->list.data[i];
+        entry->ipt_found = false;
+        memset(&entry->ipt, 0, sizeof(entry->ipt));
+    }
+
+    snprintf(command, sizeof(command), "%s -t filter -vnxL 2> /dev/null",
+            cfg->iptables_location);
+    vrmr_debug(HIGH, "command: '%s'.", command);
+
+    if (!(p = popen(command, "r"))) {
+        vrmr_error(-1, "Internal Error", "pipe failed: %s", strerror(errno));
+        return (-1);
+    }
+
+    while (fgets(line, (int)sizeof(line), p) != NULL) {
+        char *tok[10], *saveptr = NULL;
+        int n = 0;
+
+        if (strncmp(line, "Chain ", 6) == 0) {
+            if (sscanf(line, "Chain %63s", chain) != 1)
+                chain[0] = '\0';
+            continue;
+        }
+
+        for (char *t = strtok_r(line, " \t\n", &saveptr); t && n < 10;
+                t = strtok_r(NULL, " \t\n", &saveptr))
+            tok[n++] = t;
+
+        /*  pkts bytes target prot [opt] in out source destination
+
+            newer iptables versions leave out the opt column. A rule without
+            a target has one column less, those are not ours anyway.
+        */
+        if (n < 8 || chain[0] == '\0' || !isdigit((unsigned char)tok[0][0]))
+            continue;
+        int off = (strcmp(tok[4], "--") == 0 || strcmp(tok[4], "-f") == 0 ||
+                          strcmp(tok[4], "!f") == 0)
+                          ? 1
+                          : 0;
+
+        uint64_t packets = strtoull(tok[0], NULL, 10);
+        uint64_t bytes = strtoull(tok[1], NULL, 10);
+
+        if (ipt_store_rule(counters, chain, tok[2], tok[4 + off], tok[5 + off],
+                    packets, bytes) < 0) {
+            pclose(p);
+            return (-1);
+        }
+    }
+
+    pclose(p);
+    counters->ipt_tick = now;
+    return (0);
+}
@@ -21,6 +21,87 @@
 #include "config.h"
 #include "vuurmuur.h"
 
+#include <fnmatch.h>
+#include <netdb.h>
+
+/*
+    Filter expressions
+
+    A filter is a list of conditions like 'from==pc1.lan.internal',
+    'src==192.168.1.0/24', 'dport==1024-2048' or 'proto==udp', combined with
+    'and', 'or', 'not' and parentheses. Conditions next to each other must
+    all match. A word without a field matches if it is part of any of the
+    fields, like the old regex filter did.
+
+    The expression is compiled once into a tree that is evaluated against
+    the fields of each connection or log line.
+*/
+
+enum filter_node_type {
+    FILTER_AND,
+    FILTER_OR,
+    FILTER_NOT,
+    FILTER_CMP,
+};
+
+enum filter_op {
+    FILTER_EQ,
+    FILTER_NE,
+    FILTER_LT,
+    FILTER_LE,
+    FILTER_GT,
+    FILTER_GE,
+};
+
+struct vrmr_filter_node {
+    enum filter_node_type type;
+    struct vrmr_filter_node *left;  /* and, or, not */
+    struct vrmr_filter_node *right; /* and, or */
+
+    enum vrmr_filter_field field;
+    enum filter_op op;
+
+    /* string value, may contain fnmatch wildcards */
+    char *str;
+    bool wildcard;
+
+    /* word with regex characters */
+    bool regex;
+    regex_t reg;
+
+    /* port or protocol range, or a word that is a number */
+    bool number;
+    int lo, hi;
+
+    /* ip address or network */
+    bool addr;
+    int family;
+    unsigned char addr_bytes[16];
+    unsigned int prefix_len;
+};
+
+static const struct {
+    const char *name;
+    enum vrmr_filter_field field;
+} filter_fields[] = {
+        {"service", VRMR_FILTER_SERVICE},
+        {"ser", VRMR_FILTER_SERVICE},
+        {"from", VRMR_FILTER_FROM},
+        {"to", VRMR_FILTER_TO},
+        {"zone", VRMR_FILTER_ZONE},
+        {"action", VRMR_FILTER_ACTION},
+        {"src", VRMR_FILTER_SRC},
+        {"dst", VRMR_FILTER_DST},
+        {"ip", VRMR_FILTER_IP},
+        {"sport", VRMR_FILTER_SPORT},
+        {"dport", VRMR_FILTER_DPORT},
+        {"port", VRMR_FILTER_PORT},
+        {"proto", VRMR_FILTER_PROTO},
+        {"in", VRMR_FILTER_IN},
+        {"out", VRMR_FILTER_OUT},
+        {"prefix", VRMR_FILTER_PREFIX},
+};
+
 void vrmr_filter_setup(struct vrmr_filter *filter)
 {
     assert(filter);
@@ -28,16 +109,622 @@ void vrmr_filter_setup(struct vrmr_filter *filter)
     memset(filter, 0, sizeof(struct vrmr_filter));
 }
 
+static void filter_node_free(struct vrmr_filter_node *node)
+{
+    if (node == NULL)
+        return;
+
+    filter_node_free(node->left);
+    filter_node_free(node->right);
+    if (node->regex)
+        regfree(&node->reg);
+    free(node->str);
+    free(node);
+}
+
 void vrmr_filter_cleanup(struct vrmr_filter *filter)
 {
     assert(filter);
 
-    if (filter->reg_active == TRUE) {
-        /* first remove old regex */
-        regfree(&filter->reg);
-        /* set reg_active to false */
-        filter->reg_active = FALSE;
+    filter_node_free(filter->expr);
+    memset(filter, 0, sizeof(struct vrmr_filter));
+}
+
+/*
+    parser
+*/
+enum filter_token_type {
+    FILTER_TOK_END,
+    FILTER_TOK_WORD,
+    FILTER_TOK_OP,
+    FILTER_TOK_LPAREN,
+    FILTER_TOK_RPAREN,
+    FILTER_TOK_AND,
+    FILTER_TOK_OR,
+    FILTER_TOK_NOT,
+};
+
+struct filter_parser {
+    const char *pos;
+
+    /* current token */
+    enum filter_token_type tok;
+    char word[128];
+    enum filter_op op;
+
+    uint32_t fields;
+};
+
+static int filter_next(struct filter_parser *p)
+{
+    while (isspace((unsigned char)*p->pos))
+        p->pos++;
+
+    const char *s = p->pos;
+    p->word[0] = '\0';
+
+    switch (*s) {
+        case '\0':
+            p->tok = FILTER_TOK_END;
+            return (0);
+        case '(':
+            p->tok = FILTER_TOK_LPAREN;
+            p->pos++;
+            return (0);
+        case ')':
+            p->tok = FILTER_TOK_RPAREN;
+            p->pos++;
+            return (0);
+        case '&':
+        case '|':
+            if (s[1] != s[0])
+                break;
+            p->tok = (*s == '&') ? FILTER_TOK_AND : FILTER_TOK_OR;
+            p->pos += 2;
+            return (0);
+        case '!':
+            if (s[1] == '=') {
+                p->tok = FILTER_TOK_OP;
+                p->op = FILTER_NE;
+                p->pos += 2;
+            } else {
+                p->tok = FILTER_TOK_NOT;
+                p->pos++;
+            }
+            return (0);
+        case '=':
+            p->tok = FILTER_TOK_OP;
+            p->op = FILTER_EQ;
+            p->pos += (s[1] == '=') ? 2 : 1;
+            return (0);
+        case '<':
+        case '>':
+            p->tok = FILTER_TOK_OP;
+            if (s[1] == '=')
+                p->op = (*s == '<') ? FILTER_LE : FILTER_GE;
+            else
+                p->op = (*s == '<') ? FILTER_LT : FILTER_GT;
+            p->pos += (s[1] == '=') ? 2 : 1;
+            return (0);
+        case '"': {
+            const char *end = strchr(s + 1, '"');
+            if (end == NULL) {
+                vrmr_error(-1, "Error", "filter: missing '\"'");
+                return (-1);
+            }
+            if (end - s - 1 >= (int)sizeof(p->word)) {
+                vrmr_error(-1, "Error", "filter: word too long");
+                return (-1);
+            }
+            memcpy(p->word, s + 1, (size_t)(end - s - 1));
+            p->word[end - s - 1] = '\0';
+            p->tok = FILTER_TOK_WORD;
+            p->pos = end + 1;
+            return (0);
+        }
+        default:
+            break;
     }
 
-    memset(filter, 0, sizeof(struct vrmr_filter));
+    size_t len = strcspn(s, " \t()!=<>\"");
+    /* a single '&' or '|' is part of the word */
+    while (s[len] == '&' || s[len] == '|')
+        len += 1 + strcspn(s + len + 1, " \t()!=<>\"");
+    if (len == 0 || len >= sizeof(p->word)) {
+        vrmr_error(-1, "Error", "filter: unexpected '%.16s'", s);
+        return (-1);
+    }
+    memcpy(p->word, s, len);
+    p->word[len] = '\0';
+    p->pos += len;
+
+    if (strcasecmp(p->word, "and") == 0)
+        p->tok = FILTER_TOK_AND;
+    else if (strcasecmp(p->word, "or") == 0)
+        p->tok = FILTER_TOK_OR;
+    else if (strcasecmp(p->word, "not") == 0)
+        p->tok = FILTER_TOK_NOT;
+    else
+        p->tok = FILTER_TOK_WORD;
+    return (0);
+}
+
+static struct vrmr_filter_node *filter_node_new(enum filter_node_type type)
+{
+    struct vrmr_filter_node *node = calloc(1, sizeof(*node));
+    if (node == NULL) {
+        vrmr_error(-1, "Error", "calloc failed: %s", strerror(errno));
+        return (NULL);
+    }
+    node->type = type;
+    return (node);
+}
+
+/* parse 'lo' or 'lo-hi' */
+static int filter_parse_range(const char *str, int *lo, int *hi)
+{
+    char *end = NULL;
+
+    if (!isdigit((unsigned char)*str))
+        return (-1);
+    long l = strtol(str, &end, 10), h = l;
+    if (*end == '-') {
+        if (!isdigit((unsigned char)end[1]))
+            return (-1);
+        h = strtol(end + 1, &end, 10);
+    }
+    if (*end != '\0' || l < 0 || h < l || h > 65535)
+        return (-1);
+    *lo = (int)l;
+    *hi = (int)h;
+    return (0);
+}
+
+/* parse an address 'ip' or network 'ip/len' */
+static int filter_parse_addr(struct vrmr_filter_node *node, const char *str)
+{
+    char buf[INET6_ADDRSTRLEN + 4];
+
+    if (strlcpy(buf, str, sizeof(buf)) >= sizeof(buf))
+        return (-1);
+
+    char *slash = strchr(buf, '/');
+    if (slash != NULL)
+        *slash = '\0';
+
+    node->family = strchr(buf, ':') ? AF_INET6 : AF_INET;
+    if (inet_pton(node->family, buf, node->addr_bytes) != 1)
+        return (-1);
+
+    const unsigned int max_len = (node->family == AF_INET6) ? 128 : 32;
+    node->prefix_len = max_len;
+    if (slash != NULL) {
+        char *end = NULL;
+        unsigned long len = strtoul(slash + 1, &end, 10);
+        if (slash[1] == '\0' || *end != '\0' || len > max_len)
+            return (-1);
+        node->prefix_len = (unsigned int)len;
+    }
+    node->addr = true;
+    return (0);
+}
+
+static int filter_set_value(struct vrmr_filter_node *node, const char *value)
+{
+    switch (node->field) {
+        case VRMR_FILTER_SPORT:
+        case VRMR_FILTER_DPORT:
+        case VRMR_FILTER_PORT:
+            if (filter_parse_range(value, &node->lo, &node->hi) < 0) {
+                vrmr_error(-1, "Error", "filter: '%s' is not a port or range",
+                        value);
+                return (-1);
+            }
+            node->number = true;
+            return (0);
+
+        case VRMR_FILTER_PROTO:
+            if (filter_parse_range(value, &node->lo, &node->hi) < 0) {
+                struct protoent *pe = getprotobyname(value);
+                if (pe == NULL) {
+                    vrmr_error(-1, "Error", "filter: unknown protocol '%s'",
+                            value);
+                    return (-1);
+                }
+                node->lo = node->hi = pe->p_proto;
+            }
+            node->number = true;
+            return (0);
+
+        case VRMR_FILTER_SRC:
+        case VRMR_FILTER_DST:
+        case VRMR_FILTER_IP:
+            /* otherwise it's compared as a string, e.g. '10.0.0.*' */
+            if (filter_parse_addr(node, value) == 0)
+                return (0);
+            if (strchr(value, '/') != NULL) {
+                vrmr_error(-1, "Error", "filter: '%s' is not a network",
+                        value);
+                return (-1);
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    if (node->op != FILTER_EQ && node->op != FILTER_NE) {
+        vrmr_error(-1, "Error",
+                "filter: only '==' and '!=' can be used for '%s'", value);
+        return (-1);
+    }
+    if (!(node->str = strdup(value))) {
+        vrmr_error(-1, "Error", "strdup failed: %s", strerror(errno));
+        return (-1);
+    }
+    node->wildcard = (strpbrk(value, "*?[") != NULL);
+    return (0);
+}
+
+/* a word without field */
+static int filter_set_word(struct vrmr_filter_node *node, const char *word)
+{
+    node->field = VRMR_FILTER_ANY;
+
+    if (!(node->str = strdup(word))) {
+        vrmr_error(-1, "Error", "strdup failed: %s", strerror(errno));
+        return (-1);
+    }
+    if (filter_parse_range(word, &node->lo, &node->hi) == 0 &&
+            node->lo == node->hi)
+        node->number = true;
+
+    if (strpbrk(word, ".[]*+?^$\\{}") != NULL) {
+        if (regcomp(&node->reg, word, REG_EXTENDED | REG_NOSUB) != 0) {
+            vrmr_error(-1, "Error", "filter: invalid regular expression '%s'",
+                    word);
+            return (-1);
+        }
+        node->regex = true;
+    }
+    return (0);
+}
+
+static struct vrmr_filter_node *filter_parse_or(struct filter_parser *p);
+
+static struct vrmr_filter_node *filter_parse_unary(struct filter_parser *p)
+{
+    struct vrmr_filter_node *node = NULL;
+
+    switch (p->tok) {
+        case FILTER_TOK_NOT:
+            if (!(node = filter_node_new(FILTER_NOT)))
+                return (NULL);
+            if (filter_next(p) < 0 || !(node->left = filter_parse_unary(p))) {
+                filter_node_free(node);
+                return (NULL);
+            }
+            return (node);
+
+        case FILTER_TOK_LPAREN:
+            if (filter_next(p) < 0 || !(node = filter_parse_or(p)))
+                return (NULL);
+            if (p->tok != FILTER_TOK_RPAREN) {
+                vrmr_error(-1, "Error", "filter: missing ')'");
+                filter_node_free(node);
+                return (NULL);
+            }
+            if (filter_next(p) < 0) {
+                filter_node_free(node);
+                return (NULL);
+            }
+            return (node);
+
+        case FILTER_TOK_WORD:
+            break;
+
+        default:
+            vrmr_error(-1, "Error", "filter: expected a condition at '%.16s'",
+                    p->pos);
+            return (NULL);
+    }
+
+    if (!(node = filter_node_new(FILTER_CMP)))
+        return (NULL);
+
+    char word[sizeof(p->word)];
+    (void)strlcpy(word, p->word, sizeof(word));
+    if (filter_next(p) < 0) {
+        filter_node_free(node);
+        return (NULL);
+    }
+
+    if (p->tok != FILTER_TOK_OP) {
+        p->fields |= (1U << VRMR_FILTER_ANY);
+        if (filter_set_word(node, word) < 0) {
+            filter_node_free(node);
+            return (NULL);
+        }
+        return (node);
+    }
+
+    size_t i;
+    for (i = 0; i < sizeof(filter_fields) / sizeof(filter_fields[0]); i++) {
+        if (strcasecmp(word, filter_fields[i].name) == 0)
+            break;
+    }
+    if (i == sizeof(filter_fields) / sizeof(filter_fields[0])) {
+        vrmr_error(-1, "Error", "filter: unknown field '%s'", word);
+        filter_node_free(node);
+        return (NULL);
+    }
+    node->field = filter_fields[i].field;
+    node->op = p->op;
+    p->fields |= (1U << node->field);
+
+    if (filter_next(p) < 0 || p->tok != FILTER_TOK_WORD) {
+        vrmr_error(-1, "Error", "filter: missing value for '%s'", word);
+        filter_node_free(node);
+        return (NULL);
+    }
+    if (filter_set_value(node, p->word) < 0 || filter_next(p) < 0) {
+        filter_node_free(node);
+        return (NULL);
+    }
+    return (node);
+}
+
+static struct vrmr_filter_node *filter_parse_and(struct filter_parser *p)
+{
+    struct vrmr_filter_node *left = filter_parse_unary(p);
+    if (left == NULL)
+        return (NULL);
+
+    /* 'and' is optional */
+    while (p->tok == FILTER_TOK_AND || p->tok == FILTER_TOK_WORD ||
+            p->tok == FILTER_TOK_NOT || p->tok == FILTER_TOK_LPAREN) {
+        if (p->tok == FILTER_TOK_AND && filter_next(p) < 0)
+            goto error;
+
+        struct vrmr_filter_node *node = filter_node_new(FILTER_AND);
+        if (node == NULL)
+            goto error;
+        node->left = left;
+        left = node;
+        if (!(node->right = filter_parse_unary(p)))
+            goto error;
+    }
+    return (left);
+
+error:
+    filter_node_free(left);
+    return (NULL);
+}
+
+static struct vrmr_filter_node *filter_parse_or(struct filter_parser *p)
+{
+    struct vrmr_filter_node *left = filter_parse_and(p);
+
+    while (left != NULL && p->tok == FILTER_TOK_OR) {
+        struct vrmr_filter_node *node = filter_node_new(FILTER_OR);
+        if (node == NULL) {
+            filter_node_free(left);
+            return (NULL);
+        }
+        node->left = left;
+        left = node;
+        if (filter_next(p) < 0 || !(node->right = filter_parse_and(p))) {
+            filter_node_free(left);
+            return (NULL);
+        }
+    }
+    return (left);
+}
+
+/*  vrmr_filter_compile
+
+    Compiles 'str' into the filter, replacing the expression it had. An
+    empty 'str' clears the filter. On error the filter is cleared as well.
+
+    Returncodes:
+         0: ok
+        -1: error, e.g. invalid syntax
+*/
+int vrmr_filter_compile(struct vrmr_filter *filter, const char *str)
+{
+    struct filter_parser p;
+
+    assert(filter && str);
+
+    filter_node_free(filter->expr);
+    filter->expr = NULL;
+    filter->fields = 0;
+    (void)strlcpy(filter->str, str, sizeof(filter->str));
+
+    memset(&p, 0, sizeof(p));
+    p.pos = str;
+    if (filter_next(&p) < 0)
+        return (-1);
+    if (p.tok == FILTER_TOK_END)
+        return (0);
+
+    struct vrmr_filter_node *expr = filter_parse_or(&p);
+    if (expr == NULL)
+        return (-1);
+    if (p.tok != FILTER_TOK_END) {
+        vrmr_error(-1, "Error", "filter: unexpected '%s%.16s'", p.word, p.pos);
+        filter_node_free(expr);
+        return (-1);
+    }
+
+    filter->expr = expr;
+    filter->fields = p.fields;
+    return (0);
+}
+
+/*
+    evaluation
+*/
+static bool filter_match_str(
+        const struct vrmr_filter_node *node, const char *value)
+{
+    if (value == NULL)
+        return (false);
+    if (node->wildcard)
+        return (fnmatch(node->str, value, FNM_CASEFOLD) == 0);
+    return (strcasecmp(node->str, value) == 0);
+}
+
+static bool filter_match_addr(
+        const struct vrmr_filter_node *node, const char *value)
+{
+    unsigned char bytes[16];
+
+    if (value == NULL || value[0] == '\0')
+        return (false);
+    if (!node->addr)
+        return (filter_match_str(node, value));
+
+    const int family = strchr(value, ':') ? AF_INET6 : AF_INET;
+    if (family != node->family || inet_pton(family, value, bytes) != 1)
+        return (false);
+
+    const unsigned int whole = node->prefix_len / 8;
+    const unsigned int bits = node->prefix_len % 8;
+    if (memcmp(bytes, node->addr_bytes, whole) != 0)
+        return (false);
+    if (bits == 0)
+        return (true);
+    const unsigned char mask = (unsigned char)(0xff << (8 - bits));
+    return ((bytes[whole] & mask) == (node->addr_bytes[whole] & mask));
+}
+
+static bool filter_match_number(const struct vrmr_filter_node *node, int value)
+{
+    if (value < 0)
+        return (false);
+
+    switch (node->op) {
+        case FILTER_LT:
+            return (value < node->lo);
+        case FILTER_LE:
+            return (value <= node->hi);
+        case FILTER_GT:
+            return (value > node->hi);
+        case FILTER_GE:
+            return (value >= node->lo);
+        default:
+            return (value >= node->lo && value <= node->hi);
+    }
+}
+
+/* a word without field: part of any of the fields */
+static bool filter_match_word_in(
+        const struct vrmr_filter_node *node, const char *value)
+{
+    if (value == NULL)
+        return (false);
+    if (node->regex)
+        return (regexec(&node->reg, value, 0, NULL, 0) == 0);
+    return (strstr(value, node->str) != NULL);
+}
+
+static bool filter_match_word(const struct vrmr_filter_node *node,
+        const struct vrmr_filter_record *rec)
+{
+    if (node->number && (rec->src_port == node->lo ||
+                                rec->dst_port == node->lo ||
+                                rec->protocol == node->lo))
+        return (true);
+
+    return (filter_match_word_in(node, rec->service) ||
+            filter_match_word_in(node, rec->from) ||
+            filter_match_word_in(node, rec->to) ||
+            filter_match_word_in(node, rec->action) ||
+            filter_match_word_in(node, rec->src_ip) ||
+            filter_match_word_in(node, rec->dst_ip) ||
+            filter_match_word_in(node, rec->in) ||
+            filter_match_word_in(node, rec->out) ||
+            filter_match_word_in(node, rec->prefix) ||
+            filter_match_word_in(node, rec->line));
+}
+
+static bool filter_match_cmp(const struct vrmr_filter_node *node,
+        const struct vrmr_filter_record *rec)
+{
+    switch (node->field) {
+        case VRMR_FILTER_ANY:
+            return (filter_match_word(node, rec));
+        case VRMR_FILTER_SERVICE:
+            return (filter_match_str(node, rec->service));
+        case VRMR_FILTER_FROM:
+            return (filter_match_str(node, rec->from));
+        case VRMR_FILTER_TO:
+            return (filter_match_str(node, rec->to));
+        case VRMR_FILTER_ZONE:
+            return (filter_match_str(node, rec->from) ||
+                    filter_match_str(node, rec->to));
+        case VRMR_FILTER_ACTION:
+            return (filter_match_str(node, rec->action));
+        case VRMR_FILTER_SRC:
+            return (filter_match_addr(node, rec->src_ip));
+        case VRMR_FILTER_DST:
+            return (filter_match_addr(node, rec->dst_ip));
+        case VRMR_FILTER_IP:
+            return (filter_match_addr(node, rec->src_ip) ||
+                    filter_match_addr(node, rec->dst_ip));
+        case VRMR_FILTER_SPORT:
+            return (filter_match_number(node, rec->src_port));
+        case VRMR_FILTER_DPORT:
+            return (filter_match_number(node, rec->dst_port));
+        case VRMR_FILTER_PORT:
+            return (filter_match_number(node, rec->src_port) ||
+                    filter_match_number(node, rec->dst_port));
+        case VRMR_FILTER_PROTO:
+            return (filter_match_number(node, rec->protocol));
+        case VRMR_FILTER_IN:
+            return (filter_match_str(node, rec->in));
+        case VRMR_FILTER_OUT:
+            return (filter_match_str(node, rec->out));
+        case VRMR_FILTER_PREFIX:
+            return (filter_match_str(node, rec->prefix));
+    }
+    return (false);
+}
+
+static bool filter_eval(const struct vrmr_filter_node *node,
+        const struct vrmr_filter_record *rec)
+{
+    switch (node->type) {
+        case FILTER_AND:
+            return (filter_eval(node->left, rec) &&
+                    filter_eval(node->right, rec));
+        case FILTER_OR:
+            return (filter_eval(node->left, rec) ||
+                    filter_eval(node->right, rec));
+        case FILTER_NOT:
+            return (!filter_eval(node->left, rec));
+        case FILTER_CMP:
+            /* '!=' is the opposite of '==', also if the field is not set */
+            if (node->op == FILTER_NE)
+                return (!filter_match_cmp(node, rec));
+            return (filter_match_cmp(node, rec));
+    }
+    return (false);
+}
+
+/*  vrmr_filter_match
+
+    Returns true if the record should be shown: it matches the filter, or
+    doesn't match it if the filter is negated. Without a filter everything
+    matches.
+*/
+bool vrmr_filter_match(
+        const struct vrmr_filter *filter, const struct vrmr_filter_record *rec)
+{
+    assert(filter && rec);
+
+    if (filter->expr == NULL)
+        return (true);
+    return (filter_eval(filter->expr, rec) != (filter->neg == TRUE));
 }
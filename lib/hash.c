@@ -38,8 +38,8 @@ int vrmr_hash_setup(struct vrmr_hash_table *hash_table, /* the hash table ;-) */
     }
 
     /* Allocate space for the hash table. */
-    if (!(hash_table->table = (struct vrmr_list *)malloc(
-                  rows * sizeof(struct vrmr_list)))) {
+    if (!(hash_table->table = (struct vrmr_vector *)malloc(
+                  rows * sizeof(struct vrmr_vector)))) {
         vrmr_error(-1, "Error", "malloc failed: %s", strerror(errno));
         return (-1);
     }
@@ -55,13 +55,13 @@ int vrmr_hash_setup(struct vrmr_hash_table *hash_table, /* the hash table ;-) */
     /* initialize the rows. */
     hash_table->rows = rows;
 
-    /*  setup the row list
+    /*  setup the rows
 
-        the hash table is not supposed to contain any data, only pointers. So we
-        setup the list without a cleanup function.
+        the rows are vectors, so an empty row costs no allocation and a lookup
+        scans one contiguous array instead of chasing list nodes.
     */
     for (unsigned int row = 0; row < hash_table->rows; row++) {
-        vrmr_list_setup(&hash_table->table[row], free_func);
+        vrmr_vector_setup(&hash_table->table[row], free_func);
     }
 
     return (0);
@@ -84,10 +84,7 @@ int vrmr_hash_cleanup(struct vrmr_hash_table *hash_table)
 
     /* clear all rows */
     for (unsigned int row = 0; row < hash_table->rows; row++) {
-        if (vrmr_list_cleanup(&hash_table->table[row]) < 0) {
-            vrmr_error(-1, "Internal Error", "cleaning up row %u failed", row);
-            return (-1);
-        }
+        vrmr_vector_cleanup(&hash_table->table[row]);
     }
 
     /* free the hash table */
@@ -110,8 +107,8 @@ int vrmr_hash_insert(struct vrmr_hash_table *hash_table, const void *data)
     unsigned int row = hash_table->hash_func(data) % hash_table->rows;
 
     /* insert the data into the row */
-    if (!(vrmr_list_append(&hash_table->table[row], data))) {
-        vrmr_error(-1, "Internal Error", "appending to the list failed");
+    if (vrmr_vector_append(&hash_table->table[row], data) < 0) {
+        vrmr_error(-1, "Internal Error", "appending to the row failed");
         return (-1);
     }
 
@@ -130,17 +127,17 @@ int vrmr_hash_insert(struct vrmr_hash_table *hash_table, const void *data)
 */
 int vrmr_hash_remove(struct vrmr_hash_table *hash_table, void *data)
 {
-    struct vrmr_list_node *d_node = NULL;
     void *table_data = NULL;
 
     assert(hash_table != NULL && data != NULL);
 
     /* hash the key with the hash function */
     unsigned int row = hash_table->hash_func(data) % hash_table->rows;
+    struct vrmr_vector *vec = &hash_table->table[row];
 
-    /* run trough the list at the row */
-    for (d_node = hash_table->table[row].top; d_node; d_node = d_node->next) {
-        if (!(table_data = d_node->data)) {
+    /* run trough the row */
+    for (unsigned int i = 0; i < vec->len; i++) {
+        if (!(table_data = vec->data[i])) {
             vrmr_error(-1, "Internal Error", "NULL pointer");
             return (-1);
         }
@@ -149,10 +146,11 @@ int vrmr_hash_remove(struct vrmr_hash_table *hash_table, void *data)
             with the data from the table.
         */
         if (hash_table->compare_func(table_data, data)) {
-            /* remove the data from the row/list. */
-            if (vrmr_list_remove_node(&hash_table->table[row], d_node) < 0) {
+            /* remove the data from the row, order within a row is
+             * irrelevant */
+            if (vrmr_vector_remove_unordered(vec, i) < 0) {
                 vrmr_error(
-                        -1, "Internal Error", "removing from the list failed");
+                        -1, "Internal Error", "removing from the row failed");
                 return (-1);
             }
 
@@ -175,16 +173,16 @@ int vrmr_hash_remove(struct vrmr_hash_table *hash_table, void *data)
 void *vrmr_hash_search(const struct vrmr_hash_table *hash_table, void *data)
 {
     void *table_data = NULL;
-    struct vrmr_list_node *d_node = NULL;
 
     assert(hash_table != NULL && data != NULL);
 
     /* determine the row by calling the hash function */
     unsigned int row = hash_table->hash_func(data) % hash_table->rows;
+    const struct vrmr_vector *vec = &hash_table->table[row];
 
     /* look for the data in the row */
-    for (d_node = hash_table->table[row].top; d_node; d_node = d_node->next) {
-        if (!(table_data = d_node->data)) {
+    for (unsigned int i = 0; i < vec->len; i++) {
+        if (!(table_data = vec->data[i])) {
             vrmr_error(-1, "Internal Error", "NULL pointer");
             return (NULL);
         }
@@ -200,42 +198,24 @@ void *vrmr_hash_search(const struct vrmr_hash_table *hash_table, void *data)
     return (NULL);
 }
 
-/*
-    serv_req is the search string, we only use src_low and dst_low from it.
-*/
-int vrmr_compare_ports(const void *serv_hash, const void *serv_req)
-{
-    struct vrmr_portdata *table_port_ptr = NULL, *search_port_ptr = NULL;
-    struct vrmr_list_node *d_node = NULL;
-
-    assert(serv_hash != NULL && serv_req != NULL);
+/*  service_match_portdata
 
-    /* cast */
-    struct vrmr_service *sertable = (struct vrmr_service *)serv_hash;
-    struct vrmr_service *sersearch = (struct vrmr_service *)serv_req;
+    Checks if one of the portranges of service 'ser' covers the request in
+    'search'. Only protocol, src_low and dst_low (and dst_high for icmp) of
+    'search' are used.
 
-    /* here we just take the top node, because thats the only one we use for a
-     * request */
-    if (!(d_node = sersearch->PortrangeList.top)) {
-        vrmr_error(-1, "Internal Error", "NULL pointer");
-        return (0);
-    }
-    if (!(search_port_ptr = d_node->data)) {
-        vrmr_error(-1, "Internal Error", "NULL pointer");
-        return (0);
-    }
-    d_node = NULL;
-
-    /*
-        were going to loop trough the portrange list of serv_req
-        if the service has no portranges, we can't match so we bail out.
-    */
-    if (!(d_node = sertable->PortrangeList.top))
-        return (0);
+    Returns 1 on a match, 0 otherwise.
+*/
+static int service_match_portdata(
+        const struct vrmr_service *ser, const struct vrmr_portdata *search)
+{
+    struct vrmr_portdata *table_port_ptr = NULL;
+    const struct vrmr_portdata *search_port_ptr = search;
 
-    /* now run trough the portrangelist */
-    for (; d_node; d_node = d_node->next) {
-        if (!(table_port_ptr = d_node->data)) {
+    /* now run trough the portrangelist. If the service has no portranges,
+     * we can't match. */
+    for (unsigned int i = 0; i < ser->PortrangeList.len; i++) {
+        if (!(table_port_ptr = ser->PortrangeList.data[i])) {
             vrmr_error(-1, "Internal Error", "NULL pointer");
             return (0);
         }
@@ -292,6 +272,33 @@ int vrmr_compare_ports(const void *serv_hash, const void *serv_req)
     return (0);
 }
 
+/*
+    serv_req is the search string, we only use src_low and dst_low from it.
+*/
+int vrmr_compare_ports(const void *serv_hash, const void *serv_req)
+{
+    struct vrmr_portdata *search_port_ptr = NULL;
+
+    assert(serv_hash != NULL && serv_req != NULL);
+
+    /* cast */
+    struct vrmr_service *sertable = (struct vrmr_service *)serv_hash;
+    struct vrmr_service *sersearch = (struct vrmr_service *)serv_req;
+
+    /* here we just take the first portrange, because thats the only one we
+     * use for a request */
+    if (sersearch->PortrangeList.len == 0) {
+        vrmr_error(-1, "Internal Error", "NULL pointer");
+        return (0);
+    }
+    if (!(search_port_ptr = sersearch->PortrangeList.data[0])) {
+        vrmr_error(-1, "Internal Error", "NULL pointer");
+        return (0);
+    }
+
+    return (service_match_portdata(sertable, search_port_ptr));
+}
+
 int vrmr_compare_ipaddress(const void *string1, const void *string2)
 {
     assert(string1 != NULL && string2 != NULL);
@@ -373,18 +380,17 @@ void vrmr_print_table_service(const struct vrmr_hash_table *hash_table)
 {
     unsigned int i;
     void *list_data = NULL;
-    struct vrmr_list_node *d_node = NULL;
 
     fprintf(stdout, "Hashtable has %u rows and %u cells.\n", hash_table->rows,
             hash_table->cells);
 
-    for (i = 0; hash_table->rows; i++) {
+    for (i = 0; i < hash_table->rows; i++) {
         fprintf(stdout, "Row[%03u]=", i);
 
-        for (d_node = hash_table->table[i].top; d_node; d_node = d_node->next) {
-            list_data = d_node->data;
+        for (unsigned int j = 0; j < hash_table->table[i].len; j++) {
+            list_data = hash_table->table[i].data[j];
 
-            fprintf(stdout, "%s(%p), ", (char *)list_data, (void *)d_node);
+            fprintf(stdout, "%s(%p), ", (char *)list_data, list_data);
         }
 
         fprintf(stdout, "\n");
@@ -393,28 +399,266 @@ void vrmr_print_table_service(const struct vrmr_hash_table *hash_table)
     return;
 }
 
-/*
- */
-int vrmr_init_services_hashtable(unsigned int n_rows,
-        struct vrmr_list *services_list,
-        unsigned int (*hash_func)(const void *data),
-        int (*compare_func)(const void *table_data, const void *search_data),
-        struct vrmr_hash_table *hash_table)
+/*  services_map_insert
+
+    Inserts 'ser' under 'key', unless it is already there. Services with
+    several portranges often map to the same key more than once.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int services_map_insert(struct vrmr_map *map,
+        const struct vrmr_map_key *key, struct vrmr_service *ser)
+{
+    if (vrmr_map_contains(map, key, ser))
+        return (0);
+
+    if (vrmr_map_insert(map, key, ser) < 0) {
+        vrmr_error(-1, "Internal Error", "inserting into map failed");
+        return (-1);
+    }
+    return (0);
+}
+
+/* a destination port range of a service, while building the segments */
+struct services_range {
+    uint32_t low;
+    uint32_t high;
+    struct vrmr_service *ser;
+};
+
+static int services_bound_cmp(const void *a, const void *b)
+{
+    const uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x < y ? -1 : x > y);
+}
+
+/* index of 'port' in the sorted 'bounds', which contains it */
+static unsigned int services_bound_find(
+        const uint32_t *bounds, unsigned int len, uint32_t port)
+{
+    unsigned int lo = 0, hi = len;
+
+    while (lo + 1 < hi) {
+        unsigned int mid = lo + (hi - lo) / 2;
+        if (bounds[mid] <= port)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return (lo);
+}
+
+static void services_ports_cleanup(struct vrmr_services_ports *ports)
+{
+    free(ports->segments);
+    free(ports->candidates);
+    memset(ports, 0, sizeof(*ports));
+}
+
+/*  services_ports_build
+
+    Builds the destination port segments of 'protocol'. The start and the
+    end of every portrange are the segment boundaries, so each segment is
+    covered by the same services from start to end. A service is listed
+    once per segment, in the order of the list.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int services_ports_build(struct vrmr_services_ports *ports,
+        struct vrmr_list *services_list, int protocol)
+{
+    struct services_range *ranges = NULL;
+    unsigned int ranges_len = 0, ranges_size = 0;
+    uint32_t *bounds = NULL;
+    struct vrmr_service **last = NULL;
+    int retval = -1;
+
+    memset(ports, 0, sizeof(*ports));
+
+    for (struct vrmr_list_node *s_node = services_list->top; s_node;
+            s_node = s_node->next) {
+        struct vrmr_service *ser_ptr = s_node->data;
+
+        for (unsigned int i = 0; i < ser_ptr->PortrangeList.len; i++) {
+            struct vrmr_portdata *portrange_ptr =
+                    ser_ptr->PortrangeList.data[i];
+            if (portrange_ptr->protocol != protocol)
+                continue;
+
+            int high = portrange_ptr->dst_high ? portrange_ptr->dst_high
+                                               : portrange_ptr->dst_low;
+            if (portrange_ptr->dst_low < 0 || high > 65535 ||
+                    portrange_ptr->dst_low > high) {
+                vrmr_debug(LOW, "service '%s': invalid portrange %d:%d.",
+                        ser_ptr->name, portrange_ptr->dst_low, high);
+                continue;
+            }
+
+            if (ranges_len == ranges_size) {
+                ranges_size = ranges_size ? ranges_size * 2 : 64;
+                struct services_range *r =
+                        realloc(ranges, ranges_size * sizeof(*ranges));
+                if (r == NULL) {
+                    vrmr_error(-1, "Error", "realloc failed: %s",
+                            strerror(errno));
+                    goto end;
+                }
+                ranges = r;
+            }
+            ranges[ranges_len].low = (uint32_t)portrange_ptr->dst_low;
+            ranges[ranges_len].high = (uint32_t)high;
+            ranges[ranges_len].ser = ser_ptr;
+            ranges_len++;
+        }
+    }
+    if (ranges_len == 0) {
+        retval = 0;
+        goto end;
+    }
+
+    /* the boundaries: the start of every range and the port after it */
+    unsigned int bounds_len = 0;
+    if (!(bounds = malloc(2 * ranges_len * sizeof(*bounds)))) {
+        vrmr_error(-1, "Error", "malloc failed: %s", strerror(errno));
+        goto end;
+    }
+    for (unsigned int i = 0; i < ranges_len; i++) {
+        bounds[bounds_len++] = ranges[i].low;
+        bounds[bounds_len++] = ranges[i].high + 1;
+    }
+    qsort(bounds, bounds_len, sizeof(*bounds), services_bound_cmp);
+    unsigned int n = 0;
+    for (unsigned int i = 0; i < bounds_len; i++) {
+        if (n == 0 || bounds[n - 1] != bounds[i])
+            bounds[n++] = bounds[i];
+    }
+    bounds_len = n;
+
+    ports->segments_len = bounds_len - 1;
+    if (!(ports->segments = calloc(
+                  ports->segments_len, sizeof(*ports->segments))) ||
+            !(last = calloc(ports->segments_len, sizeof(*last)))) {
+        vrmr_error(-1, "Error", "calloc failed: %s", strerror(errno));
+        goto end;
+    }
+    for (unsigned int i = 0; i < ports->segments_len; i++) {
+        ports->segments[i].low = (uint16_t)bounds[i];
+        ports->segments[i].high = (uint16_t)(bounds[i + 1] - 1);
+    }
+
+    /* count the candidates of each segment, then fill them in */
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == 1) {
+            unsigned int first = 0;
+            for (unsigned int i = 0; i < ports->segments_len; i++) {
+                ports->segments[i].first = first;
+                first += ports->segments[i].count;
+                ports->segments[i].count = 0;
+                last[i] = NULL;
+            }
+            ports->candidates_len = first;
+            if (!(ports->candidates =
+                                calloc(first, sizeof(*ports->candidates)))) {
+                vrmr_error(-1, "Error", "calloc failed: %s", strerror(errno));
+                goto end;
+            }
+        }
+
+        for (unsigned int r = 0; r < ranges_len; r++) {
+            unsigned int i = services_bound_find(
+                    bounds, bounds_len, ranges[r].low);
+            for (; i < ports->segments_len &&
+                    ports->segments[i].low <= ranges[r].high;
+                    i++) {
+                struct vrmr_services_segment *seg = &ports->segments[i];
+                /* the ranges of a service are next to each other */
+                if (last[i] == ranges[r].ser)
+                    continue;
+                last[i] = ranges[r].ser;
+                if (pass == 1)
+                    ports->candidates[seg->first + seg->count] =
+                            ranges[r].ser;
+                seg->count++;
+            }
+        }
+    }
+
+    /* drop the segments in the gaps between the ranges */
+    n = 0;
+    for (unsigned int i = 0; i < ports->segments_len; i++) {
+        if (ports->segments[i].count > 0)
+            ports->segments[n++] = ports->segments[i];
+    }
+    ports->segments_len = n;
+
+    vrmr_debug(LOW, "protocol %d: %u ranges, %u segments, %u candidates.",
+            protocol, ranges_len, ports->segments_len, ports->candidates_len);
+    retval = 0;
+end:
+    if (retval != 0)
+        services_ports_cleanup(ports);
+    free(ranges);
+    free(bounds);
+    free(last);
+    return (retval);
+}
+
+static struct vrmr_service *services_ports_search(
+        const struct vrmr_services_ports *ports,
+        const struct vrmr_portdata *search)
+{
+    unsigned int lo = 0, hi = ports->segments_len;
+
+    while (lo < hi) {
+        unsigned int mid = lo + (hi - lo) / 2;
+        const struct vrmr_services_segment *seg = &ports->segments[mid];
+
+        if (search->dst_low < seg->low) {
+            hi = mid;
+        } else if (search->dst_low > seg->high) {
+            lo = mid + 1;
+        } else {
+            /* the candidates cover the destination port, check the rest */
+            for (unsigned int i = 0; i < seg->count; i++) {
+                struct vrmr_service *ser_ptr =
+                        ports->candidates[seg->first + i];
+                if (service_match_portdata(ser_ptr, search))
+                    return (ser_ptr);
+            }
+            return (NULL);
+        }
+    }
+    return (NULL);
+}
+
+/*  vrmr_init_services_hashtable
+
+    Builds the services index for looking up the service of a logged packet
+    or a connection: the destination port segments for TCP and UDP, and a
+    map with ICMP services under their type and all other protocols under
+    port 0. Free it with vrmr_services_index_cleanup().
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_init_services_hashtable(
+        struct vrmr_list *services_list, struct vrmr_services_index *index)
 {
-    struct vrmr_list_node *d_node = NULL;
-    int port = 0;
     struct vrmr_service *ser_ptr = NULL;
     struct vrmr_portdata *portrange_ptr = NULL;
     struct vrmr_list_node *d_node_serlist = NULL;
+    struct vrmr_map_key key;
 
-    vrmr_debug(LOW, "services hashtable size will be %u rows.", n_rows);
+    assert(services_list && index);
 
-    assert(services_list);
-
-    /* init the hashtable for services */
-    if (vrmr_hash_setup(hash_table, n_rows, hash_func, compare_func, NULL) !=
-            0) {
-        vrmr_error(-1, "Internal Error", "hash table initializing failed");
+    memset(index, 0, sizeof(*index));
+    if (vrmr_map_setup(&index->map, VRMR_MAP_KEY_PORTPROTO, 0) < 0) {
+        vrmr_error(-1, "Internal Error", "map initializing failed");
         return (-1);
     }
 
@@ -422,114 +666,85 @@ int vrmr_init_services_hashtable(unsigned int n_rows,
             d_node_serlist = d_node_serlist->next) {
         if (!(ser_ptr = d_node_serlist->data)) {
             vrmr_error(-1, "Internal Error", "NULL pointer");
-            return (-1);
+            goto error;
         }
 
         vrmr_debug(HIGH, "service: '%s', '%p', len: '%u'.", ser_ptr->name,
                 ser_ptr, ser_ptr->PortrangeList.len);
 
-        if (ser_ptr->PortrangeList.len > 0) {
-            for (d_node = ser_ptr->PortrangeList.top; d_node;
-                    d_node = d_node->next) {
-                vrmr_debug(HIGH,
-                        "service: '%s', '%p', len: '%u', d_node: '%p', "
-                        "'d_node->data: '%p'.",
-                        ser_ptr->name, ser_ptr, ser_ptr->PortrangeList.len,
-                        d_node, d_node->data);
-
-                portrange_ptr = d_node->data;
-                if (portrange_ptr == NULL) {
-                    vrmr_error(-1, "Internal Error", "NULL pointer");
-                    return (-1);
-                }
+        for (unsigned int i = 0; i < ser_ptr->PortrangeList.len; i++) {
+            if (!(portrange_ptr = ser_ptr->PortrangeList.data[i])) {
+                vrmr_error(-1, "Internal Error", "NULL pointer");
+                goto error;
+            }
 
-                if (portrange_ptr->dst_high == 0) {
-                    /*  once a service is inserted into the hash, we dont need
-                       to insert it again under the same hash
-
-                        we don't do this check for GRE, because dst_low and
-                       vrmr_hash_port are both 0
-                    */
-                    if ((portrange_ptr->protocol == 1 ||
-                                portrange_ptr->protocol == 6 ||
-                                portrange_ptr->protocol == 17) &&
-                            portrange_ptr->dst_low == ser_ptr->vrmr_hash_port) {
-                        vrmr_debug(HIGH,
-                                "dupe! service '%s': hashport: %d, prot: %d, "
-                                "src_low: %d, src_high: %d, dst_low: %d, "
-                                "dst_high: %d",
-                                ser_ptr->name, ser_ptr->vrmr_hash_port,
-                                portrange_ptr->protocol, portrange_ptr->src_low,
-                                portrange_ptr->src_high, portrange_ptr->dst_low,
-                                portrange_ptr->dst_high);
-                    } else {
-                        if (!(portrange_ptr->protocol == 1 ||
-                                    portrange_ptr->protocol == 6 ||
-                                    portrange_ptr->protocol == 17))
-                            ser_ptr->vrmr_hash_port = portrange_ptr->protocol;
-                        else
-                            ser_ptr->vrmr_hash_port = portrange_ptr->dst_low;
-
-                        vrmr_debug(HIGH,
-                                "(dst_high == 0): service '%s': hashport: %d, "
-                                "prot: %d, src_low: %d, src_high: %d, dst_low: "
-                                "%d, dst_high: %d",
-                                ser_ptr->name, ser_ptr->vrmr_hash_port,
-                                portrange_ptr->protocol, portrange_ptr->src_low,
-                                portrange_ptr->src_high, portrange_ptr->dst_low,
-                                portrange_ptr->dst_high);
-
-                        if (vrmr_hash_insert(hash_table, ser_ptr) != 0) {
-                            vrmr_error(-1, "Internal Error",
-                                    "inserting into hashtable failed");
-                            return (1);
-                        }
-                    }
-                } else {
-                    for (port = portrange_ptr->dst_low;
-                            port <= portrange_ptr->dst_high; port++) {
-                        ser_ptr->vrmr_hash_port = port;
-
-                        if (vrmr_hash_insert(hash_table, ser_ptr) != 0) {
-                            vrmr_error(-1, "Internal Error",
-                                    "inserting into hashtable failed");
-                            return (1);
-                        }
-                    }
-                }
+            vrmr_debug(HIGH,
+                    "service '%s': prot: %d, src_low: %d, src_high: %d, "
+                    "dst_low: %d, dst_high: %d",
+                    ser_ptr->name, portrange_ptr->protocol,
+                    portrange_ptr->src_low, portrange_ptr->src_high,
+                    portrange_ptr->dst_low, portrange_ptr->dst_high);
+
+            if (portrange_ptr->protocol == 6 || portrange_ptr->protocol == 17) {
+                /* see services_ports_build() */
+                continue;
+            } else if (portrange_ptr->protocol == 1) {
+                /* icmp: dst_low is the type */
+                vrmr_map_key_portproto(
+                        &key, (uint16_t)portrange_ptr->dst_low, 1);
+                if (services_map_insert(&index->map, &key, ser_ptr) < 0)
+                    goto error;
+            } else {
+                vrmr_map_key_portproto(
+                        &key, 0, (uint8_t)portrange_ptr->protocol);
+                if (services_map_insert(&index->map, &key, ser_ptr) < 0)
+                    goto error;
             }
         }
-
-        /* now we reset the hash-port variable, otherwise it disturb creating
-           the hash again (this function depends on vrmr_hash_port to be 0 on
-           start) */
-        ser_ptr->vrmr_hash_port = 0;
     }
 
+    if (services_ports_build(&index->tcp, services_list, 6) < 0 ||
+            services_ports_build(&index->udp, services_list, 17) < 0)
+        goto error;
     return (0);
+
+error:
+    vrmr_services_index_cleanup(index);
+    return (-1);
 }
 
-/*
- */
-int vrmr_init_zonedata_hashtable(unsigned int n_rows,
-        struct vrmr_list *zones_list,
-        unsigned int (*hash_func)(const void *data),
-        int (*compare_func)(const void *table_data, const void *search_data),
-        struct vrmr_hash_table *hash_table)
+void vrmr_services_index_cleanup(struct vrmr_services_index *index)
+{
+    assert(index);
+
+    services_ports_cleanup(&index->tcp);
+    services_ports_cleanup(&index->udp);
+    vrmr_map_cleanup(&index->map);
+}
+
+/*  vrmr_init_zonedata_hashtable
+
+    Builds a map of ipaddress to host (and firewall) zone.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_init_zonedata_hashtable(
+        struct vrmr_list *zones_list, struct vrmr_map *map)
 {
     struct vrmr_zone *zone_ptr = NULL;
     struct vrmr_list_node *d_node = NULL;
+    struct vrmr_map_key key;
 
-    assert(zones_list);
+    assert(zones_list && map);
 
-    /* setup the hash table */
-    if (vrmr_hash_setup(hash_table, n_rows, hash_func, compare_func, NULL) !=
-            0) {
-        vrmr_error(-1, "Internal Error", "hash table initializing failed");
+    if (vrmr_map_setup(map, VRMR_MAP_KEY_IP, zones_list->len) < 0) {
+        vrmr_error(-1, "Internal Error", "map initializing failed");
         return (-1);
     }
 
-    /* go through the list and insert into the hash-table */
+    /* go through the list and insert into the map */
     for (d_node = zones_list->top; d_node; d_node = d_node->next) {
         if (!(zone_ptr = d_node->data)) {
             vrmr_error(-1, "Internal Error", "NULL pointer");
@@ -539,133 +754,327 @@ int vrmr_init_zonedata_hashtable(unsigned int n_rows,
         /* we only insert hosts and firewalls, which are actually interfaces */
         if (zone_ptr->type == VRMR_TYPE_HOST ||
                 zone_ptr->type == VRMR_TYPE_FIREWALL) {
-            if (strcmp(zone_ptr->ipv4.ipaddress, "") != 0) {
-                if (vrmr_hash_insert(hash_table, zone_ptr) != 0) {
-                    vrmr_error(-1, "Internal Error",
-                            "inserting hashtable failed for %s",
-                            zone_ptr->name);
-                    return (-1);
-                } else {
-                    vrmr_debug(HIGH, "vrmr_hash_insert succes (%s)",
-                            zone_ptr->name);
-                }
-            } else {
-                vrmr_debug(HIGH, "no ipaddress in zone %s (%s)", zone_ptr->name,
-                        zone_ptr->ipv4.ipaddress);
+            if (strcmp(zone_ptr->ipv4.ipaddress, "") == 0) {
+                vrmr_debug(HIGH, "no ipaddress in zone %s", zone_ptr->name);
+                continue;
+            }
+            if (vrmr_map_key_ip(&key, zone_ptr->ipv4.ipaddress) < 0) {
+                vrmr_debug(HIGH, "invalid ipaddress '%s' in zone %s",
+                        zone_ptr->ipv4.ipaddress, zone_ptr->name);
+                continue;
             }
+            if (vrmr_map_insert(map, &key, zone_ptr) < 0) {
+                vrmr_error(-1, "Internal Error",
+                        "inserting into map failed for %s", zone_ptr->name);
+                return (-1);
+            }
+            vrmr_debug(HIGH, "vrmr_map_insert succes (%s)", zone_ptr->name);
         }
     }
 
     return (0);
 }
 
+static int service_match_cb(const void *data, const void *ctx)
+{
+    return (service_match_portdata(data, ctx));
+}
+
 void *vrmr_search_service_in_hash(const int src, const int dst,
-        const int protocol, const struct vrmr_hash_table *serhash)
+        const int protocol, const struct vrmr_services_index *serhash)
 {
-    struct vrmr_service *ser_search_ptr = NULL, *return_ptr = NULL;
-    struct vrmr_portdata *portrange_ptr = NULL;
-    int vrmr_hash_port = 0, src_port = 0, dst_port = 0;
+    struct vrmr_service *return_ptr = NULL;
+    struct vrmr_portdata search;
+    struct vrmr_map_key key;
 
     assert(serhash);
 
     vrmr_debug(HIGH, "src: %d, dst: %d, protocol: %d.", src, dst, protocol);
 
+    memset(&search, 0, sizeof(search));
+    search.protocol = protocol;
+
+    /* here we do the actual search */
     if (protocol == 6 || protocol == 17) {
-        vrmr_hash_port = dst;
-        src_port = src;
-        dst_port = dst;
-    } else if (protocol == 1) {
-        /* hashport is the icmptype */
-        vrmr_hash_port = src;
-        src_port = src;
-        dst_port = dst;
+        search.src_low = src;
+        search.dst_low = dst;
+        return_ptr = services_ports_search(
+                protocol == 6 ? &serhash->tcp : &serhash->udp, &search);
     } else {
-        vrmr_hash_port = protocol;
-        src_port = 1;
-        dst_port = 1;
+        if (protocol == 1) {
+            /* src is the icmp type, dst the code */
+            search.dst_low = src;
+            search.dst_high = dst;
+            vrmr_map_key_portproto(&key, (uint16_t)src, 1);
+        } else {
+            vrmr_map_key_portproto(&key, 0, (uint8_t)protocol);
+        }
+        return_ptr = vrmr_map_search_match(
+                &serhash->map, &key, service_match_cb, &search);
     }
 
-    /* alloc the temp service */
-    if (!(ser_search_ptr = vrmr_service_malloc())) {
-        vrmr_error(-1, "Error", "malloc failed: %s", strerror(errno));
-        return (NULL);
-    }
-    vrmr_list_setup(&ser_search_ptr->PortrangeList, free);
+    if (!return_ptr)
+        vrmr_debug(HIGH, "src: %d, dst: %d, protocol: %d: not found.", src, dst,
+                protocol);
+    else
+        vrmr_debug(HIGH, "src: %d, dst: %d, protocol: %d: found: %s.", src, dst,
+                protocol, return_ptr->name);
 
-    /* alloc the portrange */
-    if (!(portrange_ptr = malloc(sizeof(struct vrmr_portdata)))) {
-        vrmr_error(-1, "Error", "malloc failed: %s", strerror(errno));
+    return (return_ptr);
+}
 
-        free(ser_search_ptr);
+void *vrmr_search_zone_in_hash_with_ipv4(
+        const char *ipaddress, const struct vrmr_map *zonehash)
+{
+    struct vrmr_map_key key;
+
+    assert(ipaddress && zonehash);
+
+    if (vrmr_map_key_ip(&key, ipaddress) < 0)
         return (NULL);
+
+    return (vrmr_map_search(zonehash, &key));
+}
+
+/*  vrmr_hash_name
+
+    FNV-1a hash of a name. Used by the name index.
+*/
+unsigned int vrmr_hash_name(const char *name)
+{
+    uint32_t hash = 2166136261U;
+
+    assert(name);
+
+    for (; *name != '\0'; name++) {
+        hash ^= (uint8_t)*name;
+        hash *= 16777619U;
     }
+    return ((unsigned int)hash);
+}
 
-    /* populate the portrange */
-    portrange_ptr->protocol = protocol;
-    if (protocol == 1) {
-        portrange_ptr->dst_low = src_port;
-        portrange_ptr->dst_high = dst_port;
-    } else {
-        portrange_ptr->dst_low = dst_port;
-        portrange_ptr->src_low = src_port;
+#define VRMR_NAME_INDEX_MIN_ROWS 64
+
+/*  name_index_hash
+
+    The names in the index are interned, see vrmr_intern(), so the row is
+    picked by the address of the interned name and names are compared by
+    pointer.
+*/
+static unsigned int name_index_hash(const char *iname)
+{
+    uintptr_t p = (uintptr_t)iname;
+    uint32_t hash = 2166136261U;
+
+    for (size_t i = 0; i < sizeof(p); i++, p >>= 8) {
+        hash ^= (uint8_t)p;
+        hash *= 16777619U;
     }
+    return ((unsigned int)hash);
+}
 
-    /* set the hash port */
-    ser_search_ptr->vrmr_hash_port = vrmr_hash_port;
+/*  name_index_grow
 
-    if (vrmr_list_append(&ser_search_ptr->PortrangeList, portrange_ptr) ==
-            NULL) {
-        vrmr_error(-1, "Error",
-                "insert into list failed for src: %d, dst: %d, prot: %d", src,
-                dst, protocol);
-        free(portrange_ptr);
-        free(ser_search_ptr);
-        return (NULL);
+    Doubles the number of rows and rehashes the cells into them. The entries
+    themselves are reused, only the row array is reallocated.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int name_index_grow(struct vrmr_name_index *idx)
+{
+    unsigned int new_rows =
+            idx->rows ? idx->rows * 2 : VRMR_NAME_INDEX_MIN_ROWS;
+    struct vrmr_name_index_entry **new_table = NULL;
+
+    if (!(new_table = calloc(new_rows, sizeof(*new_table)))) {
+        vrmr_error(-1, "Error", "calloc failed: %s", strerror(errno));
+        return (-1);
     }
 
-    /* here we do the actual search */
-    return_ptr = vrmr_hash_search(serhash, (void *)ser_search_ptr);
+    for (unsigned int row = 0; row < idx->rows; row++) {
+        struct vrmr_name_index_entry *entry = idx->table[row], *next = NULL;
 
-    /* cleanup */
-    portrange_ptr = NULL;
-    vrmr_list_cleanup(&ser_search_ptr->PortrangeList);
-    free(ser_search_ptr);
+        for (; entry; entry = next) {
+            next = entry->next;
 
-    if (!return_ptr)
-        vrmr_debug(HIGH, "src: %d, dst: %d, protocol: %d: not found.", src, dst,
-                protocol);
-    else
-        vrmr_debug(HIGH, "src: %d, dst: %d, protocol: %d: found: %s.", src, dst,
-                protocol, return_ptr->name);
+            unsigned int new_row = entry->hash & (new_rows - 1);
+            entry->next = new_table[new_row];
+            new_table[new_row] = entry;
+        }
+    }
 
-    return (return_ptr);
+    free(idx->table);
+    idx->table = new_table;
+    idx->rows = new_rows;
+    return (0);
 }
 
-void *vrmr_search_zone_in_hash_with_ipv4(
-        const char *ipaddress, const struct vrmr_hash_table *zonehash)
+/*  vrmr_name_index_insert
+
+    Adds 'data' under 'name'. The index keeps an interned copy of the name,
+    so the caller may change or free its copy afterwards. Duplicate names
+    are allowed, they are returned most recently inserted first.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_name_index_insert(
+        struct vrmr_name_index *idx, const char *name, void *data)
 {
-    struct vrmr_zone *search_ptr = NULL, *return_ptr = NULL;
+    struct vrmr_name_index_entry *entry = NULL;
 
-    assert(ipaddress && zonehash);
+    assert(idx && name && data);
 
-    /* search zone ptr */
-    if (!(search_ptr = malloc(sizeof(struct vrmr_zone)))) {
+    /* keep the load factor at or below 1 */
+    if (idx->cells >= idx->rows) {
+        if (name_index_grow(idx) < 0)
+            return (-1);
+    }
+
+    if (!(entry = malloc(sizeof(*entry)))) {
         vrmr_error(-1, "Error", "malloc failed: %s", strerror(errno));
-        return (NULL);
+        return (-1);
+    }
+    if (!(entry->name = vrmr_intern(name))) {
+        free(entry);
+        return (-1);
+    }
+    entry->hash = name_index_hash(entry->name);
+    entry->data = data;
+
+    unsigned int row = entry->hash & (idx->rows - 1);
+    entry->next = idx->table[row];
+    idx->table[row] = entry;
+
+    idx->cells++;
+    return (0);
+}
+
+/*  vrmr_name_index_remove
+
+    Removes the entry for 'data' stored under 'name'. If the object was
+    renamed without updating the index, the stale entry is looked up by
+    its data pointer instead.
+
+    Returncodes:
+         0: ok
+        -1: not found
+*/
+int vrmr_name_index_remove(
+        struct vrmr_name_index *idx, const char *name, const void *data)
+{
+    struct vrmr_name_index_entry **entry_ptr = NULL, *entry = NULL;
+
+    assert(idx && name && data);
+
+    if (idx->cells == 0)
+        return (-1);
+
+    const char *iname = vrmr_intern_lookup(name);
+    if (iname != NULL) {
+        unsigned int hash = name_index_hash(iname);
+        for (entry_ptr = &idx->table[hash & (idx->rows - 1)]; *entry_ptr;
+                entry_ptr = &(*entry_ptr)->next) {
+            entry = *entry_ptr;
+
+            if (entry->data == data && entry->name == iname) {
+                *entry_ptr = entry->next;
+                vrmr_intern_release(entry->name);
+                free(entry);
+                idx->cells--;
+                return (0);
+            }
+        }
     }
 
-    if (strlcpy(search_ptr->ipv4.ipaddress, ipaddress,
-                sizeof(search_ptr->ipv4.ipaddress)) >=
-            sizeof(search_ptr->ipv4.ipaddress)) {
-        vrmr_error(-1, "Internal Error", "buffer overflow");
+    /* slow path: the name was changed behind our back */
+    for (unsigned int row = 0; row < idx->rows; row++) {
+        for (entry_ptr = &idx->table[row]; *entry_ptr;
+                entry_ptr = &(*entry_ptr)->next) {
+            entry = *entry_ptr;
+
+            if (entry->data == data) {
+                vrmr_debug(LOW, "stale index entry '%s' for '%s'.",
+                        entry->name, name);
+
+                *entry_ptr = entry->next;
+                vrmr_intern_release(entry->name);
+                free(entry);
+                idx->cells--;
+                return (0);
+            }
+        }
+    }
+
+    return (-1);
+}
+
+/*  vrmr_name_index_search_match
+
+    Returns the first object stored under 'name' for which 'match' returns
+    non-zero, or NULL if there is none. If 'match' is NULL the first object
+    with the name is returned.
+*/
+void *vrmr_name_index_search_match(const struct vrmr_name_index *idx,
+        const char *name, int (*match)(const void *data, const void *ctx),
+        const void *ctx)
+{
+    struct vrmr_name_index_entry *entry = NULL;
+
+    assert(idx && name);
+
+    if (idx->cells == 0)
+        return (NULL);
 
-        free(search_ptr);
+    /* a name that isn't interned isn't in any index */
+    const char *iname = vrmr_intern_lookup(name);
+    if (iname == NULL)
         return (NULL);
+
+    unsigned int hash = name_index_hash(iname);
+    for (entry = idx->table[hash & (idx->rows - 1)]; entry;
+            entry = entry->next) {
+        if (entry->name == iname &&
+                (match == NULL || match(entry->data, ctx))) {
+            return (entry->data);
+        }
     }
 
-    return_ptr = vrmr_hash_search(zonehash, (void *)search_ptr);
+    return (NULL);
+}
 
-    free(search_ptr);
+/*  vrmr_name_index_search
 
-    return (return_ptr);
+    Returns the object stored under 'name', or NULL if not found.
+*/
+void *vrmr_name_index_search(
+        const struct vrmr_name_index *idx, const char *name)
+{
+    return (vrmr_name_index_search_match(idx, name, NULL, NULL));
+}
+
+/*  vrmr_name_index_cleanup
+
+    Frees the index. The objects themselves are not touched. The index is
+    left empty and can be reused.
+*/
+void vrmr_name_index_cleanup(struct vrmr_name_index *idx)
+{
+    assert(idx);
+
+    for (unsigned int row = 0; row < idx->rows; row++) {
+        struct vrmr_name_index_entry *entry = idx->table[row], *next = NULL;
+
+        for (; entry; entry = next) {
+            next = entry->next;
+            vrmr_intern_release(entry->name);
+            free(entry);
+        }
+    }
+
+    free(idx->table);
+    memset(idx, 0, sizeof(*idx));
 }
@@ -21,6 +21,8 @@
 #include "config.h"
 #include "vuurmuur.h"
 
+#include <linux/rtnetlink.h>
+
 int vrmr_get_ip_info(struct vrmr_ctx *vctx, const char *name,
         struct vrmr_zone *answer_ptr, struct vrmr_regex *reg)
 {
@@ -491,123 +493,174 @@ int vrmr_check_active(struct vrmr_ctx *vctx, char *name, int type)
     }
 }
 
-/*  vrmr_get_dynamic_ip
+/*
+    The addresses of a device, from a RTM_GETADDR dump of the kernel.
+*/
+
+struct dynamic_ip_ctx {
+    unsigned int ifindex;
+    unsigned char family;
+    char *answer_ptr;
+    size_t size;
+    int result;
+};
+
+static int dynamic_ip_attr_cb(const struct nlattr *attr, void *data)
+{
+    const struct nlattr **tb = data;
+
+    if (mnl_attr_type_valid(attr, IFA_MAX) < 0)
+        return (MNL_CB_OK);
+
+    tb[mnl_attr_get_type(attr)] = attr;
+    return (MNL_CB_OK);
+}
+
+static int dynamic_ip_data_cb(const struct nlmsghdr *nlh, void *data)
+{
+    struct dynamic_ip_ctx *ctx = data;
+    const struct ifaddrmsg *ifa = mnl_nlmsg_get_payload(nlh);
+    const struct nlattr *tb[IFA_MAX + 1];
+
+    /* the first (primary) address of the device wins */
+    if (ctx->result != 0 || ifa->ifa_index != ctx->ifindex ||
+            ifa->ifa_family != ctx->family)
+        return (MNL_CB_OK);
+    if (ifa->ifa_flags & (IFA_F_SECONDARY | IFA_F_TENTATIVE |
+                                 IFA_F_DADFAILED | IFA_F_DEPRECATED))
+        return (MNL_CB_OK);
+    /* no link local IPv6 addresses */
+    if (ifa->ifa_family == AF_INET6 && ifa->ifa_scope != RT_SCOPE_UNIVERSE)
+        return (MNL_CB_OK);
+
+    memset(tb, 0, sizeof(tb));
+    if (mnl_attr_parse(nlh, sizeof(*ifa), dynamic_ip_attr_cb, tb) < 0)
+        return (MNL_CB_ERROR);
+
+    /* on point to point links IFA_ADDRESS is the address of the peer */
+    const struct nlattr *attr = tb[IFA_LOCAL] ? tb[IFA_LOCAL] : tb[IFA_ADDRESS];
+    if (attr == NULL)
+        return (MNL_CB_OK);
+
+    char ipaddress[INET6_ADDRSTRLEN] = "";
+    if (inet_ntop(ifa->ifa_family, mnl_attr_get_payload(attr), ipaddress,
+                (socklen_t)sizeof(ipaddress)) == NULL ||
+            strlcpy(ctx->answer_ptr, ipaddress, ctx->size) >= ctx->size) {
+        vrmr_error(-1, "Error", "copying ipaddress '%s' failed", ipaddress);
+        ctx->result = -1;
+        return (MNL_CB_OK);
+    }
+    ctx->result = 1;
+    return (MNL_CB_OK);
+}
+
+/*  dynamic_ip_request
 
-    partly ripped from Net-tools 1.60 (c) Phil Blundell philb@gnu.org and
-    Bernd Eckenfels net-tools@lina.inka.de
+    Gets the address of 'family' of 'device' from the kernel. This replaces
+    the SIOCGIFCONF listing of all interfaces, which only knew about IPv4.
 
     Returncodes:
         1: ok
         0: not found
         -1: error
- */
-int vrmr_get_dynamic_ip(char *device, char *answer_ptr, size_t size)
+*/
+static int dynamic_ip_request(const char *device, unsigned char family,
+        char *answer_ptr, size_t size)
 {
-    int numreqs = 30;
-    struct ifconf ifc;
-    struct ifreq *ifr_ptr = NULL, ifr_struct;
-    char ipaddress[16] = "";
-    struct sockaddr *sa = NULL;
-    struct sockaddr_in *sin = NULL;
+    char buf[MNL_SOCKET_BUFFER_SIZE];
+    struct mnl_socket *nl = NULL;
+    struct dynamic_ip_ctx ctx = {.family = family,
+            .answer_ptr = answer_ptr,
+            .size = size,
+            .result = 0};
 
     assert(size);
     assert(device && answer_ptr);
 
-    /* open a socket for ioctl */
-    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
-    if (sockfd == -1) {
-        vrmr_error(-1, "Error", "couldn't open socket: %s", strerror(errno));
-        return (-1);
+    if ((ctx.ifindex = if_nametoindex(device)) == 0) {
+        vrmr_debug(LOW, "device '%s' not found.", device);
+        return (0);
     }
 
-    /* initialize the buf otherwise realloc will freak out (read segv) */
-    ifc.ifc_buf = NULL;
-    for (;;) {
-        ifc.ifc_len = (int)(sizeof(struct ifreq) * numreqs);
-        /* get some mem */
-        if (!(ifc.ifc_buf = realloc(ifc.ifc_buf, (size_t)ifc.ifc_len))) {
-            vrmr_error(-1, "Error", "realloc failed: %s", strerror(errno));
-            (void)close(sockfd);
-            return (-1);
-        }
+    struct nlmsghdr *nlh = mnl_nlmsg_put_header(buf);
+    nlh->nlmsg_type = RTM_GETADDR;
+    nlh->nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    unsigned int seq = nlh->nlmsg_seq = (unsigned int)time(NULL);
 
-        /* get the interfaces from the system */
-        if (ioctl(sockfd, SIOCGIFCONF, &ifc) < 0) {
-            vrmr_error(-1, "Error", "ioctl(SIOCGIFCONF) failed: %s",
-                    strerror(errno));
-            free(ifc.ifc_buf);
-            (void)close(sockfd);
-            return (-1);
-        }
-        if (ifc.ifc_len == (int)(sizeof(struct ifreq) * numreqs)) {
-            /* assume it overflowed and try again */
-            numreqs += 10;
-            continue;
-        }
-        break;
+    struct ifaddrmsg *ifa = mnl_nlmsg_put_extra_header(nlh, sizeof(*ifa));
+    ifa->ifa_family = family;
+
+    if (!(nl = mnl_socket_open(NETLINK_ROUTE))) {
+        vrmr_error(-1, "Error", "mnl_socket_open failed: %s", strerror(errno));
+        return (-1);
+    }
+    if (mnl_socket_bind(nl, 0, MNL_SOCKET_AUTOPID) < 0) {
+        vrmr_error(-1, "Error", "mnl_socket_bind failed: %s", strerror(errno));
+        mnl_socket_close(nl);
+        return (-1);
     }
+    unsigned int portid = mnl_socket_get_portid(nl);
 
-    ifr_ptr = ifc.ifc_req;
-    for (int n = 0; n < ifc.ifc_len; n += sizeof(struct ifreq)) {
-        vrmr_debug(HIGH, "ifr_ptr->ifr_name: '%s'.", ifr_ptr->ifr_name);
+    if (mnl_socket_sendto(nl, nlh, nlh->nlmsg_len) < 0) {
+        vrmr_error(-1, "Error", "mnl_socket_sendto failed: %s",
+                strerror(errno));
+        mnl_socket_close(nl);
+        return (-1);
+    }
 
-        if (strcmp(device, ifr_ptr->ifr_name) == 0) {
-            if (strlcpy(ifr_struct.ifr_name, ifr_ptr->ifr_name,
-                        sizeof(ifr_struct.ifr_name)) >=
-                    sizeof(ifr_struct.ifr_name)) {
-                vrmr_error(-1, "Error", "buffer overflow");
-                (void)close(sockfd);
-                free(ifc.ifc_buf);
-                return (-1);
-            }
-            /* we only care about IPv4 */
-            ifr_struct.ifr_addr.sa_family = AF_INET;
+    /* read the whole dump, even after finding the address */
+    ssize_t ret;
+    while ((ret = mnl_socket_recvfrom(nl, buf, sizeof(buf))) > 0) {
+        int r = mnl_cb_run(
+                buf, (size_t)ret, seq, portid, dynamic_ip_data_cb, &ctx);
+        if (r == MNL_CB_STOP)
+            break;
+        if (r == MNL_CB_ERROR) {
+            vrmr_error(-1, "Error", "mnl_cb_run failed: %s", strerror(errno));
+            ctx.result = -1;
+            break;
+        }
+    }
+    if (ret < 0) {
+        vrmr_error(-1, "Error", "mnl_socket_recvfrom failed: %s",
+                strerror(errno));
+        ctx.result = -1;
+    }
+    mnl_socket_close(nl);
 
-            /* cast to a socketaddr */
-            sa = &ifr_struct.ifr_addr;
+    if (ctx.result == 1)
+        vrmr_debug(LOW, "device: '%s', ipaddress: '%s'.", device, answer_ptr);
+    else if (ctx.result == 0)
+        vrmr_debug(LOW, "device '%s' has no address.", device);
+    return (ctx.result);
+}
 
-            if (ioctl(sockfd, SIOCGIFADDR, &ifr_struct) == 0) {
-                sin = (struct sockaddr_in *)sa;
+/*  vrmr_get_dynamic_ip
 
-                /* get the ipaddress into a string */
-                if (inet_ntop(AF_INET, &sin->sin_addr, ipaddress,
-                            (socklen_t)sizeof(ipaddress)) == NULL) {
-                    vrmr_error(-1, "Error",
-                            "getting ipaddress for device '%s' failed: %s",
-                            device, strerror(errno));
-                    (void)close(sockfd);
-                    free(ifc.ifc_buf);
-                    return (-1);
-                }
+    Gets the IPv4 address of 'device'.
 
-                vrmr_debug(LOW, ", device: '%s', ipaddress: '%s'.", device,
-                        ipaddress);
+    Returncodes:
+        1: ok
+        0: not found
+        -1: error
+ */
+int vrmr_get_dynamic_ip(char *device, char *answer_ptr, size_t size)
+{
+    return (dynamic_ip_request(device, AF_INET, answer_ptr, size));
+}
 
-                /* copy back to the caller */
-                if (strlcpy(answer_ptr, ipaddress, size) >= size) {
-                    vrmr_error(-1, "Error",
-                            "copying ipaddress for device '%s' failed: "
-                            "destination buffer too small",
-                            device);
-                    (void)close(sockfd);
-                    free(ifc.ifc_buf);
-                    return (-1);
-                }
+/*  vrmr_get_dynamic_ip6
 
-                /* found! */
-                (void)close(sockfd);
-                free(ifc.ifc_buf);
-                return (1);
-            }
-        }
-        ifr_ptr++;
-    }
+    Gets the global IPv6 address of 'device'.
 
-    /* not found */
-    vrmr_debug(LOW, "device '%s' not found.", device);
-    close(sockfd);
-    free(ifc.ifc_buf);
-    return (0);
+    Returncodes:
+        1: ok
+        0: not found
+        -1: error
+ */
+int vrmr_get_dynamic_ip6(const char *device, char *answer_ptr, size_t size)
+{
+    return (dynamic_ip_request(device, AF_INET6, answer_ptr, size));
 }
 
 /**
@@ -81,46 +81,35 @@ static int vrmr_insert_interface_list(struct vrmr_interfaces *interfaces,
             return (-1);
         }
     }
+
+    /* and into the name index */
+    if (vrmr_name_index_insert(
+                &interfaces->index, iface_ptr->name, (void *)iface_ptr) < 0) {
+        vrmr_error(-1, "Internal Error", "vrmr_name_index_insert() failed");
+        return (-1);
+    }
     return (0);
 }
 
 /*  search_interface
 
-    Function to search the InterfacesList. This is a very slow
-    function. It worst case performance is O(n) where 'n' is the
-    size of the list.
+    Function to search the InterfacesList by name, using the name index.
 
     It returns the pointer or a NULL-pointer if not found.
 */
 void *vrmr_search_interface(
         const struct vrmr_interfaces *interfaces, const char *name)
 {
-    struct vrmr_list_node *d_node = NULL;
     struct vrmr_interface *iface_ptr = NULL;
 
     assert(name && interfaces);
 
     vrmr_debug(HIGH, "looking for interface '%s'.", name);
 
-    /* dont bother searching a empty list */
-    if (interfaces->list.len == 0)
-        return (NULL);
-
-    /*
-        loop trough the list and compare the names
-    */
-    for (d_node = interfaces->list.top; d_node; d_node = d_node->next) {
-        iface_ptr = d_node->data;
-        if (iface_ptr == NULL)
-            continue;
-
-        if (strcmp(iface_ptr->name, name) == 0) {
-            /* Found! */
-            vrmr_debug(HIGH, "Interface '%s' found!", name);
-
-            /* return the pointer we found */
-            return (iface_ptr);
-        }
+    if ((iface_ptr = vrmr_name_index_search(&interfaces->index, name))) {
+        /* Found! */
+        vrmr_debug(HIGH, "Interface '%s' found!", name);
+        return (iface_ptr);
     }
 
     /* if we get here, the interface was not found, so return NULL */
@@ -363,6 +352,7 @@ int vrmr_read_interface_info(
         /* check if ip is dynamic */
         if (strcmp(iface_ptr->ipv6.ip6, "dynamic") == 0) {
             iface_ptr->dynamic = TRUE;
+            iface_ptr->dynamic6 = TRUE;
         }
 
         iface_ptr->ipv6.cidr6 = 128;
@@ -839,6 +829,8 @@ int vrmr_delete_interface(struct vrmr_ctx *vctx,
                         -1, "Internal Error", "vrmr_list_remove_node() failed");
                 return (-1);
             }
+            (void)vrmr_name_index_remove(
+                    &interfaces->index, iface_ptr->name, iface_ptr);
 
             /* finally free the memory */
             free(iface_ptr);
@@ -989,8 +981,8 @@ int vrmr_rem_iface_from_zonelist(struct vrmr_list *zonelist)
 
 /*  vrmr_get_iface_stats
 
-    Gets information about an interface from /proc/net/dev. It can also be used
-    to check if an interface is up.
+    Gets the counters of an interface from the kernel through rtnetlink. It
+    can also be used to check if an interface exists.
 
     Returncodes:
          0: ok
@@ -1000,29 +992,9 @@ int vrmr_rem_iface_from_zonelist(struct vrmr_list *zonelist)
 int vrmr_get_iface_stats(const char *iface_name, uint32_t *recv_bytes,
         uint32_t *recv_packets, uint32_t *trans_bytes, uint32_t *trans_packets)
 {
-    char proc_net_dev[] = "/proc/net/dev";
-    char line[256] = "",
-
-         /*
-             NOTE: if you change the length of the interface, also change it in
-             sscanf!!!!
-         */
-            interface[64] = "";
-
-    int found = 0; /* indicates that the interface was found */
-
-    FILE *fp = NULL;
-
-    struct {
-        uint64_t bytes; /* a long because otherwise it would max handle 2gb */
-        uint64_t packets;
-        uint32_t errors;
-        uint32_t drop;
-        uint32_t fifo;
-        uint32_t frame;
-        uint32_t comp;
-        uint32_t multi;
-    } recv = {0, 0, 0, 0, 0, 0, 0, 0}, trans = {0, 0, 0, 0, 0, 0, 0, 0};
+    struct vrmr_counters_iface link;
+
+    assert(iface_name);
 
     /* first reset */
     if (recv_bytes != NULL)
@@ -1034,95 +1006,19 @@ int vrmr_get_iface_stats(const char *iface_name, uint32_t *recv_bytes,
     if (trans_packets != NULL)
         *trans_packets = 0;
 
-    /* open the proc entry */
-    if (!(fp = fopen(proc_net_dev, "r"))) {
-        vrmr_error(-1, "Internal Error", "unable to open '%s': %s",
-                proc_net_dev, strerror(errno));
-        return (-1);
-    }
-
-    /* loop trough the file */
-    while (fgets(line, (int)sizeof(line), fp) != NULL) {
-        if (strlen(line) == 0 || line[0] == '\n')
-            continue;
-
-        /*  first scan only the first string, here you can see why (from the
-           file): lo: 3335005   17735 ... eth0:1055472756 4679465 ...
-
-            notice that with eth0 there is no space between the semicolon and
-           the number. Thats where we test for.
-        */
-        sscanf(line, "%63s", interface);
-
-        if (strncmp(interface, iface_name, strlen(iface_name)) == 0) {
-            found = 1;
-
-            /* if only want to know if the device is up break out now */
-            if (!recv_bytes && !trans_bytes && !recv_packets && !trans_packets)
-                break;
-
-            /* if we have an semicolon at the end (common) */
-            if (interface[strlen(interface) - 1] == ':') {
-                int r = sscanf(line,
-                        "%32s %" PRIu64 " %" PRIu64
-                        " %u %u %u %u %u %u %" PRIu64 " %" PRIu64 " %u %u %u "
-                        "%u %u %u",
-                        interface, &recv.bytes, &recv.packets, &recv.errors,
-                        &recv.drop, &recv.fifo, &recv.frame, &recv.comp,
-                        &recv.multi, &trans.bytes, &trans.packets,
-                        &trans.errors, &trans.drop, &trans.fifo, &trans.frame,
-                        &trans.comp, &trans.multi);
-                if (r != 17)
-                    vrmr_debug(NONE,
-                            "r %d (17?), interface '%s' iface_name '%s' line "
-                            "'%s'",
-                            r, interface, iface_name, line);
-            }
-            /* else the recv bytes is very big and old format */
-            else {
-                char *bytes_start = strchr(interface, ':');
-                if (bytes_start != NULL) {
-                    bytes_start++; // skip past :
-                    char *end;
-                    recv.bytes = strtoul(bytes_start, &end, 10);
-                    if (end) {
-                        vrmr_debug(NONE, "recv.bytes %" PRIu64 " %s",
-                                recv.bytes, end);
-                    }
-                    char *line_part = line + strlen(interface);
-
-                    int y = sscanf(line_part,
-                            "%" PRIu64 " %u %u %u %u %u %u %" PRIu64 " %" PRIu64
-                            " %u %u %u %u %u "
-                            "%u",
-                            &recv.packets, &recv.errors, &recv.drop, &recv.fifo,
-                            &recv.frame, &recv.comp, &recv.multi, &trans.bytes,
-                            &trans.packets, &trans.errors, &trans.drop,
-                            &trans.fifo, &trans.frame, &trans.comp,
-                            &trans.multi);
-                    if (y != 15)
-                        vrmr_debug(NONE, "y %d (15?), line '%s'", y, line_part);
-                }
-            }
-
-            /* pass back to the calling function */
-            if (recv_bytes != NULL)
-                *recv_bytes = recv.bytes;
-            if (trans_bytes != NULL)
-                *trans_bytes = trans.bytes;
-            if (recv_packets != NULL)
-                *recv_packets = recv.packets;
-            if (trans_packets != NULL)
-                *trans_packets = trans.packets;
-        }
-    }
-
-    if (fclose(fp) < 0)
-        return (-1);
+    int result = vrmr_counters_get_link(iface_name, &link);
+    if (result != 0)
+        return (result);
 
-    /* if not found, return 1 */
-    if (found == 0)
-        return (1);
+    /* pass back to the calling function */
+    if (recv_bytes != NULL)
+        *recv_bytes = (uint32_t)link.rx_bytes;
+    if (trans_bytes != NULL)
+        *trans_bytes = (uint32_t)link.tx_bytes;
+    if (recv_packets != NULL)
+        *recv_packets = (uint32_t)link.rx_packets;
+    if (trans_packets != NULL)
+        *trans_packets = (uint32_t)link.tx_packets;
 
     return (0);
 }
@@ -1271,6 +1167,38 @@ void vrmr_destroy_interfaceslist(struct vrmr_interfaces *interfaces)
 
     /* then the list itself */
     vrmr_list_cleanup(&interfaces->list);
+    vrmr_name_index_cleanup(&interfaces->index);
+}
+
+/*  vrmr_interfaces_set_name
+
+    Renames an interface that is in the interfaces list, keeping the name
+    index in sync.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_interfaces_set_name(struct vrmr_interfaces *interfaces,
+        struct vrmr_interface *iface_ptr, const char *name)
+{
+    assert(interfaces && iface_ptr && name);
+
+    if (strlen(name) >= sizeof(iface_ptr->name)) {
+        vrmr_error(-1, "Internal Error", "buffer overflow");
+        return (-1);
+    }
+
+    (void)vrmr_name_index_remove(
+            &interfaces->index, iface_ptr->name, iface_ptr);
+    (void)strlcpy(iface_ptr->name, name, sizeof(iface_ptr->name));
+
+    if (vrmr_name_index_insert(&interfaces->index, iface_ptr->name,
+                iface_ptr) < 0) {
+        vrmr_error(-1, "Internal Error", "vrmr_name_index_insert() failed");
+        return (-1);
+    }
+    return (0);
 }
 
 /*  vrmr_interfaces_analyze_rule
@@ -1361,8 +1289,7 @@ int vrmr_interfaces_analyze_rule(struct vrmr_rule *rule_ptr,
 int vrmr_interfaces_rule_parse_line(
         const char *line, struct vrmr_rule *rule_ptr)
 {
-    size_t line_pos = 0, /* position in line */
-            var_pos = 0; /* position in varible */
+    size_t line_pos = 0; /* position in line */
     char against_keyw[32] = "";
     char action_str[32] = "";
 
@@ -1370,12 +1297,9 @@ int vrmr_interfaces_rule_parse_line(
     assert(strlen(line) <= VRMR_MAX_RULE_LENGTH);
 
     /* get the action */
-    for (; line_pos < sizeof(action_str) - 1 && line[line_pos] != ' ' &&
-            line[line_pos] != '\0' && line[line_pos] != '\n';
-            line_pos++, var_pos++) {
-        action_str[var_pos] = line[line_pos];
-    }
-    action_str[var_pos] = '\0';
+    if (vrmr_rules_get_word(line, &line_pos, action_str, sizeof(action_str)) <
+            0)
+        return (-1);
 
     rule_ptr->action = vrmr_rules_actiontoi(action_str);
     if (rule_ptr->action <= VRMR_AT_ERROR ||
@@ -1385,13 +1309,9 @@ int vrmr_interfaces_rule_parse_line(
     /* now we analyze the action */
     if (rule_ptr->action == VRMR_AT_PROTECT) {
         /* get the 'against' */
-        for (line_pos++, var_pos = 0;
-                var_pos < sizeof(against_keyw) - 1 && line[line_pos] != ' ' &&
-                line[line_pos] != '\0' && line[line_pos] != '\n';
-                line_pos++, var_pos++) {
-            against_keyw[var_pos] = line[line_pos];
-        }
-        against_keyw[var_pos] = '\0';
+        if (vrmr_rules_get_word(line, &line_pos, against_keyw,
+                    sizeof(against_keyw)) < 0)
+            return (-1);
 
         /*
             now check what kind of rule we have
@@ -1405,14 +1325,9 @@ int vrmr_interfaces_rule_parse_line(
         /*
             okay, now lets see what kind of danger we are talking about
         */
-        for (line_pos++, var_pos = 0;
-                var_pos < sizeof(rule_ptr->danger) - 1 &&
-                line[line_pos] != ' ' && line[line_pos] != '\0' &&
-                line[line_pos] != '\n';
-                line_pos++, var_pos++) {
-            rule_ptr->danger[var_pos] = line[line_pos];
-        }
-        rule_ptr->danger[var_pos] = '\0';
+        if (vrmr_rules_get_word(line, &line_pos, rule_ptr->danger,
+                    sizeof(rule_ptr->danger)) < 0)
+            return (-1);
 
         vrmr_debug(HIGH, "protect: danger: '%s'", rule_ptr->danger);
 
@@ -1517,6 +1432,16 @@ int vrmr_interfaces_check(struct vrmr_interface *iface_ptr)
             return (-1);
         }
     }
+    if (iface_ptr->dynamic6 == TRUE) {
+        ipresult = vrmr_get_dynamic_ip6(iface_ptr->device, iface_ptr->ipv6.ip6,
+                sizeof(iface_ptr->ipv6.ip6));
+        if (ipresult == 0) {
+            memset(iface_ptr->ipv6.ip6, 0, sizeof(iface_ptr->ipv6.ip6));
+        } else if (ipresult < 0) {
+            vrmr_error(-1, "Internal Error", "vrmr_get_dynamic_ip6() failed");
+            return (-1);
+        }
+    }
 
     /* check the ip if we have one */
     if (iface_ptr->ipv4.ipaddress[0] != '\0') {
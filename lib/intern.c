@@ -0,0 +1,171 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2019 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "config.h"
+#include "vuurmuur.h"
+
+/*
+    Interned names
+
+    Each distinct name is stored once and handed out as a const pointer, so
+    two interned names are equal if and only if the pointers are equal.
+    This is used for the names that are copied and compared over and over
+    again: the service and zone names of the conntrack entries, the names
+    in the name index of the zones, services, interfaces and rules, and the
+    iptables rules queued while creating the ruleset.
+
+    The strings are reference counted: every vrmr_intern() or
+    vrmr_intern_ref() needs a vrmr_intern_release(). Not thread safe.
+*/
+
+struct intern_entry {
+    unsigned int refs;
+    char str[];
+};
+
+static struct vrmr_map intern_map;
+static bool intern_ready = false;
+
+static struct intern_entry *intern_entry(const char *str)
+{
+    return ((struct intern_entry *)(str - offsetof(struct intern_entry, str)));
+}
+
+/*  vrmr_intern
+
+    Returns the interned copy of 'str', with a reference for the caller.
+
+    Returns NULL on error.
+*/
+const char *vrmr_intern(const char *str)
+{
+    struct vrmr_map_key key;
+    struct intern_entry *entry = NULL;
+
+    assert(str);
+
+    if (!intern_ready) {
+        if (vrmr_map_setup(&intern_map, VRMR_MAP_KEY_STRING, 0) < 0)
+            return (NULL);
+        intern_ready = true;
+    }
+
+    vrmr_map_key_string(&key, str);
+    if ((entry = vrmr_map_search(&intern_map, &key)) != NULL) {
+        entry->refs++;
+        return (entry->str);
+    }
+
+    size_t len = strlen(str) + 1;
+    if (!(entry = malloc(sizeof(*entry) + len))) {
+        vrmr_error(-1, "Error", "malloc failed: %s", strerror(errno));
+        return (NULL);
+    }
+    entry->refs = 1;
+    memcpy(entry->str, str, len);
+
+    vrmr_map_key_string(&key, entry->str);
+    if (vrmr_map_insert(&intern_map, &key, entry) < 0) {
+        free(entry);
+        return (NULL);
+    }
+    return (entry->str);
+}
+
+/*  vrmr_intern_lookup
+
+    Returns the interned copy of 'str' without taking a reference, or NULL
+    if 'str' is not interned. A name that isn't interned isn't used by
+    anything, so a lookup that gets NULL can stop right there.
+*/
+const char *vrmr_intern_lookup(const char *str)
+{
+    struct vrmr_map_key key;
+    struct intern_entry *entry = NULL;
+
+    assert(str);
+
+    if (!intern_ready)
+        return (NULL);
+
+    vrmr_map_key_string(&key, str);
+    if ((entry = vrmr_map_search(&intern_map, &key)) == NULL)
+        return (NULL);
+    return (entry->str);
+}
+
+/*  vrmr_intern_ref
+
+    Takes another reference to the interned 'str'. Returns 'str'.
+*/
+const char *vrmr_intern_ref(const char *str)
+{
+    if (str != NULL)
+        intern_entry(str)->refs++;
+    return (str);
+}
+
+/*  vrmr_intern_release
+
+    Drops a reference to the interned 'str', which may be NULL. The last
+    one frees it.
+*/
+void vrmr_intern_release(const char *str)
+{
+    struct vrmr_map_key key;
+
+    if (str == NULL)
+        return;
+
+    struct intern_entry *entry = intern_entry(str);
+    assert(entry->refs > 0);
+    if (--entry->refs > 0)
+        return;
+
+    vrmr_map_key_string(&key, entry->str);
+    (void)vrmr_map_remove(&intern_map, &key, entry);
+    free(entry);
+}
+
+/*  vrmr_intern_cleanup
+
+    Frees all interned names, whether they were released or not. For use
+    at exit, when none of them is used anymore. Names that are still
+    referenced are reported in debug mode, they point at a missing
+    vrmr_intern_release().
+*/
+void vrmr_intern_cleanup(void)
+{
+    struct intern_entry *entry = NULL;
+    unsigned int iter = 0, leaked = 0;
+
+    if (!intern_ready)
+        return;
+
+    while ((entry = vrmr_map_iter(&intern_map, &iter)) != NULL) {
+        leaked++;
+        free(entry);
+    }
+    if (leaked > 0)
+        vrmr_debug(LOW, "%u interned names were not released.", leaked);
+
+    vrmr_map_cleanup(&intern_map);
+    intern_ready = false;
+}
@@ -247,7 +247,7 @@ int vrmr_check_pidfile(char *pidfile_location, pid_t *thepid)
     return (0);
 }
 
-int vrmr_create_pidfile(char *pidfile_location, int shm_id)
+int vrmr_create_pidfile(char *pidfile_location)
 {
     FILE *fp;
     pid_t pid;
@@ -269,7 +269,7 @@ int vrmr_create_pidfile(char *pidfile_location, int shm_id)
                 pidfile_location, strerror(errno));
         return (-1);
     }
-    if (fprintf(fp, "%ld %d\n", (long)pid, shm_id) < 0) {
+    if (fprintf(fp, "%ld\n", (long)pid) < 0) {
         vrmr_error(-1, "Error", "writing pid-file '%s' failed: %s.",
                 pidfile_location, strerror(errno));
         fclose(fp);
@@ -542,6 +542,12 @@ int libvuurmuur_exec_command(struct vrmr_config *cnf ATTR_UNUSED,
             exit(127);
         }
 
+        /* the daemon blocks signals to read them from a signalfd, don't
+         * pass that on to the command */
+        sigset_t sigmask;
+        sigemptyset(&sigmask);
+        (void)sigprocmask(SIG_SETMASK, &sigmask, NULL);
+
         /* actually exec the command */
         execv(path, (char **)argv);
 
@@ -571,17 +577,6 @@ int libvuurmuur_exec_command(struct vrmr_config *cnf ATTR_UNUSED,
     return retval;
 }
 
-void vrmr_shm_update_progress(int semid, int *shm_progress, int set_percent)
-{
-    if (vrmr_lock(semid)) {
-        *shm_progress = set_percent;
-
-        vrmr_unlock(semid);
-    }
-
-    vrmr_debug(HIGH, "set_percent %d.", set_percent);
-}
-
 // coverity[ +tainted_string_sanitize_content : arg-0 ]
 static bool sanitize_pid_string(char *s)
 {
@@ -596,17 +591,17 @@ static bool sanitize_pid_string(char *s)
 
 /*  get_vuurmuur_pid
 
-    Gets the pid and shm_id from vuurmuur.
+    Gets the pid of vuurmuur or vuurmuur_log from its pidfile.
 
     Returncodes:
         -1: error
             otherwise the pid of vuurmuur
 */
-pid_t get_vuurmuur_pid(char *vuurmuur_pidfile_location, int *shmid)
+pid_t get_vuurmuur_pid(char *vuurmuur_pidfile_location)
 {
     FILE *fp = NULL;
     pid_t pid = -1;
-    char line[32] = "", pid_c[16] = "", shm_c[16] = "";
+    char line[32] = "", pid_c[16] = "";
 
     /* open the pidfile */
     if (!(fp = fopen(vuurmuur_pidfile_location, "r")))
@@ -614,7 +609,7 @@ pid_t get_vuurmuur_pid(char *vuurmuur_pidfile_location, int *shmid)
 
     /* read the first line */
     if (fgets(line, (int)sizeof(line), fp) != NULL) {
-        sscanf(line, "%15s %15s", pid_c, shm_c);
+        sscanf(line, "%15s", pid_c);
 
         if (!sanitize_pid_string(pid_c)) {
             vrmr_error(-1, "Error", "invalid pid string '%s' in '%s'", pid_c,
@@ -639,15 +634,6 @@ pid_t get_vuurmuur_pid(char *vuurmuur_pidfile_location, int *shmid)
             return (-1);
         }
         pid = (pid_t)r;
-
-        endptr = NULL;
-        *shmid = (int)strtol(shm_c, &endptr, 10);
-        if (endptr == NULL || *endptr != '\0') {
-            vrmr_error(-1, "Error", "shmid string '%s' in '%s'", shm_c,
-                    vuurmuur_pidfile_location);
-            (void)fclose(fp);
-            return (-1);
-        }
     } else {
         /* no need to return, because pid isn't touched, so still -1 */
         vrmr_error(-1, "Error", "empty or corrupted pid file: '%s'",
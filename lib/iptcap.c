@@ -25,6 +25,8 @@
 
 #include "config.h"
 #include "vuurmuur.h"
+#include <stddef.h>
+#include <sys/utsname.h>
 
 static int iptcap_get_one_cap_from_proc(
         const char *procpath, const char *request)
@@ -624,13 +626,224 @@ static int iptcap_test_table(
     return retval;
 }
 
+/*
+    Probe result cache
+
+    Probing runs a modprobe and/or iptables command for most of the
+    capabilities. The results only change when the kernel, the iptables
+    binary or the set of loaded modules changes, so we store them together
+    with a key describing those and reuse them while the key still matches.
+*/
+
+/* modules of the other ip version, these don't influence the results */
+static bool iptcap_cache_module_foreign(const char *name, int ipv)
+{
+    if (ipv == VRMR_IPV4)
+        return (strncmp(name, "ip6", 3) == 0 || strstr(name, "ipv6") != NULL);
+
+    return (strncmp(name, "ipt", 3) == 0 || strcmp(name, "ip_tables") == 0 ||
+            strstr(name, "ipv4") != NULL);
+}
+
+/* hash the names of the loaded modules. The order of /proc/modules changes
+   when modules get loaded, so the per name hashes are combined in an order
+   independent way. */
+static uint32_t iptcap_cache_modules_hash(int ipv)
+{
+    char line[512] = "";
+    uint32_t sum = 0, cnt = 0;
+    bool newline = true;
+
+    FILE *fp = fopen("/proc/modules", "r");
+    if (fp == NULL)
+        return (0);
+
+    while (fgets(line, (int)sizeof(line), fp) != NULL) {
+        /* skip the remainder of overly long lines */
+        bool start = newline;
+        newline = (strchr(line, '\n') != NULL);
+        if (!start)
+            continue;
+
+        line[strcspn(line, " \n")] = '\0';
+        if (iptcap_cache_module_foreign(line, ipv))
+            continue;
+
+        uint32_t hash = 2166136261U;
+        for (const char *c = line; *c != '\0'; c++) {
+            hash ^= (uint8_t)*c;
+            hash *= 16777619U;
+        }
+        sum += hash;
+        cnt++;
+    }
+
+    fclose(fp);
+    return (sum ^ cnt);
+}
+
+/*  iptcap_cache_key
+
+    Builds the key from the kernel release and build, the (resolved)
+    iptables binary and the loaded modules.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int iptcap_cache_key(const char *ipt_loc, int ipv, bool load_modules,
+        char *key, size_t size)
+{
+    struct utsname uts;
+    struct stat st;
+
+    if (uname(&uts) != 0 || stat(ipt_loc, &st) != 0)
+        return (-1);
+
+    int r = snprintf(key, size, "%s %u %s %s %s:%lu:%lu:%lld:%lld %08x %d",
+            PACKAGE_VERSION, (unsigned int)sizeof(struct vrmr_iptcaps),
+            uts.release, uts.version, ipt_loc, (unsigned long)st.st_dev,
+            (unsigned long)st.st_ino, (long long)st.st_size,
+            (long long)st.st_mtime, iptcap_cache_modules_hash(ipv),
+            load_modules ? 1 : 0);
+    if (r < 0 || (size_t)r >= size)
+        return (-1);
+
+    return (0);
+}
+
+/*  iptcap_cache_read
+
+    Returncodes:
+         1: cache hit, 'data' is filled
+         0: missing, stale or invalid cache
+*/
+static int iptcap_cache_read(
+        const char *path, const char *key, uint8_t *data, size_t len)
+{
+    char line[1024] = "";
+    int result = 0;
+
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+        return (0);
+
+    if (fgets(line, (int)sizeof(line), fp) == NULL)
+        goto end;
+    line[strcspn(line, "\n")] = '\0';
+    if (strcmp(line, key) != 0) {
+        vrmr_debug(LOW, "cache %s is stale", path);
+        goto end;
+    }
+
+    /* one byte per cap, which is either 0 or 1 */
+    for (size_t i = 0; i < len; i++) {
+        int c = fgetc(fp);
+        if (c != '0' && c != '1')
+            goto end;
+        data[i] = (uint8_t)(c - '0');
+    }
+    if (fgetc(fp) != '\n')
+        goto end;
+
+    result = 1;
+end:
+    fclose(fp);
+    return (result);
+}
+
+static void iptcap_cache_write(
+        const char *path, const char *key, const uint8_t *data, size_t len)
+{
+    char tmp_path[PATH_MAX];
+
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >=
+            (int)sizeof(tmp_path))
+        return;
+
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd == -1) {
+        vrmr_debug(LOW, "opening %s failed: %s", tmp_path, strerror(errno));
+        return;
+    }
+    FILE *fp = fdopen(fd, "w");
+    if (fp == NULL) {
+        close(fd);
+        (void)unlink(tmp_path);
+        return;
+    }
+
+    fprintf(fp, "%s\n", key);
+    for (size_t i = 0; i < len; i++)
+        fputc(data[i] ? '1' : '0', fp);
+    fputc('\n', fp);
+
+    if (fclose(fp) != 0 || rename(tmp_path, path) != 0) {
+        vrmr_debug(LOW, "writing %s failed: %s", path, strerror(errno));
+        (void)unlink(tmp_path);
+    }
+}
+
+/*  iptcap_load_cached
+
+    Loads the caps for one ip version from the cache, or probes them and
+    updates the cache. Only the part of 'iptcap' belonging to 'ipv' is
+    touched, except that the IPv4 load clears the whole struct like
+    vrmr_load_iptcaps does.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int iptcap_load_cached(struct vrmr_config *cnf,
+        struct vrmr_iptcaps *iptcap, int ipv, bool load_modules)
+{
+    const size_t split = offsetof(struct vrmr_iptcaps, proc_net_ip6_names);
+    const char *ipt_loc, *path;
+    uint8_t *data;
+    size_t len;
+    char key[1024];
+
+    if (ipv == VRMR_IPV4) {
+        ipt_loc = cnf->iptables_location;
+        path = VRMR_IPTCAP_CACHE_LOCATION;
+        data = (uint8_t *)iptcap;
+        len = split;
+    } else {
+        ipt_loc = cnf->ip6tables_location;
+        path = VRMR_IP6TCAP_CACHE_LOCATION;
+        data = (uint8_t *)iptcap + split;
+        len = sizeof(struct vrmr_iptcaps) - split;
+    }
+
+    if (iptcap_cache_key(ipt_loc, ipv, load_modules, key, sizeof(key)) == 0 &&
+            iptcap_cache_read(path, key, data, len) == 1) {
+        vrmr_debug(LOW, "using cached capabilities from %s", path);
+        if (ipv == VRMR_IPV4)
+            memset(data + len, 0, sizeof(struct vrmr_iptcaps) - len);
+        return (0);
+    }
+
+    int result = (ipv == VRMR_IPV4)
+                         ? vrmr_load_iptcaps(cnf, iptcap, load_modules)
+                         : vrmr_load_ip6tcaps(cnf, iptcap, load_modules);
+    if (result < 0)
+        return (result);
+
+    /* the key is built after probing, as the probes may load modules */
+    if (iptcap_cache_key(ipt_loc, ipv, load_modules, key, sizeof(key)) == 0)
+        iptcap_cache_write(path, key, data, len);
+
+    return (result);
+}
+
 int vrmr_check_iptcaps(
         struct vrmr_config *cnf, struct vrmr_iptcaps *iptcap, bool load_modules)
 {
     assert(iptcap != NULL && cnf != NULL);
 
     /* load the caps */
-    int result = vrmr_load_iptcaps(cnf, iptcap, load_modules);
+    int result = iptcap_load_cached(cnf, iptcap, VRMR_IPV4, load_modules);
     if (result == -1) {
         vrmr_error(-1, "Error", "loading iptables capabilities failed");
         return (-1);
@@ -1094,7 +1307,7 @@ int vrmr_check_ip6tcaps(
     assert(iptcap != NULL && cnf != NULL);
 
     /* load the caps */
-    int result = vrmr_load_ip6tcaps(cnf, iptcap, load_modules);
+    int result = iptcap_load_cached(cnf, iptcap, VRMR_IPV6, load_modules);
     if (result == -1) {
         vrmr_error(-1, "Error", "loading ip6tables capabilities failed");
         return (-1);
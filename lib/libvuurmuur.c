@@ -147,28 +147,6 @@ void *vrmr_interface_malloc()
     return (iface_ptr);
 }
 
-/*
-
-*/
-int vrmr_shm_lock(int lock, int sem_id)
-{
-    int z;
-    static struct sembuf sops = {0, -1, 0};
-
-    sops.sem_num = 0;
-    sops.sem_op = (short int)(lock ? -1 : 1);
-
-    do {
-        z = semop(sem_id, &sops, 1);
-    } while (z == -1 && errno == EINTR);
-
-    if (z == -1) {
-        return (0);
-    }
-
-    return (1);
-}
-
 /* return a ptr to the lib version string */
 char *libvuurmuur_get_version(void)
 {
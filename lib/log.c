@@ -396,11 +396,14 @@ static void vrmr_log_record_create_tcp_flags(
          0: logline not ok
         -1: internal error
 
+    If 'lookups' is not NULL the lookups and their hits are counted in it.
+
     NOTE: if the function returns -1 the memory is not cleaned up: the program
    is supposed to exit
 */
 int vrmr_log_record_get_names(struct vrmr_log_record *log_record,
-        struct vrmr_hash_table *zone_hash, struct vrmr_hash_table *service_hash)
+        struct vrmr_map *zone_hash, struct vrmr_services_index *service_hash,
+        struct vrmr_log_lookups *lookups)
 {
     struct vrmr_zone *zone = NULL;
     struct vrmr_service *service = NULL;
@@ -436,6 +439,11 @@ int vrmr_log_record_get_names(struct vrmr_log_record *log_record,
                 strlcpy(log_record->from_name, "firewall",
                         sizeof(log_record->from_name));
         }
+        if (lookups != NULL) {
+            lookups->zones++;
+            if (zone != NULL)
+                lookups->zone_hits++;
+        }
         zone = NULL;
 
         /*  do it all again for TO */
@@ -457,6 +465,11 @@ int vrmr_log_record_get_names(struct vrmr_log_record *log_record,
                 strlcpy(log_record->to_name, "firewall",
                         sizeof(log_record->to_name));
         }
+        if (lookups != NULL) {
+            lookups->zones++;
+            if (zone != NULL)
+                lookups->zone_hits++;
+        }
         zone = NULL;
     }
 
@@ -541,6 +554,11 @@ int vrmr_log_record_get_names(struct vrmr_log_record *log_record,
         }
     }
 
+    if (lookups != NULL) {
+        lookups->services++;
+        if (service != NULL)
+            lookups->service_hits++;
+    }
     return (1);
 }
 
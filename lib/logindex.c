@@ -0,0 +1,872 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2019 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "config.h"
+#include "vuurmuur.h"
+
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/param.h> /* for MIN and MAX */
+
+/*
+    Log index.
+
+    The index has a point for every VRMR_LOGINDEX_STRIDE lines of a log: the
+    offset of the line and the time stamp it starts with. It is updated
+    incrementally, only the part that was added to the log since the last
+    update is read. The index is saved next to the log as '<log>.idx', so
+    it doesn't have to be rebuilt every time the log is opened.
+
+    Using the points any line or time can be found by reading at most
+    VRMR_LOGINDEX_STRIDE lines, no matter how large the log is.
+
+    Syslog style time stamps don't have a year. The stamps of the points
+    count the number of times the year changed in the upper 32 bits.
+*/
+
+#define LOGINDEX_MAGIC "VRMRLI"
+#define LOGINDEX_VERSION 1
+#define LOGINDEX_READ_SIZE (1024 * 1024)
+
+/* a stamp that goes back this far means a new year */
+#define LOGINDEX_YEAR_GAP (6 * 32 * 24 * 3600)
+
+struct logindex_header {
+    char magic[8];
+    uint32_t version;
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    uint64_t lines;
+    uint64_t last_stamp;
+    uint64_t points;
+};
+
+static const char *logindex_months[12] = {"Jan", "Feb", "Mar", "Apr", "May",
+        "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+/* key of a time within a year, ordered like the time */
+static uint32_t logindex_key(const struct tm *tm)
+{
+    return (((((uint32_t)tm->tm_mon * 32 + (uint32_t)tm->tm_mday) * 24 +
+                     (uint32_t)tm->tm_hour) *
+                            60 +
+                    (uint32_t)tm->tm_min) *
+                    60 +
+            (uint32_t)tm->tm_sec);
+}
+
+/*  vrmr_logindex_parse_time
+
+    Parses a syslog style time "Mon DD HH:MM:SS". The time or parts of it
+    may be left out, "Feb 6" and "Feb 6 12:30" are fine too.
+
+    Returncodes:
+         0: ok
+        -1: not a valid time
+*/
+int vrmr_logindex_parse_time(const char *str, struct tm *tm)
+{
+    char mon[4] = "";
+    unsigned int day = 0, hour = 0, min = 0, sec = 0;
+
+    assert(str && tm);
+
+    memset(tm, 0, sizeof(*tm));
+    if (sscanf(str, "%3s %2u %2u:%2u:%2u", mon, &day, &hour, &min, &sec) < 2)
+        return (-1);
+    if (day < 1 || day > 31 || hour > 23 || min > 59 || sec > 60)
+        return (-1);
+
+    for (int m = 0; m < 12; m++) {
+        if (strcasecmp(mon, logindex_months[m]) == 0) {
+            tm->tm_mon = m;
+            tm->tm_mday = (int)day;
+            tm->tm_hour = (int)hour;
+            tm->tm_min = (int)min;
+            tm->tm_sec = (int)sec;
+            return (0);
+        }
+    }
+    return (-1);
+}
+
+/* key of the time stamp at the start of a log line */
+static bool logindex_line_key(const char *line, size_t len, uint32_t *key)
+{
+    char buf[16];
+    struct tm tm;
+
+    if (len < 15)
+        return (false);
+    memcpy(buf, line, 15);
+    buf[15] = '\0';
+
+    if (vrmr_logindex_parse_time(buf, &tm) < 0)
+        return (false);
+    *key = logindex_key(&tm);
+    return (true);
+}
+
+/* stamp of a line following a line with 'prev' */
+static uint64_t logindex_line_stamp(uint64_t prev, uint32_t key)
+{
+    uint64_t era = prev >> 32;
+
+    if (key + LOGINDEX_YEAR_GAP < (uint32_t)prev)
+        era++;
+    return ((era << 32) | key);
+}
+
+/*
+    line reader on top of pread, so it doesn't disturb the file position of
+    users of the same file
+*/
+struct logindex_reader {
+    int fd;
+    uint64_t pos; /* file offset of buf[0] */
+    uint64_t end; /* don't read beyond this offset */
+    char *buf;
+    size_t size;
+    size_t len;
+    size_t off;
+    bool error;
+};
+
+static int logindex_reader_setup(struct logindex_reader *r, int fd,
+        uint64_t start, uint64_t end, size_t size)
+{
+    memset(r, 0, sizeof(*r));
+    r->fd = fd;
+    r->pos = start;
+    r->end = end;
+    r->size = size;
+    if (!(r->buf = malloc(size))) {
+        vrmr_error(-1, "Error", "malloc failed: %s", strerror(errno));
+        return (-1);
+    }
+    return (0);
+}
+
+/* returns the next complete line without the newline, or NULL at the end */
+static const char *logindex_reader_next(
+        struct logindex_reader *r, uint64_t *offset, size_t *len)
+{
+    for (;;) {
+        char *start = r->buf + r->off;
+        char *nl = memchr(start, '\n', r->len - r->off);
+        if (nl != NULL) {
+            *offset = r->pos + r->off;
+            *len = (size_t)(nl - start);
+            r->off = (size_t)(nl - r->buf) + 1;
+            return (start);
+        }
+
+        /* move the partial line to the front and read more */
+        size_t left = r->len - r->off;
+        memmove(r->buf, start, left);
+        r->pos += r->off;
+        r->off = 0;
+        r->len = left;
+
+        if (r->pos + r->len >= r->end)
+            return (NULL);
+        if (r->len == r->size) {
+            /* a line longer than the buffer */
+            char *buf = realloc(r->buf, r->size * 2);
+            if (buf == NULL) {
+                r->error = true;
+                return (NULL);
+            }
+            r->buf = buf;
+            r->size *= 2;
+        }
+
+        size_t want = MIN(r->size - r->len, r->end - (r->pos + r->len));
+        ssize_t n = pread(r->fd, r->buf + r->len, want, r->pos + r->len);
+        if (n <= 0) {
+            if (n < 0)
+                r->error = true;
+            return (NULL);
+        }
+        r->len += (size_t)n;
+    }
+}
+
+static void logindex_reader_cleanup(struct logindex_reader *r)
+{
+    free(r->buf);
+    r->buf = NULL;
+}
+
+static void logindex_reset(struct vrmr_logindex *idx)
+{
+    idx->size = 0;
+    idx->lines = 0;
+    idx->last_stamp = 0;
+    idx->points_len = 0;
+    idx->dirty = true;
+}
+
+static int logindex_add_point(struct vrmr_logindex *idx, uint64_t offset,
+        const char *line, size_t len)
+{
+    uint32_t key;
+
+    if (idx->points_len == idx->points_size) {
+        uint64_t size = idx->points_size ? idx->points_size * 2 : 64;
+        struct vrmr_logindex_point *points =
+                realloc(idx->points, size * sizeof(*points));
+        if (points == NULL) {
+            vrmr_error(-1, "Error", "realloc failed: %s", strerror(errno));
+            return (-1);
+        }
+        idx->points = points;
+        idx->points_size = size;
+    }
+
+    /* a line without a stamp gets the one of the previous point */
+    if (logindex_line_key(line, len, &key))
+        idx->last_stamp = logindex_line_stamp(idx->last_stamp, key);
+
+    idx->points[idx->points_len].offset = offset;
+    idx->points[idx->points_len].stamp = idx->last_stamp;
+    idx->points_len++;
+    return (0);
+}
+
+static int logindex_idx_path(
+        const struct vrmr_logindex *idx, char *path, size_t size)
+{
+    if (snprintf(path, size, "%s.idx", idx->logfile) >= (int)size)
+        return (-1);
+    return (0);
+}
+
+/* load the saved index if it still matches the log */
+static void logindex_load(struct vrmr_logindex *idx, const struct stat *st)
+{
+    char path[PATH_MAX];
+    struct logindex_header hdr;
+    char last = 0;
+
+    if (logindex_idx_path(idx, path, sizeof(path)) < 0)
+        return;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return;
+
+    if (read(fd, &hdr, sizeof(hdr)) != (ssize_t)sizeof(hdr) ||
+            memcmp(hdr.magic, LOGINDEX_MAGIC, sizeof(LOGINDEX_MAGIC)) != 0 ||
+            hdr.version != LOGINDEX_VERSION ||
+            hdr.dev != (uint64_t)st->st_dev ||
+            hdr.ino != (uint64_t)st->st_ino ||
+            hdr.size > (uint64_t)st->st_size ||
+            hdr.points != (hdr.lines + VRMR_LOGINDEX_STRIDE - 1) /
+                                  VRMR_LOGINDEX_STRIDE) {
+        vrmr_debug(LOW, "index '%s' doesn't match the log", path);
+        close(fd);
+        return;
+    }
+
+    /* the log must still end a line where the index stopped */
+    if (hdr.size > 0 &&
+            (pread(idx->fd, &last, 1, (off_t)hdr.size - 1) != 1 ||
+                    last != '\n')) {
+        close(fd);
+        return;
+    }
+
+    struct vrmr_logindex_point *points = NULL;
+    if (hdr.points > 0) {
+        const size_t len = hdr.points * sizeof(*points);
+        if (!(points = malloc(len)) ||
+                read(fd, points, len) != (ssize_t)len) {
+            free(points);
+            close(fd);
+            return;
+        }
+    }
+    close(fd);
+
+    free(idx->points);
+    idx->points = points;
+    idx->points_len = idx->points_size = hdr.points;
+    idx->size = hdr.size;
+    idx->lines = hdr.lines;
+    idx->last_stamp = hdr.last_stamp;
+    idx->dirty = false;
+}
+
+/* save the index next to the log. It's fine if that's not possible, it
+ * will be rebuilt next time. */
+static void logindex_save(struct vrmr_logindex *idx)
+{
+    char path[PATH_MAX], tmp[PATH_MAX];
+    struct logindex_header hdr;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, LOGINDEX_MAGIC, sizeof(LOGINDEX_MAGIC));
+    hdr.version = LOGINDEX_VERSION;
+    hdr.dev = (uint64_t)idx->dev;
+    hdr.ino = (uint64_t)idx->ino;
+    hdr.size = idx->size;
+    hdr.lines = idx->lines;
+    hdr.last_stamp = idx->last_stamp;
+    hdr.points = idx->points_len;
+
+    if (logindex_idx_path(idx, path, sizeof(path)) < 0 ||
+            snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp))
+        return;
+
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        vrmr_debug(LOW, "can't save index '%s': %s", tmp, strerror(errno));
+        return;
+    }
+    const size_t len = idx->points_len * sizeof(*idx->points);
+    if (write(fd, &hdr, sizeof(hdr)) != (ssize_t)sizeof(hdr) ||
+            (len > 0 && write(fd, idx->points, len) != (ssize_t)len)) {
+        vrmr_debug(LOW, "writing index '%s' failed", tmp);
+        close(fd);
+        (void)unlink(tmp);
+        return;
+    }
+    close(fd);
+
+    if (rename(tmp, path) < 0) {
+        vrmr_debug(LOW, "renaming '%s' failed: %s", tmp, strerror(errno));
+        (void)unlink(tmp);
+        return;
+    }
+    idx->dirty = false;
+}
+
+static int logindex_open_log(struct vrmr_logindex *idx, struct stat *st)
+{
+    idx->fd = open(idx->logfile, O_RDONLY);
+    if (idx->fd < 0) {
+        vrmr_error(-1, "Error", "opening '%s' failed: %s", idx->logfile,
+                strerror(errno));
+        return (-1);
+    }
+    if (fstat(idx->fd, st) < 0) {
+        vrmr_error(-1, "Error", "stat '%s' failed: %s", idx->logfile,
+                strerror(errno));
+        close(idx->fd);
+        idx->fd = -1;
+        return (-1);
+    }
+    idx->dev = st->st_dev;
+    idx->ino = st->st_ino;
+    return (0);
+}
+
+/*  vrmr_logindex_open
+
+    Opens the index of 'logfile'. The saved index is used if it matches
+    the log. Call vrmr_logindex_update() to index the rest of it.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_logindex_open(struct vrmr_logindex *idx, const char *logfile)
+{
+    struct stat st;
+
+    assert(idx && logfile);
+
+    memset(idx, 0, sizeof(*idx));
+    if (strlcpy(idx->logfile, logfile, sizeof(idx->logfile)) >=
+            sizeof(idx->logfile)) {
+        vrmr_error(-1, "Error", "path '%s' is too long", logfile);
+        return (-1);
+    }
+    if (logindex_open_log(idx, &st) < 0)
+        return (-1);
+
+    logindex_reset(idx);
+    logindex_load(idx, &st);
+    return (0);
+}
+
+/*  vrmr_logindex_close
+
+    Saves the index if it changed and frees it.
+*/
+void vrmr_logindex_close(struct vrmr_logindex *idx)
+{
+    assert(idx);
+
+    if (idx->fd >= 0) {
+        if (idx->dirty)
+            logindex_save(idx);
+        close(idx->fd);
+    }
+    free(idx->points);
+    memset(idx, 0, sizeof(*idx));
+    idx->fd = -1;
+}
+
+/*  vrmr_logindex_update
+
+    Indexes the lines that were added to the log since the last update. If
+    the log was rotated or truncated the index is rebuilt.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_logindex_update(struct vrmr_logindex *idx)
+{
+    struct stat st;
+    struct logindex_reader r;
+    const char *line;
+    uint64_t offset;
+    size_t len;
+
+    assert(idx && idx->fd >= 0);
+
+    /* a new log at the same path */
+    if (stat(idx->logfile, &st) == 0 &&
+            (st.st_dev != idx->dev || st.st_ino != idx->ino)) {
+        vrmr_debug(LOW, "'%s' was rotated, rebuilding index", idx->logfile);
+        close(idx->fd);
+        if (logindex_open_log(idx, &st) < 0)
+            return (-1);
+        logindex_reset(idx);
+    } else if (fstat(idx->fd, &st) < 0) {
+        vrmr_error(-1, "Error", "stat '%s' failed: %s", idx->logfile,
+                strerror(errno));
+        return (-1);
+    }
+    if ((uint64_t)st.st_size < idx->size)
+        logindex_reset(idx);
+    if ((uint64_t)st.st_size == idx->size)
+        return (0);
+
+    if (logindex_reader_setup(&r, idx->fd, idx->size, (uint64_t)st.st_size,
+                LOGINDEX_READ_SIZE) < 0)
+        return (-1);
+
+    while ((line = logindex_reader_next(&r, &offset, &len)) != NULL) {
+        if (idx->lines % VRMR_LOGINDEX_STRIDE == 0 &&
+                logindex_add_point(idx, offset, line, len) < 0) {
+            logindex_reader_cleanup(&r);
+            return (-1);
+        }
+        idx->lines++;
+        idx->size = offset + len + 1;
+        idx->dirty = true;
+    }
+    logindex_reader_cleanup(&r);
+
+    if (r.error) {
+        vrmr_error(-1, "Error", "reading '%s' failed", idx->logfile);
+        return (-1);
+    }
+    return (0);
+}
+
+/*  vrmr_logindex_line_offset
+
+    Finds the offset of line number 'line' (counting from 0). For a line
+    past the end of the index the end of the index is returned.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_logindex_line_offset(
+        struct vrmr_logindex *idx, uint64_t line, uint64_t *offset)
+{
+    struct logindex_reader r;
+    uint64_t skip;
+    size_t len;
+
+    assert(idx && offset);
+
+    if (line >= idx->lines) {
+        *offset = idx->size;
+        return (0);
+    }
+
+    const struct vrmr_logindex_point *pt =
+            &idx->points[line / VRMR_LOGINDEX_STRIDE];
+    *offset = pt->offset;
+    skip = line % VRMR_LOGINDEX_STRIDE;
+    if (skip == 0)
+        return (0);
+
+    if (logindex_reader_setup(&r, idx->fd, pt->offset, idx->size, 65536) < 0)
+        return (-1);
+    for (; skip > 0; skip--) {
+        if (logindex_reader_next(&r, offset, &len) == NULL) {
+            logindex_reader_cleanup(&r);
+            return (-1);
+        }
+    }
+    /* the line after the skipped ones */
+    if (logindex_reader_next(&r, offset, &len) == NULL)
+        *offset = idx->size;
+    logindex_reader_cleanup(&r);
+    return (0);
+}
+
+/*  vrmr_logindex_find_time
+
+    Finds the first line with a time stamp at or after 'tm' (only the
+    month, day and time are used). If the time is later in the year than
+    the end of the log, it's taken to be in the year before.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_logindex_find_time(
+        struct vrmr_logindex *idx, const struct tm *tm, uint64_t *line)
+{
+    struct logindex_reader r;
+    const char *l;
+    uint64_t offset;
+    size_t len;
+    uint32_t key = logindex_key(tm);
+
+    assert(idx && tm && line);
+
+    *line = 0;
+    if (idx->points_len == 0)
+        return (0);
+
+    uint64_t era = idx->last_stamp >> 32;
+    if (era > 0 && key > (uint32_t)idx->last_stamp + 24 * 3600)
+        era--;
+    const uint64_t target = (era << 32) | key;
+
+    /* the last point before the target */
+    uint64_t lo = 0, hi = idx->points_len;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (idx->points[mid].stamp < target)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    const uint64_t p = lo > 0 ? lo - 1 : 0;
+
+    /* then find the line in its stride, or at most one stride further */
+    if (logindex_reader_setup(
+                &r, idx->fd, idx->points[p].offset, idx->size, 65536) < 0)
+        return (-1);
+
+    uint64_t stamp = idx->points[p].stamp;
+    uint64_t n = p * VRMR_LOGINDEX_STRIDE;
+    for (uint64_t i = 0; i < 2 * VRMR_LOGINDEX_STRIDE; i++, n++) {
+        if ((l = logindex_reader_next(&r, &offset, &len)) == NULL)
+            break;
+        if (logindex_line_key(l, len, &key))
+            stamp = logindex_line_stamp(stamp, key);
+        if (stamp >= target)
+            break;
+    }
+    logindex_reader_cleanup(&r);
+
+    *line = MIN(n, idx->lines);
+    return (0);
+}
+
+/*
+    Log search.
+
+    The log is split into one part per thread at line boundaries. Each
+    thread maps its part a window at a time and keeps the offsets of the
+    last 'max' matching lines.
+*/
+
+/* bytes a search thread maps at once */
+#define LOGSEARCH_WINDOW (64 * 1024 * 1024)
+/* don't start a thread for less than this */
+#define LOGSEARCH_MIN_PART (4 * 1024 * 1024)
+
+struct logsearch_match {
+    uint64_t offset;
+    size_t len;
+};
+
+struct logsearch_job {
+    pthread_t thread;
+    int fd;
+    uint64_t start;
+    uint64_t end;
+
+    const char *needle;
+    size_t needle_len;
+    const regex_t *reg; /* NULL for a plain string */
+
+    /* ring of the last 'max' matches */
+    struct logsearch_match *matches;
+    unsigned int max;
+    uint64_t count;
+
+    int retval;
+};
+
+static void logsearch_store(
+        struct logsearch_job *job, uint64_t offset, size_t len)
+{
+    struct logsearch_match *m = &job->matches[job->count % job->max];
+    m->offset = offset;
+    m->len = len;
+    job->count++;
+}
+
+/* scan the complete lines in s..e, s is at 'offset' in the log */
+static void logsearch_scan(struct logsearch_job *job, const char *s,
+        const char *e, uint64_t offset)
+{
+    const char *p = s;
+
+    if (job->reg == NULL) {
+        const char *m;
+        while (p < e && (m = memmem(p, (size_t)(e - p), job->needle,
+                                 job->needle_len)) != NULL) {
+            const char *ls = memrchr(p, '\n', (size_t)(m - p));
+            ls = ls ? ls + 1 : p;
+            const char *le = memchr(m, '\n', (size_t)(e - m));
+            le = le ? le : e;
+
+            logsearch_store(
+                    job, offset + (uint64_t)(ls - s), (size_t)(le - ls));
+            p = le + 1;
+        }
+        return;
+    }
+
+    /* regexec needs a terminated string. Lines that don't fit 'buf' are
+     * copied to the heap, so the regex always sees the whole line. */
+    char buf[1024];
+    char *line = buf;
+    size_t size = sizeof(buf);
+    while (p < e) {
+        const char *le = memchr(p, '\n', (size_t)(e - p));
+        le = le ? le : e;
+
+        const size_t len = (size_t)(le - p);
+        if (len >= size) {
+            if (line != buf)
+                free(line);
+            size = len + 1;
+            if ((line = malloc(size)) == NULL) {
+                job->retval = -1;
+                return;
+            }
+        }
+        memcpy(line, p, len);
+        line[len] = '\0';
+        if (regexec(job->reg, line, 0, NULL, 0) == 0)
+            logsearch_store(job, offset + (uint64_t)(p - s), len);
+        p = le + 1;
+    }
+    if (line != buf)
+        free(line);
+}
+
+static void *logsearch_thread(void *arg)
+{
+    struct logsearch_job *job = arg;
+    const uint64_t pagesize = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t pos = job->start;
+
+    while (pos < job->end) {
+        const uint64_t map_start = pos - pos % pagesize;
+        const size_t map_len =
+                (size_t)MIN((uint64_t)LOGSEARCH_WINDOW, job->end - map_start);
+
+        char *map = mmap(NULL, map_len, PROT_READ, MAP_PRIVATE, job->fd,
+                (off_t)map_start);
+        if (map == MAP_FAILED) {
+            job->retval = -1;
+            return (NULL);
+        }
+        (void)madvise(map, map_len, MADV_SEQUENTIAL);
+
+        const char *s = map + (pos - map_start);
+        const char *e = map + map_len;
+        /* leave a partial line at the end of the window for the next one */
+        if (map_start + map_len < job->end) {
+            const char *last = memrchr(s, '\n', (size_t)(e - s));
+            if (last != NULL)
+                e = last + 1;
+        }
+        logsearch_scan(job, s, e, pos);
+        pos += (uint64_t)(e - s);
+
+        munmap(map, map_len);
+    }
+    return (NULL);
+}
+
+/* move 'pos' to the start of the next line */
+static uint64_t logsearch_line_start(int fd, uint64_t pos, uint64_t end)
+{
+    char buf[4096];
+
+    if (pos == 0)
+        return (0);
+
+    /* pos - 1, so a pos at a line start stays there */
+    pos--;
+    while (pos < end) {
+        ssize_t n = pread(fd, buf, (size_t)MIN(sizeof(buf), end - pos), pos);
+        if (n <= 0)
+            return (end);
+        const char *nl = memchr(buf, '\n', (size_t)n);
+        if (nl != NULL)
+            return (pos + (uint64_t)(nl - buf) + 1);
+        pos += (uint64_t)n;
+    }
+    return (end);
+}
+
+/*  vrmr_log_search
+
+    Searches 'path' for lines containing 'pattern'. If 'pattern' contains
+    regex characters it's used as a basic regular expression, like grep
+    does. The log is scanned by several threads. The last 'max' matching
+    lines are passed to 'cb' in the order of the log.
+
+    Returns the number of matching lines, or -1 on error.
+*/
+int64_t vrmr_log_search(const char *path, const char *pattern, unsigned int max,
+        void (*cb)(const char *line, size_t len, void *ctx), void *ctx)
+{
+    struct logsearch_job jobs[VRMR_LOGSEARCH_MAX_THREADS];
+    struct stat st;
+    regex_t reg;
+    bool use_reg = false;
+    int64_t retval = 0;
+    unsigned int n = 0;
+    char *line = NULL;
+
+    assert(path && pattern && cb && max > 0);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        vrmr_error(-1, "Error", "opening '%s' failed: %s", path,
+                strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        return (-1);
+    }
+    const uint64_t size = (uint64_t)st.st_size;
+
+    if (strpbrk(pattern, ".[]*^$\\") != NULL) {
+        if (regcomp(&reg, pattern, REG_NOSUB) != 0) {
+            vrmr_error(-1, "Error", "invalid search '%s'", pattern);
+            close(fd);
+            return (-1);
+        }
+        use_reg = true;
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int threads = cpus > 0 ? (unsigned int)cpus : 1;
+    threads = MIN(threads, VRMR_LOGSEARCH_MAX_THREADS);
+    threads = MIN(threads, (unsigned int)(size / LOGSEARCH_MIN_PART) + 1);
+
+    memset(jobs, 0, sizeof(jobs));
+    uint64_t start = 0;
+    for (n = 0; n < threads; n++) {
+        struct logsearch_job *job = &jobs[n];
+
+        job->fd = fd;
+        job->start = start;
+        job->end = n + 1 == threads
+                           ? size
+                           : logsearch_line_start(
+                                     fd, size / threads * (n + 1), size);
+        job->end = MAX(job->end, job->start);
+        start = job->end;
+
+        job->needle = pattern;
+        job->needle_len = strlen(pattern);
+        job->reg = use_reg ? &reg : NULL;
+        job->max = max;
+        if (!(job->matches = calloc(max, sizeof(*job->matches)))) {
+            vrmr_error(-1, "Error", "calloc failed: %s", strerror(errno));
+            retval = -1;
+            break;
+        }
+        if (pthread_create(&job->thread, NULL, logsearch_thread, job) != 0) {
+            vrmr_error(-1, "Error", "creating search thread failed");
+            free(job->matches);
+            retval = -1;
+            break;
+        }
+    }
+
+    /* n is the number of running threads */
+    uint64_t total = 0, kept = 0;
+    for (unsigned int i = 0; i < n; i++) {
+        (void)pthread_join(jobs[i].thread, NULL);
+        if (jobs[i].retval < 0) {
+            vrmr_error(-1, "Error", "searching '%s' failed", path);
+            retval = -1;
+        }
+        total += jobs[i].count;
+        kept += MIN(jobs[i].count, (uint64_t)max);
+    }
+
+    /* pass the last 'max' matches in order */
+    if (retval == 0 && total > 0 && !(line = malloc(65536))) {
+        vrmr_error(-1, "Error", "malloc failed: %s", strerror(errno));
+        retval = -1;
+    }
+    uint64_t skip = kept > max ? kept - max : 0;
+    for (unsigned int i = 0; retval == 0 && i < n; i++) {
+        struct logsearch_job *job = &jobs[i];
+        uint64_t first = job->count - MIN(job->count, (uint64_t)max);
+
+        for (uint64_t k = first; k < job->count; k++) {
+            if (skip > 0) {
+                skip--;
+                continue;
+            }
+
+            struct logsearch_match *m = &job->matches[k % max];
+            size_t len = MIN(m->len, (size_t)65536);
+            if (pread(fd, line, len, (off_t)m->offset) != (ssize_t)len) {
+                vrmr_error(-1, "Error", "reading '%s' failed", path);
+                retval = -1;
+                break;
+            }
+            cb(line, len, ctx);
+        }
+    }
+
+    for (unsigned int i = 0; i < n; i++)
+        free(jobs[i].matches);
+    free(line);
+    if (use_reg)
+        regfree(&reg);
+    close(fd);
+    return (retval < 0 ? -1 : (int64_t)total);
+}
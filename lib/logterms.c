@@ -0,0 +1,842 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2019 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "config.h"
+#include "vuurmuur.h"
+
+#include <sys/mman.h>
+#include <sys/param.h> /* for MIN and MAX */
+
+/*
+    Term index of the traffic log.
+
+    vuurmuur_log adds the action, service, source and destination names and
+    the source and destination ip's of every line it writes to the traffic
+    log. The terms are collected for a block of lines, then the block is
+    appended to the index: a sorted dictionary of the term hashes, followed
+    by the offsets of the lines containing them.
+
+    The index of a log is kept next to it as '<log>.terms.<inode>'. The
+    inode doesn't change when logrotate renames the log, so each rotated
+    log keeps its own index segment.
+
+    Parts of the log that are not covered by the index, like the lines of
+    the block that is still being collected, are scanned instead.
+*/
+
+#define LOGTERMS_MAGIC "VRMRLT"
+#define LOGTERMS_VERSION 1
+
+struct logterms_block {
+    char magic[8];
+    uint32_t version;
+    uint32_t terms;        /* entries in the dictionary */
+    uint64_t postings;     /* offsets after the dictionary */
+    uint64_t first_offset; /* log offset of the first line */
+    uint64_t end_offset;   /* log offset after the last line */
+    int64_t first_time;
+    int64_t last_time;
+};
+
+struct logterms_term {
+    uint64_t hash;
+    uint64_t start; /* first posting of the term */
+    uint64_t count;
+};
+
+static const char *logterms_names[VRMR_LOGTERM_TYPES] = {
+        "action", "service", "from", "to", "src", "dst"};
+
+static uint64_t logterms_hash(enum vrmr_logterm_type type, const char *value)
+{
+    /* FNV-1a */
+    uint64_t hash = 14695981039346656037ULL;
+
+    hash = (hash ^ (uint64_t)type) * 1099511628211ULL;
+    for (; *value != '\0'; value++)
+        hash = (hash ^ (uint64_t)tolower((unsigned char)*value)) *
+               1099511628211ULL;
+    return (hash);
+}
+
+static size_t logterms_block_size(const struct logterms_block *b)
+{
+    return (sizeof(*b) + b->terms * sizeof(struct logterms_term) +
+            b->postings * sizeof(uint64_t));
+}
+
+static bool logterms_block_valid(const struct logterms_block *b, size_t left)
+{
+    return (left >= sizeof(*b) &&
+            memcmp(b->magic, LOGTERMS_MAGIC, sizeof(LOGTERMS_MAGIC)) == 0 &&
+            b->version == LOGTERMS_VERSION && b->terms <= b->postings &&
+            b->postings <= left / sizeof(uint64_t) &&
+            logterms_block_size(b) <= left &&
+            b->first_offset <= b->end_offset);
+}
+
+static int logterms_segment_path(
+        const char *logfile, ino_t ino, char *path, size_t size)
+{
+    if (snprintf(path, size, "%s.terms.%lu", logfile, (unsigned long)ino) >=
+            (int)size)
+        return (-1);
+    return (0);
+}
+
+/* remove the segments of logs that no longer exist, e.g. because they were
+ * compressed or removed by logrotate */
+static void logterms_remove_stale(const char *logfile)
+{
+    char dir[PATH_MAX] = ".", path[PATH_MAX], prefix[NAME_MAX + 8];
+    const char *base = logfile;
+    struct stat st;
+
+    const char *slash = strrchr(logfile, '/');
+    if (slash != NULL) {
+        base = slash + 1;
+        snprintf(dir, sizeof(dir), "%.*s", (int)(slash - logfile), logfile);
+    }
+    if (snprintf(prefix, sizeof(prefix), "%s.terms.", base) >=
+            (int)sizeof(prefix))
+        return;
+    const size_t base_len = strlen(base);
+    const size_t prefix_len = strlen(prefix);
+
+    /* inodes of the log and its rotated versions */
+    ino_t inos[64];
+    unsigned int n = 0;
+
+    DIR *d = opendir(dir);
+    if (d == NULL)
+        return;
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL && n < 64) {
+        if (strncmp(de->d_name, base, base_len) != 0 ||
+                strncmp(de->d_name, prefix, prefix_len) == 0)
+            continue;
+        if (snprintf(path, sizeof(path), "%s/%s", dir, de->d_name) >=
+                        (int)sizeof(path) ||
+                stat(path, &st) < 0)
+            continue;
+        inos[n++] = st.st_ino;
+    }
+
+    rewinddir(d);
+    while ((de = readdir(d)) != NULL) {
+        if (strncmp(de->d_name, prefix, prefix_len) != 0)
+            continue;
+
+        unsigned long ino = strtoul(de->d_name + prefix_len, NULL, 10);
+        bool found = false;
+        for (unsigned int i = 0; i < n && !found; i++)
+            found = ((unsigned long)inos[i] == ino);
+        if (found)
+            continue;
+
+        if (snprintf(path, sizeof(path), "%s/%s", dir, de->d_name) <
+                (int)sizeof(path)) {
+            vrmr_debug(LOW, "removing stale index segment '%s'", path);
+            (void)unlink(path);
+        }
+    }
+    closedir(d);
+}
+
+/*  vrmr_logterms_open
+
+    Opens the index segment of 'logfile' for adding lines. A segment that
+    ends in a partially written block is cut back to the last complete
+    block. If the log was truncated the segment is started over.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_logterms_open(struct vrmr_logterms *lt, const char *logfile)
+{
+    struct stat st, seg_st;
+    struct logterms_block b;
+    uint64_t pos = 0, end = 0;
+
+    assert(lt && logfile);
+
+    memset(lt, 0, sizeof(*lt));
+    lt->fd = -1;
+
+    if (stat(logfile, &st) < 0) {
+        vrmr_error(-1, "Error", "stat '%s' failed: %s", logfile,
+                strerror(errno));
+        return (-1);
+    }
+    logterms_remove_stale(logfile);
+
+    if (logterms_segment_path(logfile, st.st_ino, lt->path, sizeof(lt->path)) <
+            0) {
+        vrmr_error(-1, "Error", "path '%s' is too long", logfile);
+        return (-1);
+    }
+    lt->fd = open(lt->path, O_RDWR | O_APPEND | O_CREAT, 0600);
+    if (lt->fd < 0 || fstat(lt->fd, &seg_st) < 0) {
+        vrmr_error(-1, "Error", "opening '%s' failed: %s", lt->path,
+                strerror(errno));
+        if (lt->fd >= 0)
+            close(lt->fd);
+        lt->fd = -1;
+        return (-1);
+    }
+
+    /* find the end of the last complete block */
+    const uint64_t seg_size = (uint64_t)seg_st.st_size;
+    while (pread(lt->fd, &b, sizeof(b), (off_t)pos) == (ssize_t)sizeof(b) &&
+            logterms_block_valid(&b, (size_t)(seg_size - pos))) {
+        pos += logterms_block_size(&b);
+        end = b.end_offset;
+    }
+    if (end > (uint64_t)st.st_size) {
+        vrmr_info("Info", "'%s' was truncated, starting a new index", logfile);
+        pos = 0;
+    }
+    if (pos != seg_size && ftruncate(lt->fd, (off_t)pos) < 0) {
+        vrmr_error(-1, "Error", "truncating '%s' failed: %s", lt->path,
+                strerror(errno));
+        close(lt->fd);
+        lt->fd = -1;
+        return (-1);
+    }
+    return (0);
+}
+
+static int logterms_add_term(struct vrmr_logterms *lt,
+        enum vrmr_logterm_type type, const char *value, uint64_t offset)
+{
+    if (value[0] == '\0')
+        return (0);
+
+    if (lt->postings_len == lt->postings_size) {
+        unsigned int size = lt->postings_size ? lt->postings_size * 2 : 1024;
+        struct vrmr_logterms_posting *p =
+                realloc(lt->postings, size * sizeof(*p));
+        if (p == NULL) {
+            vrmr_error(-1, "Error", "realloc failed: %s", strerror(errno));
+            return (-1);
+        }
+        lt->postings = p;
+        lt->postings_size = size;
+    }
+    lt->postings[lt->postings_len].hash = logterms_hash(type, value);
+    lt->postings[lt->postings_len].offset = offset;
+    lt->postings_len++;
+    return (0);
+}
+
+/*  vrmr_logterms_add
+
+    Adds the terms of a line that was written to the log at 'offset'. The
+    block is written out every VRMR_LOGTERMS_BLOCK_LINES lines or when it
+    gets older than VRMR_LOGTERMS_BLOCK_TIME seconds.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_logterms_add(struct vrmr_logterms *lt, uint64_t offset, size_t len,
+        const struct vrmr_log_record *log_record)
+{
+    assert(lt && log_record);
+
+    if (lt->fd < 0)
+        return (0);
+
+    const time_t now = time(NULL);
+    if (lt->lines == 0) {
+        lt->first_offset = offset;
+        lt->first_time = now;
+    }
+
+    if (logterms_add_term(lt, VRMR_LOGTERM_ACTION, log_record->action,
+                offset) < 0 ||
+            logterms_add_term(lt, VRMR_LOGTERM_SERVICE, log_record->ser_name,
+                    offset) < 0 ||
+            logterms_add_term(lt, VRMR_LOGTERM_FROM, log_record->from_name,
+                    offset) < 0 ||
+            logterms_add_term(
+                    lt, VRMR_LOGTERM_TO, log_record->to_name, offset) < 0 ||
+            logterms_add_term(
+                    lt, VRMR_LOGTERM_SRC, log_record->src_ip, offset) < 0 ||
+            logterms_add_term(
+                    lt, VRMR_LOGTERM_DST, log_record->dst_ip, offset) < 0)
+        return (-1);
+
+    lt->end_offset = offset + len;
+    lt->last_time = now;
+    lt->lines++;
+
+    if (lt->lines >= VRMR_LOGTERMS_BLOCK_LINES ||
+            now - lt->first_time >= VRMR_LOGTERMS_BLOCK_TIME)
+        return (vrmr_logterms_flush(lt));
+    return (0);
+}
+
+static int logterms_posting_cmp(const void *a, const void *b)
+{
+    const struct vrmr_logterms_posting *x = a, *y = b;
+
+    if (x->hash != y->hash)
+        return (x->hash < y->hash ? -1 : 1);
+    if (x->offset != y->offset)
+        return (x->offset < y->offset ? -1 : 1);
+    return (0);
+}
+
+/*  vrmr_logterms_flush
+
+    Appends the collected block to the index segment.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_logterms_flush(struct vrmr_logterms *lt)
+{
+    struct logterms_block b;
+
+    assert(lt);
+
+    if (lt->fd < 0 || lt->lines == 0)
+        return (0);
+
+    qsort(lt->postings, lt->postings_len, sizeof(*lt->postings),
+            logterms_posting_cmp);
+
+    memset(&b, 0, sizeof(b));
+    memcpy(b.magic, LOGTERMS_MAGIC, sizeof(LOGTERMS_MAGIC));
+    b.version = LOGTERMS_VERSION;
+    b.postings = lt->postings_len;
+    b.first_offset = lt->first_offset;
+    b.end_offset = lt->end_offset;
+    b.first_time = (int64_t)lt->first_time;
+    b.last_time = (int64_t)lt->last_time;
+    for (unsigned int i = 0; i < lt->postings_len; i++) {
+        if (i == 0 || lt->postings[i].hash != lt->postings[i - 1].hash)
+            b.terms++;
+    }
+
+    /* build the block in one buffer, so it's appended with one write */
+    const size_t size = logterms_block_size(&b);
+    char *buf = malloc(size);
+    if (buf == NULL) {
+        vrmr_error(-1, "Error", "malloc failed: %s", strerror(errno));
+        return (-1);
+    }
+    memcpy(buf, &b, sizeof(b));
+    struct logterms_term *terms = (struct logterms_term *)(buf + sizeof(b));
+    uint64_t *postings = (uint64_t *)(terms + b.terms);
+
+    struct logterms_term *term = terms - 1;
+    for (unsigned int i = 0; i < lt->postings_len; i++) {
+        if (i == 0 || lt->postings[i].hash != lt->postings[i - 1].hash) {
+            term++;
+            term->hash = lt->postings[i].hash;
+            term->start = i;
+            term->count = 0;
+        }
+        term->count++;
+        postings[i] = lt->postings[i].offset;
+    }
+
+    ssize_t written = write(lt->fd, buf, size);
+    free(buf);
+
+    lt->postings_len = 0;
+    lt->lines = 0;
+
+    if (written != (ssize_t)size) {
+        vrmr_error(-1, "Error", "writing to '%s' failed: %s", lt->path,
+                strerror(errno));
+        return (-1);
+    }
+    return (0);
+}
+
+/*  vrmr_logterms_close
+
+    Writes out the last block and closes the segment.
+*/
+void vrmr_logterms_close(struct vrmr_logterms *lt)
+{
+    assert(lt);
+
+    if (lt->fd >= 0) {
+        (void)vrmr_logterms_flush(lt);
+        close(lt->fd);
+    }
+    free(lt->postings);
+    memset(lt, 0, sizeof(*lt));
+    lt->fd = -1;
+}
+
+/*
+    queries
+*/
+#define LOGTERMS_MAX_QUERY_TERMS 8
+
+struct logterms_query {
+    struct {
+        enum vrmr_logterm_type type;
+        char value[128];
+        uint64_t hash;
+    } terms[LOGTERMS_MAX_QUERY_TERMS];
+    unsigned int n;
+    time_t since; /* 0 for no limit */
+};
+
+/* parse "key:value key:value ...". Returns false if it's not a query. */
+static bool logterms_parse_query(const char *str, struct logterms_query *q)
+{
+    char word[160];
+    int len = 0;
+
+    memset(q, 0, sizeof(*q));
+    while (sscanf(str, " %159s%n", word, &len) == 1) {
+        str += len;
+
+        char *colon = strchr(word, ':');
+        if (colon == NULL || colon[1] == '\0')
+            return (false);
+        *colon = '\0';
+        const char *value = colon + 1;
+
+        if (strcasecmp(word, "since") == 0) {
+            char unit = '\0';
+            unsigned int amount = 0;
+            if (sscanf(value, "%u%c", &amount, &unit) != 2)
+                return (false);
+
+            time_t secs;
+            switch (tolower((unsigned char)unit)) {
+                case 'm':
+                    secs = 60;
+                    break;
+                case 'h':
+                    secs = 3600;
+                    break;
+                case 'd':
+                    secs = 24 * 3600;
+                    break;
+                case 'w':
+                    secs = 7 * 24 * 3600;
+                    break;
+                default:
+                    return (false);
+            }
+            q->since = time(NULL) - (time_t)amount * secs;
+            continue;
+        }
+
+        int type;
+        for (type = 0; type < VRMR_LOGTERM_TYPES; type++) {
+            if (strcasecmp(word, logterms_names[type]) == 0)
+                break;
+        }
+        if (type == VRMR_LOGTERM_TYPES || q->n == LOGTERMS_MAX_QUERY_TERMS ||
+                strlen(value) >= sizeof(q->terms[0].value))
+            return (false);
+
+        q->terms[q->n].type = (enum vrmr_logterm_type)type;
+        (void)strlcpy(q->terms[q->n].value, value, sizeof(q->terms[0].value));
+        q->terms[q->n].hash = logterms_hash(q->terms[q->n].type, value);
+        q->n++;
+    }
+    return (q->n > 0 || q->since != 0);
+}
+
+/*  vrmr_logterms_is_query
+
+    Returns true if 'str' is a term query like "action:DROP from:host.net.zone
+    since:1d" that vrmr_logterms_query() can answer.
+*/
+bool vrmr_logterms_is_query(const char *str)
+{
+    struct logterms_query q;
+
+    assert(str);
+    return (logterms_parse_query(str, &q));
+}
+
+/* time of a log line, the log has no year so assume it's in the last year */
+static time_t logterms_line_time(const char *line, size_t len, time_t now)
+{
+    char buf[16];
+    struct tm tm, now_tm;
+
+    if (len < 15)
+        return (0);
+    memcpy(buf, line, 15);
+    buf[15] = '\0';
+    if (vrmr_logindex_parse_time(buf, &tm) < 0)
+        return (0);
+
+    (void)localtime_r(&now, &now_tm);
+    tm.tm_year = now_tm.tm_year;
+    tm.tm_isdst = -1;
+    time_t t = mktime(&tm);
+    if (t > now + 24 * 3600) {
+        tm.tm_year--;
+        tm.tm_isdst = -1;
+        t = mktime(&tm);
+    }
+    return (t);
+}
+
+/* does an address in the line, e.g. '1.2.3.4:80' or '1.2.3.4(mac)', match */
+static bool logterms_addr_match(
+        const char *addr, size_t len, const char *value)
+{
+    size_t vlen = strlen(value);
+
+    if (vlen > len || strncasecmp(addr, value, vlen) != 0)
+        return (false);
+    return (vlen == len || addr[vlen] == ':' || addr[vlen] == '(');
+}
+
+/* check the terms against a line of the log, for the parts that are not
+ * indexed */
+static bool logterms_line_match(
+        const struct logterms_query *q, const char *line, size_t len)
+{
+    char buf[1024];
+    char action[32] = "", service[128] = "", from[256] = "", to[256] = "";
+
+    len = MIN(len, sizeof(buf) - 1);
+    memcpy(buf, line, len);
+    buf[len] = '\0';
+
+    if (sscanf(buf, "%*3s %*2s %*9s %31s service %127s from %255s to %255s",
+                action, service, from, to) != 4)
+        return (false);
+    size_t to_len = strlen(to);
+    if (to_len > 0 && to[to_len - 1] == ',')
+        to[to_len - 1] = '\0';
+
+    /* the addresses are around the ' -> ' in the details */
+    const char *src = NULL, *dst = NULL;
+    size_t src_len = 0, dst_len = 0;
+    const char *details = strrchr(buf, '(');
+    const char *arrow = details ? strstr(details, " -> ") : NULL;
+    if (arrow != NULL) {
+        src = arrow;
+        while (src > details && src[-1] != ' ' && src[-1] != '(')
+            src--;
+        src_len = (size_t)(arrow - src);
+        dst = arrow + 4;
+        dst_len = strcspn(dst, " )");
+    }
+
+    for (unsigned int i = 0; i < q->n; i++) {
+        const char *value = q->terms[i].value;
+        bool match = false;
+
+        switch (q->terms[i].type) {
+            case VRMR_LOGTERM_ACTION:
+                match = (strcasecmp(action, value) == 0);
+                break;
+            case VRMR_LOGTERM_SERVICE:
+                match = (strcasecmp(service, value) == 0);
+                break;
+            case VRMR_LOGTERM_FROM:
+                match = (strcasecmp(from, value) == 0);
+                break;
+            case VRMR_LOGTERM_TO:
+                match = (strcasecmp(to, value) == 0);
+                break;
+            case VRMR_LOGTERM_SRC:
+                match = src && logterms_addr_match(src, src_len, value);
+                break;
+            case VRMR_LOGTERM_DST:
+                match = dst && logterms_addr_match(dst, dst_len, value);
+                break;
+            case VRMR_LOGTERM_TYPES:
+                break;
+        }
+        if (!match)
+            return (false);
+    }
+    return (true);
+}
+
+struct logterms_results {
+    int fd;
+    time_t now;
+    const struct logterms_query *q;
+
+    /* ring of the last 'max' matches */
+    uint64_t *offsets;
+    unsigned int max;
+    uint64_t count;
+};
+
+static void logterms_store(struct logterms_results *r, uint64_t offset)
+{
+    r->offsets[r->count % r->max] = offset;
+    r->count++;
+}
+
+/* scan the lines in start..end that are not in the index */
+static int logterms_scan(struct logterms_results *r, uint64_t start,
+        uint64_t end)
+{
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len;
+
+    if (start >= end)
+        return (0);
+
+    int fd = dup(r->fd);
+    FILE *fp = fd >= 0 ? fdopen(fd, "r") : NULL;
+    if (fp == NULL) {
+        if (fd >= 0)
+            close(fd);
+        return (-1);
+    }
+    if (fseeko(fp, (off_t)start, SEEK_SET) != 0) {
+        fclose(fp);
+        return (-1);
+    }
+
+    uint64_t pos = start;
+    while (pos < end && (len = getline(&line, &size, fp)) > 0) {
+        if (line[len - 1] != '\n')
+            break;
+        if (logterms_line_match(r->q, line, (size_t)len - 1) &&
+                (r->q->since == 0 || logterms_line_time(line, (size_t)len,
+                                             r->now) >= r->q->since))
+            logterms_store(r, pos);
+        pos += (uint64_t)len;
+    }
+    free(line);
+    fclose(fp);
+    return (0);
+}
+
+/* the offsets of a term in a block, or NULL if it's not in there */
+static const uint64_t *logterms_block_term(const struct logterms_block *b,
+        uint64_t hash, uint64_t *count)
+{
+    const struct logterms_term *terms = (const struct logterms_term *)(b + 1);
+    const uint64_t *postings = (const uint64_t *)(terms + b->terms);
+
+    uint32_t lo = 0, hi = b->terms;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (terms[mid].hash < hash)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == b->terms || terms[lo].hash != hash ||
+            terms[lo].start + terms[lo].count > b->postings)
+        return (NULL);
+
+    *count = terms[lo].count;
+    return (postings + terms[lo].start);
+}
+
+/* does the line at 'offset' start after r->q->since */
+static bool logterms_offset_in_time(struct logterms_results *r, uint64_t offset)
+{
+    char buf[16];
+
+    if (pread(r->fd, buf, 15, (off_t)offset) != 15)
+        return (false);
+    return (logterms_line_time(buf, 15, r->now) >= r->q->since);
+}
+
+/* intersect the posting lists of the query terms in a block */
+static void logterms_query_block(
+        struct logterms_results *r, const struct logterms_block *b)
+{
+    const uint64_t *lists[LOGTERMS_MAX_QUERY_TERMS];
+    uint64_t counts[LOGTERMS_MAX_QUERY_TERMS], pos[LOGTERMS_MAX_QUERY_TERMS];
+    unsigned int smallest = 0;
+
+    for (unsigned int i = 0; i < r->q->n; i++) {
+        if (!(lists[i] = logterms_block_term(b, r->q->terms[i].hash,
+                      &counts[i])))
+            return;
+        pos[i] = 0;
+        if (counts[i] < counts[smallest])
+            smallest = i;
+    }
+
+    /* a block older than 'since' is skipped, a block that is partly older
+     * is checked line by line */
+    const bool check_time = r->q->since != 0 && b->first_time < r->q->since;
+
+    for (uint64_t k = 0; k < counts[smallest]; k++) {
+        const uint64_t offset = lists[smallest][k];
+        bool match = true;
+
+        for (unsigned int i = 0; i < r->q->n && match; i++) {
+            if (i == smallest)
+                continue;
+            while (pos[i] < counts[i] && lists[i][pos[i]] < offset)
+                pos[i]++;
+            match = (pos[i] < counts[i] && lists[i][pos[i]] == offset);
+        }
+        if (match && (!check_time || logterms_offset_in_time(r, offset)))
+            logterms_store(r, offset);
+    }
+}
+
+/* the segment of a log is named after the log it was written for, so for a
+ * rotated log '<log>.N' it's '<log>.terms.<inode>' */
+static int logterms_query_segment_path(
+        const char *logfile, ino_t ino, char *path, size_t size)
+{
+    char name[PATH_MAX];
+
+    if (strlcpy(name, logfile, sizeof(name)) >= sizeof(name))
+        return (-1);
+    if (logterms_segment_path(name, ino, path, size) == 0 &&
+            access(path, R_OK) == 0)
+        return (0);
+
+    char *dot = strrchr(name, '.');
+    if (dot == NULL || dot[1] == '\0' ||
+            strspn(dot + 1, "0123456789") != strlen(dot + 1))
+        return (-1);
+    *dot = '\0';
+    return (logterms_segment_path(name, ino, path, size));
+}
+
+/*  vrmr_logterms_query
+
+    Finds the lines of 'logfile' that match all terms of 'query', using the
+    index segment of the log if there is one. The last 'max' matching lines
+    are passed to 'cb' in the order of the log.
+
+    Returns the number of matching lines, or -1 on error.
+*/
+int64_t vrmr_logterms_query(const char *logfile, const char *query,
+        unsigned int max, void (*cb)(const char *line, size_t len, void *ctx),
+        void *ctx)
+{
+    struct logterms_query q;
+    struct logterms_results r;
+    struct stat st, seg_st;
+    char path[PATH_MAX];
+    int64_t retval = 0;
+
+    assert(logfile && query && cb && max > 0);
+
+    if (!logterms_parse_query(query, &q)) {
+        vrmr_error(-1, "Error", "invalid query '%s'", query);
+        return (-1);
+    }
+
+    memset(&r, 0, sizeof(r));
+    r.now = time(NULL);
+    r.q = &q;
+    r.max = max;
+
+    r.fd = open(logfile, O_RDONLY);
+    if (r.fd < 0 || fstat(r.fd, &st) < 0) {
+        vrmr_error(-1, "Error", "opening '%s' failed: %s", logfile,
+                strerror(errno));
+        if (r.fd >= 0)
+            close(r.fd);
+        return (-1);
+    }
+    /* nothing was written to the log since then */
+    if (q.since != 0 && st.st_mtime < q.since) {
+        close(r.fd);
+        return (0);
+    }
+    if (!(r.offsets = calloc(max, sizeof(uint64_t)))) {
+        vrmr_error(-1, "Error", "calloc failed: %s", strerror(errno));
+        close(r.fd);
+        return (-1);
+    }
+
+    /* the blocks of the index, the lines between them are scanned */
+    uint64_t covered = 0;
+    int seg_fd = -1;
+    if (logterms_query_segment_path(logfile, st.st_ino, path, sizeof(path)) ==
+            0)
+        seg_fd = open(path, O_RDONLY);
+    if (seg_fd >= 0 && fstat(seg_fd, &seg_st) == 0 && seg_st.st_size > 0) {
+        const size_t seg_size = (size_t)seg_st.st_size;
+        char *map = mmap(NULL, seg_size, PROT_READ, MAP_SHARED, seg_fd, 0);
+        if (map != MAP_FAILED) {
+            size_t pos = 0;
+            while (pos < seg_size) {
+                const struct logterms_block *b =
+                        (const struct logterms_block *)(map + pos);
+                if (!logterms_block_valid(b, seg_size - pos) ||
+                        b->end_offset > (uint64_t)st.st_size ||
+                        b->first_offset < covered)
+                    break;
+
+                if (logterms_scan(&r, covered, b->first_offset) < 0)
+                    retval = -1;
+                if (q.n == 0 || (q.since != 0 && b->last_time < q.since))
+                    ; /* only a time limit, or older: the scan handles it */
+                else
+                    logterms_query_block(&r, b);
+                if (q.n == 0 && logterms_scan(&r, b->first_offset,
+                                        b->end_offset) < 0)
+                    retval = -1;
+
+                covered = b->end_offset;
+                pos += logterms_block_size(b);
+            }
+            munmap(map, seg_size);
+        }
+    }
+    if (seg_fd >= 0)
+        close(seg_fd);
+
+    /* the lines after the index */
+    if (logterms_scan(&r, covered, (uint64_t)st.st_size) < 0)
+        retval = -1;
+
+    if (retval < 0) {
+        vrmr_error(-1, "Error", "reading '%s' failed", logfile);
+    } else {
+        char line[4096];
+
+        const uint64_t kept = MIN(r.count, (uint64_t)max);
+        for (uint64_t k = r.count - kept; k < r.count; k++) {
+            ssize_t n = pread(r.fd, line, sizeof(line),
+                    (off_t)r.offsets[k % max]);
+            if (n <= 0)
+                continue;
+            const char *nl = memchr(line, '\n', (size_t)n);
+            cb(line, nl ? (size_t)(nl - line) : (size_t)n, ctx);
+        }
+        retval = (int64_t)r.count;
+    }
+
+    free(r.offsets);
+    close(r.fd);
+    return (retval);
+}
@@ -0,0 +1,478 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2019 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "config.h"
+#include "vuurmuur.h"
+
+/*
+    Open addressing hash map using Robin Hood hashing: on insert an entry
+    that is further away from its home slot takes the place of one that is
+    closer to home. This keeps probe sequences short and lets a lookup stop
+    as soon as it passes an entry that is closer to home than it would be.
+    Removal uses backward shifting, so there are no tombstones.
+
+    Duplicate keys are allowed. vrmr_map_search_match walks all entries with
+    the same key until the match callback accepts one.
+*/
+
+/* number of slots allocated on the first insert, must be a power of 2 */
+#define VRMR_MAP_MIN_SIZE 16
+
+/* grow when the table would get more than 7/8 full */
+#define VRMR_MAP_LOAD_NUM 7
+#define VRMR_MAP_LOAD_DEN 8
+
+static uint32_t map_hash_bytes(uint32_t hash, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+
+    for (size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= 16777619U;
+    }
+    return (hash);
+}
+
+static uint32_t map_hash_key(
+        enum vrmr_map_key_type type, const struct vrmr_map_key *key)
+{
+    uint32_t hash = 2166136261U;
+
+    switch (type) {
+        case VRMR_MAP_KEY_IP:
+            hash = map_hash_bytes(hash, &key->ip, sizeof(key->ip));
+            break;
+        case VRMR_MAP_KEY_PORTPROTO:
+            hash = map_hash_bytes(
+                    hash, &key->portproto, sizeof(key->portproto));
+            break;
+        case VRMR_MAP_KEY_STRING:
+            hash = vrmr_hash_name(key->string);
+            break;
+        case VRMR_MAP_KEY_TUPLE:
+            hash = map_hash_bytes(hash, &key->tuple, sizeof(key->tuple));
+            break;
+        case VRMR_MAP_KEY_CONNGROUP:
+            /* field by field, the struct has padding */
+            hash = map_hash_bytes(hash, &key->conngroup.sername,
+                    sizeof(key->conngroup.sername));
+            hash = map_hash_bytes(hash, &key->conngroup.fromname,
+                    sizeof(key->conngroup.fromname));
+            hash = map_hash_bytes(hash, &key->conngroup.toname,
+                    sizeof(key->conngroup.toname));
+            hash = map_hash_bytes(hash, &key->conngroup.status,
+                    sizeof(key->conngroup.status));
+            break;
+    }
+
+    /* 0 marks an empty slot */
+    return (hash ? hash : 1);
+}
+
+static int map_key_equal(enum vrmr_map_key_type type,
+        const struct vrmr_map_key *a, const struct vrmr_map_key *b)
+{
+    switch (type) {
+        case VRMR_MAP_KEY_IP:
+            return (memcmp(&a->ip, &b->ip, sizeof(a->ip)) == 0);
+        case VRMR_MAP_KEY_PORTPROTO:
+            return (memcmp(&a->portproto, &b->portproto,
+                            sizeof(a->portproto)) == 0);
+        case VRMR_MAP_KEY_STRING:
+            return (strcmp(a->string, b->string) == 0);
+        case VRMR_MAP_KEY_TUPLE:
+            return (memcmp(&a->tuple, &b->tuple, sizeof(a->tuple)) == 0);
+        case VRMR_MAP_KEY_CONNGROUP:
+            return (a->conngroup.sername == b->conngroup.sername &&
+                    a->conngroup.fromname == b->conngroup.fromname &&
+                    a->conngroup.toname == b->conngroup.toname &&
+                    a->conngroup.status == b->conngroup.status);
+    }
+    return (0);
+}
+
+/*  vrmr_map_setup
+
+    Sets up an empty map. 'expected' is a hint for the number of entries,
+    the map grows as needed so 0 is fine.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_map_setup(struct vrmr_map *map, enum vrmr_map_key_type type,
+        unsigned int expected)
+{
+    assert(map);
+
+    memset(map, 0, sizeof(*map));
+    map->type = type;
+
+    if (expected > 0) {
+        unsigned int size = VRMR_MAP_MIN_SIZE;
+        while (size < UINT_MAX / 2 &&
+                (uint64_t)expected * VRMR_MAP_LOAD_DEN >
+                        (uint64_t)size * VRMR_MAP_LOAD_NUM)
+            size *= 2;
+
+        if (!(map->slots = calloc(size, sizeof(struct vrmr_map_slot)))) {
+            vrmr_error(-1, "Error", "calloc failed: %s", strerror(errno));
+            return (-1);
+        }
+        map->size = size;
+    }
+    return (0);
+}
+
+/*  vrmr_map_cleanup
+
+    Frees the slots. The data the map points to is not touched.
+*/
+void vrmr_map_cleanup(struct vrmr_map *map)
+{
+    assert(map);
+
+    free(map->slots);
+    map->slots = NULL;
+    map->size = 0;
+    map->cells = 0;
+}
+
+/* place an entry, slots must have room for it */
+static void map_place(struct vrmr_map *map, struct vrmr_map_slot entry)
+{
+    unsigned int mask = map->size - 1;
+    unsigned int pos = entry.hash & mask;
+
+    entry.dist = 0;
+    for (;;) {
+        struct vrmr_map_slot *slot = &map->slots[pos];
+
+        if (slot->hash == 0) {
+            *slot = entry;
+            return;
+        }
+        if (slot->dist < entry.dist) {
+            struct vrmr_map_slot tmp = *slot;
+            *slot = entry;
+            entry = tmp;
+        }
+        pos = (pos + 1) & mask;
+        entry.dist++;
+    }
+}
+
+static int map_grow(struct vrmr_map *map)
+{
+    unsigned int old_size = map->size;
+    struct vrmr_map_slot *old_slots = map->slots;
+    unsigned int new_size = old_size ? old_size * 2 : VRMR_MAP_MIN_SIZE;
+
+    if (new_size < old_size) {
+        vrmr_error(-1, "Internal Error", "map size overflow");
+        return (-1);
+    }
+    if (!(map->slots = calloc(new_size, sizeof(struct vrmr_map_slot)))) {
+        vrmr_error(-1, "Error", "calloc failed: %s", strerror(errno));
+        map->slots = old_slots;
+        return (-1);
+    }
+    map->size = new_size;
+
+    for (unsigned int i = 0; i < old_size; i++) {
+        if (old_slots[i].hash != 0)
+            map_place(map, old_slots[i]);
+    }
+    free(old_slots);
+    return (0);
+}
+
+/*  vrmr_map_insert
+
+    Inserts 'data' under 'key'. The key is copied into the map, except for
+    string keys: there only the pointer is stored, so the string must stay
+    valid while the entry is in the map (normally it points into 'data').
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_map_insert(
+        struct vrmr_map *map, const struct vrmr_map_key *key, const void *data)
+{
+    assert(map && key);
+
+    if ((uint64_t)(map->cells + 1) * VRMR_MAP_LOAD_DEN >
+            (uint64_t)map->size * VRMR_MAP_LOAD_NUM) {
+        if (map_grow(map) < 0)
+            return (-1);
+    }
+
+    struct vrmr_map_slot entry = {
+            .hash = map_hash_key(map->type, key),
+            .dist = 0,
+            .key = *key,
+            .data = (void *)data,
+    };
+    map_place(map, entry);
+    map->cells++;
+    return (0);
+}
+
+/* returns the slot position of the first entry matching, or -1 */
+static int map_find(const struct vrmr_map *map, const struct vrmr_map_key *key,
+        int (*match)(const void *data, const void *ctx), const void *ctx)
+{
+    if (map->cells == 0)
+        return (-1);
+
+    uint32_t hash = map_hash_key(map->type, key);
+    unsigned int mask = map->size - 1;
+    unsigned int pos = hash & mask;
+
+    for (uint32_t dist = 0;; dist++) {
+        const struct vrmr_map_slot *slot = &map->slots[pos];
+
+        /* an empty slot or an entry closer to home: ours isn't here */
+        if (slot->hash == 0 || slot->dist < dist)
+            return (-1);
+
+        if (slot->hash == hash && map_key_equal(map->type, &slot->key, key) &&
+                (match == NULL || match(slot->data, ctx)))
+            return ((int)pos);
+
+        pos = (pos + 1) & mask;
+    }
+}
+
+/*  vrmr_map_search_match
+
+    Returns the first entry stored under 'key' for which 'match' returns
+    non-zero, or NULL. A NULL 'match' accepts the first entry.
+*/
+void *vrmr_map_search_match(const struct vrmr_map *map,
+        const struct vrmr_map_key *key,
+        int (*match)(const void *data, const void *ctx), const void *ctx)
+{
+    assert(map && key);
+
+    int pos = map_find(map, key, match, ctx);
+    if (pos < 0)
+        return (NULL);
+    return (map->slots[pos].data);
+}
+
+void *vrmr_map_search(
+        const struct vrmr_map *map, const struct vrmr_map_key *key)
+{
+    return (vrmr_map_search_match(map, key, NULL, NULL));
+}
+
+static int map_match_ptr(const void *data, const void *ctx)
+{
+    return (data == ctx);
+}
+
+/*  vrmr_map_contains
+
+    Returns 1 if 'data' is stored under 'key', 0 otherwise.
+*/
+int vrmr_map_contains(const struct vrmr_map *map,
+        const struct vrmr_map_key *key, const void *data)
+{
+    return (vrmr_map_search_match(map, key, map_match_ptr, data) != NULL);
+}
+
+/*  vrmr_map_remove
+
+    Removes the entry for 'data' stored under 'key'. If 'data' is NULL the
+    first entry with the key is removed.
+
+    Returncodes:
+         0: ok
+        -1: not found
+*/
+int vrmr_map_remove(
+        struct vrmr_map *map, const struct vrmr_map_key *key, const void *data)
+{
+    assert(map && key);
+
+    int found = map_find(map, key, data ? map_match_ptr : NULL, data);
+    if (found < 0)
+        return (-1);
+
+    /* shift the following entries back until one is at its home slot */
+    unsigned int mask = map->size - 1;
+    unsigned int pos = (unsigned int)found;
+    for (;;) {
+        unsigned int next = (pos + 1) & mask;
+
+        if (map->slots[next].hash == 0 || map->slots[next].dist == 0) {
+            memset(&map->slots[pos], 0, sizeof(struct vrmr_map_slot));
+            break;
+        }
+        map->slots[pos] = map->slots[next];
+        map->slots[pos].dist--;
+        pos = next;
+    }
+    map->cells--;
+    return (0);
+}
+
+/*  vrmr_map_iter
+
+    Iterates over the data stored in the map. '*iter' must be 0 on the first
+    call. Returns NULL when all entries have been returned. The map can not
+    be modified while iterating.
+*/
+void *vrmr_map_iter(const struct vrmr_map *map, unsigned int *iter)
+{
+    assert(map && iter);
+
+    while (*iter < map->size) {
+        const struct vrmr_map_slot *slot = &map->slots[*iter];
+
+        (*iter)++;
+        if (slot->hash != 0)
+            return (slot->data);
+    }
+    return (NULL);
+}
+
+/*  vrmr_map_get_stats
+
+    Fills 'stats' with the size, load factor and probe lengths of the map.
+    The probe length of an entry is the number of slots a successful lookup
+    inspects, so an entry in its home slot has probe length 1.
+*/
+void vrmr_map_get_stats(
+        const struct vrmr_map *map, struct vrmr_map_stats *stats)
+{
+    uint64_t total = 0;
+
+    assert(map && stats);
+
+    memset(stats, 0, sizeof(*stats));
+    stats->size = map->size;
+    stats->cells = map->cells;
+    if (map->size == 0 || map->cells == 0)
+        return;
+
+    stats->load = (double)map->cells / (double)map->size;
+    for (unsigned int i = 0; i < map->size; i++) {
+        const struct vrmr_map_slot *slot = &map->slots[i];
+
+        if (slot->hash == 0)
+            continue;
+
+        total += slot->dist + 1;
+        if (slot->dist + 1 > stats->max_probe)
+            stats->max_probe = slot->dist + 1;
+    }
+    stats->avg_probe = (double)total / (double)map->cells;
+}
+
+/*
+    typed keys
+*/
+
+/*  vrmr_map_key_ip
+
+    Builds an IP key from an IPv4 or IPv6 address string.
+
+    Returncodes:
+         0: ok
+        -1: not a valid address
+*/
+int vrmr_map_key_ip(struct vrmr_map_key *key, const char *ipaddress)
+{
+    assert(key && ipaddress);
+
+    memset(key, 0, sizeof(*key));
+    if (inet_pton(AF_INET, ipaddress, key->ip.addr) == 1) {
+        key->ip.family = AF_INET;
+        return (0);
+    }
+    if (inet_pton(AF_INET6, ipaddress, key->ip.addr) == 1) {
+        key->ip.family = AF_INET6;
+        return (0);
+    }
+    return (-1);
+}
+
+void vrmr_map_key_portproto(
+        struct vrmr_map_key *key, uint16_t port, uint8_t protocol)
+{
+    assert(key);
+
+    memset(key, 0, sizeof(*key));
+    key->portproto.port = port;
+    key->portproto.protocol = protocol;
+}
+
+void vrmr_map_key_string(struct vrmr_map_key *key, const char *string)
+{
+    assert(key && string);
+
+    memset(key, 0, sizeof(*key));
+    key->string = string;
+}
+
+/*  vrmr_map_key_conngroup
+
+    Builds the key of a group of connections. The names must be interned,
+    see vrmr_intern(), as they are compared by pointer.
+*/
+void vrmr_map_key_conngroup(struct vrmr_map_key *key, const char *sername,
+        const char *fromname, const char *toname, int status)
+{
+    assert(key);
+
+    memset(key, 0, sizeof(*key));
+    key->conngroup.sername = sername;
+    key->conngroup.fromname = fromname;
+    key->conngroup.toname = toname;
+    key->conngroup.status = status;
+}
+
+/*  vrmr_map_key_tuple
+
+    Builds a 5-tuple key. 'src' and 'dst' point to a struct in_addr or a
+    struct in6_addr depending on 'family'.
+*/
+void vrmr_map_key_tuple(struct vrmr_map_key *key, uint8_t family,
+        uint8_t protocol, const void *src, const void *dst, uint16_t src_port,
+        uint16_t dst_port)
+{
+    assert(key && src && dst);
+    assert(family == AF_INET || family == AF_INET6);
+
+    size_t len = (family == AF_INET) ? sizeof(struct in_addr)
+                                     : sizeof(struct in6_addr);
+
+    memset(key, 0, sizeof(*key));
+    key->tuple.family = family;
+    key->tuple.protocol = protocol;
+    key->tuple.src_port = src_port;
+    key->tuple.dst_port = dst_port;
+    memcpy(key->tuple.src, src, len);
+    memcpy(key->tuple.dst, dst, len);
+}
@@ -0,0 +1,219 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2019 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "config.h"
+#include "vuurmuur.h"
+
+/*
+    Metrics in the prometheus text format.
+
+    Every daemon writes its metrics to its own file in VRMR_METRICS_LOCATION,
+    e.g. vuurmuur.prom, so the node_exporter textfile collector can pick
+    them up. The file is written next to the old one and renamed over it,
+    so readers never see a partial file.
+
+    Counters only go up while the daemon runs. Rates, like the log records
+    per second, are left to the reader: rate(vuurmuur_log_records_total[1m]).
+
+    Labels are passed preformatted, e.g. 'table="filter",chain="INPUT"'. The
+    values are our own names, so they don't need escaping.
+*/
+
+static int metrics_mkdir(const char *dir)
+{
+    char parent[256];
+
+    if (mkdir(dir, 0755) == 0 || errno == EEXIST)
+        return (0);
+    if (errno != ENOENT)
+        goto error;
+
+    /* create the parent, e.g. /var/lib/vuurmuur */
+    strlcpy(parent, dir, sizeof(parent));
+    char *slash = strrchr(parent, '/');
+    if (slash == NULL || slash == parent)
+        goto error;
+    *slash = '\0';
+    if (mkdir(parent, 0755) < 0 && errno != EEXIST)
+        goto error;
+    if (mkdir(dir, 0755) == 0 || errno == EEXIST)
+        return (0);
+error:
+    vrmr_error(-1, "Error", "creating directory '%s' failed: %s", dir,
+            strerror(errno));
+    return (-1);
+}
+
+/*  vrmr_metrics_open
+
+    Starts writing the metrics file 'name'.prom in 'dir'. Finish it with
+    vrmr_metrics_close().
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_metrics_open(struct vrmr_metrics *m, const char *dir, const char *name)
+{
+    assert(m && dir && name);
+
+    memset(m, 0, sizeof(*m));
+
+    if (metrics_mkdir(dir) < 0)
+        return (-1);
+
+    if (snprintf(m->path, sizeof(m->path), "%s/%s.prom", dir, name) >=
+                    (int)sizeof(m->path) ||
+            snprintf(m->tmp_path, sizeof(m->tmp_path), "%s/.%s.prom.tmp", dir,
+                    name) >= (int)sizeof(m->tmp_path)) {
+        vrmr_error(-1, "Error", "metrics path too long");
+        return (-1);
+    }
+
+    if (!(m->fp = fopen(m->tmp_path, "w"))) {
+        vrmr_error(-1, "Error", "opening '%s' failed: %s", m->tmp_path,
+                strerror(errno));
+        return (-1);
+    }
+    return (0);
+}
+
+/* the HELP and TYPE lines go once before the first sample of a metric */
+static void metrics_header(struct vrmr_metrics *m, const char *name,
+        const char *type, const char *help)
+{
+    if (strcmp(m->last_name, name) == 0)
+        return;
+
+    fprintf(m->fp, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+    (void)strlcpy(m->last_name, name, sizeof(m->last_name));
+}
+
+/*  vrmr_metrics_u64
+
+    Writes a sample of the metric 'name' of 'type' (counter or gauge).
+    Samples of the same metric with different 'labels' (or NULL) have to
+    be written one after the other.
+*/
+void vrmr_metrics_u64(struct vrmr_metrics *m, const char *name,
+        const char *type, const char *help, const char *labels,
+        uint64_t value)
+{
+    assert(m && m->fp && name && type && help);
+
+    metrics_header(m, name, type, help);
+    fprintf(m->fp, "%s%s%s%s %" PRIu64 "\n", name, labels ? "{" : "",
+            labels ? labels : "", labels ? "}" : "", value);
+}
+
+/*  vrmr_metrics_double
+
+    Like vrmr_metrics_u64(), for fractions like durations in seconds.
+*/
+void vrmr_metrics_double(struct vrmr_metrics *m, const char *name,
+        const char *type, const char *help, const char *labels, double value)
+{
+    assert(m && m->fp && name && type && help);
+
+    metrics_header(m, name, type, help);
+    fprintf(m->fp, "%s%s%s%s %.6f\n", name, labels ? "{" : "",
+            labels ? labels : "", labels ? "}" : "", value);
+}
+
+/*  vrmr_metrics_control
+
+    Writes the reload metrics of the control socket 'ctl': the number of
+    reloads, the result and duration of the last one and the duration of
+    each of its phases. The names start with 'prefix', e.g. 'vuurmuur'.
+*/
+void vrmr_metrics_control(struct vrmr_metrics *m, const char *prefix,
+        const struct vrmr_control *ctl)
+{
+    char name[64];
+    char labels[64];
+
+    assert(m && prefix && ctl);
+
+    snprintf(name, sizeof(name), "%s_reloads_total", prefix);
+    vrmr_metrics_u64(m, name, "counter", "Reloads done.", NULL, ctl->reloads);
+    snprintf(name, sizeof(name), "%s_reload_requests_total", prefix);
+    vrmr_metrics_u64(m, name, "counter",
+            "Reload requests, several can be joined into one reload.", NULL,
+            ctl->requests);
+    snprintf(name, sizeof(name), "%s_reloads_failed_total", prefix);
+    vrmr_metrics_u64(m, name, "counter", "Reloads that failed.", NULL,
+            ctl->reloads_failed);
+
+    if (ctl->reloads == 0)
+        return;
+
+    snprintf(name, sizeof(name), "%s_reload_last_success", prefix);
+    vrmr_metrics_u64(m, name, "gauge",
+            "Whether the last reload succeeded (1) or failed (0).", NULL,
+            ctl->last_result != VRMR_RR_ERROR);
+    snprintf(name, sizeof(name), "%s_reload_last_timestamp_seconds", prefix);
+    vrmr_metrics_u64(m, name, "gauge", "When the last reload finished.", NULL,
+            (uint64_t)ctl->last_time);
+    snprintf(name, sizeof(name), "%s_reload_duration_seconds", prefix);
+    vrmr_metrics_double(m, name, "gauge", "Duration of the last reload.",
+            NULL, (double)ctl->last_duration_ms / 1000.0);
+
+    snprintf(name, sizeof(name), "%s_reload_phase_duration_seconds", prefix);
+    for (unsigned int i = 0; i < ctl->phases_len; i++) {
+        snprintf(labels, sizeof(labels), "phase=\"%s\"", ctl->phases[i].name);
+        vrmr_metrics_double(m, name, "gauge",
+                "Duration of the phases of the last reload.", labels,
+                (double)ctl->phases[i].ms / 1000.0);
+    }
+}
+
+/*  vrmr_metrics_close
+
+    Finishes the metrics file and replaces the old one with it.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_metrics_close(struct vrmr_metrics *m)
+{
+    assert(m);
+
+    if (m->fp == NULL)
+        return (-1);
+
+    int failed = ferror(m->fp);
+    if (fclose(m->fp) != 0)
+        failed = 1;
+    m->fp = NULL;
+
+    if (failed) {
+        vrmr_error(-1, "Error", "writing '%s' failed", m->tmp_path);
+        (void)unlink(m->tmp_path);
+        return (-1);
+    }
+    if (rename(m->tmp_path, m->path) < 0) {
+        vrmr_error(-1, "Error", "renaming '%s' to '%s' failed: %s",
+                m->tmp_path, m->path, strerror(errno));
+        (void)unlink(m->tmp_path);
+        return (-1);
+    }
+    return (0);
+}
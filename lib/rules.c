@@ -587,6 +587,75 @@ int vrmr_rules_analyze_rule(struct vrmr_rule *rule_ptr,
     return (0);
 }
 
+/*  vrmr_rules_index_key
+
+    Assembles the key under which a rule is stored in the rules index:
+    the action and the zone and service names. Rules with the same key are
+    told apart by their options in vrmr_search_rule().
+*/
+void vrmr_rules_index_key(
+        const struct vrmr_rule *rule_ptr, char *key, size_t size)
+{
+    assert(rule_ptr && key && size);
+
+    if (rule_ptr->action == VRMR_AT_PROTECT)
+        snprintf(key, size, "%d %s %s %s", rule_ptr->action, rule_ptr->who,
+                rule_ptr->source, rule_ptr->danger);
+    else
+        snprintf(key, size, "%d %s %s %s", rule_ptr->action, rule_ptr->service,
+                rule_ptr->from, rule_ptr->to);
+}
+
+static int rules_index_insert(
+        struct vrmr_rules *rules, struct vrmr_rule *rule_ptr)
+{
+    char key[VRMR_MAX_RULE_LENGTH] = "";
+
+    vrmr_rules_index_key(rule_ptr, key, sizeof(key));
+    if (vrmr_name_index_insert(&rules->index, key, rule_ptr) < 0) {
+        vrmr_error(-1, "Internal Error", "vrmr_name_index_insert() failed");
+        return (-1);
+    }
+    return (0);
+}
+
+static void rules_index_remove(
+        struct vrmr_rules *rules, struct vrmr_rule *rule_ptr)
+{
+    char key[VRMR_MAX_RULE_LENGTH] = "";
+
+    vrmr_rules_index_key(rule_ptr, key, sizeof(key));
+    (void)vrmr_name_index_remove(&rules->index, key, rule_ptr);
+}
+
+/*  vrmr_rules_reindex
+
+    Rebuilds the rules index from the list. Needs to be called after rules
+    in the list have been changed in place (e.g. after a rename of a zone or
+    service they refer to, or after editing a rule).
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_rules_reindex(struct vrmr_rules *rules)
+{
+    struct vrmr_list_node *d_node = NULL;
+
+    assert(rules);
+
+    vrmr_name_index_cleanup(&rules->index);
+
+    for (d_node = rules->list.top; d_node; d_node = d_node->next) {
+        if (d_node->data == NULL)
+            continue;
+
+        if (rules_index_insert(rules, d_node->data) < 0)
+            return (-1);
+    }
+    return (0);
+}
+
 /*  rules_init_list
 
     loads the rules from the backend
@@ -683,6 +752,9 @@ int vrmr_rules_init_list(struct vrmr_ctx *vctx,
                         rule_ptr = NULL;
                         return (-1);
                     }
+                    if (rules_index_insert(rules, rule_ptr) < 0)
+                        return (-1);
+                    (void)vrmr_rules_hash(rule_ptr);
 
                     /* set the rule number */
                     rule_ptr->number = count;
@@ -697,6 +769,372 @@ int vrmr_rules_init_list(struct vrmr_ctx *vctx,
     return (retval);
 }
 
+/*
+    Compiled rule options
+
+    The rules are read again on every reload, and most of them have the same
+    options as the last time. The options are parsed once per action and
+    option string and the result is kept here. Reading a rule copies the
+    parsed options, so the parser only runs for new option strings.
+
+    When the cache is full an entry is replaced, giving the entries that
+    were used since the last time they were looked at a second chance.
+
+    The options are hashed from their contents, see rules_options_hash().
+    Nothing is stored with the options, so changing them can't leave a
+    stale hash behind.
+*/
+
+#define RULES_OPTIONS_CACHE_MAX 4096
+
+struct rules_options_entry {
+    char *key; /* action, ':' and the option string */
+    struct vrmr_rule_options *opt;
+    bool used; /* looked up since the last eviction pass */
+};
+
+static struct vrmr_vector options_list;
+static struct vrmr_map options_map;
+static unsigned int options_hand = 0; /* next eviction candidate */
+static bool options_ready = false;
+
+static void rules_options_entry_free(void *data)
+{
+    struct rules_options_entry *entry = data;
+
+    vrmr_rules_free_options(entry->opt);
+    free(entry->key);
+    free(entry);
+}
+
+/*  vrmr_rules_options_cache_cleanup
+
+    Frees the compiled rule options.
+*/
+void vrmr_rules_options_cache_cleanup(void)
+{
+    if (!options_ready)
+        return;
+
+    vrmr_map_cleanup(&options_map);
+    vrmr_vector_cleanup(&options_list);
+    options_hand = 0;
+    options_ready = false;
+}
+
+static int rules_options_cache_setup(void)
+{
+    if (options_ready)
+        return (0);
+
+    vrmr_vector_setup(&options_list, rules_options_entry_free);
+    if (vrmr_map_setup(&options_map, VRMR_MAP_KEY_STRING, 0) < 0)
+        return (-1);
+    options_ready = true;
+    return (0);
+}
+
+static int rules_portlist_copy(
+        struct vrmr_list *dst, const struct vrmr_list *src)
+{
+    for (struct vrmr_list_node *d_node = src->top; d_node;
+            d_node = d_node->next) {
+        struct vrmr_portdata *port_ptr = malloc(sizeof(*port_ptr));
+        if (port_ptr == NULL) {
+            vrmr_error(-1, "Error", "malloc failed: %s", strerror(errno));
+            return (-1);
+        }
+        *port_ptr = *(struct vrmr_portdata *)d_node->data;
+
+        if (vrmr_list_append(dst, port_ptr) == NULL) {
+            vrmr_error(-1, "Internal Error", "vrmr_list_append() failed");
+            free(port_ptr);
+            return (-1);
+        }
+    }
+    return (0);
+}
+
+static bool rules_portlist_equal(
+        const struct vrmr_list *a, const struct vrmr_list *b)
+{
+    const struct vrmr_list_node *a_node = a->top, *b_node = b->top;
+
+    for (; a_node && b_node; a_node = a_node->next, b_node = b_node->next) {
+        const struct vrmr_portdata *a_port = a_node->data;
+        const struct vrmr_portdata *b_port = b_node->data;
+
+        if (a_port->protocol != b_port->protocol ||
+                a_port->src_low != b_port->src_low ||
+                a_port->src_high != b_port->src_high ||
+                a_port->dst_low != b_port->dst_low ||
+                a_port->dst_high != b_port->dst_high)
+            return (false);
+    }
+    return (a_node == NULL && b_node == NULL);
+}
+
+/*  rules_options_copy
+
+    Copies 'src' to 'dst', which must be freshly allocated by
+    vrmr_rule_option_malloc().
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int rules_options_copy(
+        struct vrmr_rule_options *dst, const struct vrmr_rule_options *src)
+{
+    memcpy(dst, src, sizeof(*dst));
+    vrmr_list_setup(&dst->RemoteportList, NULL);
+    vrmr_list_setup(&dst->ListenportList, NULL);
+
+    if (rules_portlist_copy(&dst->RemoteportList, &src->RemoteportList) < 0)
+        return (-1);
+    if (rules_portlist_copy(&dst->ListenportList, &src->ListenportList) < 0)
+        return (-1);
+    return (0);
+}
+
+/* the fixed fields of the options. The strings are compared and hashed up
+ * to their '\0', the rest of the array and the padding between the fields
+ * may hold anything. */
+struct rules_options_field {
+    size_t offset;
+    size_t size;
+    bool string;
+};
+
+#define RULES_OPTIONS_FIELD(f, s)                                             \
+    {                                                                         \
+        offsetof(struct vrmr_rule_options, f),                                \
+                sizeof(((struct vrmr_rule_options *)0)->f), (s)               \
+    }
+
+static const struct rules_options_field rules_options_fields[] = {
+        RULES_OPTIONS_FIELD(rule_log, false),
+        RULES_OPTIONS_FIELD(logprefix, true),
+        RULES_OPTIONS_FIELD(rule_logprefix, false),
+        RULES_OPTIONS_FIELD(loglimit, false),
+        RULES_OPTIONS_FIELD(logburst, false),
+        RULES_OPTIONS_FIELD(comment, true),
+        RULES_OPTIONS_FIELD(rule_comment, false),
+        RULES_OPTIONS_FIELD(redirectport, false),
+        RULES_OPTIONS_FIELD(in_int, true),
+        RULES_OPTIONS_FIELD(out_int, true),
+        RULES_OPTIONS_FIELD(via_int, true),
+        RULES_OPTIONS_FIELD(reject_option, false),
+        RULES_OPTIONS_FIELD(reject_type, true),
+        RULES_OPTIONS_FIELD(nfmark, false),
+        RULES_OPTIONS_FIELD(chain, true),
+        RULES_OPTIONS_FIELD(limit, false),
+        RULES_OPTIONS_FIELD(limit_unit, true),
+        RULES_OPTIONS_FIELD(burst, false),
+        RULES_OPTIONS_FIELD(nfqueue_num, false),
+        RULES_OPTIONS_FIELD(nflog_num, false),
+        RULES_OPTIONS_FIELD(bw_in_max, false),
+        RULES_OPTIONS_FIELD(bw_in_max_unit, true),
+        RULES_OPTIONS_FIELD(bw_in_min, false),
+        RULES_OPTIONS_FIELD(bw_in_min_unit, true),
+        RULES_OPTIONS_FIELD(bw_out_max, false),
+        RULES_OPTIONS_FIELD(bw_out_max_unit, true),
+        RULES_OPTIONS_FIELD(bw_out_min, false),
+        RULES_OPTIONS_FIELD(bw_out_min_unit, true),
+        RULES_OPTIONS_FIELD(prio, false),
+        RULES_OPTIONS_FIELD(random, false),
+        RULES_OPTIONS_FIELD(remoteport, false),
+        RULES_OPTIONS_FIELD(listenport, false),
+};
+#define RULES_OPTIONS_FIELDS                                                  \
+    (sizeof(rules_options_fields) / sizeof(rules_options_fields[0]))
+
+/*  rules_options_equal
+
+    Compares the options field by field. If this returns false the options
+    may still assemble to the same string.
+*/
+static bool rules_options_equal(
+        const struct vrmr_rule_options *a, const struct vrmr_rule_options *b)
+{
+    for (size_t i = 0; i < RULES_OPTIONS_FIELDS; i++) {
+        const struct rules_options_field *f = &rules_options_fields[i];
+        const char *a_field = (const char *)a + f->offset;
+        const char *b_field = (const char *)b + f->offset;
+
+        if (f->string) {
+            if (strncmp(a_field, b_field, f->size) != 0)
+                return (false);
+        } else if (memcmp(a_field, b_field, f->size) != 0) {
+            return (false);
+        }
+    }
+    return (rules_portlist_equal(&a->RemoteportList, &b->RemoteportList) &&
+            rules_portlist_equal(&a->ListenportList, &b->ListenportList));
+}
+
+static uint32_t rules_options_hash_bytes(
+        uint32_t hash, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+
+    for (size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= 16777619U;
+    }
+    return (hash);
+}
+
+static uint32_t rules_options_hash_ports(
+        uint32_t hash, const struct vrmr_list *list)
+{
+    for (const struct vrmr_list_node *d_node = list->top; d_node;
+            d_node = d_node->next) {
+        const struct vrmr_portdata *port = d_node->data;
+        const int fields[] = {port->protocol, port->src_low, port->src_high,
+                port->dst_low, port->dst_high};
+
+        hash = rules_options_hash_bytes(hash, fields, sizeof(fields));
+    }
+    return (hash);
+}
+
+/*  rules_options_hash
+
+    Hashes what rules_options_equal() compares, so options that are equal
+    get the same hash. Options that differ may still assemble to the same
+    string.
+*/
+static uint32_t rules_options_hash(const struct vrmr_rule_options *opt)
+{
+    uint32_t hash = 2166136261U;
+
+    for (size_t i = 0; i < RULES_OPTIONS_FIELDS; i++) {
+        const struct rules_options_field *f = &rules_options_fields[i];
+        const char *field = (const char *)opt + f->offset;
+
+        /* hash the '\0' too, so "ab" + "c" differs from "a" + "bc" */
+        hash = rules_options_hash_bytes(hash, field,
+                f->string ? strnlen(field, f->size - 1) + 1 : f->size);
+    }
+    hash = rules_options_hash_ports(hash, &opt->RemoteportList);
+    hash = rules_options_hash_ports(hash, &opt->ListenportList);
+    return (hash);
+}
+
+/* makes room for a new entry: replaces the first entry from 'options_hand'
+ * that wasn't used since the hand passed it last. Returns its position. */
+static unsigned int rules_options_evict(void)
+{
+    struct rules_options_entry *entry = NULL;
+    struct vrmr_map_key map_key;
+
+    for (;;) {
+        if (options_hand >= options_list.len)
+            options_hand = 0;
+
+        entry = options_list.data[options_hand];
+        if (!entry->used)
+            break;
+        entry->used = false;
+        options_hand++;
+    }
+
+    vrmr_debug(HIGH, "evicting compiled rule options '%s'.", entry->key);
+    vrmr_map_key_string(&map_key, entry->key);
+    (void)vrmr_map_remove(&options_map, &map_key, entry);
+    rules_options_entry_free(entry);
+    options_list.data[options_hand] = NULL;
+    return (options_hand++);
+}
+
+/*  rules_read_options
+
+    Reads the options of a rule through the compiled options.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int rules_read_options(
+        const char *optstr, int action, struct vrmr_rule_options *op)
+{
+    char key[VRMR_MAX_OPTIONS_LENGTH + 16];
+    struct vrmr_map_key map_key;
+    struct rules_options_entry *entry = NULL;
+
+    const char *action_ptr = vrmr_rules_itoaction(action);
+    if (action_ptr == NULL ||
+            snprintf(key, sizeof(key), "%d:%s", action, optstr) >=
+                    (int)sizeof(key) ||
+            rules_options_cache_setup() < 0)
+        return (vrmr_rules_read_options(optstr, op));
+
+    vrmr_map_key_string(&map_key, key);
+    if ((entry = vrmr_map_search(&options_map, &map_key)) != NULL) {
+        entry->used = true;
+        return (rules_options_copy(op, entry->opt));
+    }
+
+    if (vrmr_rules_read_options(optstr, op) < 0)
+        return (-1);
+
+    /* keep a copy of the result */
+    if (!(entry = calloc(1, sizeof(*entry))) || !(entry->key = strdup(key)) ||
+            !(entry->opt = vrmr_rule_option_malloc()) ||
+            rules_options_copy(entry->opt, op) < 0) {
+        vrmr_error(-1, "Error", "storing the rule options failed");
+        if (entry != NULL)
+            rules_options_entry_free(entry);
+        return (0);
+    }
+    if (options_list.len >= RULES_OPTIONS_CACHE_MAX) {
+        options_list.data[rules_options_evict()] = entry;
+    } else if (vrmr_vector_append(&options_list, entry) < 0) {
+        rules_options_entry_free(entry);
+        return (0);
+    }
+    vrmr_map_key_string(&map_key, entry->key);
+    (void)vrmr_map_insert(&options_map, &map_key, entry);
+    return (0);
+}
+
+/*  vrmr_rules_get_word
+
+    Copies the word at position '*pos' of the rule 'line' into 'word' and
+    moves '*pos' to the next word. Words are separated by a space, the line
+    ends at the end of the string or at a newline.
+
+    Returncodes:
+         0: ok
+        -1: the word doesn't fit in 'word'
+*/
+int vrmr_rules_get_word(
+        const char *line, size_t *pos, char *word, size_t size)
+{
+    size_t p = 0, w = 0;
+
+    assert(line && pos && word && size > 0);
+
+    for (p = *pos; line[p] != ' ' && line[p] != '\0' && line[p] != '\n';
+            p++) {
+        if (w == size - 1) {
+            word[w] = '\0';
+            vrmr_error(-1, "Error", "bad rule syntax, '%s...' is too long: %s",
+                    word, line);
+            return (-1);
+        }
+        word[w++] = line[p];
+    }
+    word[w] = '\0';
+
+    /* skip the separator, but never the end of the line */
+    if (line[p] == ' ')
+        p++;
+    *pos = p;
+    return (0);
+}
+
 /*  vrmr_rules_parse_line
 
     Returncodes:
@@ -706,10 +1144,10 @@ int vrmr_rules_init_list(struct vrmr_ctx *vctx,
 int vrmr_rules_parse_line(
         char *line, struct vrmr_rule *rule_ptr, struct vrmr_regex *reg)
 {
-    size_t line_pos = 0, // position in line
-            var_pos = 0; // position in varible
+    size_t line_pos = 0; // position in line
     char options[VRMR_MAX_OPTIONS_LENGTH] = "";
     char action_str[32] = "";
+    char keyword[16] = "";
 
     assert(line && rule_ptr && reg);
 
@@ -720,15 +1158,14 @@ int vrmr_rules_parse_line(
     }
 
     /* this should not happen, but it can't hurt to check, right? */
-    if (strlen(line) > VRMR_MAX_RULE_LENGTH) {
+    size_t line_len = strlen(line);
+    if (line_len > VRMR_MAX_RULE_LENGTH) {
         vrmr_error(-1, "Internal Error", "rule is too long");
         return (-1);
     }
     /* strip the newline */
-    if (line[strlen(line) - 1] == '\n')
-        line[strlen(line) - 1] = '\0';
-
-    memset(options, 0, sizeof(options));
+    if (line_len > 0 && line[line_len - 1] == '\n')
+        line[line_len - 1] = '\0';
 
     vrmr_debug(LOW, "rule: '%s'.", line);
 
@@ -743,13 +1180,9 @@ int vrmr_rules_parse_line(
     }
 
     /* get the action */
-    for (var_pos = 0;
-            line_pos < sizeof(action_str) - 1 && line[line_pos] != ' ' &&
-            line[line_pos] != '\0' && line[line_pos] != '\n';
-            line_pos++, var_pos++) {
-        action_str[var_pos] = line[line_pos];
-    }
-    action_str[var_pos] = '\0';
+    if (vrmr_rules_get_word(line, &line_pos, action_str, sizeof(action_str)) <
+            0)
+        return (-1);
 
     rule_ptr->action = vrmr_rules_actiontoi(action_str);
     if (rule_ptr->action <= VRMR_AT_ERROR ||
@@ -763,13 +1196,9 @@ int vrmr_rules_parse_line(
         /*
             get the who, or 'against'
         */
-        for (line_pos++, var_pos = 0;
-                var_pos < sizeof(rule_ptr->who) && line[line_pos] != ' ' &&
-                line[line_pos] != '\0' && line[line_pos] != '\n';
-                line_pos++, var_pos++) {
-            rule_ptr->who[var_pos] = line[line_pos];
-        }
-        rule_ptr->who[var_pos] = '\0';
+        if (vrmr_rules_get_word(line, &line_pos, rule_ptr->who,
+                    sizeof(rule_ptr->who)) < 0)
+            return (-1);
 
         vrmr_debug(HIGH, "protect: who: '%s'", rule_ptr->who);
 
@@ -787,14 +1216,9 @@ int vrmr_rules_parse_line(
             /*
                 okay, now lets see what kind of danger we are talking about
             */
-            for (line_pos++, var_pos = 0;
-                    var_pos < sizeof(rule_ptr->danger) &&
-                    line[line_pos] != ' ' && line[line_pos] != '\0' &&
-                    line[line_pos] != '\n';
-                    line_pos++, var_pos++) {
-                rule_ptr->danger[var_pos] = line[line_pos];
-            }
-            rule_ptr->danger[var_pos] = '\0';
+            if (vrmr_rules_get_word(line, &line_pos, rule_ptr->danger,
+                        sizeof(rule_ptr->danger)) < 0)
+                return (-1);
 
             vrmr_debug(HIGH, "protect: danger: '%s'", rule_ptr->danger);
         } else {
@@ -816,22 +1240,17 @@ int vrmr_rules_parse_line(
             /*
                 get the keyword 'against'
             */
-            for (line_pos++, var_pos = 0;
-                    var_pos < strlen("against") && line[line_pos] != ' ' &&
-                    line[line_pos] != '\0' && line[line_pos] != '\n';
-                    line_pos++, var_pos++) {
-                rule_ptr->danger[var_pos] = line[line_pos];
-            }
-            rule_ptr->danger[var_pos] = '\0';
+            if (vrmr_rules_get_word(
+                        line, &line_pos, keyword, sizeof(keyword)) < 0)
+                return (-1);
 
-            vrmr_debug(
-                    HIGH, "protect: keyword against: '%s'", rule_ptr->danger);
+            vrmr_debug(HIGH, "protect: keyword against: '%s'", keyword);
 
             /*
                 if 'against' is missing, the rule is malformed, so we bail out
                screaming & kicking
             */
-            if (strcasecmp(rule_ptr->danger, "against") != 0) {
+            if (strcasecmp(keyword, "against") != 0) {
                 vrmr_error(-1, "Error",
                         "bad rule syntax, keyword 'against' is missing: %s",
                         line);
@@ -841,14 +1260,9 @@ int vrmr_rules_parse_line(
             /*
                 okay, now lets see what kind of danger we are talking about
             */
-            for (line_pos++, var_pos = 0;
-                    var_pos < sizeof(rule_ptr->danger) &&
-                    line[line_pos] != ' ' && line[line_pos] != '\0' &&
-                    line[line_pos] != '\n';
-                    line_pos++, var_pos++) {
-                rule_ptr->danger[var_pos] = line[line_pos];
-            }
-            rule_ptr->danger[var_pos] = '\0';
+            if (vrmr_rules_get_word(line, &line_pos, rule_ptr->danger,
+                        sizeof(rule_ptr->danger)) < 0)
+                return (-1);
 
             vrmr_debug(HIGH, "protect: danger: '%s'", rule_ptr->danger);
 
@@ -859,22 +1273,17 @@ int vrmr_rules_parse_line(
                 /*
                     get the 'from'
                 */
-                for (line_pos++, var_pos = 0;
-                        var_pos < strlen("from") && line[line_pos] != ' ' &&
-                        line[line_pos] != '\0' && line[line_pos] != '\n';
-                        line_pos++, var_pos++) {
-                    rule_ptr->source[var_pos] = line[line_pos];
-                }
-                rule_ptr->source[var_pos] = '\0';
+                if (vrmr_rules_get_word(
+                            line, &line_pos, keyword, sizeof(keyword)) < 0)
+                    return (-1);
 
-                vrmr_debug(
-                        HIGH, "protect: keyword from: '%s'", rule_ptr->source);
+                vrmr_debug(HIGH, "protect: keyword from: '%s'", keyword);
 
                 /*
                     if 'from' is missing, the rule is malformed, so we bail out
                    screaming & kicking
                 */
-                if (strcasecmp(rule_ptr->source, "from") != 0) {
+                if (strcasecmp(keyword, "from") != 0) {
                     vrmr_error(-1, "Error",
                             "bad rule syntax, keyword 'from' is missing");
                     return (-1);
@@ -883,14 +1292,9 @@ int vrmr_rules_parse_line(
                 /*
                     get the source
                 */
-                for (line_pos++, var_pos = 0;
-                        var_pos < sizeof(rule_ptr->source) &&
-                        line[line_pos] != ' ' && line[line_pos] != '\0' &&
-                        line[line_pos] != '\n';
-                        line_pos++, var_pos++) {
-                    rule_ptr->source[var_pos] = line[line_pos];
-                }
-                rule_ptr->source[var_pos] = '\0';
+                if (vrmr_rules_get_word(line, &line_pos, rule_ptr->source,
+                            sizeof(rule_ptr->source)) < 0)
+                    return (-1);
 
                 vrmr_debug(HIGH, "protect: source: '%s'", rule_ptr->source);
             }
@@ -907,18 +1311,13 @@ int vrmr_rules_parse_line(
             /*
                 first check for the keyword 'service'
             */
-            for (line_pos++, var_pos = 0;
-                    var_pos < sizeof(rule_ptr->service) &&
-                    line[line_pos] != ' ' && line[line_pos] != '\0' &&
-                    line[line_pos] != '\n' && line_pos < strlen(line);
-                    line_pos++, var_pos++) {
-                rule_ptr->service[var_pos] = line[line_pos];
-            }
-            rule_ptr->service[var_pos] = '\0';
+            if (vrmr_rules_get_word(
+                        line, &line_pos, keyword, sizeof(keyword)) < 0)
+                return (-1);
 
-            vrmr_debug(HIGH, "keyword service: '%s'.", rule_ptr->service);
+            vrmr_debug(HIGH, "keyword service: '%s'.", keyword);
 
-            if (strcasecmp(rule_ptr->service, "service") != 0) {
+            if (strcasecmp(keyword, "service") != 0) {
                 vrmr_error(-1, "Error",
                         "bad rule syntax, keyword 'service' is missing: %s",
                         line);
@@ -928,14 +1327,9 @@ int vrmr_rules_parse_line(
             /*
                 get the service itself
             */
-            for (line_pos++, var_pos = 0;
-                    var_pos < sizeof(rule_ptr->service) &&
-                    line[line_pos] != ' ' && line[line_pos] != '\0' &&
-                    line[line_pos] != '\n' && line_pos < strlen(line);
-                    line_pos++, var_pos++) {
-                rule_ptr->service[var_pos] = line[line_pos];
-            }
-            rule_ptr->service[var_pos] = '\0';
+            if (vrmr_rules_get_word(line, &line_pos, rule_ptr->service,
+                        sizeof(rule_ptr->service)) < 0)
+                return (-1);
 
             vrmr_debug(HIGH, "service: '%s'.", rule_ptr->service);
 
@@ -960,18 +1354,13 @@ int vrmr_rules_parse_line(
             /*
                 first check for the keyword 'from'
             */
-            for (line_pos++, var_pos = 0;
-                    var_pos < sizeof(rule_ptr->from) && line[line_pos] != ' ' &&
-                    line[line_pos] != '\0' && line[line_pos] != '\n' &&
-                    line_pos < strlen(line);
-                    line_pos++, var_pos++) {
-                rule_ptr->from[var_pos] = line[line_pos];
-            }
-            rule_ptr->from[var_pos] = '\0';
+            if (vrmr_rules_get_word(
+                        line, &line_pos, keyword, sizeof(keyword)) < 0)
+                return (-1);
 
-            vrmr_debug(HIGH, "keyword from: '%s'.", rule_ptr->from);
+            vrmr_debug(HIGH, "keyword from: '%s'.", keyword);
 
-            if (strcasecmp(rule_ptr->from, "from") != 0) {
+            if (strcasecmp(keyword, "from") != 0) {
                 vrmr_error(-1, "Error",
                         "bad rule syntax, keyword 'from' is missing: %s", line);
                 return (-1);
@@ -980,14 +1369,9 @@ int vrmr_rules_parse_line(
             /*
                 get the from itself
             */
-            for (line_pos++, var_pos = 0;
-                    var_pos < sizeof(rule_ptr->from) && line[line_pos] != ' ' &&
-                    line[line_pos] != '\0' && line[line_pos] != '\n' &&
-                    line_pos < strlen(line);
-                    line_pos++, var_pos++) {
-                rule_ptr->from[var_pos] = line[line_pos];
-            }
-            rule_ptr->from[var_pos] = '\0';
+            if (vrmr_rules_get_word(line, &line_pos, rule_ptr->from,
+                        sizeof(rule_ptr->from)) < 0)
+                return (-1);
 
             vrmr_debug(HIGH, "from: '%s'.", rule_ptr->from);
 
@@ -1017,18 +1401,13 @@ int vrmr_rules_parse_line(
             /*
                 first check for the keyword 'to'
             */
-            for (line_pos++, var_pos = 0;
-                    var_pos < sizeof(rule_ptr->to) && line[line_pos] != ' ' &&
-                    line[line_pos] != '\0' && line[line_pos] != '\n' &&
-                    line_pos < strlen(line);
-                    line_pos++, var_pos++) {
-                rule_ptr->to[var_pos] = line[line_pos];
-            }
-            rule_ptr->to[var_pos] = '\0';
+            if (vrmr_rules_get_word(
+                        line, &line_pos, keyword, sizeof(keyword)) < 0)
+                return (-1);
 
-            vrmr_debug(HIGH, "keyword to: '%s'.", rule_ptr->to);
+            vrmr_debug(HIGH, "keyword to: '%s'.", keyword);
 
-            if (strcasecmp(rule_ptr->to, "to") != 0) {
+            if (strcasecmp(keyword, "to") != 0) {
                 vrmr_error(-1, "Error",
                         "bad rule syntax, keyword 'to' is missing: %s", line);
                 return (-1);
@@ -1037,14 +1416,9 @@ int vrmr_rules_parse_line(
             /*
                 get to
             */
-            for (line_pos++, var_pos = 0;
-                    var_pos < sizeof(rule_ptr->to) && line[line_pos] != ' ' &&
-                    line[line_pos] != '\0' && line[line_pos] != '\n' &&
-                    line_pos < strlen(line);
-                    line_pos++, var_pos++) {
-                rule_ptr->to[var_pos] = line[line_pos];
-            }
-            rule_ptr->to[var_pos] = '\0';
+            if (vrmr_rules_get_word(line, &line_pos, rule_ptr->to,
+                        sizeof(rule_ptr->to)) < 0)
+                return (-1);
 
             vrmr_debug(HIGH, "to: '%s'.", rule_ptr->to);
 
@@ -1075,32 +1449,26 @@ int vrmr_rules_parse_line(
         /*
             first check for the keyword 'options'
         */
-        for (line_pos++, var_pos = 0;
-                var_pos < sizeof(options) && line[line_pos] != ' ' &&
-                line[line_pos] != '\0' && line[line_pos] != '\n' &&
-                line_pos < strlen(line);
-                line_pos++, var_pos++) {
-            options[var_pos] = line[line_pos];
-        }
-        options[var_pos] = '\0';
+        if (vrmr_rules_get_word(line, &line_pos, keyword, sizeof(keyword)) < 0)
+            return (-1);
 
-        vrmr_debug(MEDIUM, "keyword options: '%s'.", options);
+        vrmr_debug(MEDIUM, "keyword options: '%s'.", keyword);
 
         /*
             if this keyword exists we have options
         */
-        if (strcasecmp(options, "options") == 0) {
+        if (strcasecmp(keyword, "options") == 0) {
             /*
                 get options: NOTE: whitespaces are allowed!
             */
-            for (line_pos++, var_pos = 0;
-                    var_pos < sizeof(options) && line[line_pos] != '\0' &&
-                    line[line_pos] != '\n' && line_pos < VRMR_MAX_RULE_LENGTH &&
-                    line_pos < strlen(line);
-                    line_pos++, var_pos++) {
-                options[var_pos] = line[line_pos];
+            size_t options_len = strcspn(line + line_pos, "\n");
+            if (options_len >= sizeof(options)) {
+                vrmr_error(-1, "Error",
+                        "bad rule syntax, options are too long: %s", line);
+                return (-1);
             }
-            options[var_pos] = '\0';
+            memcpy(options, line + line_pos, options_len);
+            options[options_len] = '\0';
 
             vrmr_debug(MEDIUM, "options: '%s'.", options);
 
@@ -1113,11 +1481,12 @@ int vrmr_rules_parse_line(
             /*
                 now split them up
             */
-            if (vrmr_rules_read_options(options, rule_ptr->opt) < 0) {
+            if (rules_read_options(options, rule_ptr->action, rule_ptr->opt) <
+                    0) {
                 vrmr_error(-1, "Error",
                         "parsing rule options failed for: '%s'.", line);
 
-                free(rule_ptr->opt);
+                vrmr_rules_free_options(rule_ptr->opt);
                 rule_ptr->opt = NULL;
 
                 return (-1);
@@ -1126,7 +1495,6 @@ int vrmr_rules_parse_line(
         /* no options */
         else {
             vrmr_debug(HIGH, "rule has no options.");
-            strcpy(options, "");
             rule_ptr->opt = NULL;
         }
     }
@@ -1291,6 +1659,7 @@ int vrmr_rules_cleanup_list(struct vrmr_rules *rules)
     /* cleanup lists */
     if (vrmr_list_cleanup(&rules->list) < 0)
         return (-1);
+    vrmr_name_index_cleanup(&rules->index);
 
     if (vrmr_list_cleanup(&rules->helpers) < 0)
         return (-1);
@@ -1349,6 +1718,8 @@ int vrmr_rules_insert_list(struct vrmr_rules *rules, unsigned int place,
                     "inserting the data to the top of list failed");
             return (-1);
         }
+        if (rules_index_insert(rules, rule_ptr) < 0)
+            return (-1);
 
         vrmr_debug(HIGH,
                 "vrmr_list_prepend succes, now update numbers (place: %u)",
@@ -1388,6 +1759,8 @@ int vrmr_rules_insert_list(struct vrmr_rules *rules, unsigned int place,
                         "inserting the data into the list failed.");
                 return (-1);
             }
+            if (rules_index_insert(rules, rule_ptr) < 0)
+                return (-1);
 
             /* update numbers after count */
             vrmr_debug(HIGH,
@@ -1832,6 +2205,44 @@ char *vrmr_rules_assemble_options_string(
     return (option_ptr);
 }
 
+/*  vrmr_rules_hash
+
+    Sets rule_ptr->hash to the hash of the rule as it is stored in the
+    backend, so rules that are written the same get the same hash. Rules
+    with a different hash differ, for rules with the same hash the fields
+    still have to be compared. The options are hashed from their contents,
+    see rules_options_hash().
+
+    Returncodes:
+         0: ok
+        -1: error, hash set to 0
+*/
+int vrmr_rules_hash(struct vrmr_rule *rule_ptr)
+{
+    char line[VRMR_MAX_RULE_LENGTH] = "";
+
+    assert(rule_ptr);
+
+    rule_ptr->hash = 0;
+    if (rule_ptr->action == VRMR_AT_SEPARATOR) {
+        (void)strlcpy(line, "separator", sizeof(line));
+    } else {
+        const char *action_ptr = vrmr_rules_itoaction(rule_ptr->action);
+        if (action_ptr == NULL)
+            return (-1);
+
+        snprintf(line, sizeof(line), "%s%s service %s from %s to %s",
+                rule_ptr->active == TRUE ? "" : ";", action_ptr,
+                rule_ptr->service, rule_ptr->from, rule_ptr->to);
+    }
+
+    uint32_t hash = (uint32_t)vrmr_hash_name(line);
+    if (rule_ptr->opt != NULL)
+        hash = hash * 31 + rules_options_hash(rule_ptr->opt);
+    rule_ptr->hash = hash;
+    return (0);
+}
+
 /*
     Returncodes:
         -1: error
@@ -1856,6 +2267,11 @@ int vrmr_rules_compare_options(struct vrmr_rule_options *old_opt,
         return (1);
     }
 
+    /* options that are the same down to the byte, like the options read
+       from the same string, are the same without assembling them */
+    if (rules_options_equal(old_opt, new_opt))
+        return (0);
+
     /* from here on, we are sure we have two options */
     if (!(old_str = vrmr_rules_assemble_options_string(old_opt, action)))
         return (-1);
@@ -1881,61 +2297,33 @@ int vrmr_rules_compare_options(struct vrmr_rule_options *old_opt,
 /*
     TODO: compare active
 */
-void *vrmr_search_rule(
-        struct vrmr_rules *rules, struct vrmr_rule *searchrule_ptr)
+/*  rules_search_match
+
+    Match callback for the rules index: the key already matched, so for
+    normal rules only the options are left to compare.
+*/
+static int rules_search_match(const void *data, const void *ctx)
 {
-    struct vrmr_list_node *d_node = NULL;
-    struct vrmr_rule *listrule_ptr = NULL;
+    const struct vrmr_rule *listrule_ptr = data;
+    const struct vrmr_rule *searchrule_ptr = ctx;
 
-    assert(rules && searchrule_ptr);
+    if (searchrule_ptr->action == VRMR_AT_PROTECT)
+        return (1);
 
-    for (d_node = rules->list.top; d_node; d_node = d_node->next) {
-        if (!(listrule_ptr = d_node->data)) {
-            vrmr_error(-1, "Internal Error", "NULL pointer");
-            return (NULL);
-        }
+    return (vrmr_rules_compare_options(listrule_ptr->opt, searchrule_ptr->opt,
+                    vrmr_rules_itoaction(listrule_ptr->action)) == 0);
+}
 
-        if (listrule_ptr->action == searchrule_ptr->action) {
-            /* protect rule */
-            if (searchrule_ptr->action == VRMR_AT_PROTECT) {
-                /* compare who */
-                if (strcmp(listrule_ptr->who, searchrule_ptr->who) == 0) {
-                    /* compare source */
-                    if (strcmp(listrule_ptr->source, searchrule_ptr->source) ==
-                            0) {
-                        /* compare the danger */
-                        if (strcmp(listrule_ptr->danger,
-                                    searchrule_ptr->danger) == 0) {
-                            return (listrule_ptr);
-                        }
-                    }
-                }
-            }
+void *vrmr_search_rule(
+        struct vrmr_rules *rules, struct vrmr_rule *searchrule_ptr)
+{
+    char key[VRMR_MAX_RULE_LENGTH] = "";
 
-            /* normal rule */
-            else {
-                /* first compare the service-names */
-                if (strcmp(listrule_ptr->service, searchrule_ptr->service) ==
-                        0) {
-                    /* comparing the 'from'-name */
-                    if (strcmp(listrule_ptr->from, searchrule_ptr->from) == 0) {
-                        /* comparing the 'to'-name */
-                        if (strcmp(listrule_ptr->to, searchrule_ptr->to) == 0) {
-                            /* comparing the rule options */
-                            if (vrmr_rules_compare_options(listrule_ptr->opt,
-                                        searchrule_ptr->opt,
-                                        vrmr_rules_itoaction(
-                                                listrule_ptr->action)) == 0) {
-                                return (listrule_ptr);
-                            }
-                        }
-                    }
-                }
-            }
-        }
-    }
+    assert(rules && searchrule_ptr);
 
-    return (NULL);
+    vrmr_rules_index_key(searchrule_ptr, key, sizeof(key));
+    return (vrmr_name_index_search_match(
+            &rules->index, key, rules_search_match, searchrule_ptr));
 }
 
 static int parse_option(const char *curopt, struct vrmr_rule_options *op)
@@ -2089,6 +2477,10 @@ static int parse_option(const char *curopt, struct vrmr_rule_options *op)
     else if (strncmp(curopt, "remoteport", strlen("remoteport")) == 0) {
         vrmr_debug(MEDIUM, "remoteport specified.");
 
+        if (curopt_len <= strlen("remoteport")) {
+            vrmr_error(-1, "Error", "remoteport option has no value.");
+            return (-1);
+        }
         const char *valuestart = curopt + (strlen("remoteport") + 1);
         strlcpy(portstring, valuestart, sizeof(portstring));
 
@@ -2107,6 +2499,10 @@ static int parse_option(const char *curopt, struct vrmr_rule_options *op)
     else if (strncmp(curopt, "listenport", strlen("listenport")) == 0) {
         vrmr_debug(MEDIUM, "listenport specified.");
 
+        if (curopt_len <= strlen("listenport")) {
+            vrmr_error(-1, "Error", "listenport option has no value.");
+            return (-1);
+        }
         const char *valuestart = curopt + (strlen("listenport") + 1);
         strlcpy(portstring, valuestart, sizeof(portstring));
 
@@ -2294,7 +2690,8 @@ static int parse_option(const char *curopt, struct vrmr_rule_options *op)
 
         /* split the value and the unit */
         for (p = 0, i = 0; p < sizeof(value_string) - 1 &&
-                           i < strlen(bw_string) && isdigit(bw_string[i]);
+                           i < strlen(bw_string) &&
+                           isdigit((unsigned char)bw_string[i]);
                 i++, p++) {
             value_string[p] = bw_string[i];
         }
@@ -2302,7 +2699,7 @@ static int parse_option(const char *curopt, struct vrmr_rule_options *op)
 
         for (p = 0, i = strlen(value_string);
                 p < sizeof(unit_string) - 1 && i < strlen(bw_string) &&
-                isalpha(bw_string[i]);
+                isalpha((unsigned char)bw_string[i]);
                 i++, p++) {
             unit_string[p] = bw_string[i];
         }
@@ -2340,7 +2737,8 @@ static int parse_option(const char *curopt, struct vrmr_rule_options *op)
 
         /* split the value and the unit */
         for (p = 0, i = 0; p < sizeof(value_string) - 1 &&
-                           i < strlen(bw_string) && isdigit(bw_string[i]);
+                           i < strlen(bw_string) &&
+                           isdigit((unsigned char)bw_string[i]);
                 i++, p++) {
             value_string[p] = bw_string[i];
         }
@@ -2348,7 +2746,7 @@ static int parse_option(const char *curopt, struct vrmr_rule_options *op)
 
         for (p = 0, i = strlen(value_string);
                 p < sizeof(unit_string) - 1 && i < strlen(bw_string) &&
-                isalpha(bw_string[i]);
+                isalpha((unsigned char)bw_string[i]);
                 i++, p++) {
             unit_string[p] = bw_string[i];
         }
@@ -2385,7 +2783,8 @@ static int parse_option(const char *curopt, struct vrmr_rule_options *op)
 
         /* split the value and the unit */
         for (p = 0, i = 0; p < sizeof(value_string) - 1 &&
-                           i < strlen(bw_string) && isdigit(bw_string[i]);
+                           i < strlen(bw_string) &&
+                           isdigit((unsigned char)bw_string[i]);
                 i++, p++) {
             value_string[p] = bw_string[i];
         }
@@ -2393,7 +2792,7 @@ static int parse_option(const char *curopt, struct vrmr_rule_options *op)
 
         for (p = 0, i = strlen(value_string);
                 p < sizeof(unit_string) - 1 && i < strlen(bw_string) &&
-                isalpha(bw_string[i]);
+                isalpha((unsigned char)bw_string[i]);
                 i++, p++) {
             unit_string[p] = bw_string[i];
         }
@@ -2430,7 +2829,8 @@ static int parse_option(const char *curopt, struct vrmr_rule_options *op)
 
         /* split the value and the unit */
         for (p = 0, i = 0; p < sizeof(value_string) - 1 &&
-                           i < strlen(bw_string) && isdigit(bw_string[i]);
+                           i < strlen(bw_string) &&
+                           isdigit((unsigned char)bw_string[i]);
                 i++, p++) {
             value_string[p] = bw_string[i];
         }
@@ -2438,7 +2838,7 @@ static int parse_option(const char *curopt, struct vrmr_rule_options *op)
 
         for (p = 0, i = strlen(value_string);
                 p < sizeof(unit_string) - 1 && i < strlen(bw_string) &&
-                isalpha(bw_string[i]);
+                isalpha((unsigned char)bw_string[i]);
                 i++, p++) {
             unit_string[p] = bw_string[i];
         }
@@ -2491,6 +2891,10 @@ int vrmr_rules_read_options(const char *optstr, struct vrmr_rule_options *op)
     }
 
     while (x <= optstr_len) {
+        if (cur_pos == sizeof(curopt)) {
+            vrmr_error(-1, "Error", "option too long in rule");
+            return (-1);
+        }
         curopt[cur_pos] = optstr[x];
         cur_pos++;
 
@@ -2914,7 +3318,8 @@ int vrmr_rules_decode_rule(char *rulestr, size_t size)
 
     assert(rulestr);
 
-    for (i = 0, x = 0; i < strlen(rulestr) && x < size; i++) {
+    const size_t len = strlen(rulestr);
+    for (i = 0, x = 0; i < len && x < size && x < sizeof(line) - 1; i++) {
         if (rulestr[i] == '\\' && rulestr[i + 1] == '\"') {
             /* nothing */
         } else {
@@ -3010,6 +3415,8 @@ struct vrmr_rule *vrmr_rules_remove_rule_from_list(
                 "now we have to remove (query_ptr->number: %u, place: %u)",
                 rule_ptr->number, place);
 
+        rules_index_remove(rules, rule_ptr);
+
         if (vrmr_list_node_is_bot(d_node)) {
             vrmr_debug(HIGH, "removing last entry");
 
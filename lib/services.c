@@ -24,7 +24,7 @@
 static void vrmr_service_free(struct vrmr_service *service)
 {
     assert(service);
-    vrmr_list_cleanup(&service->PortrangeList);
+    vrmr_vector_cleanup(&service->PortrangeList);
     free(service);
 }
 
@@ -90,6 +90,13 @@ static int vrmr_insert_service_list(
         }
     }
 
+    /* and into the name index */
+    if (vrmr_name_index_insert(
+                &services->index, ser_ptr->name, (void *)ser_ptr) < 0) {
+        vrmr_error(-1, "Internal Error", "vrmr_name_index_insert() failed");
+        return (-1);
+    }
+
     return (0);
 }
 
@@ -148,25 +155,15 @@ int vrmr_insert_service(
 void *vrmr_search_service(
         const struct vrmr_services *services, const char *name)
 {
-    struct vrmr_list_node *d_node = NULL;
     struct vrmr_service *service_ptr = NULL;
 
     assert(services && name);
 
     vrmr_debug(MEDIUM, "looking for service '%s'.", name);
 
-    /* loop the list and compare */
-    for (d_node = services->list.top; d_node; d_node = d_node->next) {
-        if (!(service_ptr = d_node->data)) {
-            vrmr_error(-1, "Internal Error", "NULL pointer");
-            return (NULL);
-        }
-
-        if (strcmp(service_ptr->name, name) == 0) {
-            vrmr_debug(
-                    HIGH, "service %s found at address: %p", name, service_ptr);
-            return (service_ptr);
-        }
+    if ((service_ptr = vrmr_name_index_search(&services->index, name))) {
+        vrmr_debug(HIGH, "service %s found at address: %p", name, service_ptr);
+        return (service_ptr);
     }
 
     vrmr_debug(LOW, "service '%s' not found.", name);
@@ -212,7 +209,7 @@ int vrmr_read_service(
         return (-1);
     }
 
-    vrmr_list_setup(&service_ptr->PortrangeList, free);
+    vrmr_vector_setup(&service_ptr->PortrangeList, free);
 
     /* first check RANGE */
     while ((result = vctx->sf->ask(vctx->serv_backend, sername, "RANGE",
@@ -589,9 +586,10 @@ int vrmr_process_portrange(
                 if all went well, insert the portrange into the list, and update
                the counter now insert the entry into the list
             */
-            if (vrmr_list_append(&ser_ptr->PortrangeList, portrange_ptr) ==
-                    NULL) {
-                vrmr_error(-1, "Internal Error", "vrmr_list_append() failed");
+            if (vrmr_vector_append(&ser_ptr->PortrangeList, portrange_ptr) <
+                    0) {
+                vrmr_error(-1, "Internal Error", "vrmr_vector_append() failed");
+                free(portrange_ptr);
                 return (-1);
             }
 
@@ -626,11 +624,41 @@ void vrmr_destroy_serviceslist(struct vrmr_services *services)
             return;
         }
 
-        vrmr_list_cleanup(&ser_ptr->PortrangeList);
+        vrmr_vector_cleanup(&ser_ptr->PortrangeList);
     }
 
     /* then the list itself */
     vrmr_list_cleanup(&services->list);
+    vrmr_name_index_cleanup(&services->index);
+}
+
+/*  vrmr_services_set_name
+
+    Renames a service that is in the services list, keeping the name index
+    in sync.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_services_set_name(struct vrmr_services *services,
+        struct vrmr_service *ser_ptr, const char *name)
+{
+    assert(services && ser_ptr && name);
+
+    if (strlen(name) >= sizeof(ser_ptr->name)) {
+        vrmr_error(-1, "Internal Error", "string overflow");
+        return (-1);
+    }
+
+    (void)vrmr_name_index_remove(&services->index, ser_ptr->name, ser_ptr);
+    (void)strlcpy(ser_ptr->name, name, sizeof(ser_ptr->name));
+
+    if (vrmr_name_index_insert(&services->index, ser_ptr->name, ser_ptr) < 0) {
+        vrmr_error(-1, "Internal Error", "vrmr_name_index_insert() failed");
+        return (-1);
+    }
+    return (0);
 }
 
 /*  vrmr_new_service
@@ -658,7 +686,7 @@ int vrmr_new_service(struct vrmr_ctx *vctx, struct vrmr_services *services,
 
     /* set the bare minimum */
     strlcpy(ser_ptr->name, name, sizeof(ser_ptr->name));
-    vrmr_list_setup(&ser_ptr->PortrangeList, free);
+    vrmr_vector_setup(&ser_ptr->PortrangeList, free);
 
     /* insert into the list */
     if (vrmr_insert_service_list(services, ser_ptr) < 0) {
@@ -722,6 +750,9 @@ int vrmr_delete_service(struct vrmr_ctx *vctx, struct vrmr_services *services,
         }
 
         if (strcmp(name, ser_list_ptr->name) == 0) {
+            (void)vrmr_name_index_remove(
+                    &services->index, ser_list_ptr->name, ser_list_ptr);
+
             if (vrmr_list_remove_node(&services->list, d_node) < 0) {
                 vrmr_error(
                         -1, "Internal Error", "vrmr_list_remove_node() failed");
@@ -764,7 +795,6 @@ int vrmr_services_save_portranges(
 {
     struct vrmr_portdata *port_ptr = NULL;
     char prot_format[32] = "", frmt_src[16] = "", frmt_dst[16] = "";
-    struct vrmr_list_node *d_node = NULL;
     char overwrite = 1;
 
     assert(ser_ptr);
@@ -778,9 +808,8 @@ int vrmr_services_save_portranges(
         }
     } else {
         /* safe the ports */
-        for (d_node = ser_ptr->PortrangeList.top; d_node;
-                d_node = d_node->next) {
-            if (!(port_ptr = d_node->data)) {
+        for (unsigned int i = 0; i < ser_ptr->PortrangeList.len; i++) {
+            if (!(port_ptr = ser_ptr->PortrangeList.data[i])) {
                 vrmr_error(-1, "Internal Error", "NULL pointer");
                 return (-1);
             }
@@ -125,7 +125,8 @@ int ask_textdir(void *backend, const char *name, const char *question,
         line_pos = 0;
 
         while (val[line_pos] != '\0' && val[line_pos] != '\n' &&
-                line_pos < val_len && val_pos < max_answer) {
+                line_pos < val_len && val_pos < max_answer &&
+                val_pos < sizeof(value) - 1) {
             /* if the first character is a '"' we strip it. */
             if ((val_pos == 0) && (val[line_pos] == '\"'))
                 line_pos++;
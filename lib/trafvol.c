@@ -0,0 +1,387 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2019 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "config.h"
+#include "vuurmuur.h"
+
+/*
+    Traffic volume store.
+
+    The daemon samples the counters of the interface accounting rules (or the
+    link counters if those rules are missing) and adds the difference with
+    the previous sample to the current hour, day and month. Every interface
+    has its own file of fixed size:
+
+        header
+        VRMR_TRAFVOL_HOURS hour records
+        VRMR_TRAFVOL_DAYS day records
+        VRMR_TRAFVOL_MONTHS month records
+
+    Each period is a ring indexed by its bucket number modulo the number of
+    records. A record stores its bucket number, so stale records are simply
+    ignored by the readers and overwritten by the writer.
+
+    The buckets are in local time. When DST ends the repeated hour is added
+    to the same hour bucket, and when it starts one hour bucket stays empty.
+    The day and month totals are not affected.
+*/
+
+#if VRMR_TRAFVOL_DAYS < VRMR_TRAFVOL_HOURS || \
+        VRMR_TRAFVOL_DAYS < VRMR_TRAFVOL_MONTHS
+#error "vrmr_trafvol_get() expects the day ring to be the largest"
+#endif
+
+#define TRAFVOL_MAGIC "VRMRTV"
+#define TRAFVOL_VERSION 1
+
+/* where the counters of the last sample came from */
+#define TRAFVOL_SOURCE_NONE 0
+#define TRAFVOL_SOURCE_IPT 1
+#define TRAFVOL_SOURCE_LINK 2
+
+struct trafvol_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t source;
+    uint64_t last_in;
+    uint64_t last_out;
+    int64_t last_sample;
+};
+
+static bool trafvol_header_valid(const struct trafvol_header *hdr)
+{
+    return (memcmp(hdr->magic, TRAFVOL_MAGIC, sizeof(TRAFVOL_MAGIC)) == 0 &&
+            hdr->version == TRAFVOL_VERSION);
+}
+
+static const unsigned int trafvol_records[] = {
+        [VRMR_TRAFVOL_HOUR] = VRMR_TRAFVOL_HOURS,
+        [VRMR_TRAFVOL_DAY] = VRMR_TRAFVOL_DAYS,
+        [VRMR_TRAFVOL_MONTH] = VRMR_TRAFVOL_MONTHS,
+};
+
+static off_t trafvol_offset(enum vrmr_trafvol_period period, unsigned int idx)
+{
+    const off_t rec_size = sizeof(struct vrmr_trafvol_record);
+    off_t offset = sizeof(struct trafvol_header);
+
+    for (int p = 0; p < (int)period; p++)
+        offset += (off_t)trafvol_records[p] * rec_size;
+    return (offset + (off_t)idx * rec_size);
+}
+
+/* days since 1970-01-01 of a date in the proleptic Gregorian calendar */
+static int64_t trafvol_days_from_civil(
+        int64_t y, unsigned int m, unsigned int d)
+{
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned int yoe = (unsigned int)(y - era * 400);
+    const unsigned int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return (era * 146097 + (int64_t)doe - 719468);
+}
+
+/*  vrmr_trafvol_bucket
+
+    Returns the number of the hour, day or month 'tm' (local time) is in.
+*/
+int64_t vrmr_trafvol_bucket(
+        enum vrmr_trafvol_period period, const struct tm *tm)
+{
+    assert(tm);
+
+    const int64_t year = (int64_t)tm->tm_year + 1900;
+    const int64_t day =
+            trafvol_days_from_civil(year, tm->tm_mon + 1, tm->tm_mday);
+
+    switch (period) {
+        case VRMR_TRAFVOL_HOUR:
+            return (day * 24 + tm->tm_hour);
+        case VRMR_TRAFVOL_DAY:
+            return (day);
+        case VRMR_TRAFVOL_MONTH:
+            return (year * 12 + tm->tm_mon);
+    }
+    return (0);
+}
+
+static void trafvol_path(
+        const char *dir, const char *device, char *path, size_t size)
+{
+    snprintf(path, size, "%s/%s.vol", dir, device);
+}
+
+static int trafvol_mkdir(const char *dir)
+{
+    char parent[PATH_MAX];
+
+    if (mkdir(dir, 0700) == 0 || errno == EEXIST)
+        return (0);
+    if (errno != ENOENT)
+        goto error;
+
+    /* create the parent, e.g. /var/lib/vuurmuur */
+    strlcpy(parent, dir, sizeof(parent));
+    char *slash = strrchr(parent, '/');
+    if (slash == NULL || slash == parent)
+        goto error;
+    *slash = '\0';
+    if (mkdir(parent, 0755) < 0 && errno != EEXIST)
+        goto error;
+    if (mkdir(dir, 0700) == 0 || errno == EEXIST)
+        return (0);
+error:
+    vrmr_error(-1, "Error", "creating directory '%s' failed: %s", dir,
+            strerror(errno));
+    return (-1);
+}
+
+/* add 'in' and 'out' to the record for 'bucket' */
+static int trafvol_add(int fd, enum vrmr_trafvol_period period, int64_t bucket,
+        uint64_t in, uint64_t out)
+{
+    struct vrmr_trafvol_record rec;
+
+    if (bucket < 0)
+        return (0);
+
+    const unsigned int idx = (unsigned int)(bucket % trafvol_records[period]);
+    const off_t offset = trafvol_offset(period, idx);
+
+    if (pread(fd, &rec, sizeof(rec), offset) != (ssize_t)sizeof(rec))
+        return (-1);
+    if (rec.bucket != bucket) {
+        rec.bucket = bucket;
+        rec.in_bytes = rec.out_bytes = 0;
+    }
+    rec.in_bytes += in;
+    rec.out_bytes += out;
+
+    if (pwrite(fd, &rec, sizeof(rec), offset) != (ssize_t)sizeof(rec))
+        return (-1);
+    return (0);
+}
+
+/*  trafvol_store
+
+    Adds the traffic since the last sample of 'device' to the store.
+    Counters that went down were reset (e.g. the accounting chain was
+    recreated), so then all of 'in' and 'out' is new traffic. This
+    undercounts: the traffic between the last sample and the reset is not
+    known and is lost.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int trafvol_store(const char *dir, const char *device, uint32_t source,
+        uint64_t in, uint64_t out, time_t now)
+{
+    char path[PATH_MAX];
+    struct trafvol_header hdr;
+    struct tm tm;
+    int retval = 0;
+
+    trafvol_path(dir, device, path, sizeof(path));
+
+    int fd = open(path, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        vrmr_error(-1, "Error", "opening '%s' failed: %s", path,
+                strerror(errno));
+        return (-1);
+    }
+
+    ssize_t n = pread(fd, &hdr, sizeof(hdr), 0);
+    if (n != (ssize_t)sizeof(hdr) || !trafvol_header_valid(&hdr)) {
+        if (n != 0) {
+            vrmr_warning("Warning",
+                    "traffic volume store '%s' is damaged or of an unknown "
+                    "version, starting over.",
+                    path);
+        }
+
+        /* the records are zero, so they have bucket 0: no data */
+        if (ftruncate(fd, 0) < 0 ||
+                ftruncate(fd, trafvol_offset(VRMR_TRAFVOL_MONTH,
+                                      VRMR_TRAFVOL_MONTHS)) < 0) {
+            vrmr_error(-1, "Error", "resizing '%s' failed: %s", path,
+                    strerror(errno));
+            close(fd);
+            return (-1);
+        }
+        memset(&hdr, 0, sizeof(hdr));
+        strlcpy(hdr.magic, TRAFVOL_MAGIC, sizeof(hdr.magic));
+        hdr.version = TRAFVOL_VERSION;
+    }
+
+    /* the first sample from a source only sets the baseline */
+    if (hdr.source == source && localtime_r(&now, &tm) != NULL) {
+        uint64_t din = in >= hdr.last_in ? in - hdr.last_in : in;
+        uint64_t dout = out >= hdr.last_out ? out - hdr.last_out : out;
+
+        if (in < hdr.last_in || out < hdr.last_out)
+            vrmr_debug(LOW,
+                    "counters of '%s' were reset, traffic since the last "
+                    "sample (%" PRId64 ") is lost",
+                    device, hdr.last_sample);
+
+        if (din > 0 || dout > 0) {
+            for (int p = VRMR_TRAFVOL_HOUR; p <= VRMR_TRAFVOL_MONTH; p++) {
+                if (trafvol_add(fd, p, vrmr_trafvol_bucket(p, &tm), din,
+                            dout) < 0) {
+                    vrmr_error(-1, "Error", "updating '%s' failed: %s", path,
+                            strerror(errno));
+                    retval = -1;
+                    break;
+                }
+            }
+        }
+    }
+
+    hdr.source = source;
+    hdr.last_in = in;
+    hdr.last_out = out;
+    hdr.last_sample = (int64_t)now;
+    if (retval == 0 &&
+            pwrite(fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr)) {
+        vrmr_error(-1, "Error", "writing '%s' failed: %s", path,
+                strerror(errno));
+        retval = -1;
+    }
+
+    close(fd);
+    return (retval);
+}
+
+/*  vrmr_trafvol_update
+
+    Samples the counters of all non-virtual interfaces and adds the traffic
+    since the previous sample to their store in 'dir'. 'counters' is
+    updated first.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_trafvol_update(struct vrmr_config *cnf,
+        struct vrmr_interfaces *interfaces, struct vrmr_counters *counters,
+        const char *dir)
+{
+    int retval = 0;
+    time_t now = time(NULL);
+
+    assert(cnf && interfaces && counters && dir);
+
+    if (trafvol_mkdir(dir) < 0)
+        return (-1);
+    if (vrmr_counters_update_ipt(cnf, counters, true) < 0)
+        return (-1);
+    if (vrmr_counters_update_links(counters, true) < 0)
+        return (-1);
+
+    for (struct vrmr_list_node *d_node = interfaces->list.top; d_node;
+            d_node = d_node->next) {
+        struct vrmr_interface *iface_ptr = d_node->data;
+
+        if (iface_ptr->device_virtual == TRUE || iface_ptr->device[0] == '\0')
+            continue;
+
+        struct vrmr_counters_iface *c =
+                vrmr_counters_get(counters, iface_ptr->device);
+        if (c == NULL)
+            continue;
+
+        if (c->ipt_found) {
+            if (trafvol_store(dir, iface_ptr->device, TRAFVOL_SOURCE_IPT,
+                        c->ipt.acc_in_bytes, c->ipt.acc_out_bytes, now) < 0)
+                retval = -1;
+        } else if (c->link_found) {
+            if (trafvol_store(dir, iface_ptr->device, TRAFVOL_SOURCE_LINK,
+                        c->rx_bytes, c->tx_bytes, now) < 0)
+                retval = -1;
+        }
+    }
+    return (retval);
+}
+
+/*  vrmr_trafvol_get
+
+    Sums the traffic of 'device' over 'n' hours, days or months, starting
+    at bucket 'first'.
+
+    Returncodes:
+         1: ok
+         0: ok, but no data
+        -1: error
+*/
+int vrmr_trafvol_get(const char *dir, const char *device,
+        enum vrmr_trafvol_period period, int64_t first, unsigned int n,
+        uint64_t *in, uint64_t *out)
+{
+    char path[PATH_MAX];
+    struct trafvol_header hdr;
+    struct vrmr_trafvol_record recs[VRMR_TRAFVOL_DAYS];
+    const unsigned int size = trafvol_records[period];
+    int retval = 0;
+
+    assert(dir && device && in && out);
+
+    *in = *out = 0;
+    if (n > size)
+        n = size;
+
+    trafvol_path(dir, device, path, sizeof(path));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        if (errno == ENOENT)
+            return (0);
+        vrmr_error(-1, "Error", "opening '%s' failed: %s", path,
+                strerror(errno));
+        return (-1);
+    }
+
+    /* read the whole ring at once, it's only a few kb */
+    const size_t len = size * sizeof(struct vrmr_trafvol_record);
+    if (pread(fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr) ||
+            !trafvol_header_valid(&hdr)) {
+        close(fd);
+        return (0);
+    }
+    if (pread(fd, recs, len, trafvol_offset(period, 0)) != (ssize_t)len) {
+        vrmr_error(-1, "Error", "reading '%s' failed", path);
+        close(fd);
+        return (-1);
+    }
+    close(fd);
+
+    for (int64_t bucket = first; bucket < first + (int64_t)n; bucket++) {
+        if (bucket < 0)
+            continue;
+
+        const struct vrmr_trafvol_record *rec = &recs[bucket % size];
+        if (rec->bucket != bucket)
+            continue;
+        *in += rec->in_bytes;
+        *out += rec->out_bytes;
+        retval = 1;
+    }
+    return (retval);
+}
@@ -0,0 +1,240 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2019 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "config.h"
+#include "vuurmuur.h"
+
+/* number of slots allocated on the first append */
+#define VRMR_VECTOR_MIN_SIZE 8
+
+/*  vrmr_vector_setup
+
+    Sets up a struct vrmr_vector. Nothing is allocated until the first
+    element is added.
+*/
+void vrmr_vector_setup(struct vrmr_vector *vec, void (*remove)(void *data))
+{
+    assert(vec);
+
+    vec->len = 0;
+    vec->size = 0;
+    vec->data = NULL;
+    vec->remove = remove;
+}
+
+/*  vrmr_vector_reserve
+
+    Makes sure the vector can hold at least 'size' elements without
+    reallocating.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_vector_reserve(struct vrmr_vector *vec, unsigned int size)
+{
+    assert(vec);
+
+    if (size <= vec->size)
+        return (0);
+
+    unsigned int new_size = vec->size ? vec->size : VRMR_VECTOR_MIN_SIZE;
+    while (new_size < size) {
+        if (new_size > UINT_MAX / 2) {
+            new_size = size;
+            break;
+        }
+        new_size *= 2;
+    }
+
+    void **new_data = realloc(vec->data, new_size * sizeof(void *));
+    if (new_data == NULL) {
+        vrmr_error(-1, "Error", "realloc failed: %s", strerror(errno));
+        return (-1);
+    }
+
+    vec->data = new_data;
+    vec->size = new_size;
+    return (0);
+}
+
+/*  vrmr_vector_insert
+
+    Inserts 'data' at position 'pos', moving the elements at and after
+    'pos' one slot up. A 'pos' equal to the length appends.
+
+    The pointers stored in the vector are the stable handles: positions
+    change on insert and remove, the data they point to never moves.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_vector_insert(
+        struct vrmr_vector *vec, unsigned int pos, const void *data)
+{
+    assert(vec);
+
+    if (pos > vec->len) {
+        vrmr_error(-1, "Internal Error", "position %u out of range (len %u)",
+                pos, vec->len);
+        return (-1);
+    }
+
+    if (vrmr_vector_reserve(vec, vec->len + 1) < 0)
+        return (-1);
+
+    if (pos < vec->len) {
+        memmove(&vec->data[pos + 1], &vec->data[pos],
+                (vec->len - pos) * sizeof(void *));
+    }
+    vec->data[pos] = (void *)data;
+    vec->len++;
+    return (0);
+}
+
+/*  vrmr_vector_append
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_vector_append(struct vrmr_vector *vec, const void *data)
+{
+    assert(vec);
+
+    if (vec->len == vec->size) {
+        if (vrmr_vector_reserve(vec, vec->len + 1) < 0)
+            return (-1);
+    }
+
+    vec->data[vec->len++] = (void *)data;
+    return (0);
+}
+
+/*  vrmr_vector_prepend
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_vector_prepend(struct vrmr_vector *vec, const void *data)
+{
+    return (vrmr_vector_insert(vec, 0, data));
+}
+
+/*  vrmr_vector_remove
+
+    Removes the element at 'pos', calling the remove function on the data
+    if one was set up. Order of the remaining elements is kept.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_vector_remove(struct vrmr_vector *vec, unsigned int pos)
+{
+    assert(vec);
+
+    if (pos >= vec->len) {
+        vrmr_error(-1, "Internal Error", "position %u out of range (len %u)",
+                pos, vec->len);
+        return (-1);
+    }
+
+    void *data = vec->data[pos];
+
+    vec->len--;
+    if (pos < vec->len) {
+        memmove(&vec->data[pos], &vec->data[pos + 1],
+                (vec->len - pos) * sizeof(void *));
+    }
+
+    if (vec->remove != NULL)
+        vec->remove(data);
+
+    return (0);
+}
+
+/*  vrmr_vector_remove_unordered
+
+    Like vrmr_vector_remove, but moves the last element into the hole
+    instead of shifting. O(1), for containers where order does not matter.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_vector_remove_unordered(struct vrmr_vector *vec, unsigned int pos)
+{
+    assert(vec);
+
+    if (pos >= vec->len) {
+        vrmr_error(-1, "Internal Error", "position %u out of range (len %u)",
+                pos, vec->len);
+        return (-1);
+    }
+
+    void *data = vec->data[pos];
+
+    vec->len--;
+    vec->data[pos] = vec->data[vec->len];
+
+    if (vec->remove != NULL)
+        vec->remove(data);
+
+    return (0);
+}
+
+/*  vrmr_vector_find
+
+    Returns the position of 'data' (compared by pointer) or -1 if it is not
+    in the vector.
+*/
+int vrmr_vector_find(const struct vrmr_vector *vec, const void *data)
+{
+    assert(vec);
+
+    for (unsigned int i = 0; i < vec->len; i++) {
+        if (vec->data[i] == data)
+            return ((int)i);
+    }
+    return (-1);
+}
+
+/*  vrmr_vector_cleanup
+
+    Removes all elements, calling the remove function on each of them, and
+    frees the storage. The vector can be reused afterwards.
+*/
+void vrmr_vector_cleanup(struct vrmr_vector *vec)
+{
+    assert(vec);
+
+    if (vec->remove != NULL) {
+        for (unsigned int i = 0; i < vec->len; i++)
+            vec->remove(vec->data[i]);
+    }
+
+    free(vec->data);
+    vec->data = NULL;
+    vec->len = 0;
+    vec->size = 0;
+}
@@ -264,6 +264,13 @@ int vrmr_insert_zonedata_list(
         }
     }
 
+    /* and into the name index */
+    if (vrmr_name_index_insert(&zones->index, zone_ptr->name,
+                (void *)zone_ptr) < 0) {
+        vrmr_error(-1, "Internal Error", "vrmr_name_index_insert() failed");
+        return (-1);
+    }
+
     /* for debugging, print the entire list to the log */
     if (vrmr_debug_level >= HIGH) {
         for (d_node = zones->list.top; d_node; d_node = d_node->next) {
@@ -408,34 +415,54 @@ int vrmr_read_zonedata(struct vrmr_ctx *vctx, struct vrmr_zones *zones,
 
 /*  vrmr_search_zonedata
 
-    Function to search the ServicesList.
+    Function to search the zones by name, using the name index.
 
     It returns the pointer or a NULL-pointer if not found.
 */
 void *vrmr_search_zonedata(const struct vrmr_zones *zones, const char *name)
 {
-    struct vrmr_list_node *d_node = NULL;
     struct vrmr_zone *zonedata_ptr = NULL;
 
     assert(name && zones);
 
-    /* now search */
-    for (d_node = zones->list.top; d_node; d_node = d_node->next) {
-        if (!(zonedata_ptr = d_node->data)) {
-            vrmr_error(-1, "Internal Error", "NULL pointer");
-            return (NULL);
-        }
-
-        if (strcmp(zonedata_ptr->name, name) == 0) {
-            vrmr_debug(HIGH, "zone '%s' found.", name);
-            return (zonedata_ptr);
-        }
+    if ((zonedata_ptr = vrmr_name_index_search(&zones->index, name))) {
+        vrmr_debug(HIGH, "zone '%s' found.", name);
+        return (zonedata_ptr);
     }
 
     vrmr_debug(LOW, "zone '%s' not found.", name);
     return (NULL);
 }
 
+/*  vrmr_zones_set_name
+
+    Renames a zone that is in the zones list, keeping the name index in sync.
+    Only the full name is changed, the caller updates the name parts.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vrmr_zones_set_name(
+        struct vrmr_zones *zones, struct vrmr_zone *zone_ptr, const char *name)
+{
+    assert(zones && zone_ptr && name);
+
+    if (strlen(name) >= sizeof(zone_ptr->name)) {
+        vrmr_error(-1, "Internal Error", "string overflow");
+        return (-1);
+    }
+
+    (void)vrmr_name_index_remove(&zones->index, zone_ptr->name, zone_ptr);
+    (void)strlcpy(zone_ptr->name, name, sizeof(zone_ptr->name));
+
+    if (vrmr_name_index_insert(&zones->index, zone_ptr->name, zone_ptr) < 0) {
+        vrmr_error(-1, "Internal Error", "vrmr_name_index_insert() failed");
+        return (-1);
+    }
+    return (0);
+}
+
 /*- print_list - */
 void vrmr_zonedata_print_list(const struct vrmr_zones *zones)
 {
@@ -519,6 +546,7 @@ void vrmr_destroy_zonedatalist(struct vrmr_zones *zones)
     }
 
     vrmr_list_cleanup(&zones->list);
+    vrmr_name_index_cleanup(&zones->index);
 }
 
 int vrmr_delete_zone(struct vrmr_ctx *vctx, struct vrmr_zones *zones,
@@ -611,6 +639,8 @@ int vrmr_delete_zone(struct vrmr_ctx *vctx, struct vrmr_zones *zones,
                 vrmr_error(-1, "Internal Error", "NULL pointer");
                 return (-1);
             }
+            (void)vrmr_name_index_remove(
+                    &zones->index, zone_list_ptr->name, zone_list_ptr);
 
             /* remove from memory */
             vrmr_zone_free(zone_list_ptr);
@@ -1430,21 +1460,18 @@ int vrmr_zones_network_analyze_rule(struct vrmr_rule *rule_ptr,
 int vrmr_zones_network_rule_parse_line(
         const char *line, struct vrmr_rule *rule_ptr)
 {
-    size_t line_pos = 0, // position in line
-            var_pos = 0; // position in varible
+    size_t line_pos = 0; // position in line
     char against_keyw[32] = "";
     char action_str[32] = "";
+    char from_keyw[16] = "";
 
     assert(line && rule_ptr);
     assert(strlen(line) <= VRMR_MAX_RULE_LENGTH);
 
     /* get the action */
-    for (; line_pos < sizeof(action_str) - 1 && line[line_pos] != ' ' &&
-            line[line_pos] != '\0' && line[line_pos] != '\n';
-            line_pos++, var_pos++) {
-        action_str[var_pos] = line[line_pos];
-    }
-    action_str[var_pos] = '\0';
+    if (vrmr_rules_get_word(line, &line_pos, action_str, sizeof(action_str)) <
+            0)
+        return (-1);
 
     rule_ptr->action = vrmr_rules_actiontoi(action_str);
     if (rule_ptr->action <= VRMR_AT_ERROR ||
@@ -1454,13 +1481,9 @@ int vrmr_zones_network_rule_parse_line(
     /* now we analyze the action */
     if (rule_ptr->action == VRMR_AT_PROTECT) {
         /* get the 'against' */
-        for (line_pos++, var_pos = 0;
-                var_pos < sizeof(against_keyw) - 1 && line[line_pos] != ' ' &&
-                line[line_pos] != '\0' && line[line_pos] != '\n';
-                line_pos++, var_pos++) {
-            against_keyw[var_pos] = line[line_pos];
-        }
-        against_keyw[var_pos] = '\0';
+        if (vrmr_rules_get_word(line, &line_pos, against_keyw,
+                    sizeof(against_keyw)) < 0)
+            return (-1);
 
         /* check for the against keyword */
         if (strcasecmp(against_keyw, "against") != 0) {
@@ -1470,14 +1493,9 @@ int vrmr_zones_network_rule_parse_line(
         }
 
         /* okay, now lets see what kind of danger we are talking about */
-        for (line_pos++, var_pos = 0;
-                var_pos < sizeof(rule_ptr->danger) - 1 &&
-                line[line_pos] != ' ' && line[line_pos] != '\0' &&
-                line[line_pos] != '\n';
-                line_pos++, var_pos++) {
-            rule_ptr->danger[var_pos] = line[line_pos];
-        }
-        rule_ptr->danger[var_pos] = '\0';
+        if (vrmr_rules_get_word(line, &line_pos, rule_ptr->danger,
+                    sizeof(rule_ptr->danger)) < 0)
+            return (-1);
 
         vrmr_debug(HIGH, "protect: danger: '%s'", rule_ptr->danger);
 
@@ -1489,33 +1507,24 @@ int vrmr_zones_network_rule_parse_line(
         }
 
         /* get the 'from' */
-        for (line_pos++, var_pos = 0;
-                var_pos < strlen("from") && line[line_pos] != ' ' &&
-                line[line_pos] != '\0' && line[line_pos] != '\n';
-                line_pos++, var_pos++) {
-            rule_ptr->source[var_pos] = line[line_pos];
-        }
-        rule_ptr->source[var_pos] = '\0';
+        if (vrmr_rules_get_word(
+                    line, &line_pos, from_keyw, sizeof(from_keyw)) < 0)
+            return (-1);
 
-        vrmr_debug(HIGH, "protect: keyword from: '%s'", rule_ptr->source);
+        vrmr_debug(HIGH, "protect: keyword from: '%s'", from_keyw);
 
         /* if 'from' is missing, the rule is malformed, so we bail out screaming
          * & kicking */
-        if (strcasecmp(rule_ptr->source, "from") != 0) {
+        if (strcasecmp(from_keyw, "from") != 0) {
             vrmr_error(-1, "Error",
                     "bad rule syntax, keyword 'from' is missing: %s", line);
             return (-1);
         }
 
         /* get the source */
-        for (line_pos++, var_pos = 0;
-                var_pos < sizeof(rule_ptr->source) - 1 &&
-                line[line_pos] != ' ' && line[line_pos] != '\0' &&
-                line[line_pos] != '\n';
-                line_pos++, var_pos++) {
-            rule_ptr->source[var_pos] = line[line_pos];
-        }
-        rule_ptr->source[var_pos] = '\0';
+        if (vrmr_rules_get_word(line, &line_pos, rule_ptr->source,
+                    sizeof(rule_ptr->source)) < 0)
+            return (-1);
 
         vrmr_debug(HIGH, "protect: source: '%s'", rule_ptr->source);
 
@@ -1527,14 +1536,11 @@ int vrmr_zones_network_rule_parse_line(
         vrmr_debug(
                 MEDIUM, "action: '%s'", vrmr_rules_itoaction(rule_ptr->action));
 
-        for (line_pos++, var_pos = 0;
-                var_pos < sizeof(rule_ptr->service) - 1 &&
-                line[line_pos] != ' ' && line[line_pos] != ',' &&
-                line[line_pos] != '\0' && line[line_pos] != '\n';
-                line_pos++, var_pos++) {
-            rule_ptr->service[var_pos] = line[line_pos];
-        }
-        rule_ptr->service[var_pos] = '\0';
+        if (vrmr_rules_get_word(line, &line_pos, rule_ptr->service,
+                    sizeof(rule_ptr->service)) < 0)
+            return (-1);
+        /* the options would follow the comma */
+        rule_ptr->service[strcspn(rule_ptr->service, ",")] = '\0';
 
         vrmr_debug(MEDIUM, "service: '%s'", rule_ptr->service);
 
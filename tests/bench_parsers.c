@@ -0,0 +1,295 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2019 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+    Benchmark of the parsers
+
+    Runs each parser over its benchmark corpus, tests/bench/<parser>, a
+    number of rounds and prints the time per input. The corpus holds what
+    the backend typically contains: rules.conf lines, the options of those
+    rules, network and interface rules and complete textdir files. The
+    line parsers take every line of their files as an input, the textdir
+    reader a whole file.
+
+    With -b the times are compared with a baseline file, tests/bench/
+    baseline, and the benchmark fails if a parser is more than -t times
+    (default 3) slower. The time of a parser is the best of a few batches,
+    so a busy machine doesn't fail it that easily.
+
+        bench_parsers [-n <rounds>] [-b <baseline>] [-t <tolerance>]
+                [<corpus directory>]
+*/
+
+#include "tests.h"
+
+#include <time.h>
+
+/* number of batches the rounds are split in, the fastest one counts */
+#define BENCH_BATCHES 5
+
+struct bench_input {
+    char **items;
+    size_t len;
+};
+
+static int bench_append(struct bench_input *in, char *item)
+{
+    char **items = realloc(in->items, (in->len + 1) * sizeof(*items));
+
+    if (items == NULL) {
+        free(item);
+        return (-1);
+    }
+    in->items = items;
+    in->items[in->len++] = item;
+    return (0);
+}
+
+/* every non-empty line is an input */
+static int bench_load_lines(const char *path ATTR_UNUSED, const uint8_t *data,
+        size_t size, void *ctx)
+{
+    const uint8_t *end = data + size;
+
+    while (data < end) {
+        const uint8_t *nl = memchr(data, '\n', (size_t)(end - data));
+        size_t len = (size_t)((nl ? nl : end) - data);
+
+        /* the backend doesn't return longer lines */
+        if (len > 0) {
+            char *line = tests_string(data, len, VRMR_MAX_RULE_LENGTH);
+            if (line == NULL || bench_append(ctx, line) < 0)
+                return (-1);
+        }
+        if (nl == NULL)
+            break;
+        data = nl + 1;
+    }
+    return (0);
+}
+
+/* the whole file is an input: it's stored in the textdir backend, the
+ * input is its name */
+static int bench_load_textdir(const char *path ATTR_UNUSED,
+        const uint8_t *data, size_t size, void *ctx)
+{
+    struct bench_input *in = ctx;
+    char name[32];
+
+    snprintf(name, sizeof(name), "bench%zu", in->len);
+    if (tests_textdir_write(name, data, size) < 0)
+        return (-1);
+    return (bench_append(in, strdup(name)));
+}
+
+static int bench_rules_parse_line(const char *str)
+{
+    static struct vrmr_regex reg;
+    static bool ready = false;
+    char line[VRMR_MAX_RULE_LENGTH + 1];
+    struct vrmr_rule rule;
+
+    if (!ready) {
+        if (vrmr_regex_setup(1, &reg) < 0)
+            return (-1);
+        ready = true;
+    }
+
+    (void)strlcpy(line, str, sizeof(line));
+    memset(&rule, 0, sizeof(rule));
+    int r = vrmr_rules_parse_line(line, &rule, &reg);
+    vrmr_rules_free_options(rule.opt);
+    return (r);
+}
+
+static int bench_rules_read_options(const char *str)
+{
+    struct vrmr_rule_options *opt = vrmr_rule_option_malloc();
+
+    if (opt == NULL)
+        return (-1);
+    int r = vrmr_rules_read_options(str, opt);
+    vrmr_rules_free_options(opt);
+    return (r);
+}
+
+static int bench_zones_rule(const char *str)
+{
+    struct vrmr_rule rule;
+
+    memset(&rule, 0, sizeof(rule));
+    return (vrmr_zones_network_rule_parse_line(str, &rule));
+}
+
+static int bench_interfaces_rule(const char *str)
+{
+    struct vrmr_rule rule;
+
+    memset(&rule, 0, sizeof(rule));
+    return (vrmr_interfaces_rule_parse_line(str, &rule));
+}
+
+static int bench_textdir_ask(const char *name)
+{
+    return (tests_textdir_read(name) < 0 ? -1 : 0);
+}
+
+static const struct {
+    const char *name; /* also the directory of the corpus */
+    int (*setup)(void);
+    int (*load)(const char *path, const uint8_t *data, size_t size,
+            void *ctx);
+    int (*parse)(const char *input);
+} parsers[] = {
+        {"rules_parse_line", NULL, bench_load_lines, bench_rules_parse_line},
+        {"rules_read_options", NULL, bench_load_lines,
+                bench_rules_read_options},
+        {"zones_rule", NULL, bench_load_lines, bench_zones_rule},
+        {"interfaces_rule", NULL, bench_load_lines, bench_interfaces_rule},
+        {"textdir_ask", tests_textdir_open, bench_load_textdir,
+                bench_textdir_ask},
+};
+#define BENCH_PARSERS (sizeof(parsers) / sizeof(parsers[0]))
+
+static uint64_t bench_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);
+}
+
+/*  bench_read_baseline
+
+    Reads the 'parser ns/input' lines of the baseline file into 'ns',
+    indexed like 'parsers'. Parsers that aren't in the file get 0.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int bench_read_baseline(const char *path, double ns[BENCH_PARSERS])
+{
+    char line[128], name[64];
+    double value = 0.0;
+    FILE *fp = NULL;
+
+    if (!(fp = fopen(path, "r"))) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return (-1);
+    }
+    while (fgets(line, (int)sizeof(line), fp) != NULL) {
+        if (line[0] == '#' || sscanf(line, "%63s %lf", name, &value) != 2)
+            continue;
+        for (size_t p = 0; p < BENCH_PARSERS; p++) {
+            if (strcmp(parsers[p].name, name) == 0)
+                ns[p] = value;
+        }
+    }
+    fclose(fp);
+    return (0);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *corpus = "bench", *baseline = NULL;
+    double base_ns[BENCH_PARSERS] = {0.0}, tolerance = 3.0;
+    unsigned long rounds = 10000;
+    int opt = 0, retval = EXIT_SUCCESS;
+
+    while ((opt = getopt(argc, argv, "n:b:t:")) != -1) {
+        if (opt == 'n') {
+            rounds = strtoul(optarg, NULL, 10);
+        } else if (opt == 'b') {
+            baseline = optarg;
+        } else if (opt == 't') {
+            tolerance = strtod(optarg, NULL);
+        } else {
+            fprintf(stderr,
+                    "usage: %s [-n <rounds>] [-b <baseline>] "
+                    "[-t <tolerance>] [<corpus directory>]\n",
+                    argv[0]);
+            return (EXIT_FAILURE);
+        }
+    }
+    if (optind < argc)
+        corpus = argv[optind];
+    if (baseline != NULL && bench_read_baseline(baseline, base_ns) < 0)
+        return (EXIT_FAILURE);
+
+    tests_quiet();
+
+    for (size_t p = 0; p < BENCH_PARSERS; p++) {
+        struct bench_input in = {NULL, 0};
+        char path[PATH_MAX];
+        unsigned long ok = 0;
+        uint64_t best = UINT64_MAX;
+
+        if (parsers[p].setup != NULL && parsers[p].setup() < 0) {
+            printf("%-20s skipped, setup failed (not root?)\n",
+                    parsers[p].name);
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "%s/%s", corpus, parsers[p].name);
+        if (tests_read_corpus(path, parsers[p].load, &in) < 0 ||
+                in.len == 0) {
+            fprintf(stderr, "%s: no inputs in '%s'\n", parsers[p].name, path);
+            retval = EXIT_FAILURE;
+            goto next;
+        }
+
+        const unsigned long batch = rounds / BENCH_BATCHES + 1;
+        for (int b = 0; b < BENCH_BATCHES; b++) {
+            uint64_t start = bench_ns();
+            for (unsigned long r = 0; r < batch; r++) {
+                for (size_t i = 0; i < in.len; i++) {
+                    if (parsers[p].parse(in.items[i]) == 0)
+                        ok++;
+                }
+            }
+            uint64_t ns = bench_ns() - start;
+            if (ns < best)
+                best = ns;
+        }
+
+        const unsigned long inputs = batch * (unsigned long)in.len;
+        const double ns_input = (double)best / (double)inputs;
+        printf("%-20s %6zu inputs %8.1f ns/input %5.1f%% ok", parsers[p].name,
+                in.len, ns_input,
+                100.0 * (double)ok / (double)(inputs * BENCH_BATCHES));
+
+        if (base_ns[p] > 0.0) {
+            printf("  baseline %8.1f", base_ns[p]);
+            if (ns_input > base_ns[p] * tolerance) {
+                printf("  SLOWER than %.1fx the baseline", tolerance);
+                retval = EXIT_FAILURE;
+            }
+        }
+        printf("\n");
+    next:
+        for (size_t i = 0; i < in.len; i++)
+            free(in.items[i]);
+        free(in.items);
+    }
+
+    vrmr_rules_options_cache_cleanup();
+    return (retval);
+}
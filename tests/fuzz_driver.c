@@ -0,0 +1,65 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2019 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+    Standalone driver for the fuzz targets
+
+    Replays inputs through LLVMFuzzerTestOneInput() without libFuzzer, so
+    the checked-in corpus runs with 'make check' and crashes found by a
+    fuzzer can be reproduced under a debugger or valgrind. Arguments are
+    files or directories of files. Options starting with '-', like the
+    '-runs=0' libFuzzer needs to only replay, are ignored so both take the
+    same command line.
+
+    With AFL build the target with afl-clang-fast and run it as
+    'fuzz_<target> @@'.
+*/
+
+#include "tests.h"
+
+static int replay(const char *path, const uint8_t *data, size_t size,
+        void *ctx ATTR_UNUSED)
+{
+    (void)LLVMFuzzerTestOneInput(data, size);
+    return (0);
+}
+
+int main(int argc, char *argv[])
+{
+    int total = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-')
+            continue;
+
+        int n = tests_read_corpus(argv[i], replay, NULL);
+        if (n < 0)
+            return (EXIT_FAILURE);
+        total += n;
+    }
+    if (total == 0) {
+        fprintf(stderr, "usage: %s [-runs=0] <file or directory>...\n",
+                argv[0]);
+        return (EXIT_FAILURE);
+    }
+
+    printf("%s: %d inputs replayed.\n", argv[0], total);
+    return (EXIT_SUCCESS);
+}
@@ -0,0 +1,52 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2019 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+    Fuzz target for vrmr_rules_parse_line(), the parser of the lines in the
+    rules file. See fuzz_driver.c for running it without libFuzzer.
+*/
+
+#include "tests.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static struct vrmr_regex reg;
+    static bool ready = false;
+    struct vrmr_rule rule;
+    char *line = NULL;
+
+    if (!ready) {
+        tests_quiet();
+        if (vrmr_regex_setup(1, &reg) < 0)
+            abort();
+        ready = true;
+    }
+
+    /* the backend doesn't return longer lines */
+    if (!(line = tests_string(data, size, VRMR_MAX_RULE_LENGTH)))
+        return (0);
+
+    memset(&rule, 0, sizeof(rule));
+    (void)vrmr_rules_parse_line(line, &rule, &reg);
+    vrmr_rules_free_options(rule.opt);
+
+    free(line);
+    return (0);
+}
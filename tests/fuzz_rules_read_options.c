@@ -0,0 +1,50 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2019 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+    Fuzz target for vrmr_rules_read_options(), the parser of the options
+    of a rule. See fuzz_driver.c for running it without libFuzzer.
+*/
+
+#include "tests.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static bool ready = false;
+    struct vrmr_rule_options *opt = NULL;
+    char *options = NULL;
+
+    if (!ready) {
+        tests_quiet();
+        ready = true;
+    }
+
+    /* vrmr_rules_parse_line() doesn't pass on longer options */
+    if (!(options = tests_string(data, size, VRMR_MAX_OPTIONS_LENGTH - 1)))
+        return (0);
+
+    if ((opt = vrmr_rule_option_malloc()) != NULL) {
+        (void)vrmr_rules_read_options(options, opt);
+        vrmr_rules_free_options(opt);
+    }
+
+    free(options);
+    return (0);
+}
@@ -0,0 +1,55 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2019 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+    Fuzz target for ask_textdir(), the reader of the KEY="value" files of
+    the textdir backend. The input is written as a rules file, which is
+    then read like the rules are: all RULE lines, then single variables.
+    The backend only opens files owned by root, so run this as root. See
+    fuzz_driver.c for running it without libFuzzer.
+*/
+
+#include "tests.h"
+
+/* larger inputs only make the runs slower */
+#define FUZZ_TEXTDIR_MAX_INPUT (64 * 1024)
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static int ready = 0;
+
+    if (ready == 0) {
+        tests_quiet();
+        ready = tests_textdir_open() == 0 ? 1 : -1;
+        if (ready < 0)
+            fprintf(stderr, "setting up a textdir backend failed, "
+                            "running as root?\n");
+    }
+    if (ready < 0)
+        return (0);
+
+    if (size > FUZZ_TEXTDIR_MAX_INPUT)
+        size = FUZZ_TEXTDIR_MAX_INPUT;
+    if (tests_textdir_write("fuzz", data, size) < 0)
+        return (0);
+
+    (void)tests_textdir_read("fuzz");
+    return (0);
+}
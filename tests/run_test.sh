@@ -0,0 +1,31 @@
+#!/bin/sh
+# Runs one of the check_PROGRAMS for 'make check'. The fuzz targets replay
+# their corpus, tests/corpus/<target without fuzz_>. '-runs=0' makes a
+# libFuzzer build replay the corpus instead of fuzzing, the standalone
+# driver ignores it. The benchmark fails when a parser is more than 3 times
+# slower than tests/bench/baseline.
+
+prog="$1"
+shift
+name=$(basename "$prog")
+
+case "$name" in
+    fuzz_textdir_ask)
+        # the textdir backend only opens files owned by root
+        if [ "$(id -u)" != "0" ]; then
+            echo "skipped: needs to run as root"
+            exit 77
+        fi
+        exec "$prog" -runs=0 "$srcdir/corpus/${name#fuzz_}" "$@"
+        ;;
+    fuzz_*)
+        exec "$prog" -runs=0 "$srcdir/corpus/${name#fuzz_}" "$@"
+        ;;
+    bench_*)
+        exec "$prog" -n 1000 -b "$srcdir/bench/baseline" -t 3 \
+                "$srcdir/bench" "$@"
+        ;;
+    *)
+        exec "$prog" "$@"
+        ;;
+esac
@@ -0,0 +1,328 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2019 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+    Tests for the parsers of the rules, the rule options and the rules of
+    networks and interfaces: lines that must parse and lines that must be
+    refused, like words that don't fit their field and options without a
+    value. Also the reader of the textdir files, when run as root.
+*/
+
+#include "tests.h"
+
+static int failed = 0;
+
+#define CHECK(expr)                                                            \
+    do {                                                                       \
+        if (!(expr)) {                                                         \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,  \
+                    #expr);                                                    \
+            failed++;                                                          \
+        }                                                                      \
+    } while (0)
+
+static struct vrmr_regex reg;
+
+/* a copy of 'str' with 'len' times 'c' appended */
+static char *long_line(const char *str, char c, size_t len)
+{
+    size_t n = strlen(str);
+    char *line = malloc(n + len + 1);
+
+    if (line == NULL)
+        abort();
+    memcpy(line, str, n);
+    memset(line + n, c, len);
+    line[n + len] = '\0';
+    return (line);
+}
+
+static int parse_rule(const char *str, struct vrmr_rule *rule)
+{
+    char line[VRMR_MAX_RULE_LENGTH * 2];
+
+    (void)strlcpy(line, str, sizeof(line));
+    memset(rule, 0, sizeof(*rule));
+    return (vrmr_rules_parse_line(line, rule, &reg));
+}
+
+static int parse_rule_free(const char *str)
+{
+    struct vrmr_rule rule;
+    int r = parse_rule(str, &rule);
+
+    vrmr_rules_free_options(rule.opt);
+    return (r);
+}
+
+static int read_options(const char *str)
+{
+    struct vrmr_rule_options *opt = vrmr_rule_option_malloc();
+
+    if (opt == NULL)
+        abort();
+    int r = vrmr_rules_read_options(str, opt);
+    vrmr_rules_free_options(opt);
+    return (r);
+}
+
+static int zones_rule(const char *str)
+{
+    struct vrmr_rule rule;
+
+    memset(&rule, 0, sizeof(rule));
+    return (vrmr_zones_network_rule_parse_line(str, &rule));
+}
+
+static int interfaces_rule(const char *str)
+{
+    struct vrmr_rule rule;
+
+    memset(&rule, 0, sizeof(rule));
+    return (vrmr_interfaces_rule_parse_line(str, &rule));
+}
+
+static void test_get_word(void)
+{
+    char word[8];
+    size_t pos = 0;
+
+    CHECK(vrmr_rules_get_word("accept service", &pos, word, sizeof(word)) ==
+            0);
+    CHECK(strcmp(word, "accept") == 0 && pos == 7);
+    CHECK(vrmr_rules_get_word("accept service", &pos, word, sizeof(word)) ==
+            0);
+    CHECK(strcmp(word, "service") == 0 && pos == 14);
+
+    /* at the end of the line the position stays put */
+    CHECK(vrmr_rules_get_word("accept service", &pos, word, sizeof(word)) ==
+            0);
+    CHECK(word[0] == '\0' && pos == 14);
+
+    /* a newline ends the line */
+    pos = 0;
+    CHECK(vrmr_rules_get_word("accept\n", &pos, word, sizeof(word)) == 0);
+    CHECK(strcmp(word, "accept") == 0 && pos == 6);
+
+    /* a word that just fits, and one that doesn't */
+    pos = 0;
+    CHECK(vrmr_rules_get_word("1234567 x", &pos, word, sizeof(word)) == 0);
+    pos = 0;
+    CHECK(vrmr_rules_get_word("12345678 x", &pos, word, sizeof(word)) < 0);
+}
+
+static void test_rules_parse_line(void)
+{
+    struct vrmr_rule rule;
+    char *line = NULL;
+
+    CHECK(parse_rule("accept service http from lan.zone to firewall",
+                  &rule) == 0);
+    CHECK(rule.action == VRMR_AT_ACCEPT && rule.active == TRUE);
+    CHECK(strcmp(rule.service, "http") == 0);
+    CHECK(strcmp(rule.from, "lan.zone") == 0);
+    CHECK(strcmp(rule.to, "firewall") == 0);
+    CHECK(rule.opt == NULL);
+
+    CHECK(parse_rule(";drop service any from a.b.c to firewall\n", &rule) ==
+            0);
+    CHECK(rule.action == VRMR_AT_DROP && rule.active == FALSE);
+
+    CHECK(parse_rule("accept service http from lan.zone to firewall "
+                     "options log,loglimit=\"3\",comment=\"web\"",
+                  &rule) == 0);
+    CHECK(rule.opt != NULL && rule.opt->rule_log == TRUE &&
+            rule.opt->loglimit == 3 && strcmp(rule.opt->comment, "web") == 0);
+    vrmr_rules_free_options(rule.opt);
+
+    CHECK(parse_rule_free("portfw service http from world.inet to "
+                          "web.dmz.zone options listenport=\"8080\","
+                          "remoteport=\"80\"") == 0);
+    CHECK(parse_rule_free("separator") == 0);
+
+    /* truncated lines */
+    CHECK(parse_rule_free("") < 0);
+    CHECK(parse_rule_free("\n") < 0);
+    CHECK(parse_rule_free("accept") < 0);
+    CHECK(parse_rule_free("accept service") < 0);
+    CHECK(parse_rule_free("accept service http from") < 0);
+    CHECK(parse_rule_free("accept service http from lan.zone to") < 0);
+
+    /* wrong keywords */
+    CHECK(parse_rule_free("accept srvice http from a.b.c to firewall") < 0);
+    CHECK(parse_rule_free("accept service http form a.b.c to firewall") < 0);
+    CHECK(parse_rule_free("accept service http from a.b.c too firewall") < 0);
+    CHECK(parse_rule_free("acept service http from a.b.c to firewall") < 0);
+
+    /* words that don't fit their field */
+    line = long_line("accept service ", 's', VRMR_MAX_SERVICE);
+    CHECK(parse_rule_free(line) < 0);
+    free(line);
+    line = long_line("accept service http from ", 'z',
+            VRMR_MAX_HOST_NET_ZONE);
+    CHECK(parse_rule_free(line) < 0);
+    free(line);
+    line = long_line(
+            "accept service http from a.b.c to ", 'z', VRMR_MAX_HOST_NET_ZONE);
+    CHECK(parse_rule_free(line) < 0);
+    free(line);
+    line = long_line("accept", 'x', 64);
+    CHECK(parse_rule_free(line) < 0);
+    free(line);
+
+    /* options that don't fit */
+    line = long_line("accept service http from a.b.c to firewall options "
+                     "comment=\"",
+            'c', VRMR_MAX_OPTIONS_LENGTH);
+    CHECK(parse_rule_free(line) < 0);
+    free(line);
+}
+
+static void test_rules_read_options(void)
+{
+    char *str = NULL;
+
+    CHECK(read_options("") == 0);
+    CHECK(read_options("log") == 0);
+    CHECK(read_options("log,loglimit=\"5\",logburst=\"10\"") == 0);
+    CHECK(read_options("comment=\"a, b\"") == 0);
+    CHECK(read_options("remoteport=\"80\",listenport=\"8080\"") == 0);
+
+    /* options that need a value */
+    CHECK(read_options("remoteport") < 0);
+    CHECK(read_options("listenport") < 0);
+    CHECK(read_options("log,remoteport") < 0);
+
+    /* an option longer than the parser's buffer */
+    str = long_line("comment=\"", 'c', 1024);
+    CHECK(read_options(str) < 0);
+    free(str);
+
+    /* non-ascii bytes */
+    CHECK(read_options("in_max=\"\xff\xfe\"") <= 0);
+}
+
+static void test_zones_rule(void)
+{
+    char *line = NULL;
+
+    CHECK(zones_rule("protect against spoofing from 10.0.0.0/8") == 0);
+    CHECK(zones_rule("accept dhcp-client") == 0);
+    CHECK(zones_rule("accept dhcp-client,dhcp-server") == 0);
+
+    CHECK(zones_rule("") < 0);
+    CHECK(zones_rule("protect") < 0);
+    CHECK(zones_rule("protect against") < 0);
+    CHECK(zones_rule("protect spoofing") < 0);
+    CHECK(zones_rule("protect against spoofing") < 0);
+    CHECK(zones_rule("protect against spoofing to 10.0.0.0/8") < 0);
+
+    line = long_line("protect against ", 'd', 64);
+    CHECK(zones_rule(line) < 0);
+    free(line);
+    line = long_line("protect against spoofing from ", '1',
+            VRMR_MAX_RULE_LENGTH - 40);
+    CHECK(zones_rule(line) < 0);
+    free(line);
+}
+
+static void test_interfaces_rule(void)
+{
+    char *line = NULL;
+
+    CHECK(interfaces_rule("protect against source-routed-packets") == 0);
+
+    CHECK(interfaces_rule("") < 0);
+    CHECK(interfaces_rule("protect") < 0);
+    CHECK(interfaces_rule("protect spoofing") < 0);
+    CHECK(interfaces_rule("accept against spoofing") < 0);
+
+    line = long_line("protect against ", 'd', 64);
+    CHECK(interfaces_rule(line) < 0);
+    free(line);
+}
+
+static void test_textdir_ask(void)
+{
+    static const char rules[] =
+            "# comment\n"
+            "RULE=\"accept service ssh from lan.zone to firewall\"\n"
+            "ACTIVE=\"Yes\"\n"
+            "RULE=\"drop service any from any to any\"\n"
+            "COMMENT=\"a comment that is longer than the small buffer\"\n"
+            "NOQUOTES=plain\n"
+            "EMPTY=\"\"\n";
+    char answer[VRMR_MAX_RULE_LENGTH], small[4];
+
+    if (tests_textdir_open() < 0) {
+        fprintf(stderr, "textdir tests skipped, they need root.\n");
+        return;
+    }
+    CHECK(tests_textdir_write("test", (const uint8_t *)rules,
+                  sizeof(rules) - 1) == 0);
+
+    /* the RULE lines in order, then the end */
+    CHECK(tests_textdir_ask("test", "RULE", answer, sizeof(answer), 1) == 1);
+    CHECK(strcmp(answer, "accept service ssh from lan.zone to firewall") ==
+            0);
+    CHECK(tests_textdir_ask("test", "RULE", answer, sizeof(answer), 1) == 1);
+    CHECK(strcmp(answer, "drop service any from any to any") == 0);
+    CHECK(tests_textdir_ask("test", "RULE", answer, sizeof(answer), 1) == 0);
+
+    CHECK(tests_textdir_ask("test", "active", answer, sizeof(answer), 0) ==
+            1);
+    CHECK(strcmp(answer, "Yes") == 0);
+    CHECK(tests_textdir_ask("test", "NOQUOTES", answer, sizeof(answer), 0) ==
+            1);
+    CHECK(strcmp(answer, "plain") == 0);
+    CHECK(tests_textdir_ask("test", "EMPTY", answer, sizeof(answer), 0) == 0);
+    CHECK(tests_textdir_ask("test", "MISSING", answer, sizeof(answer), 0) ==
+            0);
+
+    /* a value that doesn't fit the answer is an error */
+    CHECK(tests_textdir_ask("test", "ACTIVE", small, sizeof(small), 0) == 1);
+    CHECK(tests_textdir_ask("test", "COMMENT", small, sizeof(small), 0) < 0);
+
+    CHECK(tests_textdir_ask("missing", "RULE", answer, sizeof(answer), 0) <
+            0);
+}
+
+int main(void)
+{
+    tests_quiet();
+    if (vrmr_regex_setup(1, &reg) < 0)
+        return (EXIT_FAILURE);
+
+    test_get_word();
+    test_rules_parse_line();
+    test_rules_read_options();
+    test_zones_rule();
+    test_interfaces_rule();
+    test_textdir_ask();
+
+    (void)vrmr_regex_setup(0, &reg);
+    vrmr_rules_options_cache_cleanup();
+
+    if (failed > 0) {
+        fprintf(stderr, "%d checks failed.\n", failed);
+        return (EXIT_FAILURE);
+    }
+    return (EXIT_SUCCESS);
+}
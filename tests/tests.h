@@ -0,0 +1,49 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2019 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef __TESTS_H__
+#define __TESTS_H__
+
+#include "config.h"
+#include "vuurmuur.h"
+
+/*
+    Shared by the parser tests, the fuzz targets, their standalone driver
+    and the benchmark.
+*/
+
+/* the entry point of a fuzz target, for libFuzzer, AFL or fuzz_driver.c */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+void tests_quiet(void);
+char *tests_string(const uint8_t *data, size_t size, size_t max);
+int tests_read_file(const char *path, uint8_t **data, size_t *size);
+int tests_read_corpus(const char *path,
+        int (*cb)(const char *path, const uint8_t *data, size_t size,
+                void *ctx),
+        void *ctx);
+
+/* tests_textdir.c */
+int tests_textdir_open(void);
+int tests_textdir_write(const char *name, const uint8_t *data, size_t size);
+int tests_textdir_ask(const char *name, const char *question, char *answer,
+        size_t size, int multi);
+int tests_textdir_read(const char *name);
+
+#endif
@@ -0,0 +1,159 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2019 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "tests.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+static int tests_error(int errorcode, const char *head, char *fmt, ...)
+{
+    return (0);
+}
+
+static int tests_print(const char *head, char *fmt, ...)
+{
+    return (0);
+}
+
+static int tests_audit(char *fmt, ...)
+{
+    return (0);
+}
+
+/*  tests_quiet
+
+    The parsers print an error for every bad line, which is what the
+    tests feed them. Discard all output.
+*/
+void tests_quiet(void)
+{
+    vrprint.logger = "tests";
+    vrprint.error = tests_error;
+    vrprint.warning = tests_print;
+    vrprint.info = tests_print;
+    vrprint.debug = tests_print;
+    vrprint.audit = tests_audit;
+    vrmr_debug_level = NONE;
+}
+
+/*  tests_string
+
+    Returns a malloc'd, nul terminated copy of the first 'max' bytes of
+    'data', or NULL on error. A nul byte in 'data' ends the string, like
+    it would for a line read from the backend.
+*/
+char *tests_string(const uint8_t *data, size_t size, size_t max)
+{
+    char *str = NULL;
+
+    if (size > max)
+        size = max;
+    if (!(str = malloc(size + 1)))
+        return (NULL);
+    memcpy(str, data, size);
+    str[size] = '\0';
+    return (str);
+}
+
+/*  tests_read_file
+
+    Reads the file at 'path' into a malloc'd buffer.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int tests_read_file(const char *path, uint8_t **data, size_t *size)
+{
+    FILE *fp = NULL;
+    long len = 0;
+
+    if (!(fp = fopen(path, "rb")))
+        return (-1);
+    if (fseek(fp, 0, SEEK_END) < 0 || (len = ftell(fp)) < 0 ||
+            fseek(fp, 0, SEEK_SET) < 0) {
+        fclose(fp);
+        return (-1);
+    }
+    if (!(*data = malloc((size_t)len + 1))) {
+        fclose(fp);
+        return (-1);
+    }
+    *size = fread(*data, 1, (size_t)len, fp);
+    fclose(fp);
+    return (0);
+}
+
+/*  tests_read_corpus
+
+    Calls 'cb' for the file 'path', or for each file in the directory
+    'path'. The files of a directory are read in name order, so runs can
+    be compared.
+
+    Returns the number of files, or -1 on error.
+*/
+int tests_read_corpus(const char *path,
+        int (*cb)(const char *path, const uint8_t *data, size_t size,
+                void *ctx),
+        void *ctx)
+{
+    struct dirent **names = NULL;
+    struct stat st;
+    uint8_t *data = NULL;
+    size_t size = 0;
+    int n = 0, count = 0, r = 0;
+
+    if (stat(path, &st) < 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return (-1);
+    }
+
+    if (!S_ISDIR(st.st_mode)) {
+        if (tests_read_file(path, &data, &size) < 0) {
+            fprintf(stderr, "%s: %s\n", path, strerror(errno));
+            return (-1);
+        }
+        r = cb(path, data, size, ctx);
+        free(data);
+        return (r < 0 ? -1 : 1);
+    }
+
+    if ((n = scandir(path, &names, NULL, alphasort)) < 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return (-1);
+    }
+    for (int i = 0; i < n; i++) {
+        char file[PATH_MAX];
+
+        if (r >= 0 && names[i]->d_name[0] != '.' &&
+                snprintf(file, sizeof(file), "%s/%s", path,
+                        names[i]->d_name) < (int)sizeof(file)) {
+            int c = tests_read_corpus(file, cb, ctx);
+            if (c < 0)
+                r = -1;
+            else
+                count += c;
+        }
+        free(names[i]);
+    }
+    free(names);
+    return (r < 0 ? -1 : count);
+}
@@ -0,0 +1,162 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2019 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+    A textdir backend in a temporary directory, for feeding files to
+    ask_textdir(). The backend only opens files owned by root, so this
+    only works when run as root.
+*/
+
+#include "tests.h"
+#include "textdir_plugin.h"
+
+#include <dirent.h>
+
+static struct textdir_backend textdir;
+static struct vrmr_config textdir_cfg;
+static char textdir_dir[] = "/tmp/vuurmuur-tests-XXXXXX";
+static bool textdir_ready = false;
+
+/* remove the files written by tests_textdir_write() and the directory */
+static void tests_textdir_cleanup(void)
+{
+    char path[PATH_MAX];
+    struct dirent *d = NULL;
+    DIR *dir = NULL;
+
+    snprintf(path, sizeof(path), "%s/rules", textdir_dir);
+    if ((dir = opendir(path)) != NULL) {
+        while ((d = readdir(dir)) != NULL) {
+            if (d->d_name[0] == '.')
+                continue;
+            snprintf(path, sizeof(path), "%s/rules/%s", textdir_dir,
+                    d->d_name);
+            (void)unlink(path);
+        }
+        closedir(dir);
+    }
+    snprintf(path, sizeof(path), "%s/rules", textdir_dir);
+    (void)rmdir(path);
+    (void)rmdir(textdir_dir);
+}
+
+/*  tests_textdir_open
+
+    Sets up the backend. It's removed again at exit.
+
+    Returncodes:
+         0: ok
+        -1: error, e.g. not running as root
+*/
+int tests_textdir_open(void)
+{
+    char path[PATH_MAX];
+
+    if (textdir_ready)
+        return (0);
+    if (geteuid() != 0)
+        return (-1);
+
+    if (mkdtemp(textdir_dir) == NULL)
+        return (-1);
+    atexit(tests_textdir_cleanup);
+
+    snprintf(path, sizeof(path), "%s/rules", textdir_dir);
+    if (mkdir(path, 0700) < 0)
+        return (-1);
+
+    textdir_cfg.max_permission = VRMR_ANY_PERMISSION;
+    memset(&textdir, 0, sizeof(textdir));
+    textdir.cfg = &textdir_cfg;
+    textdir.backend_open = true;
+    strlcpy(textdir.textdirlocation, textdir_dir,
+            sizeof(textdir.textdirlocation));
+
+    textdir_ready = true;
+    return (0);
+}
+
+/*  tests_textdir_write
+
+    Writes 'data' as the rules file 'name'.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int tests_textdir_write(const char *name, const uint8_t *data, size_t size)
+{
+    char path[PATH_MAX];
+    FILE *fp = NULL;
+
+    snprintf(path, sizeof(path), "%s/rules/%s.conf", textdir_dir, name);
+    if (!(fp = fopen(path, "w")))
+        return (-1);
+    if (fwrite(data, 1, size, fp) != size) {
+        fclose(fp);
+        return (-1);
+    }
+    return (fclose(fp) == 0 ? 0 : -1);
+}
+
+/*  tests_textdir_ask
+
+    Asks the backend 'question' about the rules file 'name', see
+    ask_textdir().
+*/
+int tests_textdir_ask(const char *name, const char *question, char *answer,
+        size_t size, int multi)
+{
+    return (ask_textdir(&textdir, name, question, answer, size,
+            VRMR_TYPE_RULE, multi));
+}
+
+/*  tests_textdir_read
+
+    Reads the rules file 'name' the way the rules are read: all RULE
+    lines, then the single variables. Returns the number of answers, or
+    -1 on error.
+*/
+int tests_textdir_read(const char *name)
+{
+    static const char *questions[] = {"ACTIVE", "COMMENT", "IPADDRESS"};
+    char answer[VRMR_MAX_RULE_LENGTH];
+    int n = 0, r = 0;
+
+    while ((r = tests_textdir_ask(name, "RULE", answer, sizeof(answer), 1)) ==
+            1)
+        n++;
+    if (r < 0)
+        return (-1);
+
+    for (size_t i = 0; i < sizeof(questions) / sizeof(questions[0]); i++) {
+        /* small buffers, like the yes/no variables are read with */
+        char small[4];
+
+        if ((r = tests_textdir_ask(name, questions[i], answer, sizeof(answer),
+                     0)) < 0)
+            return (-1);
+        n += r;
+        if (tests_textdir_ask(name, questions[i], small, sizeof(small), 0) ==
+                1)
+            n++;
+    }
+    return (n);
+}
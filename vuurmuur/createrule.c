@@ -60,7 +60,7 @@ struct iptables_rule {
     int ipv; /**< VRMR_IPV4 or VRMR_IPV6 */
     char *table;
     char *chain;
-    char cmd[VRMR_MAX_PIPE_COMMAND];
+    const char *cmd; /* interned, see vrmr_intern() */
     uint64_t packets;
     uint64_t bytes;
 };
@@ -115,8 +115,8 @@ static void create_srcdst_string(char mode, const char *ipaddress,
     }
 }
 
-static int pipe_iptables_command(
-        struct vrmr_config *conf, char *table, char *chain, char *cmd)
+static int pipe_iptables_command(struct vrmr_config *conf, char *table,
+        char *chain, const char *cmd)
 {
     char str[VRMR_MAX_PIPE_COMMAND] = "";
 
@@ -139,8 +139,8 @@ static int pipe_iptables_command(
 }
 
 #ifdef IPV6_ENABLED
-static int pipe_ip6tables_command(
-        struct vrmr_config *conf, char *table, char *chain, char *cmd)
+static int pipe_ip6tables_command(struct vrmr_config *conf, char *table,
+        char *chain, const char *cmd)
 {
     char str[VRMR_MAX_PIPE_COMMAND] = "";
 
@@ -163,14 +163,25 @@ static int pipe_ip6tables_command(
 }
 #endif /* IPV6_ENABLED */
 
+/*  free a struct iptables_rule, the remove function of the queues */
+void iptrule_free(void *data)
+{
+    struct iptables_rule *iptrule = data;
+
+    if (iptrule == NULL)
+        return;
+    vrmr_intern_release(iptrule->cmd);
+    free(iptrule);
+}
+
 /*  compare two struct iptables_rule structs and return 1 if they match, 0
- * otherwise */
+ * otherwise. The commands are interned, so they are compared by pointer. */
 static int iptrulecmp(struct iptables_rule *r1, struct iptables_rule *r2)
 {
     assert(r1 && r2);
 
     if (r1->ipv == r2->ipv && r1->table == r2->table &&
-            r1->chain == r2->chain && strcmp(r1->cmd, r2->cmd) == 0 &&
+            r1->chain == r2->chain && r1->cmd == r2->cmd &&
             r1->packets == r2->packets && r1->bytes == r2->bytes) {
         return (1);
     }
@@ -192,7 +203,7 @@ static int iptrule_insert(
         listrule = d_node->data;
 
         if (iptrulecmp(listrule, iptrule) == 1) {
-            free(iptrule);
+            iptrule_free(iptrule);
             return (0);
         }
     }
@@ -233,12 +244,17 @@ static int queue_rule(struct rule_scratch *rule, char *table, char *chain,
     iptrule->ipv = rule->ipv;
     iptrule->table = table;
     iptrule->chain = chain;
-    strlcpy(iptrule->cmd, cmd, sizeof(iptrule->cmd));
     iptrule->packets = packets;
     iptrule->bytes = bytes;
+    if (!(iptrule->cmd = vrmr_intern(cmd))) {
+        free(iptrule);
+        return (-1);
+    }
 
-    if (iptrule_insert(rule, iptrule) < 0)
+    if (iptrule_insert(rule, iptrule) < 0) {
+        iptrule_free(iptrule);
         return (-1);
+    }
 
     return (0);
 }
@@ -250,7 +266,7 @@ static int queue_rule(struct rule_scratch *rule, char *table, char *chain,
  */
 static int process_rule(struct vrmr_config *conf,
         /*@null@*/ struct rule_set *ruleset, int ipv, char *table, char *chain,
-        char *cmd, uint64_t packets, uint64_t bytes)
+        const char *cmd, uint64_t packets, uint64_t bytes)
 {
     assert(cmd && table && chain);
 
@@ -382,12 +398,22 @@ static int process_rule(struct vrmr_config *conf,
     passes them to process_rule */
 int process_queued_rules(struct vrmr_config *conf,
         /*@null@*/ struct rule_set *ruleset, struct rule_scratch *rule)
+{
+    assert(rule);
+
+    return (process_queued_list(conf, ruleset, &rule->iptrulelist));
+}
+
+/*  passes a queue of iptables rules to process_rule, also used for the
+    queues kept from a previous run, see rulediff.c */
+int process_queued_list(struct vrmr_config *conf,
+        /*@null@*/ struct rule_set *ruleset, struct vrmr_list *iptrulelist)
 {
     struct vrmr_list_node *d_node = NULL;
 
-    assert(rule);
+    assert(iptrulelist);
 
-    for (d_node = rule->iptrulelist.top; d_node; d_node = d_node->next) {
+    for (d_node = iptrulelist->top; d_node; d_node = d_node->next) {
         struct iptables_rule *r = d_node->data;
 
         if (process_rule(conf, ruleset, r->ipv, r->table, r->chain, r->cmd,
@@ -5523,6 +5549,89 @@ int create_block_rules(struct vrmr_config *conf,
     return (retval);
 }
 
+/*  update_block_rules
+
+    Adds ('add' is true) or deletes the rules of create_block_rules() for
+    the ipaddresses in 'ips' in the running BLOCKLIST chain, so blocking an
+    address doesn't need a reload. All rules are loaded with a single
+    iptables-restore call, so either all of them are applied or none.
+
+    The blocklist is IPv4 only, like create_block_rules(), so other
+    addresses are refused.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int update_block_rules(
+        struct vrmr_config *conf, struct vrmr_list *ips, bool add)
+{
+    char path[] = "/tmp/vuurmuur-block-XXXXXX";
+    char cmd[VRMR_MAX_PIPE_COMMAND] = "";
+    const char *chain = add ? "-A BLOCKLIST" : "-D BLOCKLIST";
+    FILE *fp = NULL;
+    int fd = -1, retval = 0;
+
+    assert(conf && ips);
+
+    if (ips->len == 0)
+        return (0);
+
+    for (struct vrmr_list_node *d_node = ips->top; d_node;
+            d_node = d_node->next) {
+        const char *ipaddress = d_node->data;
+
+        if (vrmr_check_ipv4address(NULL, NULL, ipaddress, 1) != 1) {
+            vrmr_error(-1, "Error",
+                    "'%s' is not an IPv4 address, the blocklist is IPv4 only",
+                    ipaddress);
+            return (-1);
+        }
+    }
+
+    if ((fd = vrmr_create_tempfile(path)) < 0)
+        return (-1);
+    if (!(fp = fdopen(fd, "w"))) {
+        vrmr_error(-1, "Error", "fdopen failed: %s", strerror(errno));
+        close(fd);
+        (void)unlink(path);
+        return (-1);
+    }
+
+    fprintf(fp, "*filter\n");
+    for (struct vrmr_list_node *d_node = ips->top; d_node;
+            d_node = d_node->next) {
+        const char *ipaddress = d_node->data;
+
+        vrmr_debug(HIGH, "%s rules for '%s'.", add ? "adding" : "removing",
+                ipaddress);
+
+        /* ip is source */
+        fprintf(fp, "%s -s %s/255.255.255.255 -j BLOCK\n", chain, ipaddress);
+        /* ip is dst */
+        fprintf(fp, "%s -d %s/255.255.255.255 -j BLOCK\n", chain, ipaddress);
+    }
+    fprintf(fp, "COMMIT\n");
+
+    if (fclose(fp) != 0) {
+        vrmr_error(-1, "Error", "writing '%s' failed: %s", path,
+                strerror(errno));
+        (void)unlink(path);
+        return (-1);
+    }
+
+    snprintf(cmd, sizeof(cmd), "%s --noflush < %s",
+            conf->iptablesrestore_location, path);
+    if (vrmr_pipe_command(conf, cmd, VRMR_PIPE_VERBOSE) < 0) {
+        vrmr_error(-1, "Error", "%s the blocklist rules failed",
+                add ? "adding" : "removing");
+        retval = -1;
+    }
+
+    (void)unlink(path);
+    return (retval);
+}
+
 /* create_estrelnfqueue_rules
  *
  * Create the rules for RELATED and ESTABLISHED traffic for nfqueue.
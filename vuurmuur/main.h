@@ -32,10 +32,13 @@
 #include <signal.h> /* for catching signals */
 #include <time.h>   /* included for logging */
 #include <errno.h>  /* error handling */
-#include <sys/ipc.h>
-#include <sys/sem.h>
-#include <sys/shm.h>
 #include <sys/wait.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
 
 /* our own vuurmuurlib */
 #include <vuurmuur.h>
@@ -51,8 +54,6 @@
 
 #define SVCNAME "vuurmuur"
 
-#define LOOP_INT 1
-
 #define YES 1
 #define NO 0
 
@@ -161,69 +162,69 @@ struct rule_set {
     /*
         raw
     */
-    struct vrmr_list raw_preroute; /* list with rules */
+    struct vrmr_vector raw_preroute; /* list with rules */
     char raw_preroute_policy;
-    struct vrmr_list raw_output; /* list with rules */
+    struct vrmr_vector raw_output; /* list with rules */
     char raw_output_policy;
 
     /*
         mangle
     */
-    struct vrmr_list mangle_preroute; /* list with rules */
+    struct vrmr_vector mangle_preroute; /* list with rules */
     char mangle_preroute_policy; /* policy for this chain: 0: accept, 1: drop */
-    struct vrmr_list mangle_input; /* list with rules */
+    struct vrmr_vector mangle_input; /* list with rules */
     char mangle_input_policy; /* policy for this chain: 0: accept, 1: drop */
-    struct vrmr_list mangle_forward; /* list with rules */
+    struct vrmr_vector mangle_forward; /* list with rules */
     char mangle_forward_policy; /* policy for this chain: 0: accept, 1: drop */
-    struct vrmr_list mangle_output; /* list with rules */
+    struct vrmr_vector mangle_output; /* list with rules */
     char mangle_output_policy; /* policy for this chain: 0: accept, 1: drop */
-    struct vrmr_list mangle_postroute; /* list with rules */
+    struct vrmr_vector mangle_postroute; /* list with rules */
     char mangle_postroute_policy; /* policy for this chain: 0: accept, 1: drop
                                    */
 
     /*
         extra mangle (no policies)
     */
-    struct vrmr_list mangle_shape_in;  /* list with rules */
-    struct vrmr_list mangle_shape_out; /* list with rules */
-    struct vrmr_list mangle_shape_fw;  /* list with rules */
+    struct vrmr_vector mangle_shape_in;  /* list with rules */
+    struct vrmr_vector mangle_shape_out; /* list with rules */
+    struct vrmr_vector mangle_shape_fw;  /* list with rules */
 
     /*
         nat
     */
-    struct vrmr_list nat_preroute; /* list with rules */
+    struct vrmr_vector nat_preroute; /* list with rules */
     char nat_preroute_policy; /* policy for this chain: 0: accept, 1: drop */
-    struct vrmr_list nat_postroute; /* list with rules */
+    struct vrmr_vector nat_postroute; /* list with rules */
     char nat_postroute_policy;   /* policy for this chain: 0: accept, 1: drop */
-    struct vrmr_list nat_output; /* list with rules */
+    struct vrmr_vector nat_output; /* list with rules */
     char nat_output_policy;      /* policy for this chain: 0: accept, 1: drop */
 
     /*
         filter
     */
-    struct vrmr_list filter_input; /* list with rules */
+    struct vrmr_vector filter_input; /* list with rules */
     char filter_input_policy; /* policy for this chain: 0: accept, 1: drop */
-    struct vrmr_list filter_forward; /* list with rules */
+    struct vrmr_vector filter_forward; /* list with rules */
     char filter_forward_policy; /* policy for this chain: 0: accept, 1: drop */
-    struct vrmr_list filter_output; /* list with rules */
+    struct vrmr_vector filter_output; /* list with rules */
     char filter_output_policy; /* policy for this chain: 0: accept, 1: drop */
 
     /*
         extra filter (no policies)
     */
-    struct vrmr_list filter_antispoof;           /* list with rules */
-    struct vrmr_list filter_blocklist;           /* list with rules */
-    struct vrmr_list filter_blocktarget;         /* list with rules */
-    struct vrmr_list filter_badtcp;              /* list with rules */
-    struct vrmr_list filter_synlimittarget;      /* list with rules */
-    struct vrmr_list filter_udplimittarget;      /* list with rules */
-    struct vrmr_list filter_tcpresettarget;      /* list with rules */
-    struct vrmr_list filter_newaccepttarget;     /* list with rules */
-    struct vrmr_list filter_newnfqueuetarget;    /* list with rules */
-    struct vrmr_list filter_estrelnfqueuetarget; /* list with rules */
-    struct vrmr_list filter_newnflogtarget;      /* list with rules */
-    struct vrmr_list filter_estrelnflogtarget;   /* list with rules */
-    struct vrmr_list filter_accounting;          /* list with rules */
+    struct vrmr_vector filter_antispoof;           /* list with rules */
+    struct vrmr_vector filter_blocklist;           /* list with rules */
+    struct vrmr_vector filter_blocktarget;         /* list with rules */
+    struct vrmr_vector filter_badtcp;              /* list with rules */
+    struct vrmr_vector filter_synlimittarget;      /* list with rules */
+    struct vrmr_vector filter_udplimittarget;      /* list with rules */
+    struct vrmr_vector filter_tcpresettarget;      /* list with rules */
+    struct vrmr_vector filter_newaccepttarget;     /* list with rules */
+    struct vrmr_vector filter_newnfqueuetarget;    /* list with rules */
+    struct vrmr_vector filter_estrelnfqueuetarget; /* list with rules */
+    struct vrmr_vector filter_newnflogtarget;      /* list with rules */
+    struct vrmr_vector filter_estrelnflogtarget;   /* list with rules */
+    struct vrmr_vector filter_accounting;          /* list with rules */
 
     /*
         special chains
@@ -234,7 +235,7 @@ struct rule_set {
     /*
         shaping
     */
-    struct vrmr_list tc_rules; /* list with tc rules */
+    struct vrmr_vector tc_rules; /* list with tc rules */
 };
 
 struct cmd_line {
@@ -253,11 +254,8 @@ struct cmd_line {
     char force_start;
 };
 
-/*@null@*/
-extern struct vrmr_shm_table *shm_table;
-
-/* semaphore id */
-extern int sem_id;
+/* control socket, see control.c in libvuurmuur */
+extern struct vrmr_control control;
 
 /* pointer to the environment */
 extern char **environ;
@@ -291,6 +289,8 @@ int update_udplimit_rules(struct vrmr_config *conf,
         /*@null@*/ struct rule_set *, struct vrmr_iptcaps *, int);
 int create_block_rules(struct vrmr_config *conf, /*@null@*/ struct rule_set *,
         struct vrmr_blocklist *);
+int update_block_rules(
+        struct vrmr_config *conf, struct vrmr_list *ips, bool add);
 
 int create_newnfqueue_rules(struct vrmr_config *conf,
         /*@null@*/ struct rule_set *, struct vrmr_rules *,
@@ -315,8 +315,8 @@ int create_system_protectrules(struct vrmr_config *);
 int create_normal_rules(
         struct vrmr_ctx *, /*@null@*/ struct rule_set *, char *);
 
-int create_rule(struct vrmr_ctx *, /*@null@*/ struct rule_set *,
-        struct vrmr_rule_cache *);
+int create_rule(
+        struct vrmr_ctx *, /*@null@*/ struct rule_set *, struct vrmr_rule *);
 int remove_rule(
         struct vrmr_config *conf, int chaintype, int first_ipt_rule, int rules);
 
@@ -348,6 +348,9 @@ int clear_all_iptables_rules(struct vrmr_config *);
 
 int process_queued_rules(struct vrmr_config *conf,
         /*@null@*/ struct rule_set *ruleset, struct rule_scratch *rule);
+int process_queued_list(struct vrmr_config *conf,
+        /*@null@*/ struct rule_set *ruleset, struct vrmr_list *iptrulelist);
+void iptrule_free(void *data);
 
 /* misc.c */
 void send_hup_to_vuurmuurlog(void);
@@ -362,6 +365,7 @@ int logprint_info_bash(const char *head, char *fmt, ...) ATTR_FMT_PRINTF(2, 3);
 
 /* reload.c */
 int apply_changes(struct vrmr_ctx *vctx, struct vrmr_regex *);
+int apply_changes_dynamic(struct vrmr_ctx *vctx);
 
 int reload_services(struct vrmr_ctx *, struct vrmr_services *, regex_t *);
 int reload_vrmr_services_check(struct vrmr_ctx *, struct vrmr_service *);
@@ -375,12 +379,38 @@ int reload_interfaces(struct vrmr_ctx *, struct vrmr_interfaces *);
 int reload_vrmr_interfaces_check(
         struct vrmr_ctx *, struct vrmr_interface *iface_ptr);
 
-int check_for_changed_dynamic_ips(struct vrmr_interfaces *interfaces);
+int check_for_changed_dynamic_ips(
+        struct vrmr_interfaces *interfaces, const char *device);
+
+int blocklist_block(
+        struct vrmr_ctx *, const char *item, char *err, size_t size);
+int blocklist_unblock(
+        struct vrmr_ctx *, const char *item, char *err, size_t size);
+
+/* rulediff.c */
+struct rules_diff {
+    unsigned int kept;     /* rules in the same order in both lists */
+    unsigned int inserted; /* new rules */
+    unsigned int deleted;  /* rules that are gone */
+    unsigned int moved;    /* rules that are in both, but elsewhere */
+};
+
+int rules_diff(struct vrmr_rules *old_rules, struct vrmr_rules *new_rules,
+        struct rules_diff *diff);
+int rules_output_replay(struct vrmr_ctx *, /*@null@*/ struct rule_set *,
+        struct vrmr_rule *);
+void rules_output_store(struct vrmr_ctx *, /*@null@*/ struct rule_set *,
+        struct vrmr_rule *, struct vrmr_list *iptrulelist);
+void rules_output_flush(const char *reason);
+void rules_output_invalidate(struct vrmr_ctx *);
+void rules_output_begin(struct vrmr_ctx *);
+void rules_output_end(void);
 
 /* ruleset */
 int ruleset_add_rule_to_set(
-        struct vrmr_list *, char *, char *, uint64_t, uint64_t);
+        struct vrmr_vector *, char *, const char *, uint64_t, uint64_t);
 int load_ruleset(struct vrmr_ctx *);
+void ruleset_metrics(struct vrmr_metrics *);
 
 /* shape */
 int shaping_setup_roots(struct vrmr_config *cnf,
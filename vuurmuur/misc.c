@@ -22,12 +22,11 @@
 
 void send_hup_to_vuurmuurlog(void)
 {
-    int i = 0;
     pid_t vuurmuur_pid;
     int result = 0;
 
-    /* get the pid (the i is bogus) */
-    vuurmuur_pid = get_vuurmuur_pid("/var/run/vuurmuur_log.pid", &i);
+    /* get the pid */
+    vuurmuur_pid = get_vuurmuur_pid("/var/run/vuurmuur_log.pid");
     if (vuurmuur_pid > 0) {
         /* send a signal to vuurmuur_log */
         result = kill(vuurmuur_pid, SIGHUP);
@@ -48,7 +48,7 @@ static int apply_changes_ruleset(struct vrmr_ctx *vctx, struct vrmr_regex *reg)
         vrmr_error(-1, "Error", "unloading backends failed.");
         return (-1);
     }
-    vrmr_shm_update_progress(sem_id, &shm_table->reload_progress, 5);
+    vrmr_control_progress(&control, 5, "unload");
 
     /* reload the config
 
@@ -63,7 +63,7 @@ static int apply_changes_ruleset(struct vrmr_ctx *vctx, struct vrmr_regex *reg)
         cmdline_override_config(&vctx->conf);
     }
 
-    vrmr_shm_update_progress(sem_id, &shm_table->reload_progress, 10);
+    vrmr_control_progress(&control, 10, "config");
 
     /* reopen the backends */
     result = vrmr_backends_load(&vctx->conf, vctx);
@@ -71,7 +71,7 @@ static int apply_changes_ruleset(struct vrmr_ctx *vctx, struct vrmr_regex *reg)
         vrmr_error(-1, "Error", "re-opening backends failed.");
         return (-1);
     }
-    vrmr_shm_update_progress(sem_id, &shm_table->reload_progress, 15);
+    vrmr_control_progress(&control, 15, "backends");
 
     /* reload the services, interfaces, zones and rules. */
     vrmr_info("Info", "Reloading services...");
@@ -85,7 +85,7 @@ static int apply_changes_ruleset(struct vrmr_ctx *vctx, struct vrmr_regex *reg)
         vrmr_error(-1, "Error", "Reloading services failed.");
         return (-1);
     }
-    vrmr_shm_update_progress(sem_id, &shm_table->reload_progress, 20);
+    vrmr_control_progress(&control, 20, "services");
 
     vrmr_info("Info", "Reloading interfaces...");
     result = reload_interfaces(vctx, &vctx->interfaces);
@@ -98,7 +98,7 @@ static int apply_changes_ruleset(struct vrmr_ctx *vctx, struct vrmr_regex *reg)
         vrmr_error(-1, "Error", "Reloading interfaces failed.");
         return (-1);
     }
-    vrmr_shm_update_progress(sem_id, &shm_table->reload_progress, 25);
+    vrmr_control_progress(&control, 25, "interfaces");
 
     vrmr_info("Info", "Reloading zones...");
     result = reload_zonedata(vctx, &vctx->zones, &vctx->interfaces, reg);
@@ -111,7 +111,7 @@ static int apply_changes_ruleset(struct vrmr_ctx *vctx, struct vrmr_regex *reg)
         vrmr_error(-1, "Error", "Reloading zones failed.");
         return (-1);
     }
-    vrmr_shm_update_progress(sem_id, &shm_table->reload_progress, 30);
+    vrmr_control_progress(&control, 30, "zones");
 
     /* changed networks (for antispoofing) */
     result = check_for_changed_networks(&vctx->zones);
@@ -145,21 +145,21 @@ static int apply_changes_ruleset(struct vrmr_ctx *vctx, struct vrmr_regex *reg)
         vrmr_error(-1, "Error", "reloading rules failed.");
         retval = -1;
     }
-    vrmr_shm_update_progress(sem_id, &shm_table->reload_progress, 40);
+    vrmr_control_progress(&control, 40, "rules");
 
     /* analyzing the rules */
     if (analyze_all_rules(vctx, &vctx->rules) != 0) {
         vrmr_error(-1, "Error", "analizing the rules failed.");
         retval = -1;
     }
-    vrmr_shm_update_progress(sem_id, &shm_table->reload_progress, 80);
+    vrmr_control_progress(&control, 80, "analyze");
 
     /* create the new ruleset */
+    rules_output_invalidate(vctx);
     if (load_ruleset(vctx) < 0) {
         vrmr_error(-1, "Error", "creating rules failed.");
         retval = -1;
     }
-    vrmr_shm_update_progress(sem_id, &shm_table->reload_progress, 90);
 
     if (retval == 0)
         vrmr_info("Info", "Reloading Vuurmuur completed successfully.");
@@ -172,6 +172,36 @@ int apply_changes(struct vrmr_ctx *vctx, struct vrmr_regex *reg)
     return (apply_changes_ruleset(vctx, reg));
 }
 
+/*  apply_changes_dynamic
+
+    Applies the addresses of the dynamic interfaces, as updated by
+    check_for_changed_dynamic_ips(). Nothing else changed, so the config
+    and the backends are not reloaded: the rules are analyzed again and the
+    rules of the changed interfaces are created again, see
+    rules_output_interfaces(). The other rules are reused.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int apply_changes_dynamic(struct vrmr_ctx *vctx)
+{
+    vrmr_info("Info", "Applying the changed dynamic interfaces...");
+    vrmr_control_progress(&control, 40, "interfaces");
+
+    if (analyze_all_rules(vctx, &vctx->rules) != 0) {
+        vrmr_error(-1, "Error", "analizing the rules failed.");
+        return (-1);
+    }
+    vrmr_control_progress(&control, 80, "analyze");
+
+    if (load_ruleset(vctx) < 0) {
+        vrmr_error(-1, "Error", "creating rules failed.");
+        return (-1);
+    }
+    return (0);
+}
+
 /*  reload_services
  */
 int reload_services(struct vrmr_ctx *vctx, struct vrmr_services *services,
@@ -279,7 +309,6 @@ int reload_vrmr_services_check(
     int check_result = 0;
     struct vrmr_service *new_ser_ptr = NULL;
     /* these are for the comparisson between the portranges */
-    struct vrmr_list_node *list_node = NULL, *temp_node = NULL;
     struct vrmr_portdata *list_port = NULL, *temp_port = NULL;
 
     assert(ser_ptr);
@@ -290,7 +319,7 @@ int reload_vrmr_services_check(
                 strerror(errno));
         return (-1);
     }
-    vrmr_list_setup(&new_ser_ptr->PortrangeList, free);
+    vrmr_vector_setup(&new_ser_ptr->PortrangeList, free);
 
     /* read the service from the backend again */
     result = vrmr_read_service(vctx, ser_ptr->name, new_ser_ptr);
@@ -315,59 +344,26 @@ int reload_vrmr_services_check(
             if (strcmp(ser_ptr->helper, new_ser_ptr->helper) == 0) {
                 if (ser_ptr->PortrangeList.len ==
                         new_ser_ptr->PortrangeList.len) {
-                    list_node = ser_ptr->PortrangeList.top;
-                    temp_node = new_ser_ptr->PortrangeList.top;
-
-                    /* both no items in the list */
-                    if (!list_node && !temp_node) {
-                        /* no change */
-                    }
-                    /* if eitherone is NULL and the other not there must be a
-                       change */
-                    else if ((!list_node && temp_node) ||
-                             (list_node && !temp_node)) {
-                        /* change */
-                        if (!list_node)
-                            vrmr_info("Info",
-                                    "Service '%s': the service now has (a) "
-                                    "portrange(s).",
-                                    ser_ptr->name);
-
-                        if (!temp_node)
+                    for (unsigned int i = 0; i < ser_ptr->PortrangeList.len;
+                            i++) {
+                        list_port = ser_ptr->PortrangeList.data[i];
+                        temp_port = new_ser_ptr->PortrangeList.data[i];
+                        if (list_port == NULL || temp_port == NULL)
+                            continue;
+
+                        if ((list_port->protocol == temp_port->protocol) &&
+                                (list_port->src_low == temp_port->src_low) &&
+                                (list_port->src_high == temp_port->src_high) &&
+                                (list_port->dst_low == temp_port->dst_low) &&
+                                (list_port->dst_high == temp_port->dst_high)) {
+                            /* nothing changed */
+                        } else {
                             vrmr_info("Info",
-                                    "Service '%s': the service no longer has "
-                                    "portranges.",
+                                    "Service '%s': one of the portranges has "
+                                    "been changed.",
                                     ser_ptr->name);
-
-                        status = VRMR_ST_CHANGED;
-                    } else {
-                        for (; list_node && temp_node;
-                                list_node = list_node->next,
-                                temp_node = temp_node->next) {
-                            list_port = list_node->data;
-                            temp_port = temp_node->data;
-                            if (list_port == NULL || temp_port == NULL)
-                                continue;
-
-                            if ((list_port->protocol == temp_port->protocol) &&
-                                    (list_port->src_low ==
-                                            temp_port->src_low) &&
-                                    (list_port->src_high ==
-                                            temp_port->src_high) &&
-                                    (list_port->dst_low ==
-                                            temp_port->dst_low) &&
-                                    (list_port->dst_high ==
-                                            temp_port->dst_high)) {
-                                /* nothing changed */
-                            } else {
-                                vrmr_info("Info",
-                                        "Service '%s': one of the portranges "
-                                        "has been changed.",
-                                        ser_ptr->name);
-                                status = VRMR_ST_CHANGED;
-
-                                break;
-                            }
+                            status = VRMR_ST_CHANGED;
+                            break;
                         }
                     }
                 } else {
@@ -412,7 +408,7 @@ int reload_vrmr_services_check(
         vrmr_info("Info", "Service '%s' has been changed.", ser_ptr->name);
 
         /* delete the old portrange list */
-        vrmr_list_cleanup(&ser_ptr->PortrangeList);
+        vrmr_vector_cleanup(&ser_ptr->PortrangeList);
 
         /* copy the data */
         *ser_ptr = *new_ser_ptr;
@@ -424,7 +420,7 @@ int reload_vrmr_services_check(
         retval = 1;
     } else if (status == VRMR_ST_REMOVED || status == VRMR_ST_KEEP) {
         /* destroy the portrangelist of the temp service */
-        vrmr_list_cleanup(&new_ser_ptr->PortrangeList);
+        vrmr_vector_cleanup(&new_ser_ptr->PortrangeList);
 
         /* set the status */
         ser_ptr->status = status;
@@ -1520,6 +1516,216 @@ int reload_blocklist(struct vrmr_ctx *vctx, struct vrmr_config *cfg,
     return (status);
 }
 
+/*  blocklist_resolve
+
+    Fills 'ips' with the ipaddresses of 'item': an ipaddress, or an active
+    host or group.
+
+    Returncodes:
+         0: ok
+        -1: error, reason in 'err'
+*/
+static int blocklist_resolve(struct vrmr_ctx *vctx, const char *item,
+        struct vrmr_blocklist *ips, char *err, size_t size)
+{
+    struct in6_addr in6;
+
+    memset(ips, 0, sizeof(*ips));
+    vrmr_list_setup(&ips->list, free);
+
+    /* the blocklist is IPv4 only, see create_block_rules() */
+    if (inet_pton(AF_INET6, item, &in6) == 1) {
+        snprintf(err, size,
+                "'%s' is an IPv6 address, the blocklist is IPv4 only", item);
+        return (-1);
+    }
+
+    if (vrmr_blocklist_add_one(&vctx->zones, ips, /*load_ips*/ TRUE,
+                /*no_refcnt*/ TRUE, item) < 0) {
+        snprintf(err, size, "resolving '%s' failed", item);
+        return (-1);
+    }
+    if (ips->list.len == 0) {
+        snprintf(err, size,
+                "'%s' is not an ipaddress or an active host or group", item);
+        return (-1);
+    }
+    return (0);
+}
+
+/* remove one 'ip' from the blocklist in memory */
+static bool blocklist_remove_ip(
+        struct vrmr_blocklist *blocklist, const char *ip)
+{
+    for (struct vrmr_list_node *d_node = blocklist->list.top; d_node;
+            d_node = d_node->next) {
+        const char *listip = d_node->data;
+
+        if (listip != NULL && strcmp(listip, ip) == 0) {
+            (void)vrmr_list_remove_node(&blocklist->list, d_node);
+            return (true);
+        }
+    }
+    return (false);
+}
+
+/*  blocklist_block
+
+    Blocks 'item' right away: it is added to the blocklist in the backend
+    and its ipaddresses are appended to the running BLOCKLIST chain. The
+    blocklist in memory gets the same addresses, so the next reload sees
+    no change. Blocking an item that is already blocked is a no-op.
+
+    Returncodes:
+         0: ok
+        -1: error, reason in 'err'. If the chain couldn't be updated the
+            item is in the backend, a reload applies it.
+*/
+int blocklist_block(
+        struct vrmr_ctx *vctx, const char *item, char *err, size_t size)
+{
+    struct vrmr_blocklist ips, items;
+    int retval = 0;
+
+    assert(vctx && item && err);
+
+    if (blocklist_resolve(vctx, item, &ips, err, size) < 0) {
+        vrmr_list_cleanup(&ips.list);
+        return (-1);
+    }
+
+    /* the items as they are in the backend */
+    if (vrmr_blocklist_init_list(vctx, &vctx->conf, &vctx->zones, &items,
+                /*load_ips*/ FALSE, /*no_refcnt*/ TRUE) < 0) {
+        snprintf(err, size, "reading the blocklist failed");
+        vrmr_list_cleanup(&ips.list);
+        return (-1);
+    }
+    for (struct vrmr_list_node *d_node = items.list.top; d_node;
+            d_node = d_node->next) {
+        if (d_node->data != NULL && strcmp(d_node->data, item) == 0) {
+            vrmr_debug(LOW, "'%s' is already on the blocklist.", item);
+            goto end;
+        }
+    }
+
+    char *str = strdup(item);
+    if (str == NULL || vrmr_list_append(&items.list, str) == NULL) {
+        free(str);
+        snprintf(err, size, "out of memory");
+        retval = -1;
+        goto end;
+    }
+    if (vrmr_blocklist_save_list(vctx, &vctx->conf, &items) < 0) {
+        snprintf(err, size, "saving the blocklist failed");
+        retval = -1;
+        goto end;
+    }
+
+    if (update_block_rules(&vctx->conf, &ips.list, true) < 0) {
+        snprintf(err, size, "adding the rules for '%s' failed, reload to apply",
+                item);
+        retval = -1;
+        goto end;
+    }
+
+    /* move the addresses to the blocklist in memory */
+    while (ips.list.top != NULL) {
+        char *ip = ips.list.top->data;
+
+        ips.list.top->data = NULL;
+        (void)vrmr_list_remove_top(&ips.list);
+        if (vrmr_list_append(&vctx->blocklist.list, ip) == NULL) {
+            free(ip);
+            snprintf(err, size, "out of memory");
+            retval = -1;
+            break;
+        }
+    }
+end:
+    vrmr_list_cleanup(&items.list);
+    vrmr_list_cleanup(&ips.list);
+    return (retval);
+}
+
+/*  blocklist_unblock
+
+    Undoes blocklist_block(): 'item' is removed from the blocklist in the
+    backend and the rules of its ipaddresses from the running BLOCKLIST
+    chain.
+
+    Returncodes:
+         0: ok
+        -1: error, reason in 'err'
+*/
+int blocklist_unblock(
+        struct vrmr_ctx *vctx, const char *item, char *err, size_t size)
+{
+    struct vrmr_blocklist ips, items;
+    unsigned int removed = 0;
+    int retval = 0;
+
+    assert(vctx && item && err);
+
+    if (vrmr_blocklist_init_list(vctx, &vctx->conf, &vctx->zones, &items,
+                /*load_ips*/ FALSE, /*no_refcnt*/ TRUE) < 0) {
+        snprintf(err, size, "reading the blocklist failed");
+        return (-1);
+    }
+    for (struct vrmr_list_node *d_node = items.list.top, *next = NULL; d_node;
+            d_node = next) {
+        next = d_node->next;
+        if (d_node->data != NULL && strcmp(d_node->data, item) == 0) {
+            (void)vrmr_list_remove_node(&items.list, d_node);
+            removed++;
+        }
+    }
+    if (removed == 0) {
+        snprintf(err, size, "'%s' not found in the blocklist", item);
+        vrmr_list_cleanup(&items.list);
+        return (-1);
+    }
+    if (vrmr_blocklist_save_list(vctx, &vctx->conf, &items) < 0) {
+        snprintf(err, size, "saving the blocklist failed");
+        vrmr_list_cleanup(&items.list);
+        return (-1);
+    }
+    vrmr_list_cleanup(&items.list);
+
+    /* a host that is no longer active has no rules to remove */
+    if (blocklist_resolve(vctx, item, &ips, err, size) < 0) {
+        vrmr_list_cleanup(&ips.list);
+        err[0] = '\0';
+        return (0);
+    }
+
+    /* each occurance in the backend had its own rules. 'remove' points
+     * to the addresses in 'ips'. */
+    struct vrmr_list remove;
+    vrmr_list_setup(&remove, NULL);
+    for (unsigned int i = 0; i < removed; i++) {
+        for (struct vrmr_list_node *d_node = ips.list.top; d_node;
+                d_node = d_node->next) {
+            char *ip = d_node->data;
+
+            if (!blocklist_remove_ip(&vctx->blocklist, ip))
+                continue;
+            if (vrmr_list_append(&remove, ip) == NULL) {
+                snprintf(err, size, "out of memory");
+                retval = -1;
+                break;
+            }
+        }
+    }
+    if (update_block_rules(&vctx->conf, &remove, false) < 0) {
+        snprintf(err, size, "removing the rules for '%s' failed", item);
+        retval = -1;
+    }
+    vrmr_list_cleanup(&remove);
+    vrmr_list_cleanup(&ips.list);
+    return (retval);
+}
+
 /*
 
     Two stages:
@@ -1530,10 +1736,9 @@ int reload_rules(struct vrmr_ctx *vctx, struct vrmr_regex *reg)
 {
     struct vrmr_rules *new_rules = NULL;
     char status = 0;
+    struct rules_diff diff;
     struct vrmr_list_node *new_node = NULL;
-    struct vrmr_list_node *old_node = NULL;
     struct vrmr_rule *new_rule_ptr = NULL;
-    struct vrmr_rule *org_rule_ptr = NULL;
     struct vrmr_zone *vrmr_new_zone_ptr = NULL;
     struct vrmr_service *new_serv_ptr = NULL;
     struct vrmr_rule_cache *rulecache = NULL;
@@ -1560,77 +1765,18 @@ int reload_rules(struct vrmr_ctx *vctx, struct vrmr_regex *reg)
         return (-1);
     }
 
-    /* run trough the lists and compare */
-    if (vctx->rules.list.len != new_rules->list.len) {
-        vrmr_info("Info", "Rules: the number of rules items has been changed.");
-        status = 1;
-    }
-
-    /* now loop through the member to see if they have changes */
-    new_node = new_rules->list.top;
-    old_node = vctx->rules.list.top;
-    if (!new_node && !old_node) {
-        /* no change */
+    /* compare the lists as sequences of rules */
+    if (rules_diff(&vctx->rules, new_rules, &diff) < 0) {
+        vrmr_error(-1, "Error", "comparing the rules failed.");
+        vrmr_rules_cleanup_list(new_rules);
+        free(new_rules);
+        return (-1);
     }
-    /* if eitherone is NULL and the other not there must be a change */
-    else if ((!new_node && old_node) || (new_node && !old_node)) {
-        /* change */
-        if (!old_node)
-            vrmr_info("Info",
-                    "Rules: ruleslist now has items (old: %u, new: %u).",
-                    vctx->rules.list.len, new_rules->list.len);
-
-        if (!new_node)
-            vrmr_info("Info",
-                    "Rules: ruleslist no longer has items (old: %u, new: %u).",
-                    vctx->rules.list.len, new_rules->list.len);
-
+    if (diff.inserted > 0 || diff.deleted > 0 || diff.moved > 0) {
+        vrmr_info("Info",
+                "Rules: %u kept, %u inserted, %u deleted, %u moved.",
+                diff.kept, diff.inserted, diff.deleted, diff.moved);
         status = 1;
-    } else {
-        for (; new_node && old_node;
-                new_node = new_node->next, old_node = old_node->next) {
-            new_rule_ptr = new_node->data;
-            org_rule_ptr = old_node->data;
-            if (new_rule_ptr == NULL || org_rule_ptr == NULL)
-                continue;
-
-            /* active */
-            if (org_rule_ptr->active != new_rule_ptr->active) {
-                vrmr_debug(LOW, "%u: active changed.", org_rule_ptr->number);
-                status = 1;
-            }
-
-            /* action */
-            if (org_rule_ptr->action != new_rule_ptr->action) {
-                vrmr_debug(LOW, "%u: action changed.", org_rule_ptr->number);
-                status = 1;
-            }
-
-            /* service */
-            if (strcmp(org_rule_ptr->service, new_rule_ptr->service) != 0) {
-                vrmr_debug(LOW, "%u: service changed.", org_rule_ptr->number);
-                status = 1;
-            }
-
-            /* from */
-            if (strcmp(org_rule_ptr->from, new_rule_ptr->from) != 0) {
-                vrmr_debug(LOW, "%u: from changed.", org_rule_ptr->number);
-                status = 1;
-            }
-
-            /* to */
-            if (strcmp(org_rule_ptr->to, new_rule_ptr->to) != 0) {
-                vrmr_debug(LOW, "%u: to changed.", org_rule_ptr->number);
-                status = 1;
-            }
-
-            /* comparing the rule options */
-            if (vrmr_rules_compare_options(org_rule_ptr->opt, new_rule_ptr->opt,
-                        vrmr_rules_itoaction(new_rule_ptr->action)) != 0) {
-                vrmr_debug(LOW, "%u: options changed.", org_rule_ptr->number);
-                status = 1;
-            }
-        }
     }
 
     /* see if we are already done */
@@ -1737,18 +1883,63 @@ int check_for_changed_networks(struct vrmr_zones *zones)
     return (status);
 }
 
+/*  check_dynamic_ip
+
+    Gets the current address of 'family' of a dynamic interface and updates
+    'ipaddress' if it changed. 'up', if not NULL, is set if the address was
+    found.
+
+    Returncodes:
+        -1: error
+        0: no changes
+        1: changes
+*/
+static int check_dynamic_ip(struct vrmr_interface *iface_ptr, int family,
+        char *ipaddress, size_t size, bool *up)
+{
+    char new_ip[VRMR_MAX_IPV6_ADDR_LEN] = "";
+    int result;
+
+    if (family == AF_INET)
+        result = vrmr_get_dynamic_ip(iface_ptr->device, new_ip, sizeof(new_ip));
+    else
+        result = vrmr_get_dynamic_ip6(
+                iface_ptr->device, new_ip, sizeof(new_ip));
+    if (result < 0) {
+        vrmr_error(-1, "Error", "getting the ipaddress failed");
+        return (-1);
+    }
+    if (result == 1 && up != NULL)
+        *up = true;
+
+    /* compare the result with the known ipaddress */
+    if (strcmp(new_ip, ipaddress) == 0)
+        return (0);
+
+    if (new_ip[0] != '\0')
+        vrmr_info("Info",
+                "dynamic interface '%s' had ipaddress '%s' now it has '%s'.",
+                iface_ptr->name, ipaddress, new_ip);
+    (void)strlcpy(ipaddress, new_ip, size);
+    return (1);
+}
+
 /*  check_for_changed_dynamic_ips
 
+    Checks the dynamic interfaces on 'device', or all of them if 'device' is
+    NULL, and updates their addresses and 'up' state. The rules of the
+    changed interfaces are created again by apply_changes_dynamic().
+
     Returncodes:
         -1: error
         0: no changes
         1: changes
 */
-int check_for_changed_dynamic_ips(struct vrmr_interfaces *interfaces)
+int check_for_changed_dynamic_ips(
+        struct vrmr_interfaces *interfaces, const char *device)
 {
     struct vrmr_list_node *d_node = NULL;
     struct vrmr_interface *iface_ptr = NULL;
-    char ipaddress[16] = "";
     int result = 0, retval = 0;
 
     assert(interfaces);
@@ -1759,46 +1950,40 @@ int check_for_changed_dynamic_ips(struct vrmr_interfaces *interfaces)
             return (-1);
         }
 
-        if (iface_ptr->dynamic == 1 && strcmp(iface_ptr->device, "") != 0) {
-            result = vrmr_get_dynamic_ip(
-                    iface_ptr->device, ipaddress, sizeof(ipaddress));
-            if (result == -1) {
-                vrmr_error(-1, "Error", "getting the ipaddress failed");
-                return (-1);
-            } else if (result == 1) {
-                /* we got a valid answer, this means the interface is 'up'.
-                   So check if the last known state was 'down' */
-                if (!iface_ptr->up) {
-                    vrmr_info("Info", "dynamic interface '%s' is now up.",
-                            iface_ptr->name);
-                    retval = 1;
-                }
+        if (iface_ptr->dynamic != TRUE || iface_ptr->device[0] == '\0')
+            continue;
+        if (device != NULL && strcmp(iface_ptr->device, device) != 0)
+            continue;
 
-                /* compare the result with the known ipaddress */
-                if (strcmp(ipaddress, iface_ptr->ipv4.ipaddress) != 0) {
-                    vrmr_info("Info",
-                            "dynamic interface '%s' had ipaddress '%s' now it "
-                            "has '%s'.",
-                            iface_ptr->name, iface_ptr->ipv4.ipaddress,
-                            ipaddress);
-                    retval = 1;
-                }
-            } else if (result == 0) {
-                vrmr_debug(HIGH, "dynamic interface '%s' is down.",
-                        iface_ptr->name);
-
-                /* see if the last known state was 'up'. */
-                if (iface_ptr->up) {
-                    vrmr_info("Info", "dynamic interface '%s' is now down.",
-                            iface_ptr->name);
-                    retval = 1;
-                }
-            } else {
-                vrmr_error(-1, "Internal Error",
-                        "unknown errorcode '%d' for vrmr_get_dynamic_ip()",
-                        result);
+        bool up = false;
+        if ((result = check_dynamic_ip(iface_ptr, AF_INET,
+                     iface_ptr->ipv4.ipaddress,
+                     sizeof(iface_ptr->ipv4.ipaddress), &up)) < 0)
+            return (-1);
+        else if (result == 1)
+            retval = 1;
+        /* like vrmr_interfaces_check() only IPv4 decides about 'up' */
+        if (iface_ptr->dynamic6 == TRUE) {
+            if ((result = check_dynamic_ip(iface_ptr, AF_INET6,
+                         iface_ptr->ipv6.ip6, sizeof(iface_ptr->ipv6.ip6),
+                         NULL)) < 0)
                 return (-1);
-            }
+            else if (result == 1)
+                retval = 1;
+        }
+
+        /* we got a valid answer, this means the interface is 'up'. So check
+           if the last known state was 'down' and the other way around. */
+        if (up && !iface_ptr->up) {
+            vrmr_info("Info", "dynamic interface '%s' is now up.",
+                    iface_ptr->name);
+            iface_ptr->up = TRUE;
+            retval = 1;
+        } else if (!up && iface_ptr->up) {
+            vrmr_info("Info", "dynamic interface '%s' is now down.",
+                    iface_ptr->name);
+            iface_ptr->up = FALSE;
+            retval = 1;
         }
     }
 
@@ -0,0 +1,981 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2019 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "main.h"
+
+/*
+    Comparing the rules on a reload.
+
+    Every rule has a hash of how it is written in the backend, see
+    vrmr_rules_hash(). On a reload the old and the new list are compared
+    as sequences: the rules both lists start and end with are skipped and
+    the rest is matched up with a longest common subsequence. The result is
+    which rules were kept, inserted, deleted or moved, so adding a rule at
+    the top of the list is one insert, not a change of every rule below it.
+
+    The iptables rules created for a rule are kept, per ip version. When the
+    ruleset is created again a rule that is written the same gets the kept
+    iptables rules instead of being created again. Shaping rules are always
+    created, their tc classes are numbered in the order of the rules.
+
+    That only holds as long as nothing else the rule is created from
+    changed. So with the kept rules go the names of the zones, services and
+    interfaces the rule was created from, e.g. for a rule to a group: the
+    group, its members, their network and its interfaces. These are indexed
+    by name. After a reload the objects that changed are looked up in the
+    index and only the rules created from them are created again. All kept
+    rules are dropped when the config or the iptables capabilities change,
+    or when interfaces are added or removed.
+*/
+
+/* above this the middle part of the lists is not matched up, all of it
+ * counts as changed. 1M cells is 4MB. */
+#define RULES_DIFF_MAX_CELLS (1024 * 1024)
+
+static int rules_equal(struct vrmr_rule *a, struct vrmr_rule *b)
+{
+    if (a->hash != b->hash || a->active != b->active ||
+            a->action != b->action)
+        return (0);
+    if (strcmp(a->service, b->service) != 0 || strcmp(a->from, b->from) != 0 ||
+            strcmp(a->to, b->to) != 0)
+        return (0);
+
+    return (vrmr_rules_compare_options(
+                    a->opt, b->opt, vrmr_rules_itoaction(a->action)) == 0);
+}
+
+/* the rules of a list as an array, so they can be indexed */
+static struct vrmr_rule **rules_array(struct vrmr_rules *rules, size_t *len)
+{
+    struct vrmr_list_node *d_node = NULL;
+    struct vrmr_rule **array = NULL;
+
+    *len = 0;
+    if (!(array = calloc(rules->list.len + 1, sizeof(*array)))) {
+        vrmr_error(-1, "Error", "calloc failed: %s", strerror(errno));
+        return (NULL);
+    }
+    for (d_node = rules->list.top; d_node; d_node = d_node->next) {
+        if (d_node->data != NULL)
+            array[(*len)++] = d_node->data;
+    }
+    return (array);
+}
+
+/*  rules_diff_middle
+
+    Matches up old[0..rows> and new[0..cols> with a longest common
+    subsequence. The matched rules are marked in 'old_kept' and 'new_kept'.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int rules_diff_middle(struct vrmr_rule **o, size_t rows,
+        struct vrmr_rule **n, size_t cols, char *old_kept, char *new_kept)
+{
+    unsigned int *lcs = NULL;
+    size_t i, j, width = cols + 1;
+
+    if (rows == 0 || cols == 0)
+        return (0);
+    if (rows > RULES_DIFF_MAX_CELLS / cols) {
+        vrmr_debug(LOW, "%zu x %zu rules to compare, too many.", rows, cols);
+        return (0);
+    }
+
+    if (!(lcs = calloc((rows + 1) * width, sizeof(*lcs)))) {
+        vrmr_error(-1, "Error", "calloc failed: %s", strerror(errno));
+        return (-1);
+    }
+
+    /* lcs[i][j]: length of the lcs of old[i..rows> and new[j..cols> */
+    for (i = rows; i-- > 0;) {
+        for (j = cols; j-- > 0;) {
+            if (rules_equal(o[i], n[j]))
+                lcs[i * width + j] = lcs[(i + 1) * width + j + 1] + 1;
+            else if (lcs[(i + 1) * width + j] >= lcs[i * width + j + 1])
+                lcs[i * width + j] = lcs[(i + 1) * width + j];
+            else
+                lcs[i * width + j] = lcs[i * width + j + 1];
+        }
+    }
+
+    for (i = 0, j = 0; i < rows && j < cols;) {
+        if (lcs[i * width + j] == lcs[(i + 1) * width + j + 1] + 1 &&
+                rules_equal(o[i], n[j])) {
+            old_kept[i++] = 1;
+            new_kept[j++] = 1;
+        } else if (lcs[(i + 1) * width + j] >= lcs[i * width + j + 1]) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+
+    free(lcs);
+    return (0);
+}
+
+/* for vrmr_map_search_match(): 'data' points into the array of new
+ * rules, 'ctx' is the old rule */
+static int rules_diff_match(const void *data, const void *ctx)
+{
+    struct vrmr_rule *const *n = data;
+
+    return (rules_equal((struct vrmr_rule *)ctx, *n));
+}
+
+/*  rules_diff_moved
+
+    A rule that isn't kept in the old list, but is in the new list, was
+    moved. The new rules that are not kept are indexed by how they are
+    written, so each old rule is looked up instead of compared with all
+    new rules. The moved rules are marked in 'new_kept'.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int rules_diff_moved(struct vrmr_rule **o, size_t old_len,
+        const char *old_kept, struct vrmr_rule **n, size_t new_len,
+        char *new_kept, struct rules_diff *diff)
+{
+    struct vrmr_map map;
+    struct vrmr_map_key mkey;
+    char **text = NULL;
+    size_t i, j;
+    int retval = -1;
+
+    if (vrmr_map_setup(&map, VRMR_MAP_KEY_STRING,
+                (unsigned int)(new_len - diff->kept)) < 0)
+        return (-1);
+    if (!(text = calloc(new_len + 1, sizeof(*text)))) {
+        vrmr_error(-1, "Error", "calloc failed: %s", strerror(errno));
+        goto end;
+    }
+
+    for (j = 0; j < new_len; j++) {
+        if (new_kept[j])
+            continue;
+        if (!(text[j] = vrmr_rules_assemble_rule(n[j])))
+            goto end;
+        vrmr_map_key_string(&mkey, text[j]);
+        if (vrmr_map_insert(&map, &mkey, &n[j]) < 0)
+            goto end;
+    }
+
+    for (i = 0; i < old_len; i++) {
+        struct vrmr_rule **moved = NULL;
+        char *line = NULL;
+
+        if (old_kept[i])
+            continue;
+
+        if (!(line = vrmr_rules_assemble_rule(o[i])))
+            goto end;
+        vrmr_map_key_string(&mkey, line);
+        moved = vrmr_map_search_match(&map, &mkey, rules_diff_match, o[i]);
+        if (moved != NULL) {
+            vrmr_debug(LOW, "rule %u moved to %u.", o[i]->number,
+                    (*moved)->number);
+            (void)vrmr_map_remove(&map, &mkey, moved);
+            new_kept[moved - n] = 1;
+            diff->moved++;
+        } else {
+            vrmr_debug(LOW, "rule %u deleted.", o[i]->number);
+            diff->deleted++;
+        }
+        free(line);
+    }
+
+    retval = 0;
+end:
+    vrmr_map_cleanup(&map);
+    if (text != NULL) {
+        for (j = 0; j < new_len; j++)
+            free(text[j]);
+        free(text);
+    }
+    return (retval);
+}
+
+/*  rules_diff
+
+    Compares the rules in 'old_rules' with those in 'new_rules' and fills
+    'diff' with the number of rules kept, inserted, deleted and moved. The
+    edit script itself is logged in debug mode.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int rules_diff(struct vrmr_rules *old_rules, struct vrmr_rules *new_rules,
+        struct rules_diff *diff)
+{
+    struct vrmr_rule **o = NULL, **n = NULL;
+    char *old_kept = NULL, *new_kept = NULL;
+    size_t old_len = 0, new_len = 0, prefix = 0, suffix = 0, j;
+    int retval = -1;
+
+    assert(old_rules && new_rules && diff);
+
+    memset(diff, 0, sizeof(*diff));
+
+    if (!(o = rules_array(old_rules, &old_len)) ||
+            !(n = rules_array(new_rules, &new_len)))
+        goto end;
+    if (!(old_kept = calloc(old_len + 1, 1)) ||
+            !(new_kept = calloc(new_len + 1, 1))) {
+        vrmr_error(-1, "Error", "calloc failed: %s", strerror(errno));
+        goto end;
+    }
+
+    /* skip what both lists start and end with */
+    while (prefix < old_len && prefix < new_len &&
+            rules_equal(o[prefix], n[prefix])) {
+        old_kept[prefix] = new_kept[prefix] = 1;
+        prefix++;
+    }
+    while (suffix < old_len - prefix && suffix < new_len - prefix &&
+            rules_equal(o[old_len - suffix - 1], n[new_len - suffix - 1])) {
+        old_kept[old_len - suffix - 1] = new_kept[new_len - suffix - 1] = 1;
+        suffix++;
+    }
+
+    if (rules_diff_middle(o + prefix, old_len - prefix - suffix, n + prefix,
+                new_len - prefix - suffix, old_kept + prefix,
+                new_kept + prefix) < 0)
+        goto end;
+
+    for (j = 0; j < new_len; j++) {
+        if (new_kept[j])
+            diff->kept++;
+    }
+
+    if (rules_diff_moved(o, old_len, old_kept, n, new_len, new_kept, diff) < 0)
+        goto end;
+
+    for (j = 0; j < new_len; j++) {
+        if (!new_kept[j]) {
+            vrmr_debug(LOW, "rule %u inserted.", n[j]->number);
+            diff->inserted++;
+        }
+    }
+
+    retval = 0;
+end:
+    free(o);
+    free(n);
+    free(old_kept);
+    free(new_kept);
+    return (retval);
+}
+
+/* the iptables rules created for a rule */
+struct rules_output {
+    char *key; /* ip version and the rule as written in the backend */
+    struct vrmr_list iptrulelist;
+    struct vrmr_rules_chaincount iptcount;
+    struct vrmr_list deps; /* names of the objects it was created from */
+    char used;             /* used in the current run */
+    char stale;            /* an object it depends on changed */
+};
+
+/* the rules created from an object, e.g. 'z:web.dmz' */
+struct rules_dep {
+    const char *name; /* points into the deps of one of the outputs */
+    struct vrmr_list outputs;
+};
+
+/* what the rules of an interface were created from, see
+ * rules_output_interfaces() */
+struct rules_iface {
+    char name[VRMR_MAX_INTERFACE];
+    uint32_t hash;
+    char seen;
+};
+
+static struct vrmr_map output_map;   /* key -> struct rules_output */
+static struct vrmr_list output_list; /* all struct rules_output */
+static struct vrmr_map dep_map;      /* name -> struct rules_dep */
+static struct vrmr_list dep_list;    /* all struct rules_dep */
+static struct vrmr_list iface_list = VRMR_LIST_INITIALIZER(free);
+static bool output_ready = false;
+static uint32_t output_context = 0;
+static unsigned int output_reused = 0, output_created = 0;
+
+static void rules_output_free(void *data)
+{
+    struct rules_output *out = data;
+
+    vrmr_list_cleanup(&out->iptrulelist);
+    vrmr_list_cleanup(&out->deps);
+    free(out->key);
+    free(out);
+}
+
+static void rules_dep_free(void *data)
+{
+    struct rules_dep *dep = data;
+
+    vrmr_list_cleanup(&dep->outputs);
+    free(dep);
+}
+
+static int rules_output_setup(void)
+{
+    if (output_ready)
+        return (0);
+
+    if (vrmr_map_setup(&output_map, VRMR_MAP_KEY_STRING, 0) < 0)
+        return (-1);
+    if (vrmr_map_setup(&dep_map, VRMR_MAP_KEY_STRING, 0) < 0) {
+        vrmr_map_cleanup(&output_map);
+        return (-1);
+    }
+    vrmr_list_setup(&output_list, rules_output_free);
+    vrmr_list_setup(&dep_list, rules_dep_free);
+    output_ready = true;
+    return (0);
+}
+
+/*  rules_output_index
+
+    Rebuilds the index from the objects to the outputs created from them.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int rules_output_index(void)
+{
+    struct vrmr_list_node *d_node = NULL, *dep_node = NULL;
+    struct rules_dep *dep = NULL;
+    struct vrmr_map_key mkey;
+
+    vrmr_map_cleanup(&dep_map);
+    vrmr_list_cleanup(&dep_list);
+    if (vrmr_map_setup(&dep_map, VRMR_MAP_KEY_STRING, output_list.len) < 0)
+        return (-1);
+
+    for (d_node = output_list.top; d_node; d_node = d_node->next) {
+        struct rules_output *out = d_node->data;
+
+        for (dep_node = out->deps.top; dep_node; dep_node = dep_node->next) {
+            vrmr_map_key_string(&mkey, dep_node->data);
+            if (!(dep = vrmr_map_search(&dep_map, &mkey))) {
+                if (!(dep = calloc(1, sizeof(*dep)))) {
+                    vrmr_error(-1, "Error", "calloc failed: %s",
+                            strerror(errno));
+                    return (-1);
+                }
+                dep->name = dep_node->data;
+                vrmr_list_setup(&dep->outputs, NULL);
+                if (vrmr_list_append(&dep_list, dep) == NULL) {
+                    rules_dep_free(dep);
+                    return (-1);
+                }
+                vrmr_map_key_string(&mkey, dep->name);
+                if (vrmr_map_insert(&dep_map, &mkey, dep) < 0)
+                    return (-1);
+            }
+            if (vrmr_list_append(&dep->outputs, out) == NULL)
+                return (-1);
+        }
+    }
+    return (0);
+}
+
+/*  rules_output_flush
+
+    Drops all kept iptables rules, 'reason' is logged.
+*/
+void rules_output_flush(const char *reason)
+{
+    if (!output_ready)
+        return;
+
+    if (output_list.len > 0)
+        vrmr_info("Info", "Rules: creating all rules again: %s.", reason);
+
+    vrmr_map_cleanup(&output_map);
+    vrmr_list_cleanup(&output_list);
+    vrmr_map_cleanup(&dep_map);
+    vrmr_list_cleanup(&dep_list);
+    output_ready = false;
+}
+
+/* marks the outputs created from object 'type':'name' stale */
+static void rules_output_drop(char type, const char *name)
+{
+    struct vrmr_list_node *d_node = NULL;
+    struct rules_dep *dep = NULL;
+    struct vrmr_map_key mkey;
+    char key[VRMR_MAX_HOST_NET_ZONE + 3];
+
+    snprintf(key, sizeof(key), "%c:%s", type, name);
+    vrmr_map_key_string(&mkey, key);
+    if (!output_ready || !(dep = vrmr_map_search(&dep_map, &mkey)))
+        return;
+
+    vrmr_debug(LOW, "'%s' changed, %u rules depend on it.", key,
+            dep->outputs.len);
+
+    for (d_node = dep->outputs.top; d_node; d_node = d_node->next) {
+        struct rules_output *out = d_node->data;
+        out->stale = 1;
+    }
+}
+
+/* removes the outputs that were marked stale */
+static void rules_output_purge(void)
+{
+    struct vrmr_list_node *d_node = NULL, *next = NULL;
+    struct vrmr_map_key mkey;
+    unsigned int total = output_list.len, stale = 0;
+
+    if (!output_ready)
+        return;
+
+    for (d_node = output_list.top; d_node; d_node = next) {
+        struct rules_output *out = d_node->data;
+        next = d_node->next;
+
+        if (!out->stale)
+            continue;
+        vrmr_map_key_string(&mkey, out->key);
+        (void)vrmr_map_remove(&output_map, &mkey, out);
+        (void)vrmr_list_remove_node(&output_list, d_node);
+        stale++;
+    }
+    if (stale == 0)
+        return;
+
+    vrmr_info("Info", "Rules: %u of %u kept rules depend on changed objects.",
+            stale, total);
+    if (rules_output_index() < 0)
+        rules_output_flush("indexing failed");
+}
+
+/*  rules_output_invalidate
+
+    Drops the kept iptables rules of the rules that depend on a zone,
+    service or interface that changed in the last reload.
+*/
+void rules_output_invalidate(struct vrmr_ctx *vctx)
+{
+    struct vrmr_list_node *d_node = NULL;
+
+    assert(vctx);
+
+    for (d_node = vctx->interfaces.list.top; d_node; d_node = d_node->next) {
+        struct vrmr_interface *iface_ptr = d_node->data;
+
+        if (iface_ptr == NULL || iface_ptr->status == VRMR_ST_KEEP)
+            continue;
+        /* the networks may refer to it now, or no longer */
+        if (iface_ptr->status == VRMR_ST_ADDED ||
+                iface_ptr->status == VRMR_ST_REMOVED) {
+            rules_output_flush("interfaces added or removed");
+            return;
+        }
+        rules_output_drop('i', iface_ptr->name);
+        rules_output_drop('i', "*");
+    }
+
+    for (d_node = vctx->zones.list.top; d_node; d_node = d_node->next) {
+        struct vrmr_zone *zone_ptr = d_node->data;
+
+        if (zone_ptr == NULL || zone_ptr->status == VRMR_ST_KEEP)
+            continue;
+        rules_output_drop('z', zone_ptr->name);
+        /* rules for a zone are created for each of its networks */
+        if (zone_ptr->type == VRMR_TYPE_NETWORK)
+            rules_output_drop('z', zone_ptr->zone_name);
+    }
+
+    for (d_node = vctx->services.list.top; d_node; d_node = d_node->next) {
+        struct vrmr_service *ser_ptr = d_node->data;
+
+        if (ser_ptr != NULL && ser_ptr->status != VRMR_ST_KEEP)
+            rules_output_drop('s', ser_ptr->name);
+    }
+
+    rules_output_purge();
+}
+
+/* adds object 'type':'name' to 'deps', once */
+static int rules_output_dep(struct vrmr_list *deps, char type, const char *name)
+{
+    struct vrmr_list_node *d_node = NULL;
+    char key[VRMR_MAX_HOST_NET_ZONE + 3];
+    char *str = NULL;
+
+    snprintf(key, sizeof(key), "%c:%s", type, name);
+    for (d_node = deps->top; d_node; d_node = d_node->next) {
+        if (strcmp(d_node->data, key) == 0)
+            return (0);
+    }
+
+    if (!(str = strdup(key)) || vrmr_list_append(deps, str) == NULL) {
+        free(str);
+        return (-1);
+    }
+    return (0);
+}
+
+/* the network and the interfaces the rules of a network are created for */
+static int rules_output_deps_network(
+        struct vrmr_list *deps, struct vrmr_zone *network)
+{
+    struct vrmr_list_node *d_node = NULL;
+
+    if (network == NULL)
+        return (0);
+    if (rules_output_dep(deps, 'z', network->name) < 0)
+        return (-1);
+
+    for (d_node = network->InterfaceList.top; d_node; d_node = d_node->next) {
+        struct vrmr_interface *iface_ptr = d_node->data;
+
+        if (iface_ptr && rules_output_dep(deps, 'i', iface_ptr->name) < 0)
+            return (-1);
+    }
+    return (0);
+}
+
+/* the objects the rules for 'zone_ptr' are created from. Follows the
+ * rulecreate_*_iface_loop() functions: hosts and groups use the interfaces
+ * of their network, zones the interfaces of all their networks. */
+static int rules_output_deps_zone(struct vrmr_ctx *vctx, struct vrmr_list *deps,
+        /*@null@*/ struct vrmr_zone *zone_ptr)
+{
+    struct vrmr_list_node *d_node = NULL;
+
+    if (zone_ptr == NULL)
+        return (0);
+    if (rules_output_dep(deps, 'z', zone_ptr->name) < 0)
+        return (-1);
+
+    switch (zone_ptr->type) {
+        case VRMR_TYPE_GROUP:
+            for (d_node = zone_ptr->GroupList.top; d_node;
+                    d_node = d_node->next) {
+                struct vrmr_zone *member = d_node->data;
+
+                if (member && rules_output_dep(deps, 'z', member->name) < 0)
+                    return (-1);
+            }
+            /* fall through */
+        case VRMR_TYPE_HOST:
+            return (rules_output_deps_network(deps, zone_ptr->network_parent));
+        case VRMR_TYPE_NETWORK:
+            return (rules_output_deps_network(deps, zone_ptr));
+        case VRMR_TYPE_ZONE:
+            for (d_node = vctx->zones.list.top; d_node; d_node = d_node->next) {
+                struct vrmr_zone *network = d_node->data;
+
+                if (network && network->type == VRMR_TYPE_NETWORK &&
+                        strcmp(network->zone_name, zone_ptr->name) == 0 &&
+                        rules_output_deps_network(deps, network) < 0)
+                    return (-1);
+            }
+            return (0);
+        default:
+            /* the firewall: all interfaces */
+            return (rules_output_dep(deps, 'i', "*"));
+    }
+}
+
+/*  rules_output_deps
+
+    Fills 'deps' with the names of the zones, services and interfaces the
+    analyzed rule 'rule_ptr' is created from. 'i:*' means all interfaces,
+    for the firewall and 'any'.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int rules_output_deps(struct vrmr_ctx *vctx, struct vrmr_rule *rule_ptr,
+        struct vrmr_list *deps)
+{
+    struct vrmr_rule_cache *rc = &rule_ptr->rulecache;
+
+    if (rules_output_deps_zone(vctx, deps, rc->from) < 0 ||
+            rules_output_deps_zone(vctx, deps, rc->to) < 0 ||
+            rules_output_deps_zone(vctx, deps, rc->who) < 0)
+        return (-1);
+
+    if (rc->from_any || rc->to_any || rc->from_firewall || rc->to_firewall ||
+            rc->from_firewall_any || rc->to_firewall_any) {
+        if (rules_output_dep(deps, 'i', "*") < 0)
+            return (-1);
+    }
+    if (rc->service && rules_output_dep(deps, 's', rc->service->name) < 0)
+        return (-1);
+
+    if (rc->via_int && rules_output_dep(deps, 'i', rc->via_int->name) < 0)
+        return (-1);
+    if (rc->who_int && rules_output_dep(deps, 'i', rc->who_int->name) < 0)
+        return (-1);
+    if (rc->option.in_int[0] != '\0' &&
+            rules_output_dep(deps, 'i', rc->option.in_int) < 0)
+        return (-1);
+    if (rc->option.out_int[0] != '\0' &&
+            rules_output_dep(deps, 'i', rc->option.out_int) < 0)
+        return (-1);
+    return (0);
+}
+
+/* the rules of a shaping rule are never kept, see above */
+static int rules_output_key(/*@null@*/ struct rule_set *ruleset,
+        struct vrmr_rule *rule_ptr, char *key, size_t size)
+{
+    char *line = NULL;
+
+    if (ruleset == NULL || !output_ready ||
+            vrmr_is_shape_rule(&rule_ptr->rulecache.option) == 1)
+        return (-1);
+
+    if (!(line = vrmr_rules_assemble_rule(rule_ptr)))
+        return (-1);
+
+    int r = snprintf(key, size, "%d %s", ruleset->ipv, line);
+    free(line);
+    return (r >= (int)size ? -1 : 0);
+}
+
+/*  rules_output_replay
+
+    Adds the iptables rules kept for 'rule_ptr' to 'ruleset'.
+
+    Returncodes:
+         1: done
+         0: nothing kept for the rule, it has to be created
+        -1: error
+*/
+int rules_output_replay(struct vrmr_ctx *vctx,
+        /*@null@*/ struct rule_set *ruleset, struct vrmr_rule *rule_ptr)
+{
+    struct rules_output *out = NULL;
+    struct vrmr_map_key mkey;
+    char key[VRMR_MAX_RULE_LENGTH + 8];
+
+    assert(vctx && rule_ptr);
+
+    if (rules_output_key(ruleset, rule_ptr, key, sizeof(key)) < 0)
+        return (0);
+
+    vrmr_map_key_string(&mkey, key);
+    if (!(out = vrmr_map_search(&output_map, &mkey)))
+        return (0);
+
+    if (process_queued_list(&vctx->conf, ruleset, &out->iptrulelist) < 0)
+        return (-1);
+
+    rule_ptr->rulecache.iptcount = out->iptcount;
+    out->used = 1;
+    output_reused++;
+    return (1);
+}
+
+/*  rules_output_store
+
+    Keeps the iptables rules created for 'rule_ptr'. They are moved out of
+    'iptrulelist'.
+*/
+void rules_output_store(struct vrmr_ctx *vctx,
+        /*@null@*/ struct rule_set *ruleset, struct vrmr_rule *rule_ptr,
+        struct vrmr_list *iptrulelist)
+{
+    struct rules_output *out = NULL;
+    struct vrmr_map_key mkey;
+    char key[VRMR_MAX_RULE_LENGTH + 8];
+
+    assert(vctx && rule_ptr && iptrulelist);
+
+    if (ruleset != NULL)
+        output_created++;
+    if (rules_output_key(ruleset, rule_ptr, key, sizeof(key)) < 0)
+        return;
+
+    /* already kept, e.g. the same rule twice */
+    vrmr_map_key_string(&mkey, key);
+    if (vrmr_map_search(&output_map, &mkey) != NULL)
+        return;
+
+    if (!(out = calloc(1, sizeof(*out))) || !(out->key = strdup(key))) {
+        free(out);
+        return;
+    }
+    vrmr_list_setup(&out->iptrulelist, iptrulelist->remove);
+    vrmr_list_setup(&out->deps, free);
+    if (rules_output_deps(vctx, rule_ptr, &out->deps) < 0) {
+        rules_output_free(out);
+        return;
+    }
+
+    vrmr_map_key_string(&mkey, out->key);
+    if (vrmr_list_append(&output_list, out) == NULL) {
+        rules_output_free(out);
+        return;
+    }
+    if (vrmr_map_insert(&output_map, &mkey, out) < 0) {
+        (void)vrmr_list_remove_bot(&output_list);
+        return;
+    }
+
+    /* move the queue over */
+    out->iptrulelist = *iptrulelist;
+    out->iptcount = rule_ptr->rulecache.iptcount;
+    out->used = 1;
+    vrmr_list_setup(iptrulelist, iptrulelist->remove);
+}
+
+static uint32_t rules_output_hash(uint32_t hash, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+
+    for (size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= 16777619U;
+    }
+    return (hash);
+}
+
+static uint32_t rules_output_hash_str(uint32_t hash, const char *str)
+{
+    return (rules_output_hash(hash, str, strlen(str) + 1));
+}
+
+static uint32_t rules_output_hash_uint(uint32_t hash, unsigned int value)
+{
+    return (rules_output_hash(hash, &value, sizeof(value)));
+}
+
+/* the iptables capabilities the rules are created with, see
+ * createrule.c */
+static const size_t rules_output_iptcaps[] = {
+        offsetof(struct vrmr_iptcaps, table_mangle),
+        offsetof(struct vrmr_iptcaps, table_nat),
+        offsetof(struct vrmr_iptcaps, table_raw),
+        offsetof(struct vrmr_iptcaps, target_snat),
+        offsetof(struct vrmr_iptcaps, target_dnat),
+        offsetof(struct vrmr_iptcaps, target_reject),
+        offsetof(struct vrmr_iptcaps, target_nflog),
+        offsetof(struct vrmr_iptcaps, target_redirect),
+        offsetof(struct vrmr_iptcaps, target_mark),
+        offsetof(struct vrmr_iptcaps, target_masquerade),
+        offsetof(struct vrmr_iptcaps, target_classify),
+        offsetof(struct vrmr_iptcaps, target_nfqueue),
+        offsetof(struct vrmr_iptcaps, target_connmark),
+        offsetof(struct vrmr_iptcaps, target_ct),
+        offsetof(struct vrmr_iptcaps, target_tcpmss),
+        offsetof(struct vrmr_iptcaps, target_nat_random),
+        offsetof(struct vrmr_iptcaps, match_state),
+        offsetof(struct vrmr_iptcaps, match_helper),
+        offsetof(struct vrmr_iptcaps, match_limit),
+        offsetof(struct vrmr_iptcaps, match_mac),
+        offsetof(struct vrmr_iptcaps, match_connmark),
+        offsetof(struct vrmr_iptcaps, match_conntrack),
+        offsetof(struct vrmr_iptcaps, match_rpfilter),
+        offsetof(struct vrmr_iptcaps, table_ip6_raw),
+        offsetof(struct vrmr_iptcaps, target_ip6_nflog),
+        offsetof(struct vrmr_iptcaps, target_ip6_tcpmss),
+        offsetof(struct vrmr_iptcaps, match_ip6_state),
+        offsetof(struct vrmr_iptcaps, match_ip6_connmark),
+        offsetof(struct vrmr_iptcaps, match_ip6_conntrack),
+        offsetof(struct vrmr_iptcaps, match_ip6_rpfilter),
+};
+
+/*  rules_output_context
+
+    Hash of the settings and iptables capabilities the iptables rules are
+    created with. Only the fields that end up in the rules are used, so
+    e.g. a changed logfile location doesn't drop the kept rules.
+*/
+static uint32_t rules_output_context(
+        const struct vrmr_config *conf, const struct vrmr_iptcaps *iptcaps)
+{
+    uint32_t hash = 2166136261U;
+
+    hash = rules_output_hash_uint(hash, (unsigned int)conf->vrmr_check_iptcaps);
+    hash = rules_output_hash_uint(hash, conf->nfgrp);
+    hash = rules_output_hash_uint(hash, conf->check_ipv6);
+    hash = rules_output_hash_uint(hash, conf->log_blocklist);
+    hash = rules_output_hash_uint(hash, (unsigned int)conf->log_policy);
+    hash = rules_output_hash_uint(hash, conf->log_policy_limit);
+    hash = rules_output_hash_uint(hash, conf->log_policy_burst);
+    hash = rules_output_hash_uint(hash, (unsigned int)conf->log_invalid);
+    hash = rules_output_hash_uint(hash, (unsigned int)conf->log_no_syn);
+    hash = rules_output_hash_uint(hash, (unsigned int)conf->log_probes);
+    hash = rules_output_hash_uint(hash, (unsigned int)conf->log_frag);
+    hash = rules_output_hash_uint(hash, conf->use_syn_limit);
+    hash = rules_output_hash_uint(hash, conf->syn_limit);
+    hash = rules_output_hash_uint(hash, conf->syn_limit_burst);
+    hash = rules_output_hash_uint(hash, conf->use_udp_limit);
+    hash = rules_output_hash_uint(hash, conf->udp_limit);
+    hash = rules_output_hash_uint(hash, conf->udp_limit_burst);
+    hash = rules_output_hash_uint(
+            hash, (unsigned int)conf->protect_syncookie);
+    hash = rules_output_hash_uint(
+            hash, (unsigned int)conf->protect_echobroadcast);
+    hash = rules_output_hash_uint(hash, conf->conntrack_invalid_drop);
+    hash = rules_output_hash_uint(hash, conf->conntrack_accounting);
+
+    for (size_t i = 0;
+            i < sizeof(rules_output_iptcaps) / sizeof(rules_output_iptcaps[0]);
+            i++) {
+        const bool *cap =
+                (const bool *)((const char *)iptcaps + rules_output_iptcaps[i]);
+        hash = rules_output_hash_uint(hash, *cap);
+    }
+    return (hash);
+}
+
+/*  rules_output_interfaces
+
+    The state of the interfaces that isn't covered by their status after a
+    reload, like the address of a dynamic interface, is compared with the
+    last run. The rules of the interfaces that changed are dropped.
+
+    Returncodes:
+         0: ok
+        -1: interfaces were added or removed, or error
+*/
+static int rules_output_interfaces(struct vrmr_ctx *vctx)
+{
+    struct vrmr_list_node *d_node = NULL, *i_node = NULL, *next = NULL;
+    struct rules_iface *ri = NULL;
+    bool first = (iface_list.len == 0), changed = false;
+
+    for (i_node = iface_list.top; i_node; i_node = i_node->next) {
+        ri = i_node->data;
+        ri->seen = 0;
+    }
+
+    for (d_node = vctx->interfaces.list.top; d_node; d_node = d_node->next) {
+        struct vrmr_interface *iface_ptr = d_node->data;
+        uint32_t hash = 2166136261U;
+
+        if (iface_ptr == NULL)
+            continue;
+
+        hash = rules_output_hash_str(hash, iface_ptr->device);
+        hash = rules_output_hash(hash, &iface_ptr->active, 1);
+        hash = rules_output_hash(hash, &iface_ptr->up, 1);
+        hash = rules_output_hash_str(hash, iface_ptr->ipv4.ipaddress);
+        hash = rules_output_hash_str(hash, iface_ptr->ipv6.ip6);
+
+        for (i_node = iface_list.top; i_node; i_node = i_node->next) {
+            ri = i_node->data;
+            if (strcmp(ri->name, iface_ptr->name) == 0)
+                break;
+        }
+        if (i_node == NULL) {
+            if (!(ri = calloc(1, sizeof(*ri))) ||
+                    vrmr_list_append(&iface_list, ri) == NULL) {
+                free(ri);
+                vrmr_list_cleanup(&iface_list);
+                return (-1);
+            }
+            (void)strlcpy(ri->name, iface_ptr->name, sizeof(ri->name));
+            changed = true;
+        } else if (ri->hash != hash) {
+            rules_output_drop('i', ri->name);
+            rules_output_drop('i', "*");
+        }
+        ri->hash = hash;
+        ri->seen = 1;
+    }
+
+    for (i_node = iface_list.top; i_node; i_node = next) {
+        ri = i_node->data;
+        next = i_node->next;
+
+        if (!ri->seen) {
+            (void)vrmr_list_remove_node(&iface_list, i_node);
+            changed = true;
+        }
+    }
+    if (changed && !first)
+        return (-1);
+
+    rules_output_purge();
+    return (0);
+}
+
+/*  rules_output_begin
+
+    Called before the ruleset is created. Drops the kept rules that depend
+    on what changed since the last run.
+*/
+void rules_output_begin(struct vrmr_ctx *vctx)
+{
+    assert(vctx);
+
+    uint32_t context = rules_output_context(&vctx->conf, &vctx->iptcaps);
+    if (context != output_context)
+        rules_output_flush("config changed");
+    output_context = context;
+
+    if (rules_output_interfaces(vctx) < 0)
+        rules_output_flush("interfaces added or removed");
+
+    if (rules_output_setup() < 0)
+        rules_output_flush("setup failed");
+
+    output_reused = output_created = 0;
+}
+
+/*  rules_output_end
+
+    Called after the ruleset is created. Drops the kept rules of rules that
+    are gone and indexes the rest by the objects they depend on.
+*/
+void rules_output_end(void)
+{
+    struct vrmr_list_node *d_node = NULL, *next = NULL;
+    struct vrmr_map_key mkey;
+
+    if (!output_ready)
+        return;
+
+    for (d_node = output_list.top; d_node; d_node = next) {
+        struct rules_output *out = d_node->data;
+        next = d_node->next;
+
+        if (out->used) {
+            out->used = 0;
+            continue;
+        }
+        vrmr_map_key_string(&mkey, out->key);
+        (void)vrmr_map_remove(&output_map, &mkey, out);
+        (void)vrmr_list_remove_node(&output_list, d_node);
+    }
+    if (rules_output_index() < 0)
+        rules_output_flush("indexing failed");
+
+    vrmr_info("Info", "Rules: %u reused, %u created.", output_reused,
+            output_created);
+}
@@ -262,12 +262,15 @@ int analyze_normal_rules(struct vrmr_config *conf, struct vrmr_rules *rules,
             /* update node before removing */
             struct vrmr_list_node *next_d_node = d_node->next;
 
-            /* remove the failed rule from the list */
+            /* remove the failed rule from the list and the index */
             if (vrmr_list_remove_node(&rules->list, d_node) < 0) {
                 vrmr_error(
                         -1, "Internal Error", "vrmr_list_remove_node() failed");
                 return (-1);
             }
+            char key[VRMR_MAX_RULE_LENGTH];
+            vrmr_rules_index_key(rule_ptr, key, sizeof(key));
+            (void)vrmr_name_index_remove(&rules->index, key, rule_ptr);
 
             vrmr_rules_free_options(rule_ptr->opt);
             free(rule_ptr);
@@ -1435,7 +1438,6 @@ static int rulecreate_service_loop(struct vrmr_config *conf,
         struct vrmr_iptcaps *iptcap)
 {
     int retval = 0;
-    struct vrmr_list_node *port_d_node = NULL;
     struct vrmr_list_node *listenport_d_node = NULL;
     struct vrmr_list_node *remoteport_d_node = NULL;
 
@@ -1474,10 +1476,9 @@ static int rulecreate_service_loop(struct vrmr_config *conf,
         remoteport_d_node = NULL;
 
     /* loop here */
-    for (port_d_node = create->service->PortrangeList.top; port_d_node != NULL;
-            port_d_node = port_d_node->next) {
+    for (unsigned int i = 0; i < create->service->PortrangeList.len; i++) {
         /* get the current portrange */
-        if (!(rule->portrange_ptr = port_d_node->data)) {
+        if (!(rule->portrange_ptr = create->service->PortrangeList.data[i])) {
             vrmr_error(-1, "Internal Error", "NULL pointer");
             return (-1);
         }
@@ -2130,10 +2131,11 @@ static int rulecreate_ipv4ipv6_loop(struct vrmr_ctx *vctx,
         -1: error
 */
 int create_rule(struct vrmr_ctx *vctx,
-        /*@null@*/ struct rule_set *ruleset, struct vrmr_rule_cache *create)
+        /*@null@*/ struct rule_set *ruleset, struct vrmr_rule *rule_ptr)
 {
     int retval = 0;
     struct rule_scratch *rule = NULL;
+    struct vrmr_rule_cache *create = &rule_ptr->rulecache;
 
     vrmr_debug(HIGH, "** start ** (create->action: %s).", create->action);
 
@@ -2156,6 +2158,10 @@ int create_rule(struct vrmr_ctx *vctx,
     if (create->active == 0)
         return (0);
 
+    /* unchanged since the last run: reuse its iptables rules */
+    if (rules_output_replay(vctx, ruleset, rule_ptr) == 1)
+        return (0);
+
     /* alloc the temp rule data */
     if (!(rule = malloc(sizeof(struct rule_scratch)))) {
         vrmr_error(-1, "Error", "malloc failed: %s", strerror(errno));
@@ -2163,7 +2169,7 @@ int create_rule(struct vrmr_ctx *vctx,
     }
     /* init */
     memset(rule, 0, sizeof(struct rule_scratch));
-    vrmr_list_setup(&rule->iptrulelist, free);
+    vrmr_list_setup(&rule->iptrulelist, iptrule_free);
     vrmr_list_setup(&rule->shaperulelist, free);
     vrmr_list_setup(&rule->from_network_list, NULL);
     vrmr_list_setup(&rule->to_network_list, NULL);
@@ -2192,6 +2198,9 @@ int create_rule(struct vrmr_ctx *vctx,
     process_queued_rules(&vctx->conf, ruleset, rule);
     shaping_process_queued_rules(&vctx->conf, ruleset, rule);
 
+    /* keep the iptables rules for the next run */
+    rules_output_store(vctx, ruleset, rule_ptr, &rule->iptrulelist);
+
     /* free the temp data */
     vrmr_list_cleanup(&rule->iptrulelist);
     vrmr_list_cleanup(&rule->shaperulelist);
@@ -2336,7 +2345,7 @@ int create_normal_rules(struct vrmr_ctx *vctx,
                             rule_ptr->rulecache.description);
                 }
             } else {
-                if (create_rule(vctx, ruleset, &rule_ptr->rulecache) == 0) {
+                if (create_rule(vctx, ruleset, rule_ptr) == 0) {
                     vrmr_debug(HIGH, "rule created succesfully.");
 
                     if (rule_ptr->rulecache.iptcount.forward > 0)
@@ -23,6 +23,7 @@
 */
 
 #include "main.h"
+#include <stddef.h>
 
 /* hack: in 0.8 we have to do this right! */
 struct vrmr_list accounting_chain_names; /* list with the chainnames */
@@ -32,6 +33,92 @@ struct chain_ref {
     char refcnt;
 };
 
+/* the chains of the ruleset, for the metrics */
+static const struct ruleset_chain {
+    const char *table;
+    const char *chain;
+    size_t offset;
+} ruleset_chains[] = {
+        {"raw", "PREROUTING", offsetof(struct rule_set, raw_preroute)},
+        {"raw", "OUTPUT", offsetof(struct rule_set, raw_output)},
+        {"mangle", "PREROUTING", offsetof(struct rule_set, mangle_preroute)},
+        {"mangle", "INPUT", offsetof(struct rule_set, mangle_input)},
+        {"mangle", "FORWARD", offsetof(struct rule_set, mangle_forward)},
+        {"mangle", "OUTPUT", offsetof(struct rule_set, mangle_output)},
+        {"mangle", "POSTROUTING", offsetof(struct rule_set, mangle_postroute)},
+        {"mangle", "SHAPEIN", offsetof(struct rule_set, mangle_shape_in)},
+        {"mangle", "SHAPEOUT", offsetof(struct rule_set, mangle_shape_out)},
+        {"mangle", "SHAPEFW", offsetof(struct rule_set, mangle_shape_fw)},
+        {"nat", "PREROUTING", offsetof(struct rule_set, nat_preroute)},
+        {"nat", "POSTROUTING", offsetof(struct rule_set, nat_postroute)},
+        {"nat", "OUTPUT", offsetof(struct rule_set, nat_output)},
+        {"filter", "INPUT", offsetof(struct rule_set, filter_input)},
+        {"filter", "FORWARD", offsetof(struct rule_set, filter_forward)},
+        {"filter", "OUTPUT", offsetof(struct rule_set, filter_output)},
+        {"filter", "ANTISPOOF", offsetof(struct rule_set, filter_antispoof)},
+        {"filter", "BLOCKLIST", offsetof(struct rule_set, filter_blocklist)},
+        {"filter", "BLOCK", offsetof(struct rule_set, filter_blocktarget)},
+        {"filter", "BADTCP", offsetof(struct rule_set, filter_badtcp)},
+        {"filter", "SYNLIMIT",
+                offsetof(struct rule_set, filter_synlimittarget)},
+        {"filter", "UDPLIMIT",
+                offsetof(struct rule_set, filter_udplimittarget)},
+        {"filter", "TCPRESET",
+                offsetof(struct rule_set, filter_tcpresettarget)},
+        {"filter", "NEWACCEPT",
+                offsetof(struct rule_set, filter_newaccepttarget)},
+        {"filter", "NEWNFQUEUE",
+                offsetof(struct rule_set, filter_newnfqueuetarget)},
+        {"filter", "ESTRELNFQUEUE",
+                offsetof(struct rule_set, filter_estrelnfqueuetarget)},
+        {"filter", "NEWNFLOG",
+                offsetof(struct rule_set, filter_newnflogtarget)},
+        {"filter", "ESTRELNFLOG",
+                offsetof(struct rule_set, filter_estrelnflogtarget)},
+        {"filter", "ACC", offsetof(struct rule_set, filter_accounting)},
+};
+#define RULESET_CHAINS (sizeof(ruleset_chains) / sizeof(ruleset_chains[0]))
+
+/* number of rules per chain of the last loaded ruleset, per ip version */
+static unsigned int ruleset_chain_rules[2][RULESET_CHAINS];
+static bool ruleset_loaded[2];
+
+static void ruleset_count_rules(const struct rule_set *ruleset)
+{
+    const int v = ruleset->ipv == VRMR_IPV6;
+
+    for (unsigned int i = 0; i < RULESET_CHAINS; i++) {
+        const struct vrmr_vector *vec =
+                (const void *)((const char *)ruleset +
+                               ruleset_chains[i].offset);
+        ruleset_chain_rules[v][i] = vec->len;
+    }
+    ruleset_loaded[v] = true;
+}
+
+/*  ruleset_metrics
+
+    Writes the number of rules per chain of the last loaded rulesets.
+*/
+void ruleset_metrics(struct vrmr_metrics *m)
+{
+    char labels[128];
+
+    for (int v = 0; v < 2; v++) {
+        if (!ruleset_loaded[v])
+            continue;
+
+        for (unsigned int i = 0; i < RULESET_CHAINS; i++) {
+            snprintf(labels, sizeof(labels),
+                    "ipv=\"%d\",table=\"%s\",chain=\"%s\"", v ? 6 : 4,
+                    ruleset_chains[i].table, ruleset_chains[i].chain);
+            vrmr_metrics_u64(m, "vuurmuur_ruleset_rules", "gauge",
+                    "Rules per chain in the loaded ruleset.", labels,
+                    ruleset_chain_rules[v][i]);
+        }
+    }
+}
+
 /*  ruleset_init
 
     Initializes the struct rule_set datastructure.
@@ -50,51 +137,51 @@ static int ruleset_setup(struct rule_set *ruleset)
     /* init the lists */
 
     /* raw */
-    vrmr_list_setup(&ruleset->raw_preroute, free);
-    vrmr_list_setup(&ruleset->raw_output, free);
+    vrmr_vector_setup(&ruleset->raw_preroute, free);
+    vrmr_vector_setup(&ruleset->raw_output, free);
 
     /* mangle */
-    vrmr_list_setup(&ruleset->mangle_preroute, free);
-    vrmr_list_setup(&ruleset->mangle_input, free);
-    vrmr_list_setup(&ruleset->mangle_forward, free);
-    vrmr_list_setup(&ruleset->mangle_output, free);
-    vrmr_list_setup(&ruleset->mangle_postroute, free);
+    vrmr_vector_setup(&ruleset->mangle_preroute, free);
+    vrmr_vector_setup(&ruleset->mangle_input, free);
+    vrmr_vector_setup(&ruleset->mangle_forward, free);
+    vrmr_vector_setup(&ruleset->mangle_output, free);
+    vrmr_vector_setup(&ruleset->mangle_postroute, free);
 
-    vrmr_list_setup(&ruleset->mangle_shape_in, free);
-    vrmr_list_setup(&ruleset->mangle_shape_out, free);
-    vrmr_list_setup(&ruleset->mangle_shape_fw, free);
+    vrmr_vector_setup(&ruleset->mangle_shape_in, free);
+    vrmr_vector_setup(&ruleset->mangle_shape_out, free);
+    vrmr_vector_setup(&ruleset->mangle_shape_fw, free);
 
     /* nat */
-    vrmr_list_setup(&ruleset->nat_preroute, free);
-    vrmr_list_setup(&ruleset->nat_postroute, free);
-    vrmr_list_setup(&ruleset->nat_output, free);
+    vrmr_vector_setup(&ruleset->nat_preroute, free);
+    vrmr_vector_setup(&ruleset->nat_postroute, free);
+    vrmr_vector_setup(&ruleset->nat_output, free);
 
     /* filter */
-    vrmr_list_setup(&ruleset->filter_input, free);
-    vrmr_list_setup(&ruleset->filter_forward, free);
-    vrmr_list_setup(&ruleset->filter_output, free);
-
-    vrmr_list_setup(&ruleset->filter_antispoof, free);
-    vrmr_list_setup(&ruleset->filter_blocklist, free);
-    vrmr_list_setup(&ruleset->filter_blocktarget, free);
-    vrmr_list_setup(&ruleset->filter_badtcp, free);
-    vrmr_list_setup(&ruleset->filter_synlimittarget, free);
-    vrmr_list_setup(&ruleset->filter_udplimittarget, free);
-    vrmr_list_setup(&ruleset->filter_newaccepttarget, free);
+    vrmr_vector_setup(&ruleset->filter_input, free);
+    vrmr_vector_setup(&ruleset->filter_forward, free);
+    vrmr_vector_setup(&ruleset->filter_output, free);
+
+    vrmr_vector_setup(&ruleset->filter_antispoof, free);
+    vrmr_vector_setup(&ruleset->filter_blocklist, free);
+    vrmr_vector_setup(&ruleset->filter_blocktarget, free);
+    vrmr_vector_setup(&ruleset->filter_badtcp, free);
+    vrmr_vector_setup(&ruleset->filter_synlimittarget, free);
+    vrmr_vector_setup(&ruleset->filter_udplimittarget, free);
+    vrmr_vector_setup(&ruleset->filter_newaccepttarget, free);
     /* NFQueue state */
-    vrmr_list_setup(&ruleset->filter_newnfqueuetarget, free);
-    vrmr_list_setup(&ruleset->filter_estrelnfqueuetarget, free);
+    vrmr_vector_setup(&ruleset->filter_newnfqueuetarget, free);
+    vrmr_vector_setup(&ruleset->filter_estrelnfqueuetarget, free);
     /* NFLog state */
-    vrmr_list_setup(&ruleset->filter_newnflogtarget, free);
-    vrmr_list_setup(&ruleset->filter_estrelnflogtarget, free);
+    vrmr_vector_setup(&ruleset->filter_newnflogtarget, free);
+    vrmr_vector_setup(&ruleset->filter_estrelnflogtarget, free);
     /* tcp reset */
-    vrmr_list_setup(&ruleset->filter_tcpresettarget, free);
+    vrmr_vector_setup(&ruleset->filter_tcpresettarget, free);
     /* accounting */
-    vrmr_list_setup(&ruleset->filter_accounting, free);
+    vrmr_vector_setup(&ruleset->filter_accounting, free);
     vrmr_list_setup(&accounting_chain_names, free);
 
     /* shaping */
-    vrmr_list_setup(&ruleset->tc_rules, free);
+    vrmr_vector_setup(&ruleset->tc_rules, free);
     return (0);
 }
 
@@ -110,47 +197,47 @@ static void ruleset_cleanup(struct rule_set *ruleset)
     assert(ruleset);
 
     /* raw */
-    vrmr_list_cleanup(&ruleset->raw_preroute);
-    vrmr_list_cleanup(&ruleset->raw_output);
+    vrmr_vector_cleanup(&ruleset->raw_preroute);
+    vrmr_vector_cleanup(&ruleset->raw_output);
 
     /* mangle */
-    vrmr_list_cleanup(&ruleset->mangle_preroute);
-    vrmr_list_cleanup(&ruleset->mangle_input);
-    vrmr_list_cleanup(&ruleset->mangle_forward);
-    vrmr_list_cleanup(&ruleset->mangle_output);
-    vrmr_list_cleanup(&ruleset->mangle_postroute);
+    vrmr_vector_cleanup(&ruleset->mangle_preroute);
+    vrmr_vector_cleanup(&ruleset->mangle_input);
+    vrmr_vector_cleanup(&ruleset->mangle_forward);
+    vrmr_vector_cleanup(&ruleset->mangle_output);
+    vrmr_vector_cleanup(&ruleset->mangle_postroute);
 
-    vrmr_list_cleanup(&ruleset->mangle_shape_in);
-    vrmr_list_cleanup(&ruleset->mangle_shape_out);
-    vrmr_list_cleanup(&ruleset->mangle_shape_fw);
+    vrmr_vector_cleanup(&ruleset->mangle_shape_in);
+    vrmr_vector_cleanup(&ruleset->mangle_shape_out);
+    vrmr_vector_cleanup(&ruleset->mangle_shape_fw);
 
     /* nat */
-    vrmr_list_cleanup(&ruleset->nat_preroute);
-    vrmr_list_cleanup(&ruleset->nat_postroute);
-    vrmr_list_cleanup(&ruleset->nat_output);
+    vrmr_vector_cleanup(&ruleset->nat_preroute);
+    vrmr_vector_cleanup(&ruleset->nat_postroute);
+    vrmr_vector_cleanup(&ruleset->nat_output);
 
     /* filter */
-    vrmr_list_cleanup(&ruleset->filter_input);
-    vrmr_list_cleanup(&ruleset->filter_forward);
-    vrmr_list_cleanup(&ruleset->filter_output);
-
-    vrmr_list_cleanup(&ruleset->filter_antispoof);
-    vrmr_list_cleanup(&ruleset->filter_blocklist);
-    vrmr_list_cleanup(&ruleset->filter_blocktarget);
-    vrmr_list_cleanup(&ruleset->filter_badtcp);
-    vrmr_list_cleanup(&ruleset->filter_synlimittarget);
-    vrmr_list_cleanup(&ruleset->filter_udplimittarget);
-    vrmr_list_cleanup(&ruleset->filter_newaccepttarget);
-    vrmr_list_cleanup(&ruleset->filter_estrelnfqueuetarget);
-    vrmr_list_cleanup(&ruleset->filter_newnfqueuetarget);
-    vrmr_list_cleanup(&ruleset->filter_estrelnflogtarget);
-    vrmr_list_cleanup(&ruleset->filter_newnflogtarget);
-    vrmr_list_cleanup(&ruleset->filter_tcpresettarget);
-
-    vrmr_list_cleanup(&ruleset->filter_accounting);
+    vrmr_vector_cleanup(&ruleset->filter_input);
+    vrmr_vector_cleanup(&ruleset->filter_forward);
+    vrmr_vector_cleanup(&ruleset->filter_output);
+
+    vrmr_vector_cleanup(&ruleset->filter_antispoof);
+    vrmr_vector_cleanup(&ruleset->filter_blocklist);
+    vrmr_vector_cleanup(&ruleset->filter_blocktarget);
+    vrmr_vector_cleanup(&ruleset->filter_badtcp);
+    vrmr_vector_cleanup(&ruleset->filter_synlimittarget);
+    vrmr_vector_cleanup(&ruleset->filter_udplimittarget);
+    vrmr_vector_cleanup(&ruleset->filter_newaccepttarget);
+    vrmr_vector_cleanup(&ruleset->filter_estrelnfqueuetarget);
+    vrmr_vector_cleanup(&ruleset->filter_newnfqueuetarget);
+    vrmr_vector_cleanup(&ruleset->filter_estrelnflogtarget);
+    vrmr_vector_cleanup(&ruleset->filter_newnflogtarget);
+    vrmr_vector_cleanup(&ruleset->filter_tcpresettarget);
+
+    vrmr_vector_cleanup(&ruleset->filter_accounting);
     vrmr_list_cleanup(&accounting_chain_names);
 
-    vrmr_list_cleanup(&ruleset->tc_rules);
+    vrmr_vector_cleanup(&ruleset->tc_rules);
 
     /* clear all memory */
     memset(ruleset, 0, sizeof(struct rule_set));
@@ -254,8 +341,8 @@ static int ruleset_check_accounting(char *chain)
          0: ok
         -1: error
 */
-int ruleset_add_rule_to_set(struct vrmr_list *list, char *chain, char *rule,
-        uint64_t packets, uint64_t bytes)
+int ruleset_add_rule_to_set(struct vrmr_vector *list, char *chain,
+        const char *rule, uint64_t packets, uint64_t bytes)
 {
     size_t size = 0, numbers_size = 0;
     char *line = NULL, numbers[32] = "";
@@ -300,7 +387,7 @@ int ruleset_add_rule_to_set(struct vrmr_list *list, char *chain, char *rule,
     }
 
     /* append to the list */
-    if (vrmr_list_append(list, line) == NULL) {
+    if (vrmr_vector_append(list, line) < 0) {
         vrmr_error(-1, "Internal Error", "appending rule to list failed");
         free(line);
         return (-1);
@@ -321,14 +408,13 @@ static int ruleset_writeprint(const int fd, const char *line)
 /* Create the shaping script file */
 static int ruleset_fill_shaping_file(struct rule_set *ruleset, int fd)
 {
-    struct vrmr_list_node *d_node = NULL;
     char *ptr = NULL;
     char cmd[VRMR_MAX_PIPE_COMMAND] = "";
 
     ruleset_writeprint(fd, "#!/bin/bash\n");
 
-    for (d_node = ruleset->tc_rules.top; d_node; d_node = d_node->next) {
-        ptr = d_node->data;
+    for (unsigned int i = 0; i < ruleset->tc_rules.len; i++) {
+        ptr = ruleset->tc_rules.data[i];
 
         snprintf(cmd, sizeof(cmd), "%s\n", ptr);
         ruleset_writeprint(fd, cmd);
@@ -382,9 +468,8 @@ static int ruleset_fill_file(struct vrmr_ctx *vctx, struct rule_set *ruleset,
         ruleset_writeprint(ruleset_fd, cmd);
 
         /* PREROUTING */
-        for (d_node = ruleset->raw_preroute.top; d_node;
-                d_node = d_node->next) {
-            if (!(rule = d_node->data)) {
+        for (unsigned int i = 0; i < ruleset->raw_preroute.len; i++) {
+            if (!(rule = ruleset->raw_preroute.data[i])) {
                 vrmr_error(-1, "Internal Error", "NULL pointer");
                 return (-1);
             }
@@ -393,8 +478,8 @@ static int ruleset_fill_file(struct vrmr_ctx *vctx, struct rule_set *ruleset,
             ruleset_writeprint(ruleset_fd, cmd);
         }
         /* OUTPUT */
-        for (d_node = ruleset->raw_output.top; d_node; d_node = d_node->next) {
-            if (!(rule = d_node->data)) {
+        for (unsigned int i = 0; i < ruleset->raw_output.len; i++) {
+            if (!(rule = ruleset->raw_output.data[i])) {
                 vrmr_error(-1, "Internal Error", "NULL pointer");
                 return (-1);
             }
@@ -515,9 +600,8 @@ static int ruleset_fill_file(struct vrmr_ctx *vctx, struct rule_set *ruleset,
         }
 
         /* prerouting */
-        for (d_node = ruleset->mangle_preroute.top; d_node;
-                d_node = d_node->next) {
-            if (!(rule = d_node->data)) {
+        for (unsigned int i = 0; i < ruleset->mangle_preroute.len; i++) {
+            if (!(rule = ruleset->mangle_preroute.data[i])) {
                 vrmr_error(-1, "Internal Error", "NULL pointer");
                 return (-1);
             }
@@ -526,9 +610,8 @@ static int ruleset_fill_file(struct vrmr_ctx *vctx, struct rule_set *ruleset,
             ruleset_writeprint(ruleset_fd, cmd);
         }
         /* input */
-        for (d_node = ruleset->mangle_input.top; d_node;
-                d_node = d_node->next) {
-            if (!(rule = d_node->data)) {
+        for (unsigned int i = 0; i < ruleset->mangle_input.len; i++) {
+            if (!(rule = ruleset->mangle_input.data[i])) {
                 vrmr_error(-1, "Internal Error", "NULL pointer");
                 return (-1);
             }
@@ -537,9 +620,8 @@ static int ruleset_fill_file(struct vrmr_ctx *vctx, struct rule_set *ruleset,
             ruleset_writeprint(ruleset_fd, cmd);
         }
         /* forward */
-        for (d_node = ruleset->mangle_forward.top; d_node;
-                d_node = d_node->next) {
-            if (!(rule = d_node->data)) {
+        for (unsigned int i = 0; i < ruleset->mangle_forward.len; i++) {
+            if (!(rule = ruleset->mangle_forward.data[i])) {
                 vrmr_error(-1, "Internal Error", "NULL pointer");
                 return (-1);
             }
@@ -548,9 +630,8 @@ static int ruleset_fill_file(struct vrmr_ctx *vctx, struct rule_set *ruleset,
             ruleset_writeprint(ruleset_fd, cmd);
         }
         /* output */
-        for (d_node = ruleset->mangle_output.top; d_node;
-                d_node = d_node->next) {
-            if (!(rule = d_node->data)) {
+        for (unsigned int i = 0; i < ruleset->mangle_output.len; i++) {
+            if (!(rule = ruleset->mangle_output.data[i])) {
                 vrmr_error(-1, "Internal Error", "NULL pointer");
                 return (-1);
             }
@@ -559,9 +640,8 @@ static int ruleset_fill_file(struct vrmr_ctx *vctx, struct rule_set *ruleset,
             ruleset_writeprint(ruleset_fd, cmd);
         }
         /* postrouting */
-        for (d_node = ruleset->mangle_postroute.top; d_node;
-                d_node = d_node->next) {
-            if (!(rule = d_node->data)) {
+        for (unsigned int i = 0; i < ruleset->mangle_postroute.len; i++) {
+            if (!(rule = ruleset->mangle_postroute.data[i])) {
                 vrmr_error(-1, "Internal Error", "NULL pointer");
                 return (-1);
             }
@@ -572,9 +652,8 @@ static int ruleset_fill_file(struct vrmr_ctx *vctx, struct rule_set *ruleset,
 
         if (ipver == VRMR_IPV4) {
             /* shape in */
-            for (d_node = ruleset->mangle_shape_in.top; d_node;
-                    d_node = d_node->next) {
-                if (!(rule = d_node->data)) {
+            for (unsigned int i = 0; i < ruleset->mangle_shape_in.len; i++) {
+                if (!(rule = ruleset->mangle_shape_in.data[i])) {
                     vrmr_error(-1, "Internal Error", "NULL pointer");
                     return (-1);
                 }
@@ -584,9 +663,8 @@ static int ruleset_fill_file(struct vrmr_ctx *vctx, struct rule_set *ruleset,
             }
 
             /* shape out */
-            for (d_node = ruleset->mangle_shape_out.top; d_node;
-                    d_node = d_node->next) {
-                if (!(rule = d_node->data)) {
+            for (unsigned int i = 0; i < ruleset->mangle_shape_out.len; i++) {
+                if (!(rule = ruleset->mangle_shape_out.data[i])) {
                     vrmr_error(-1, "Internal Error", "NULL pointer");
                     return (-1);
                 }
@@ -596,9 +674,8 @@ static int ruleset_fill_file(struct vrmr_ctx *vctx, struct rule_set *ruleset,
             }
 
             /* shape fw */
-            for (d_node = ruleset->mangle_shape_fw.top; d_node;
-                    d_node = d_node->next) {
-                if (!(rule = d_node->data)) {
+            for (unsigned int i = 0; i < ruleset->mangle_shape_fw.len; i++) {
+                if (!(rule = ruleset->mangle_shape_fw.data[i])) {
                     vrmr_error(-1, "Internal Error", "NULL pointer");
                     return (-1);
                 }
@@ -663,9 +740,8 @@ static int ruleset_fill_file(struct vrmr_ctx *vctx, struct rule_set *ruleset,
         ruleset_writeprint(ruleset_fd, cmd);
 
         /* prerouting */
-        for (d_node = ruleset->nat_preroute.top; d_node;
-                d_node = d_node->next) {
-            if (!(rule = d_node->data)) {
+        for (unsigned int i = 0; i < ruleset->nat_preroute.len; i++) {
+            if (!(rule = ruleset->nat_preroute.data[i])) {
                 vrmr_error(-1, "Internal Error", "NULL pointer");
                 return (-1);
             }
@@ -674,8 +750,8 @@ static int ruleset_fill_file(struct vrmr_ctx *vctx, struct rule_set *ruleset,
             ruleset_writeprint(ruleset_fd, cmd);
         }
         /* output */
-        for (d_node = ruleset->nat_output.top; d_node; d_node = d_node->next) {
-            if (!(rule = d_node->data)) {
+        for (unsigned int i = 0; i < ruleset->nat_output.len; i++) {
+            if (!(rule = ruleset->nat_output.data[i])) {
                 vrmr_error(-1, "Internal Error", "NULL pointer");
                 return (-1);
             }
@@ -684,9 +760,8 @@ static int ruleset_fill_file(struct vrmr_ctx *vctx, struct rule_set *ruleset,
             ruleset_writeprint(ruleset_fd, cmd);
         }
         /* postrouting */
-        for (d_node = ruleset->nat_postroute.top; d_node;
-                d_node = d_node->next) {
-            if (!(rule = d_node->data)) {
+        for (unsigned int i = 0; i < ruleset->nat_postroute.len; i++) {
+            if (!(rule = ruleset->nat_postroute.data[i])) {
                 vrmr_error(-1, "Internal Error", "NULL pointer");
                 return (-1);
             }
@@ -906,9 +981,8 @@ static int ruleset_fill_file(struct vrmr_ctx *vctx, struct rule_set *ruleset,
         }
 
         /* input */
-        for (d_node = ruleset->filter_input.top; d_node;
-                d_node = d_node->next) {
-            if (!(rule = d_node->data)) {
+        for (unsigned int i = 0; i < ruleset->filter_input.len; i++) {
+            if (!(rule = ruleset->filter_input.data[i])) {
                 vrmr_error(-1, "Internal Error", "NULL pointer");
                 return (-1);
             }
@@ -917,9 +991,8 @@ static int ruleset_fill_file(struct vrmr_ctx *vctx, struct rule_set *ruleset,
             ruleset_writeprint(ruleset_fd, cmd);
         }
         /* forward */
-        for (d_node = ruleset->filter_forward.top; d_node;
-                d_node = d_node->next) {
-            if (!(rule = d_node->data)) {
+        for (unsigned int i = 0; i < ruleset->filter_forward.len; i++) {
+            if (!(rule = ruleset->filter_forward.data[i])) {
                 vrmr_error(-1, "Internal Error", "NULL pointer");
                 return (-1);
             }
@@ -928,9 +1001,8 @@ static int ruleset_fill_file(struct vrmr_ctx *vctx, struct rule_set *ruleset,
             ruleset_writeprint(ruleset_fd, cmd);
         }
         /* output */
-        for (d_node = ruleset->filter_output.top; d_node;
-                d_node = d_node->next) {
-            if (!(rule = d_node->data)) {
+        for (unsigned int i = 0; i < ruleset->filter_output.len; i++) {
+            if (!(rule = ruleset->filter_output.data[i])) {
                 vrmr_error(-1, "Internal Error", "NULL pointer");
                 return (-1);
             }
@@ -940,9 +1012,8 @@ static int ruleset_fill_file(struct vrmr_ctx *vctx, struct rule_set *ruleset,
         }
 
         /* antispoof */
-        for (d_node = ruleset->filter_antispoof.top; d_node;
-                d_node = d_node->next) {
-            if (!(rule = d_node->data)) {
+        for (unsigned int i = 0; i < ruleset->filter_antispoof.len; i++) {
+            if (!(rule = ruleset->filter_antispoof.data[i])) {
                 vrmr_error(-1, "Internal Error", "NULL pointer");
                 return (-1);
             }
@@ -951,9 +1022,8 @@ static int ruleset_fill_file(struct vrmr_ctx *vctx, struct rule_set *ruleset,
             ruleset_writeprint(ruleset_fd, cmd);
         }
         /* blocklist */
-        for (d_node = ruleset->filter_blocklist.top; d_node;
-                d_node = d_node->next) {
-            if (!(rule = d_node->data)) {
+        for (unsigned int i = 0; i < ruleset->filter_blocklist.len; i++) {
+            if (!(rule = ruleset->filter_blocklist.data[i])) {
                 vrmr_error(-1, "Internal Error", "NULL pointer");
                 return (-1);
             }
@@ -962,9 +1032,8 @@ static int ruleset_fill_file(struct vrmr_ctx *vctx, struct rule_set *ruleset,
             ruleset_writeprint(ruleset_fd, cmd);
         }
         /* block */
-        for (d_node = ruleset->filter_blocktarget.top; d_node;
-                d_node = d_node->next) {
-            if (!(rule = d_node->data)) {
+        for (unsigned int i = 0; i < ruleset->filter_blocktarget.len; i++) {
+            if (!(rule = ruleset->filter_blocktarget.data[i])) {
                 vrmr_error(-1, "Internal Error", "NULL pointer");
                 return (-1);
             }
@@ -973,9 +1042,8 @@ static int ruleset_fill_file(struct vrmr_ctx *vctx, struct rule_set *ruleset,
             ruleset_writeprint(ruleset_fd, cmd);
         }
         /* synlimit */
-        for (d_node = ruleset->filter_synlimittarget.top; d_node;
-                d_node = d_node->next) {
-            if (!(rule = d_node->data)) {
+        for (unsigned int i = 0; i < ruleset->filter_synlimittarget.len; i++) {
+            if (!(rule = ruleset->filter_synlimittarget.data[i])) {
                 vrmr_error(-1, "Internal Error", "NULL pointer");
                 return (-1);
             }
@@ -984,9 +1052,8 @@ static int ruleset_fill_file(struct vrmr_ctx *vctx, struct rule_set *ruleset,
             ruleset_writeprint(ruleset_fd, cmd);
         }
         /* udplimit */
-        for (d_node = ruleset->filter_udplimittarget.top; d_node;
-                d_node = d_node->next) {
-            if (!(rule = d_node->data)) {
+        for (unsigned int i = 0; i < ruleset->filter_udplimittarget.len; i++) {
+            if (!(rule = ruleset->filter_udplimittarget.data[i])) {
                 vrmr_error(-1, "Internal Error", "NULL pointer");
                 return (-1);
             }
@@ -995,9 +1062,8 @@ static int ruleset_fill_file(struct vrmr_ctx *vctx, struct rule_set *ruleset,
             ruleset_writeprint(ruleset_fd, cmd);
         }
         /* newaccept */
-        for (d_node = ruleset->filter_newaccepttarget.top; d_node;
-                d_node = d_node->next) {
-            if (!(rule = d_node->data)) {
+        for (unsigned int i = 0; i < ruleset->filter_newaccepttarget.len; i++) {
+            if (!(rule = ruleset->filter_newaccepttarget.data[i])) {
                 vrmr_error(-1, "Internal Error", "NULL pointer");
                 return (-1);
             }
@@ -1006,9 +1072,9 @@ static int ruleset_fill_file(struct vrmr_ctx *vctx, struct rule_set *ruleset,
             ruleset_writeprint(ruleset_fd, cmd);
         }
         /* newnfqueue */
-        for (d_node = ruleset->filter_newnfqueuetarget.top; d_node;
-                d_node = d_node->next) {
-            if (!(rule = d_node->data)) {
+        for (unsigned int i = 0; i < ruleset->filter_newnfqueuetarget.len;
+                i++) {
+            if (!(rule = ruleset->filter_newnfqueuetarget.data[i])) {
                 vrmr_error(-1, "Internal Error", "NULL pointer");
                 return (-1);
             }
@@ -1017,9 +1083,9 @@ static int ruleset_fill_file(struct vrmr_ctx *vctx, struct rule_set *ruleset,
             ruleset_writeprint(ruleset_fd, cmd);
         }
         /* estrelnfqueue */
-        for (d_node = ruleset->filter_estrelnfqueuetarget.top; d_node;
-                d_node = d_node->next) {
-            if (!(rule = d_node->data)) {
+        for (unsigned int i = 0; i < ruleset->filter_estrelnfqueuetarget.len;
+                i++) {
+            if (!(rule = ruleset->filter_estrelnfqueuetarget.data[i])) {
                 vrmr_error(-1, "Internal Error", "NULL pointer");
                 return (-1);
             }
@@ -1028,9 +1094,8 @@ static int ruleset_fill_file(struct vrmr_ctx *vctx, struct rule_set *ruleset,
             ruleset_writeprint(ruleset_fd, cmd);
         }
         /* newnflog */
-        for (d_node = ruleset->filter_newnflogtarget.top; d_node;
-                d_node = d_node->next) {
-            if (!(rule = d_node->data)) {
+        for (unsigned int i = 0; i < ruleset->filter_newnflogtarget.len; i++) {
+            if (!(rule = ruleset->filter_newnflogtarget.data[i])) {
                 vrmr_error(-1, "Internal Error", "NULL pointer");
                 return (-1);
             }
@@ -1039,9 +1104,9 @@ static int ruleset_fill_file(struct vrmr_ctx *vctx, struct rule_set *ruleset,
             ruleset_writeprint(ruleset_fd, cmd);
         }
         /* estrelnflog */
-        for (d_node = ruleset->filter_estrelnflogtarget.top; d_node;
-                d_node = d_node->next) {
-            if (!(rule = d_node->data)) {
+        for (unsigned int i = 0; i < ruleset->filter_estrelnflogtarget.len;
+                i++) {
+            if (!(rule = ruleset->filter_estrelnflogtarget.data[i])) {
                 vrmr_error(-1, "Internal Error", "NULL pointer");
                 return (-1);
             }
@@ -1051,9 +1116,8 @@ static int ruleset_fill_file(struct vrmr_ctx *vctx, struct rule_set *ruleset,
         }
 
         /* tcpreset */
-        for (d_node = ruleset->filter_tcpresettarget.top; d_node;
-                d_node = d_node->next) {
-            if (!(rule = d_node->data)) {
+        for (unsigned int i = 0; i < ruleset->filter_tcpresettarget.len; i++) {
+            if (!(rule = ruleset->filter_tcpresettarget.data[i])) {
                 vrmr_error(-1, "Internal Error", "NULL pointer");
                 return (-1);
             }
@@ -1063,9 +1127,8 @@ static int ruleset_fill_file(struct vrmr_ctx *vctx, struct rule_set *ruleset,
         }
 
         /* accounting */
-        for (d_node = ruleset->filter_accounting.top; d_node;
-                d_node = d_node->next) {
-            if (!(rule = d_node->data)) {
+        for (unsigned int i = 0; i < ruleset->filter_accounting.len; i++) {
+            if (!(rule = ruleset->filter_accounting.data[i])) {
                 vrmr_error(-1, "Internal Error", "NULL pointer");
                 return (-1);
             }
@@ -1291,15 +1354,22 @@ static int ruleset_save_interface_counters(
 {
     struct vrmr_list_node *d_node = NULL;
     struct vrmr_interface *iface_ptr = NULL;
-    uint64_t tmp = 0;
-    char acc_chain[32] = "";
+    struct vrmr_counters counters;
 
     assert(interfaces);
 
+    /* get the counters of all interfaces in one go */
+    vrmr_counters_setup(&counters);
+    if (vrmr_counters_update_ipt(cfg, &counters, true) < 0) {
+        vrmr_counters_cleanup(&counters);
+        return (-1);
+    }
+
     /* loop through the interfaces */
     for (d_node = interfaces->list.top; d_node; d_node = d_node->next) {
         if (!(iface_ptr = d_node->data)) {
             vrmr_error(-1, "Internal Error", "NULL pointer");
+            vrmr_counters_cleanup(&counters);
             return (-1);
         }
 
@@ -1311,54 +1381,28 @@ static int ruleset_save_interface_counters(
                               sizeof(struct vrmr_interface_counters)))) {
                     vrmr_error(
                             -1, "Error", "malloc failed: %s", strerror(errno));
+                    vrmr_counters_cleanup(&counters);
                     return (-1);
                 }
             }
             memset(iface_ptr->cnt, 0, sizeof(struct vrmr_interface_counters));
 
-            /* get the real counters from iptables */
-            vrmr_get_iface_stats_from_ipt(cfg, iface_ptr->device, "INPUT",
-                    &iface_ptr->cnt->input_packets,
-                    &iface_ptr->cnt->input_bytes, &tmp, &tmp);
-            vrmr_get_iface_stats_from_ipt(cfg, iface_ptr->device, "OUTPUT",
-                    &tmp, &tmp, &iface_ptr->cnt->output_packets,
-                    &iface_ptr->cnt->output_bytes);
-            vrmr_get_iface_stats_from_ipt(cfg, iface_ptr->device, "FORWARD",
-                    &iface_ptr->cnt->forwardin_packets,
-                    &iface_ptr->cnt->forwardin_bytes,
-                    &iface_ptr->cnt->forwardout_packets,
-                    &iface_ptr->cnt->forwardout_bytes);
+            struct vrmr_counters_iface *entry =
+                    vrmr_counters_get(&counters, iface_ptr->device);
+            if (entry != NULL)
+                *iface_ptr->cnt = entry->ipt;
 
             vrmr_debug(HIGH,
-                    "iface_ptr->cnt->input_packets: %" PRIu64 ", "
-                    "iface_ptr->cnt->input_bytes: %" PRIu64 ".",
-                    iface_ptr->cnt->input_packets, iface_ptr->cnt->input_bytes);
-            vrmr_debug(HIGH,
-                    "iface_ptr->cnt->output_packets: %" PRIu64 ", "
-                    "iface_ptr->cnt->output_bytes: %" PRIu64 ".",
-                    iface_ptr->cnt->output_packets,
-                    iface_ptr->cnt->output_bytes);
-
-            /* assemble the chain-name */
-            snprintf(acc_chain, sizeof(acc_chain), "ACC-%s", iface_ptr->device);
-
-            vrmr_debug(HIGH, "acc_chain '%s'.", acc_chain);
-
-            /* get the accounting chains numbers */
-            vrmr_get_iface_stats_from_ipt(cfg, iface_ptr->device, acc_chain,
-                    &iface_ptr->cnt->acc_in_packets,
-                    &iface_ptr->cnt->acc_in_bytes,
-                    &iface_ptr->cnt->acc_out_packets,
-                    &iface_ptr->cnt->acc_out_bytes);
-
-            vrmr_debug(HIGH,
-                    "iface_ptr->cnt->acc_in_bytes: %" PRIu64 ", "
-                    "iface_ptr->cnt->acc_out_bytes: %" PRIu64 ".",
-                    iface_ptr->cnt->acc_in_bytes,
+                    "%s: input %" PRIu64 "/%" PRIu64 ", output %" PRIu64
+                    "/%" PRIu64 ", acc in %" PRIu64 ", acc out %" PRIu64 ".",
+                    iface_ptr->device, iface_ptr->cnt->input_packets,
+                    iface_ptr->cnt->input_bytes, iface_ptr->cnt->output_packets,
+                    iface_ptr->cnt->output_bytes, iface_ptr->cnt->acc_in_bytes,
                     iface_ptr->cnt->acc_out_bytes);
         }
     }
 
+    vrmr_counters_cleanup(&counters);
     return (0);
 }
 
@@ -1507,6 +1551,8 @@ static int load_ruleset_ipv4(struct vrmr_ctx *vctx)
         return (-1);
     }
 
+    ruleset_count_rules(&ruleset);
+
     /* clear the counters again */
     if (ruleset_clear_interface_counters(&vctx->interfaces) < 0) {
         vrmr_error(-1, "Error", "clearing interface counters failed");
@@ -1555,6 +1601,7 @@ static int load_ruleset_ipv4(struct vrmr_ctx *vctx)
     }
     /* cleanup */
     vrmr_list_cleanup(&vctx->rules.custom_chain_list);
+    vrmr_control_progress(&control, 83, "generate_ipv4");
 
     /* now create the shape file */
     if (ruleset_fill_shaping_file(&ruleset, shape_fd) < 0) {
@@ -1585,6 +1632,8 @@ static int load_ruleset_ipv4(struct vrmr_ctx *vctx)
         ruleset_cleanup(&ruleset);
         return (-1);
     }
+    vrmr_control_progress(&control, 85, "shaping");
+
     /* now load the iptables ruleset */
     if (ruleset_load_ruleset(cur_ruleset_path, cur_result_path, &vctx->conf,
                 VRMR_IPV4) != 0) {
@@ -1598,6 +1647,7 @@ static int load_ruleset_ipv4(struct vrmr_ctx *vctx)
         return (-1);
     }
     load_ruleset_free_fds(ruleset_fd, result_fd, shape_fd);
+    vrmr_control_progress(&control, 87, "restore_ipv4");
 
     if (cmdline.keep_file == FALSE) {
         /* remove the rules tempfile */
@@ -1669,6 +1719,8 @@ static int load_ruleset_ipv6(struct vrmr_ctx *vctx)
         return (-1);
     }
 
+    ruleset_count_rules(&ruleset);
+
     /* clear the counters again */
     if (ruleset_clear_interface_counters(&vctx->interfaces) < 0) {
         vrmr_error(-1, "Error", "clearing interface counters failed");
@@ -1708,6 +1760,7 @@ static int load_ruleset_ipv6(struct vrmr_ctx *vctx)
     }
     /* cleanup */
     vrmr_list_cleanup(&vctx->rules.custom_chain_list);
+    vrmr_control_progress(&control, 88, "generate_ipv6");
 
     if (vrmr_debug_level >= HIGH) {
         vrmr_debug(HIGH, "sleeping so you can look into the tmpfile.");
@@ -1727,6 +1780,7 @@ static int load_ruleset_ipv6(struct vrmr_ctx *vctx)
         return (-1);
     }
     load_ruleset_free_fds(ruleset_fd, result_fd, 0);
+    vrmr_control_progress(&control, 90, "restore_ipv6");
 
     if (cmdline.keep_file == FALSE) {
         /* remove the rules tempfile */
@@ -1756,6 +1810,8 @@ static int load_ruleset_ipv6(struct vrmr_ctx *vctx)
 
 int load_ruleset(struct vrmr_ctx *vctx)
 {
+    rules_output_begin(vctx);
+
     int r = load_ruleset_ipv4(vctx);
     if (r == -1) {
         return (-1);
@@ -1769,5 +1825,6 @@ int load_ruleset(struct vrmr_ctx *vctx)
     }
 #endif
 
+    rules_output_end();
     return (0);
 }
@@ -135,7 +135,7 @@ static int shaping_process_rule(
             return (-1);
         }
 
-        if (vrmr_list_append(&ruleset->tc_rules, buf) == NULL) {
+        if (vrmr_vector_append(&ruleset->tc_rules, buf) < 0) {
             vrmr_error(-1, "Internal Error", "appending rule to list failed");
             free(buf);
             return (-1);
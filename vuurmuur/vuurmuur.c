@@ -23,61 +23,406 @@
 char version_string[128];
 struct cmd_line cmdline;
 
-struct vrmr_shm_table *shm_table = NULL;
-int sem_id;
+struct vrmr_control control;
 
 static void print_help(void);
 
+/** \brief UP all interfaces in bash mode */
+static void bash_enable_interfaces(struct vrmr_interfaces *ifaces)
+{
+    struct vrmr_list_node *node;
+    struct vrmr_interface *iface_ptr = NULL;
+
+    for (node = ifaces->list.top; node != NULL; node = node->next) {
+        iface_ptr = (struct vrmr_interface *)node->data;
+        if (iface_ptr->up == FALSE)
+            iface_ptr->up = TRUE;
+    }
+}
+
 /*
-    we put this here, because we only use it here in main.
+    The daemon loop
+
+    The loop sleeps in epoll_wait until something happens: a signal, a
+    config tool on the control socket, an address change on an interface
+    or one of the timers.
+*/
+enum loop_event {
+    LOOP_EV_SIGNAL = 0,
+    LOOP_EV_CONTROL,
+    LOOP_EV_NETLINK,
+    LOOP_EV_DYNAMIC,
+    LOOP_EV_TRAFVOL,
+};
+
+struct loop {
+    int epfd;
+    int sigfd;
+    int nlfd;        /* address notifications, for dynamic interfaces */
+    int dynamic_tfd; /* timer for the dynamic interfaces without nlfd */
+    int trafvol_tfd;
+
+    /* signals read from sigfd */
+    bool sigint;
+    bool sigterm;
+    bool sighup;
+};
+
+/*  loop_block_signals
+
+    Blocks the signals the loop reads from its signalfd. This is done at
+    startup already, so a signal that arrives before the loop runs waits
+    for it instead of killing us.
 */
-static int sigint_count = 0;
-static int sighup_count = 0;
-static int sigterm_count = 0;
+static int loop_block_signals(sigset_t *sigmask)
+{
+    sigemptyset(sigmask);
+    sigaddset(sigmask, SIGINT);
+    sigaddset(sigmask, SIGTERM);
+    sigaddset(sigmask, SIGHUP);
+    return (sigprocmask(SIG_BLOCK, sigmask, NULL));
+}
 
-static void handle_sigint(/*@unused@*/ int sig ATTR_UNUSED)
+static int loop_add(struct loop *loop, int fd, enum loop_event ev)
 {
-    sigint_count = 1;
+    struct epoll_event event;
+
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.u32 = ev;
+    if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        vrmr_error(-1, "Error", "epoll_ctl failed: %s", strerror(errno));
+        return (-1);
+    }
+    return (0);
 }
-static void handle_sigterm(/*@unused@*/ int sig ATTR_UNUSED)
+
+/* periodic timer, first expiring after 'first' seconds (0: right away) */
+static int loop_timer(unsigned int first, unsigned int interval)
 {
-    sigterm_count = 1;
+    struct itimerspec its;
+
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0) {
+        vrmr_error(-1, "Error", "timerfd_create failed: %s", strerror(errno));
+        return (-1);
+    }
+
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = first;
+    if (first == 0)
+        its.it_value.tv_nsec = 1;
+    its.it_interval.tv_sec = interval;
+    if (timerfd_settime(fd, 0, &its, NULL) < 0) {
+        vrmr_error(-1, "Error", "timerfd_settime failed: %s", strerror(errno));
+        close(fd);
+        return (-1);
+    }
+    return (fd);
 }
-static void handle_sighup(/*@unused@*/ int sig ATTR_UNUSED)
+
+static void loop_read_timer(int fd)
 {
-    sighup_count = 1;
+    uint64_t expirations;
+
+    (void)read(fd, &expirations, sizeof(expirations));
 }
 
-static void setup_signal_handler(int sig, void (*handler)(int))
+/* subscribe to the address and link changes of the interfaces */
+static int loop_netlink_open(void)
 {
-    struct sigaction action;
+    struct sockaddr_nl addr;
 
-    action.sa_handler = handler;
-    sigemptyset(&(action.sa_mask));
-    sigaddset(&(action.sa_mask), sig);
-    action.sa_flags = 0;
-    sigaction(sig, &action, 0);
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC,
+            NETLINK_ROUTE);
+    if (fd < 0) {
+        vrmr_debug(LOW, "netlink socket failed: %s", strerror(errno));
+        return (-1);
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        vrmr_debug(LOW, "netlink bind failed: %s", strerror(errno));
+        close(fd);
+        return (-1);
+    }
+    return (fd);
 }
 
-/** \brief UP all interfaces in bash mode */
-static void bash_enable_interfaces(struct vrmr_interfaces *ifaces)
+/* the devices of the notifications, if there are more they are all
+ * checked */
+#define LOOP_NETLINK_DEVICES 8
+
+struct loop_devices {
+    char name[LOOP_NETLINK_DEVICES][IFNAMSIZ];
+    unsigned int len;
+    bool all;
+};
+
+static void loop_devices_add(struct loop_devices *devs, const char *name)
 {
-    struct vrmr_list_node *node;
-    struct vrmr_interface *iface_ptr = NULL;
+    if (devs->all)
+        return;
+    if (name == NULL || name[0] == '\0' || devs->len == LOOP_NETLINK_DEVICES) {
+        devs->all = true;
+        return;
+    }
+    for (unsigned int i = 0; i < devs->len; i++) {
+        if (strcmp(devs->name[i], name) == 0)
+            return;
+    }
+    (void)strlcpy(devs->name[devs->len++], name, IFNAMSIZ);
+}
 
-    for (node = ifaces->list.top; node != NULL; node = node->next) {
-        iface_ptr = (struct vrmr_interface *)node->data;
-        if (iface_ptr->up == FALSE)
-            iface_ptr->up = TRUE;
+/* name of the device of a RTM_NEWLINK or RTM_DELLINK message. After a
+ * RTM_DELLINK the index can no longer be resolved. */
+static const char *loop_netlink_link_name(struct nlmsghdr *nlh)
+{
+    struct ifinfomsg *ifi = NLMSG_DATA(nlh);
+    int len = (int)IFLA_PAYLOAD(nlh);
+
+    for (struct rtattr *rta = IFLA_RTA(ifi); RTA_OK(rta, len);
+            rta = RTA_NEXT(rta, len)) {
+        if (rta->rta_type == IFLA_IFNAME)
+            return (RTA_DATA(rta));
+    }
+    return (NULL);
+}
+
+/*  loop_netlink_read
+
+    Reads the address and link notifications and collects the devices they
+    are about in 'devs', so only the dynamic interfaces on those devices have
+    to be checked.
+*/
+static void loop_netlink_read(int fd, struct loop_devices *devs)
+{
+    char buf[8192] __attribute__((aligned(NLMSG_ALIGNTO)));
+    char name[IFNAMSIZ];
+    ssize_t len;
+
+    while ((len = recv(fd, buf, sizeof(buf), 0)) != 0) {
+        if (len < 0) {
+            /* we missed notifications */
+            if (errno == ENOBUFS)
+                devs->all = true;
+            break;
+        }
+
+        for (struct nlmsghdr *nlh = (struct nlmsghdr *)buf;
+                NLMSG_OK(nlh, (unsigned int)len);
+                nlh = NLMSG_NEXT(nlh, len)) {
+            switch (nlh->nlmsg_type) {
+                case RTM_NEWADDR:
+                case RTM_DELADDR: {
+                    struct ifaddrmsg *ifa = NLMSG_DATA(nlh);
+                    loop_devices_add(
+                            devs, if_indextoname(ifa->ifa_index, name));
+                    break;
+                }
+                case RTM_NEWLINK:
+                case RTM_DELLINK:
+                    loop_devices_add(devs, loop_netlink_link_name(nlh));
+                    break;
+            }
+        }
+    }
+}
+
+/*  loop_setup_dynamic
+
+    Watch the addresses if there are dynamic interfaces to check. Uses the
+    address notifications of the kernel, or if they are not available, a
+    timer of DYNAMIC_CHANGES_INTERVAL. Called again after each reload, as
+    the interfaces may have changed.
+*/
+static void loop_setup_dynamic(struct loop *loop, struct vrmr_ctx *vctx)
+{
+    const bool needed = (vctx->conf.dynamic_changes_check == TRUE &&
+                         vctx->interfaces.dynamic_interfaces == TRUE);
+
+    if (!needed) {
+        if (loop->nlfd >= 0) {
+            close(loop->nlfd);
+            loop->nlfd = -1;
+        }
+        if (loop->dynamic_tfd >= 0) {
+            close(loop->dynamic_tfd);
+            loop->dynamic_tfd = -1;
+        }
+        return;
+    }
+    if (loop->nlfd >= 0 || loop->dynamic_tfd >= 0)
+        return;
+
+    loop->nlfd = loop_netlink_open();
+    if (loop->nlfd >= 0 && loop_add(loop, loop->nlfd, LOOP_EV_NETLINK) == 0) {
+        vrmr_debug(LOW, "watching address changes using netlink.");
+        return;
+    }
+    if (loop->nlfd >= 0) {
+        close(loop->nlfd);
+        loop->nlfd = -1;
+    }
+
+    const unsigned int interval = vctx->conf.dynamic_changes_interval > 0
+                                          ? vctx->conf.dynamic_changes_interval
+                                          : 1;
+    loop->dynamic_tfd = loop_timer(interval, interval);
+    if (loop->dynamic_tfd >= 0 &&
+            loop_add(loop, loop->dynamic_tfd, LOOP_EV_DYNAMIC) < 0) {
+        close(loop->dynamic_tfd);
+        loop->dynamic_tfd = -1;
+    }
+}
+
+/* commands on the control socket next to reload: block and unblock, so
+ * e.g. an IDS can block an address without waiting for a full reload */
+static int loop_command(void *ctx, const char *user, const char *cmd,
+        const char *args, char *err, size_t size)
+{
+    struct vrmr_ctx *vctx = ctx;
+    int r;
+
+    if (strcmp(cmd, "block") != 0 && strcmp(cmd, "unblock") != 0)
+        return (0);
+
+    if (args == NULL || args[0] == '\0') {
+        snprintf(err, size, "usage: %s <ipaddress|host|group>", cmd);
+        return (-1);
+    }
+
+    if (strcmp(cmd, "block") == 0)
+        r = blocklist_block(vctx, args, err, size);
+    else
+        r = blocklist_unblock(vctx, args, err, size);
+    if (r < 0) {
+        vrmr_warning("Warning", "%s '%s' failed: %s", cmd, args, err);
+        return (-1);
+    }
+
+    vrmr_audit("IPC: %s '%s' (user: %s).", cmd, args, user);
+    return (1);
+}
+
+static int loop_setup(struct loop *loop, struct vrmr_ctx *vctx)
+{
+    sigset_t sigmask;
+
+    memset(loop, 0, sizeof(*loop));
+    loop->sigfd = loop->nlfd = -1;
+    loop->dynamic_tfd = loop->trafvol_tfd = -1;
+
+    loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epfd < 0) {
+        vrmr_error(-1, "Error", "epoll_create1 failed: %s", strerror(errno));
+        return (-1);
+    }
+
+    /* the signals are read from the signalfd */
+    if (loop_block_signals(&sigmask) < 0 ||
+            (loop->sigfd = signalfd(-1, &sigmask,
+                     SFD_NONBLOCK | SFD_CLOEXEC)) < 0) {
+        vrmr_error(-1, "Error", "setting up the signalfd failed: %s",
+                strerror(errno));
+        return (-1);
+    }
+    if (loop_add(loop, loop->sigfd, LOOP_EV_SIGNAL) < 0)
+        return (-1);
+
+    /* the config tools request reloads through the control socket */
+    if (vrmr_control_listen(&control, VRMR_CONTROL_VUURMUUR) < 0 ||
+            loop_add(loop, vrmr_control_fd(&control), LOOP_EV_CONTROL) < 0) {
+        vrmr_error(-1, "Error", "setting up the control socket failed.");
+        return (-1);
+    }
+    control.command = loop_command;
+    control.command_ctx = vctx;
+    control.debounce_ms = vctx->conf.reload_debounce;
+
+    /* sample the traffic volume as soon as we enter the loop */
+    loop->trafvol_tfd = loop_timer(0, VRMR_TRAFVOL_INTERVAL);
+    if (loop->trafvol_tfd < 0 ||
+            loop_add(loop, loop->trafvol_tfd, LOOP_EV_TRAFVOL) < 0)
+        return (-1);
+
+    loop_setup_dynamic(loop, vctx);
+    return (0);
+}
+
+static void loop_cleanup(struct loop *loop)
+{
+    int *fds[] = {&loop->sigfd, &loop->nlfd, &loop->dynamic_tfd,
+            &loop->trafvol_tfd, &loop->epfd};
+
+    for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++) {
+        if (*fds[i] >= 0)
+            close(*fds[i]);
+        *fds[i] = -1;
+    }
+    vrmr_control_close(&control);
+}
+
+static void loop_read_signals(struct loop *loop)
+{
+    struct signalfd_siginfo si;
+
+    while (read(loop->sigfd, &si, sizeof(si)) == (ssize_t)sizeof(si)) {
+        if (si.ssi_signo == SIGHUP)
+            loop->sighup = true;
+        else if (si.ssi_signo == SIGINT)
+            loop->sigint = true;
+        else if (si.ssi_signo == SIGTERM)
+            loop->sigterm = true;
     }
 }
 
+/* what the config tools see with the 'status' command */
+static void loop_set_info(struct vrmr_ctx *vctx)
+{
+    vrmr_control_set_info(&control, "rules", "%u", vctx->rules.list.len);
+    vrmr_control_set_info(&control, "zones", "%u", vctx->zones.list.len);
+    vrmr_control_set_info(&control, "services", "%u", vctx->services.list.len);
+    vrmr_control_set_info(
+            &control, "interfaces", "%u", vctx->interfaces.list.len);
+}
+
+/* reload timing and the size of the ruleset, for prometheus */
+static void loop_write_metrics(struct vrmr_ctx *vctx)
+{
+    struct vrmr_metrics m;
+
+    if (!vctx->conf.metrics)
+        return;
+
+    if (vrmr_metrics_open(&m, VRMR_METRICS_LOCATION, "vuurmuur") < 0)
+        return;
+
+    vrmr_metrics_control(&m, "vuurmuur", &control);
+    ruleset_metrics(&m);
+    vrmr_metrics_u64(&m, "vuurmuur_objects", "gauge",
+            "Objects in the configuration.", "type=\"rules\"",
+            vctx->rules.list.len);
+    vrmr_metrics_u64(&m, "vuurmuur_objects", "gauge",
+            "Objects in the configuration.", "type=\"zones\"",
+            vctx->zones.list.len);
+    vrmr_metrics_u64(&m, "vuurmuur_objects", "gauge",
+            "Objects in the configuration.", "type=\"services\"",
+            vctx->services.list.len);
+    vrmr_metrics_u64(&m, "vuurmuur_objects", "gauge",
+            "Objects in the configuration.", "type=\"interfaces\"",
+            vctx->interfaces.list.len);
+    (void)vrmr_metrics_close(&m);
+}
+
 int main(int argc, char *argv[])
 {
     struct vrmr_ctx vctx;
 
     pid_t pid;
-    char reload_shm = FALSE, reload_dyn = FALSE;
+    char reload_dyn = FALSE;
 
     /* clear vuurmur/all the iptables rules? */
     char clear_vuurmuur_rules = FALSE;
@@ -85,10 +430,9 @@ int main(int argc, char *argv[])
 
     int retval = 0, optch, result = 0, debug_level = 0;
 
-    unsigned int dynamic_wait_time =
-            0;                  /* for checking the dynamic ipaddresses */
-    unsigned int wait_time = 0; /* time in seconds we have waited for an
-                                   VRMR_RR_RESULT_ACK when using SHM-IPC */
+    struct loop loop;
+    sigset_t sigmask;
+    struct vrmr_counters trafvol_counters;
     static char optstring[] = "hd:bVlvnc:L:CFDtkfKX";
     struct option prog_opts[] = {
             {"help", no_argument, NULL, 'h'},
@@ -108,10 +452,6 @@ int main(int argc, char *argv[])
             {0, 0, 0, 0},
     };
     int option_index = 0;
-    int shm_id;
-    char *shmp;
-    union semun semarg;
-    ushort seminit[] = {1, 0};
 
     snprintf(version_string, sizeof(version_string),
             "%s (using libvuurmuur %s)", VUURMUUR_VERSION,
@@ -119,13 +459,13 @@ int main(int argc, char *argv[])
 
     vrmr_init(&vctx, "vuurmuur");
 
-    /* registering signals we use */
-    setup_signal_handler(SIGINT, handle_sigint);
-    setup_signal_handler(SIGTERM, handle_sigterm);
-    setup_signal_handler(SIGHUP, handle_sighup);
+    /* the signals we use are handled by the loop */
+    if (loop_block_signals(&sigmask) < 0) {
+        vrmr_error(-1, "Error", "blocking the signals failed: %s",
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
 
-    shm_table = NULL;
-    sem_id = 0;
     memset(&cmdline, 0, sizeof(cmdline));
 
     /*  close the STDERR_FILENO because it gives us annoying "Broken
@@ -491,216 +831,132 @@ int main(int argc, char *argv[])
                             getpid());
             }
 
-            shm_id = shmget(IPC_PRIVATE, sizeof(*shm_table), 0600);
-            if (shm_id < 0) {
-                vrmr_error(-1, "Error", "unable to create shared memory: %s.",
-                        strerror(errno));
+            /* create a pidfile */
+            result = vrmr_create_pidfile(PIDFILE);
+            if (result < 0) {
+                vrmr_error(-1, "Error", "Unable to create pidfile.");
+                /* TODO: is this really that serious? */
                 exit(EXIT_FAILURE);
             }
-            /* for some reason on my machine the shm_id is zero when vuurmuur is
-               started at boot if we sleep for some time and retry it works */
-            else if (shm_id == 0) {
-                /* sleep 3 seconds before trying again */
-                (void)sleep(3);
-
-                shm_id = shmget(IPC_PRIVATE, sizeof(*shm_table), 0600);
-                if (shm_id < 0) {
-                    vrmr_error(-1, "Error",
-                            "Unable to create shared memory: %s (retry).",
-                            strerror(errno));
-                    exit(EXIT_FAILURE);
-                } else if (shm_id == 0) {
-                    vrmr_info("Info", "Still no valid shm_id. Giving up.");
-                } else {
-                    vrmr_info("Info",
-                            "Creating shared memory successfull: shm_id: %d "
-                            "(retry).",
-                            shm_id);
-                }
-            } else {
-                vrmr_info("Info",
-                        "Creating shared memory successfull: shm_id: %d.",
-                        shm_id);
-            }
 
-            /* now attach to the shared mem */
-            if (shm_id > 0) {
-                shmp = shmat(shm_id, 0, 0);
-                if (shmp == (char *)(-1)) {
-                    vrmr_error(-1, "Error",
-                            "unable to attach to shared memory: %s.",
-                            strerror(errno));
-                    exit(EXIT_FAILURE);
-                } else {
-                    shm_table = (struct vrmr_shm_table *)shmp;
-                    vrmr_info(
-                            "Info", "Attaching to shared memory successfull.");
-                }
+            vrmr_counters_setup(&trafvol_counters);
 
-                /* if all went well we create a semaphore */
-                if (shm_table != NULL) {
-                    sem_id = semget(IPC_PRIVATE, 2, 0600);
-                    if (sem_id == -1) {
-                        vrmr_error(-1, "Error",
-                                "Unable to create semaphore: %s.",
-                                strerror(errno));
-                        exit(EXIT_FAILURE);
-                    } else {
-                        vrmr_info("Info", "Creating a semaphore success: %d",
-                                sem_id);
-                    }
+            if (loop_setup(&loop, &vctx) < 0) {
+                vrmr_error(-1, "Error", "setting up the loop failed.");
+                exit(EXIT_FAILURE);
+            }
 
-                    semarg.array = seminit;
-                    if (semctl(sem_id, 0, SETALL, semarg) == -1) {
-                        vrmr_error(-1, "Error",
-                                "Unable to initialize semaphore: %s.",
-                                strerror(errno));
-                        exit(EXIT_FAILURE);
-                    } else {
-                        vrmr_info("Info",
-                                "Initializeing the semaphore successfull.");
-                    }
+            vrmr_info("Info", "Entering the loop...");
+            loop_set_info(&vctx);
+            loop_write_metrics(&vctx);
 
-                    /* now initialize the shared mem */
-                    if (vrmr_lock(sem_id)) {
-                        shm_table->sem_id = sem_id;
-                        shm_table->backend_changed = 0;
-                        shm_table->reload_result = VRMR_RR_READY;
+            while (retval == 0 && !loop.sigint && !loop.sigterm) {
+                struct epoll_event events[8];
+                struct loop_devices dyn_devs = {.len = 0, .all = false};
 
-                        vrmr_unlock(sem_id);
-                    }
+                if (loop.sighup) {
+                    (void)vrmr_control_reload_request(
+                            &control, VRMR_RQ_SIGNAL, "SIGHUP");
+                    loop.sighup = false;
                 }
-            }
-
-            /* create a pidfile */
-            result = vrmr_create_pidfile(PIDFILE, shm_id);
-            if (result < 0) {
-                vrmr_error(-1, "Error", "Unable to create pidfile.");
-                /* TODO: is this really that serious? */
-                exit(EXIT_FAILURE);
-            }
 
-            vrmr_info("Info", "Entering the loop... (interval %d seconds)",
-                    LOOP_INT);
-
-            while (retval == 0 && sigint_count == 0 && sigterm_count == 0) {
-                if (vrmr_lock(sem_id)) {
-                    if (shm_table->configtool.connected == 1) {
-                        vrmr_info("Info", "Configtool connected: %s.",
-                                shm_table->configtool.name);
-                        shm_table->configtool.connected = 2;
-                    } else if (shm_table->configtool.connected == 3) {
-                        vrmr_info("Info", "Configtool disconnected: %s.",
-                                shm_table->configtool.name);
-                        shm_table->configtool.connected = 0;
+                /* wait for events, or until the pending reload is due */
+                int timeout = vrmr_control_reload_timeout(&control);
+                if (timeout != 0) {
+                    int n = epoll_wait(loop.epfd, events, 8, timeout);
+                    if (n < 0 && errno != EINTR) {
+                        vrmr_error(-1, "Error", "epoll_wait failed: %s",
+                                strerror(errno));
+                        retval = -1;
+                        break;
                     }
 
-                    if (shm_table->backend_changed == TRUE) {
-                        vrmr_audit(
-                                "IPC-SHM: backend changed: reload (user: %s).",
-                                shm_table->configtool.username);
-                        reload_shm = TRUE;
-                        shm_table->backend_changed = FALSE;
-
-                        /* start at 0% */
-                        shm_table->reload_progress = FALSE;
+                    for (int i = 0; i < n; i++) {
+                        switch (events[i].data.u32) {
+                            case LOOP_EV_SIGNAL:
+                                loop_read_signals(&loop);
+                                break;
+                            case LOOP_EV_CONTROL:
+                                vrmr_control_handle(&control);
+                                break;
+                            case LOOP_EV_NETLINK:
+                                loop_netlink_read(loop.nlfd, &dyn_devs);
+                                break;
+                            case LOOP_EV_DYNAMIC:
+                                loop_read_timer(loop.dynamic_tfd);
+                                dyn_devs.all = true;
+                                break;
+                            case LOOP_EV_TRAFVOL:
+                                loop_read_timer(loop.trafvol_tfd);
+                                /* add the traffic since the last sample to
+                                 * the traffic volume store */
+                                if (vrmr_trafvol_update(&vctx.conf,
+                                            &vctx.interfaces,
+                                            &trafvol_counters,
+                                            VRMR_TRAFVOL_LOCATION) < 0) {
+                                    vrmr_error(-1, "Error",
+                                            "updating the traffic volume "
+                                            "failed.");
+                                }
+                                break;
+                        }
                     }
-
-                    vrmr_unlock(sem_id);
                 }
 
                 /*  if we have one or more dynamic interfaces
                     we check if there we're changes.
                 */
-                if (vctx.conf.dynamic_changes_check == TRUE &&
-                        vctx.interfaces.dynamic_interfaces == TRUE) {
-                    dynamic_wait_time++;
-
-                    if (dynamic_wait_time >=
-                            vctx.conf.dynamic_changes_interval) {
-                        vrmr_debug(LOW, "check the dynamic ipaddresses.");
+                if (dyn_devs.all || dyn_devs.len > 0) {
+                    vrmr_debug(LOW, "check the dynamic ipaddresses.");
 
-                        if (check_for_changed_dynamic_ips(&vctx.interfaces)) {
-                            reload_dyn = TRUE;
-                        }
-
-                        dynamic_wait_time = 0;
+                    result = 0;
+                    if (dyn_devs.all) {
+                        result = check_for_changed_dynamic_ips(
+                                &vctx.interfaces, NULL);
+                    }
+                    for (unsigned int i = 0; !dyn_devs.all && i < dyn_devs.len;
+                            i++) {
+                        int r = check_for_changed_dynamic_ips(
+                                &vctx.interfaces, dyn_devs.name[i]);
+                        if (r != 0)
+                            result = r;
+                    }
+                    if (result != 0) {
+                        reload_dyn = TRUE;
+                        (void)vrmr_control_reload_request(&control,
+                                VRMR_RQ_DYNAMIC, "dynamic interface");
                     }
                 }
 
-                /*  well, we either recieved a SIGHUP or we want to reload
-                   trough an IPC command, or we have an interface with a changed
-                   ip.
+                /*  well, we either recieved a SIGHUP or a reload request on
+                    the control socket, or we have an interface with a
+                    changed ip. The requests of the last RELOAD_DEBOUNCE ms
+                    are applied together.
                 */
-                if (sighup_count > 0 || reload_shm == TRUE ||
-                        reload_dyn == TRUE) {
-                    /* apply changes */
-                    result = apply_changes(&vctx, &vctx.reg);
+                if (vrmr_control_reload_pending(&control)) {
+                    /* the config tools follow the progress of the reload */
+                    (void)vrmr_control_reload_start(&control);
+
+                    /* apply changes. If only the addresses of dynamic
+                     * interfaces changed only their rules are created
+                     * again. */
+                    if (control.reload_requests == VRMR_RQ_DYNAMIC)
+                        result = apply_changes_dynamic(&vctx);
+                    else
+                        result = apply_changes(&vctx, &vctx.reg);
                     if (result < 0) {
                         vrmr_error(-1, "Error", "applying changes failed.");
                     }
 
-                    /* if we are reloading because of an IPC command, we need to
-                     * communicate with the caller */
-                    if (reload_shm == TRUE) {
-                        if (vrmr_lock(sem_id)) {
-                            /* finished so 100% */
-                            shm_table->reload_progress = 100;
-
-                            /* tell the caller about the reload result */
-                            if (result < 0) {
-                                shm_table->reload_result = VRMR_RR_ERROR;
-                            } else if (result == 0) {
-                                shm_table->reload_result = VRMR_RR_SUCCES;
-                            } else {
-                                shm_table->reload_result = VRMR_RR_NOCHANGES;
-                            }
-                            vrmr_unlock(sem_id);
-                        }
-
-                        vrmr_info("Info", "Waiting for an VRMR_RR_RESULT_ACK");
-
-                        result = 0;
-                        wait_time = 0;
-
-                        /* now wait max 30 seconds for an ACK from the caller */
-                        while (result == 0 && wait_time < 30) {
-                            if (vrmr_lock(sem_id)) {
-                                /* ah, we got one */
-                                if (shm_table->reload_result ==
-                                        VRMR_RR_RESULT_ACK) {
-                                    shm_table->reload_result = VRMR_RR_READY;
-                                    shm_table->reload_progress = 0;
-                                    result = 1;
-
-                                    vrmr_info("Info",
-                                            "We got an VRMR_RR_RESULT_ACK!");
-                                }
-                                vrmr_unlock(sem_id);
-                            }
-
-                            wait_time++;
-                            sleep(1);
-                        }
-
-                        /* damn, we didn't get one */
-                        if (result == 0) {
-                            vrmr_info("Info",
-                                    "We've waited for %u seconds for an "
-                                    "VRMR_RR_RESULT_ACK, but got none. Setting "
-                                    "to VRMR_RR_READY",
-                                    wait_time);
-                            if (vrmr_lock(sem_id)) {
-                                shm_table->reload_result = VRMR_RR_READY;
-                                shm_table->reload_progress = 0;
-                                vrmr_unlock(sem_id);
-                            } else {
-                                vrmr_info("Info",
-                                        "Hmmmm, failed to set to "
-                                        "ready. Did the client crash?");
-                            }
-                        }
-                    }
+                    /* tell the config tools about the reload result */
+                    if (result < 0)
+                        vrmr_control_reload_done(&control, VRMR_RR_ERROR);
+                    else if (result == 0)
+                        vrmr_control_reload_done(&control, VRMR_RR_SUCCES);
+                    else
+                        vrmr_control_reload_done(&control, VRMR_RR_NOCHANGES);
+                    loop_set_info(&vctx);
+                    loop_write_metrics(&vctx);
 
                     if (reload_dyn == TRUE) {
                         /* notify vuurmuur_log */
@@ -708,31 +964,19 @@ int main(int argc, char *argv[])
                     }
 
                     /* reset */
-                    sighup_count = 0;
-                    reload_shm = FALSE;
                     reload_dyn = FALSE;
-                }
+                    control.debounce_ms = vctx.conf.reload_debounce;
 
-                sleep(LOOP_INT);
+                    /* the dynamic interfaces may have changed */
+                    loop_setup_dynamic(&loop, &vctx);
+                }
             }
 
-            if (sigint_count || sigterm_count)
+            if (loop.sigint || loop.sigterm)
                 vrmr_debug(NONE, "killed by INT or TERM");
 
-            vrmr_info("Info", "Destroying shared memory...");
-            if (shmctl(shm_id, IPC_RMID, NULL) < 0) {
-                vrmr_error(-1, "Error", "destroying shared memory failed: %s.",
-                        strerror(errno));
-                retval = -1;
-            } else {
-                vrmr_debug(MEDIUM, "shared memory destroyed.");
-            }
-
-            /* destroy semaphore */
-            if (semctl(sem_id, 0, IPC_RMID, semarg) == -1) {
-                vrmr_error(-1, "Error", "failed to remove semaphore.");
-                retval = -1;
-            }
+            vrmr_counters_cleanup(&trafvol_counters);
+            loop_cleanup(&loop);
 
             /* remove the pidfile */
             if (vrmr_remove_pidfile(PIDFILE) < 0) {
@@ -28,319 +28,6 @@ struct {
     size_t n_fields;
 } traf_vol_section;
 
-struct traf_vol {
-    int year;
-    int month;
-    int day;
-    char total; /* total for this timeunit */
-    unsigned int recv_mb;
-    unsigned int send_mb;
-} traf_vol;
-
-/*  strip the buf src from the spaces before the text. Leave other
-    spaces alone.
-*/
-static void strip_buf(char *src, char *dst, size_t dstsize)
-{
-    size_t i = 0, k = 0;
-    char copy_space = 0;
-
-    for (i = 0; i < dstsize && i < StrMemLen(src); i++) {
-        if (src[i] != ' ')
-            copy_space = 1;
-
-        if (src[i] != ' ' || copy_space == 1) {
-            dst[k] = src[i];
-            k++;
-        }
-    }
-    dst[k] = '\0';
-}
-
-static void bandwidth_store(struct vrmr_list *list, int year, int month,
-        int day, char total, unsigned int recv, unsigned int send)
-{
-    struct traf_vol *bw_ptr = NULL;
-
-    bw_ptr = malloc(sizeof(struct traf_vol));
-    vrmr_fatal_alloc("malloc", bw_ptr);
-
-    bw_ptr->year = year;
-    bw_ptr->month = month;
-    bw_ptr->day = day;
-    bw_ptr->total = total;
-    bw_ptr->recv_mb = recv;
-    bw_ptr->send_mb = send;
-
-    /* append to the list */
-    vrmr_fatal_if(vrmr_list_append(list, bw_ptr) == NULL);
-}
-
-/*
-    on first sight it may look if this function solves an easy problem
-    the hard way, just reading the output one line at a time should
-    be enough right?
-
-    wrong... the number of interfaces determines how long the lines
-    are... so we read a number of bytes and try to analyse it...
-
-    if days is 0, we don't limit the number of days.
-
-    returncodes:
-        -1: error
-         0: ok, but no data
-         1: ok
-*/
-static int bandwidth_get_iface(struct vrmr_config *conf, char *device,
-        unsigned int year, int month, int start_day, int days, char only_total,
-        struct vrmr_list *list)
-{
-    char bw_buf[512] = "", sect_buf[32] = "", sect_buf_stripped[32] = "",
-         tmpfile[] = "/tmp/vuurmuur-iptrafvol-XXXXXX";
-    char done = FALSE;
-    int fd = 0;
-    int result = 0;
-
-    char data_month = 0;
-    int data_day = 0;
-
-    unsigned int k = 0;
-
-    int act_border = 0;
-
-    int device_column = 0; /* column where our
-                        device can be found. */
-    int cur_column = 0;
-
-    int line_num = 0;
-
-    char buf_done = 0;
-
-    char parsing_device_line = 0, parsing_total_line = 0;
-
-    char parsing_data = 0;
-
-    char month_str[4] = "";
-
-    unsigned int recv = 0, recv_sub = 0, send = 0, send_sub = 0;
-
-    int retval = 0;
-
-    char cmd_year_str[5] = "", cmd_month_str[3] = "", cmd_start_day_str[3] = "",
-         cmd_num_days_str[11] = "";
-
-    /* safety */
-    vrmr_fatal_if_null(device);
-    vrmr_fatal_if_null(list);
-    vrmr_fatal_if(year > 9999);
-    vrmr_fatal_if(!(month >= 1 && month <= 12));
-
-    vrmr_debug(LOW, "looking for data for '%s'.", device);
-
-    /* create the tempfile */
-    fd = vrmr_create_tempfile(tmpfile);
-    if (fd == -1)
-        return (-1);
-    close(fd);
-
-    /* setup the list */
-    vrmr_list_setup(list, free);
-
-    snprintf(cmd_year_str, sizeof(cmd_year_str), "%u", year);
-    snprintf(cmd_month_str, sizeof(cmd_month_str), "%d", month);
-    snprintf(cmd_start_day_str, sizeof(cmd_start_day_str), "%d", start_day);
-
-    /* see if we need to pass the -s option to iptrafvol*/
-    if (days > 0) {
-        snprintf(cmd_num_days_str, sizeof(cmd_num_days_str), "%d", days);
-        const char *args[] = {vccnf.iptrafvol_location, "-d", "-y",
-                cmd_year_str, "-m", cmd_month_str, "-b", cmd_start_day_str,
-                "-s", cmd_num_days_str, NULL};
-        char *outputs[] = {tmpfile, "/dev/null", NULL};
-        result = libvuurmuur_exec_command(
-                conf, vccnf.iptrafvol_location, args, outputs);
-    } else {
-        const char *args[] = {vccnf.iptrafvol_location, "-d", "-y",
-                cmd_year_str, "-m", cmd_month_str, "-b", cmd_start_day_str,
-                NULL};
-        char *outputs[] = {tmpfile, "/dev/null", NULL};
-        result = libvuurmuur_exec_command(
-                conf, vccnf.iptrafvol_location, args, outputs);
-    }
-    if (result != 0) {
-        return (-1);
-    }
-
-    /* open the file for reading */
-    fd = open(tmpfile, 0);
-    if (fd < 0) {
-        vrmr_error(-1, VR_ERR, gettext("opening '%s' failed: %s"), tmpfile,
-                strerror(errno));
-        return (-1);
-    }
-
-    while (done == FALSE) {
-        memset(bw_buf, 0, sizeof(bw_buf));
-
-        ssize_t readsize = read(fd, bw_buf, sizeof(bw_buf));
-        if (readsize > 0) {
-            for (unsigned int i = 0; i < (unsigned int)readsize; i++) {
-                if (bw_buf[i] == '\n') {
-                    line_num++;
-
-                    act_border = 0;
-
-                    sect_buf[k] = '\0';
-                    k = 0;
-
-                    if (parsing_device_line == 1) {
-                        parsing_device_line = 0;
-                    }
-                    if (parsing_total_line == 1) {
-                        done = 1;
-                        break;
-                    }
-
-                    buf_done = 1;
-                } else if (bw_buf[i] == '|') {
-                    act_border++;
-                    sect_buf[k] = '\0';
-                    k = 0;
-
-                    buf_done = 1;
-                } else {
-                    if (k < (unsigned int)sizeof(sect_buf) - 1) {
-                        sect_buf[k] = bw_buf[i];
-                        k++;
-                    } else {
-                        sect_buf[k] = '\0';
-                    }
-                }
-
-                if (line_num > 5)
-                    parsing_data = 1;
-
-                if (buf_done == 1) {
-                    buf_done = 0;
-
-                    /* strip the buffer from the starting whitespaces */
-                    strip_buf(sect_buf, sect_buf_stripped,
-                            sizeof(sect_buf_stripped));
-
-                    /* get the current column */
-                    cur_column = act_border - 1;
-
-                    if (line_num == 1) {
-                        vrmr_debug(
-                                HIGH, "line_num == 1: '%s'", sect_buf_stripped);
-
-                        if (strncmp("no data", sect_buf_stripped, 7) == 0) {
-                            retval = 0;
-                            done = TRUE;
-                            break;
-                        }
-                    }
-
-                    /* the deviceline starts with MBytes */
-                    if (strncmp(sect_buf_stripped, "MBytes", 6) == 0)
-                        parsing_device_line = 1;
-
-                    /* this is the total line */
-                    if (strcmp(sect_buf_stripped, "Total:") == 0)
-                        parsing_total_line = 1;
-
-                    /* date column */
-                    if (parsing_data == 1 && cur_column == 1 &&
-                            only_total == 0) {
-                        sscanf(sect_buf_stripped, "%d %3s", &data_day,
-                                month_str);
-
-                        /* parse the month */
-                        if (strcmp(month_str, "Jan") == 0)
-                            data_month = 1;
-                        else if (strcmp(month_str, "Feb") == 0)
-                            data_month = 2;
-                        else if (strcmp(month_str, "Mar") == 0)
-                            data_month = 3;
-                        else if (strcmp(month_str, "Apr") == 0)
-                            data_month = 4;
-                        else if (strcmp(month_str, "May") == 0)
-                            data_month = 5;
-                        else if (strcmp(month_str, "Jun") == 0)
-                            data_month = 6;
-                        else if (strcmp(month_str, "Jul") == 0)
-                            data_month = 7;
-                        else if (strcmp(month_str, "Aug") == 0)
-                            data_month = 8;
-                        else if (strcmp(month_str, "Sep") == 0)
-                            data_month = 9;
-                        else if (strcmp(month_str, "Oct") == 0)
-                            data_month = 10;
-                        else if (strcmp(month_str, "Nov") == 0)
-                            data_month = 11;
-                        else if (strcmp(month_str, "Dec") == 0)
-                            data_month = 12;
-                        else {
-                            vrmr_error(-1, VR_ERR,
-                                    gettext("could not parse month '%s'"),
-                                    month_str);
-                            retval = -1;
-                            goto end;
-                        }
-                    }
-                    /* device column */
-                    if (parsing_data == 1 && device_column > 1 &&
-                            cur_column == device_column &&
-                            ((only_total == 1 && parsing_total_line == 1) ||
-                                    only_total == 0)) {
-                        sscanf(sect_buf_stripped, "%u.%u %u.%u", &recv,
-                                &recv_sub, &send, &send_sub);
-                        recv = ((recv * 10) + recv_sub) / 10;
-                        send = ((send * 10) + send_sub) / 10;
-
-                        vrmr_debug(
-                                LOW, "recv = %.1u, send = %.1u.", recv, send);
-
-                        retval = 1;
-
-                        /* we asume that the date is already parsed */
-                        bandwidth_store(list, year, data_month, data_day,
-                                parsing_total_line, recv, send);
-                    }
-
-                    /* parse the deviceline to determine the column */
-                    if (parsing_device_line == 1) {
-                        if (strcmp(sect_buf_stripped, device) == 0) {
-                            /* act border includes the last borderline, so -1.
-                             */
-                            device_column = cur_column;
-
-                            vrmr_debug(LOW,
-                                    "sect_buf_stripped '%s' match! (device: "
-                                    "%s) column = %d.",
-                                    sect_buf_stripped, device, device_column);
-                        }
-                    }
-                }
-            }
-        } else {
-            done = TRUE;
-        }
-    }
-end:
-    /* close the file again */
-    (void)close(fd);
-
-    /* remove the file */
-    if (unlink(tmpfile) == -1) {
-        vrmr_error(-1, VR_ERR, gettext("removing '%s' failed (unlink): %s"),
-                tmpfile, strerror(errno));
-        return (-1);
-    }
-
-    return (retval);
-}
-
 /*  trafvol_section_init
 
     This function creates the trafvol section window and the fields inside it.
@@ -566,6 +253,36 @@ static void create_bw_string(unsigned int mb, char *str, size_t len)
         snprintf(str, len, "%uT", mb / (1024 * 1024));
 }
 
+/*  trafvol_set_fields
+
+    Sets the in and out fields to the traffic of 'device' over 'n' periods
+    starting at bucket 'first', as stored by the vuurmuur daemon.
+*/
+static void trafvol_set_fields(const char *device,
+        enum vrmr_trafvol_period period, int64_t first, unsigned int n,
+        FIELD *in_fld, FIELD *out_fld)
+{
+    char bw_str[6] = "";
+    uint64_t in = 0, out = 0;
+
+    int result = vrmr_trafvol_get(
+            VRMR_TRAFVOL_LOCATION, device, period, first, n, &in, &out);
+    if (result == 1) {
+        create_bw_string(
+                (unsigned int)(in / (1024 * 1024)), bw_str, sizeof(bw_str));
+        set_field_buffer_wrap(in_fld, 0, bw_str);
+        create_bw_string(
+                (unsigned int)(out / (1024 * 1024)), bw_str, sizeof(bw_str));
+        set_field_buffer_wrap(out_fld, 0, bw_str);
+    } else if (result == 0) {
+        set_field_buffer_wrap(in_fld, 0, "  -  ");
+        set_field_buffer_wrap(out_fld, 0, "  -  ");
+    } else {
+        set_field_buffer_wrap(in_fld, 0, gettext("error"));
+        set_field_buffer_wrap(out_fld, 0, gettext("error"));
+    }
+}
+
 /*  trafvol_section
 
     This section shows bandwidth usage of the system.
@@ -585,18 +302,11 @@ int trafvol_section(
     unsigned int ifac_num = 0;
     struct vrmr_interface *iface_ptr = NULL;
 
-    struct vrmr_list_node *d_node = NULL, *bw_d_node = NULL;
-    struct traf_vol *bw_ptr = NULL;
-    struct vrmr_list bw_list;
-
-    int year = 0, month = 0;
+    struct vrmr_list_node *d_node = NULL;
 
-    time_t cur_time, yesterday_time, lastweek_time;
-    struct tm cur_tm, yesterday_tm, lastweek_tm;
-
-    char bw_str[6] = "";
-
-    int result = 0;
+    time_t cur_time;
+    struct tm cur_tm;
+    int64_t today = 0, this_month = 0;
 
     int update_interval =
             10000000; /* weird, in pratice this seems to be twenty sec */
@@ -614,13 +324,6 @@ int trafvol_section(
         return (0);
     }
 
-    if (strcmp(vccnf.iptrafvol_location, "") == 0) {
-        vrmr_error(-1, VR_ERR,
-                gettext("please set the location of the iptrafvol.pl command "
-                        "in the Settings."));
-        return (-1);
-    }
-
     max_height = getmaxy(stdscr);
     max_onscreen = max_height - 8 - 6;
 
@@ -661,12 +364,10 @@ int trafvol_section(
             /* get the time */
             cur_time = time(NULL);
             vrmr_fatal_if(cur_time == -1);
-            yesterday_time = cur_time - 86400;
-            lastweek_time = cur_time - (86400 * 7);
-
             vrmr_fatal_if(localtime_r(&cur_time, &cur_tm) == NULL);
-            vrmr_fatal_if(localtime_r(&yesterday_time, &yesterday_tm) == NULL);
-            vrmr_fatal_if(localtime_r(&lastweek_time, &lastweek_tm) == NULL);
+
+            today = vrmr_trafvol_bucket(VRMR_TRAFVOL_DAY, &cur_tm);
+            this_month = vrmr_trafvol_bucket(VRMR_TRAFVOL_MONTH, &cur_tm);
 
             /* update data here */
             for (d_node = interfaces->list.top, i = 0; d_node && i < ifac_num;
@@ -681,193 +382,21 @@ int trafvol_section(
                 set_field_buffer_wrap(
                         traf_vol_section.fields[11 * i], 0, iface_ptr->name);
 
-                /* get the bw for today */
-                result = bandwidth_get_iface(conf, iface_ptr->device,
-                        cur_tm.tm_year + 1900, cur_tm.tm_mon + 1,
-                        cur_tm.tm_mday, 1, 1, &bw_list);
-                if (result == 1) {
-                    for (bw_d_node = bw_list.top; bw_d_node;
-                            bw_d_node = bw_d_node->next) {
-                        vrmr_fatal_if_null(bw_d_node->data);
-                        bw_ptr = bw_d_node->data;
-
-                        create_bw_string(
-                                bw_ptr->recv_mb, bw_str, sizeof(bw_str));
-                        set_field_buffer_wrap(
-                                traf_vol_section.fields[1 + (11 * i)], 0,
-                                bw_str);
-
-                        create_bw_string(
-                                bw_ptr->send_mb, bw_str, sizeof(bw_str));
-                        set_field_buffer_wrap(
-                                traf_vol_section.fields[2 + (11 * i)], 0,
-                                bw_str);
-                    }
-                    vrmr_list_cleanup(&bw_list);
-                } else if (result == 0) {
-                    set_field_buffer_wrap(
-                            traf_vol_section.fields[1 + (11 * i)], 0, "  -  ");
-                    set_field_buffer_wrap(
-                            traf_vol_section.fields[2 + (11 * i)], 0, "  -  ");
-                } else {
-                    set_field_buffer_wrap(traf_vol_section.fields[1 + (11 * i)],
-                            0, gettext("error"));
-                    set_field_buffer_wrap(traf_vol_section.fields[2 + (11 * i)],
-                            0, gettext("error"));
-                }
-
-                /* get the bw for yesterday */
-                result = bandwidth_get_iface(conf, iface_ptr->device,
-                        yesterday_tm.tm_year + 1900, yesterday_tm.tm_mon + 1,
-                        yesterday_tm.tm_mday, 1, 1, &bw_list);
-                if (result == 1) {
-                    for (bw_d_node = bw_list.top; bw_d_node;
-                            bw_d_node = bw_d_node->next) {
-                        vrmr_fatal_if_null(bw_d_node->data);
-                        bw_ptr = bw_d_node->data;
-
-                        create_bw_string(
-                                bw_ptr->recv_mb, bw_str, sizeof(bw_str));
-                        set_field_buffer_wrap(
-                                traf_vol_section.fields[3 + (11 * i)], 0,
-                                bw_str);
-
-                        create_bw_string(
-                                bw_ptr->send_mb, bw_str, sizeof(bw_str));
-                        set_field_buffer_wrap(
-                                traf_vol_section.fields[4 + (11 * i)], 0,
-                                bw_str);
-                    }
-                    vrmr_list_cleanup(&bw_list);
-                } else if (result == 0) {
-                    set_field_buffer_wrap(
-                            traf_vol_section.fields[3 + (11 * i)], 0, "  -  ");
-                    set_field_buffer_wrap(
-                            traf_vol_section.fields[4 + (11 * i)], 0, "  -  ");
-                } else {
-                    set_field_buffer_wrap(traf_vol_section.fields[3 + (11 * i)],
-                            0, gettext("error"));
-                    set_field_buffer_wrap(traf_vol_section.fields[4 + (11 * i)],
-                            0, gettext("error"));
-                }
-
-                /* get the bw for past 7 days */
-                result = bandwidth_get_iface(conf, iface_ptr->device,
-                        lastweek_tm.tm_year + 1900, lastweek_tm.tm_mon + 1,
-                        lastweek_tm.tm_mday, 7, 1, &bw_list);
-                if (result == 1) {
-                    for (bw_d_node = bw_list.top; bw_d_node;
-                            bw_d_node = bw_d_node->next) {
-                        vrmr_fatal_if_null(bw_d_node->data);
-                        bw_ptr = bw_d_node->data;
-
-                        create_bw_string(
-                                bw_ptr->recv_mb, bw_str, sizeof(bw_str));
-                        set_field_buffer_wrap(
-                                traf_vol_section.fields[5 + (11 * i)], 0,
-                                bw_str);
-
-                        create_bw_string(
-                                bw_ptr->send_mb, bw_str, sizeof(bw_str));
-                        set_field_buffer_wrap(
-                                traf_vol_section.fields[6 + (11 * i)], 0,
-                                bw_str);
-                    }
-                    vrmr_list_cleanup(&bw_list);
-                } else if (result == 0) {
-                    set_field_buffer_wrap(
-                            traf_vol_section.fields[5 + (11 * i)], 0, "  -  ");
-                    set_field_buffer_wrap(
-                            traf_vol_section.fields[6 + (11 * i)], 0, "  -  ");
-                } else {
-                    set_field_buffer_wrap(traf_vol_section.fields[5 + (11 * i)],
-                            0, gettext("error"));
-                    set_field_buffer_wrap(traf_vol_section.fields[6 + (11 * i)],
-                            0, gettext("error"));
-                }
-
-                /* get the bw for the current month */
-                result = bandwidth_get_iface(conf, iface_ptr->device,
-                        cur_tm.tm_year + 1900, cur_tm.tm_mon + 1, 1, 0, 1,
-                        &bw_list);
-                if (result == 1) {
-                    for (bw_d_node = bw_list.top; bw_d_node;
-                            bw_d_node = bw_d_node->next) {
-                        vrmr_fatal_if_null(bw_d_node->data);
-                        bw_ptr = bw_d_node->data;
-
-                        create_bw_string(
-                                bw_ptr->recv_mb, bw_str, sizeof(bw_str));
-                        set_field_buffer_wrap(
-                                traf_vol_section.fields[7 + (11 * i)], 0,
-                                bw_str);
-
-                        create_bw_string(
-                                bw_ptr->send_mb, bw_str, sizeof(bw_str));
-                        set_field_buffer_wrap(
-                                traf_vol_section.fields[8 + (11 * i)], 0,
-                                bw_str);
-                    }
-                    vrmr_list_cleanup(&bw_list);
-                } else if (result == 0) {
-                    set_field_buffer_wrap(
-                            traf_vol_section.fields[7 + (11 * i)], 0, "  -  ");
-                    set_field_buffer_wrap(
-                            traf_vol_section.fields[8 + (11 * i)], 0, "  -  ");
-                } else {
-                    set_field_buffer_wrap(traf_vol_section.fields[7 + (11 * i)],
-                            0, gettext("error"));
-                    set_field_buffer_wrap(traf_vol_section.fields[8 + (11 * i)],
-                            0, gettext("error"));
-                }
-
-                /* get the bw for the last month */
-                year = cur_tm.tm_year + 1900;
-                /* get prev month (by not adding +1) */
-                month = cur_tm.tm_mon;
-
-                /*  if month = 0 (Jan), set it to 12
-                    (Dec) and subtract one of the
-                    year.
-                 */
-                if (month == 0) {
-                    month = 12;
-                    year = year - 1;
-                }
-
-                result = bandwidth_get_iface(conf, iface_ptr->device, year,
-                        month, 1, 0, 1, &bw_list);
-                if (result == 1) {
-                    for (bw_d_node = bw_list.top; bw_d_node;
-                            bw_d_node = bw_d_node->next) {
-                        vrmr_fatal_if_null(bw_d_node->data);
-                        bw_ptr = bw_d_node->data;
-
-                        create_bw_string(
-                                bw_ptr->recv_mb, bw_str, sizeof(bw_str));
-                        set_field_buffer_wrap(
-                                traf_vol_section.fields[9 + (11 * i)], 0,
-                                bw_str);
-
-                        create_bw_string(
-                                bw_ptr->send_mb, bw_str, sizeof(bw_str));
-                        set_field_buffer_wrap(
-                                traf_vol_section.fields[10 + (11 * i)], 0,
-                                bw_str);
-                    }
-                    vrmr_list_cleanup(&bw_list);
-                } else if (result == 0) {
-                    set_field_buffer_wrap(
-                            traf_vol_section.fields[9 + (11 * i)], 0, "  -  ");
-                    set_field_buffer_wrap(
-                            traf_vol_section.fields[10 + (11 * i)], 0, "  -  ");
-                } else {
-                    set_field_buffer_wrap(traf_vol_section.fields[9 + (11 * i)],
-                            0, gettext("error"));
-                    set_field_buffer_wrap(
-                            traf_vol_section.fields[10 + (11 * i)], 0,
-                            gettext("error"));
-                }
+                FIELD **fields = &traf_vol_section.fields[11 * i];
+
+                /* today, yesterday and the 7 days before today */
+                trafvol_set_fields(iface_ptr->device, VRMR_TRAFVOL_DAY,
+                        today, 1, fields[1], fields[2]);
+                trafvol_set_fields(iface_ptr->device, VRMR_TRAFVOL_DAY,
+                        today - 1, 1, fields[3], fields[4]);
+                trafvol_set_fields(iface_ptr->device, VRMR_TRAFVOL_DAY,
+                        today - 7, 7, fields[5], fields[6]);
+
+                /* this month and last month */
+                trafvol_set_fields(iface_ptr->device, VRMR_TRAFVOL_MONTH,
+                        this_month, 1, fields[7], fields[8]);
+                trafvol_set_fields(iface_ptr->device, VRMR_TRAFVOL_MONTH,
+                        this_month - 1, 1, fields[9], fields[10]);
 
                 /* finally draw the screen */
                 wrefresh(traf_vol_section.win);
@@ -31,9 +31,6 @@ void vcconfig_use_defaults(struct vrmr_gui_conf *cnf)
     cnf->newrule_logburst = cnf->newrule_loglimit * 2;
     cnf->logview_bufsize = VRMR_DEFAULT_LOGVIEW_BUFFERSIZE;
     cnf->background = 0; /* blue */
-
-    (void)strlcpy(cnf->iptrafvol_location, VRMR_DEFAULT_IPTRAFVOL_LOCATION,
-            sizeof(cnf->iptrafvol_location));
 }
 
 int init_vcconfig(struct vrmr_config *conf, char *configfile_location,
@@ -132,24 +129,6 @@ int init_vcconfig(struct vrmr_config *conf, char *configfile_location,
     } else
         return (VRMR_CNF_E_UNKNOWN_ERR);
 
-    /* IPTRAFVOL */
-    result = vrmr_ask_configfile(conf, "IPTRAFVOL", cnf->iptrafvol_location,
-            configfile_location, sizeof(cnf->iptrafvol_location));
-    if (result == 1) {
-        /* ok */
-    } else if (result == 0) {
-        vrmr_debug(NONE,
-                "Variable IPTRAFVOL not found in '%s', using default value: %s",
-                configfile_location, VRMR_DEFAULT_IPTRAFVOL_LOCATION);
-
-        (void)strlcpy(cnf->iptrafvol_location, VRMR_DEFAULT_IPTRAFVOL_LOCATION,
-                sizeof(cnf->iptrafvol_location));
-    } else
-        return (VRMR_CNF_E_UNKNOWN_ERR);
-
-    vrmr_sanitize_path(
-            cnf->iptrafvol_location, sizeof(cnf->iptrafvol_location));
-
     /* NEWRULE_LOG */
     result = vrmr_ask_configfile(
             conf, "NEWRULE_LOG", answer, configfile_location, sizeof(answer));
@@ -290,9 +269,6 @@ int write_vcconfigfile(char *file_location, struct vrmr_gui_conf *cnf)
                 "logviewer for scrolling back.\n");
     fprintf(fp, "LOGVIEW_BUFSIZE=\"%u\"\n\n", cnf->logview_bufsize);
 
-    fprintf(fp, "# The location of the iptrafvol.pl command.\n");
-    fprintf(fp, "IPTRAFVOL=\"%s\"\n\n", cnf->iptrafvol_location);
-
     fprintf(fp, "# Background color: blue or black.\n");
     fprintf(fp, "BACKGROUND=\"%s\"\n\n", cnf->background ? "black" : "blue");
 
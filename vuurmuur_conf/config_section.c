@@ -1300,8 +1300,7 @@ static int edit_conconfig(struct vrmr_config *conf)
 
 struct {
     FIELD *newrule_loglimitfld, *newrule_logfld, *logview_bufsizefld,
-            *advancedmodefld, *mainmenu_statusfld, *backgroundfld,
-            *iptrafvollocfld;
+            *advancedmodefld, *mainmenu_statusfld, *backgroundfld;
     char number[8];
 } VcConfig;
 
@@ -1310,7 +1309,7 @@ static void edit_vcconfig_init(int height, int width, int starty, int startx)
     size_t i = 0;
     int rows = 0, cols = 0;
 
-    config_section.n_fields = 7;
+    config_section.n_fields = 6;
     config_section.fields =
             (FIELD **)calloc(config_section.n_fields + 1, sizeof(FIELD *));
 
@@ -1327,8 +1326,6 @@ static void edit_vcconfig_init(int height, int width, int starty, int startx)
             (config_section.fields[4] = new_field_wrap(1, 1, 7, 53, 0, 0));
     VcConfig.backgroundfld =
             (config_section.fields[5] = new_field_wrap(1, 1, 8, 53, 0, 0));
-    VcConfig.iptrafvollocfld =
-            (config_section.fields[6] = new_field_wrap(1, 64, 11, 1, 0, 0));
     config_section.fields[config_section.n_fields] = NULL;
 
     /* create win & pan */
@@ -1356,8 +1353,6 @@ static void edit_vcconfig_init(int height, int width, int starty, int startx)
             VcConfig.mainmenu_statusfld, 0, vccnf.draw_status ? "X" : " ");
     set_field_buffer_wrap(
             VcConfig.backgroundfld, 0, vccnf.background ? "X" : " ");
-    set_field_buffer_wrap(
-            VcConfig.iptrafvollocfld, 0, vccnf.iptrafvol_location);
 
     for (i = 0; i < config_section.n_fields; i++) {
         set_field_back(config_section.fields[i], vccnf.color_win_rev | A_BOLD);
@@ -1404,9 +1399,6 @@ static void edit_vcconfig_init(int height, int width, int starty, int startx)
     mvwprintw(config_section.win, 9, 2, gettext("Use black background?:"));
     mvwprintw(config_section.win, 9, 54, "[");
     mvwprintw(config_section.win, 9, 56, "]");
-
-    mvwprintw(config_section.win, 11, 2,
-            gettext("iptrafvol.pl location (full path)"));
 }
 
 static void edit_vcconfig_save(void)
@@ -1461,14 +1453,6 @@ static void edit_vcconfig_save(void)
             if (bufsize > 0) {
                 vccnf.logview_bufsize = (unsigned int)bufsize;
             }
-        } else if (config_section.fields[i] == VcConfig.iptrafvollocfld) {
-            /* synlimit */
-            copy_field2buf(vccnf.iptrafvol_location,
-                    field_buffer(config_section.fields[i], 0),
-                    sizeof(vccnf.iptrafvol_location));
-
-            vrmr_sanitize_path(
-                    vccnf.iptrafvol_location, StrLen(vccnf.iptrafvol_location));
         } else {
             vrmr_fatal("unknown field");
         }
@@ -1511,8 +1495,7 @@ int edit_vcconfig(void)
         int ch = wgetch(config_section.win);
         int not_defined = 0;
         if (cur == VcConfig.newrule_loglimitfld ||
-                cur == VcConfig.logview_bufsizefld ||
-                cur == VcConfig.iptrafvollocfld) {
+                cur == VcConfig.logview_bufsizefld) {
             not_defined = !(nav_field_simpletext(config_section.form, ch));
         } else if (cur == VcConfig.newrule_logfld ||
                    cur == VcConfig.advancedmodefld ||
@@ -52,7 +52,7 @@ void shorten_name(const char *input, char *output, size_t output_size)
 }
 
 /* wrapper for strlcpy, that truncates a string a little nicer */
-static void copy_name(char *dst, char *src, size_t size)
+static void copy_name(char *dst, const char *src, size_t size)
 {
     size_t srclen = StrLen(src);
     if (srclen < size) {
@@ -77,6 +77,23 @@ static int get_space(WINDOW *w, int size)
     return left;
 }
 
+/* format a rate as 5 chars: "999 ", "999 k", "9.9 M", etc */
+static void format_rate(char *str, size_t size, uint64_t rate)
+{
+    if (rate < 1000)
+        snprintf(str, size, "%3u ", (unsigned int)rate);
+    else if (rate < 1000000)
+        snprintf(str, size, "%3.0f k", (float)rate / 1000);
+    else if (rate < 10000000)
+        snprintf(str, size, "%1.1f M", (float)rate / 1000000);
+    else if (rate < 1000000000)
+        snprintf(str, size, "%3.0f M", (float)rate / 1000000);
+    else if (rate < 10000000000ULL)
+        snprintf(str, size, "%1.1f G", (float)rate / 1000000000);
+    else
+        snprintf(str, size, "%3.0f G", (float)rate / 1000000000);
+}
+
 /**
  *  \param acct print accounting is enabled
  */
@@ -92,6 +109,7 @@ static int print_connection(WINDOW *local_win,
     char servicename[32] = "";
     char zonename[46] = "";
     char bw_str[9] = "";
+    char pps_str[9] = "";
     const bool start_with_service = (connreq->group_conns == FALSE);
 
     /* determine the position where we are going to write */
@@ -246,7 +264,21 @@ static int print_connection(WINDOW *local_win,
     if (printline_width <= 0)
         return (1);
 
-    if (connreq->draw_acc_data == TRUE && acct == TRUE) {
+    if (connreq->sort_rate == TRUE) {
+        if (acct == FALSE || cd_ptr->use_acc == FALSE) {
+            snprintf(bw_str, sizeof(bw_str), "  n/a");
+            snprintf(pps_str, sizeof(pps_str), "  n/a");
+        } else {
+            format_rate(bw_str, sizeof(bw_str), cd_ptr->bps);
+            format_rate(pps_str, sizeof(pps_str), cd_ptr->pps);
+        }
+
+        /* TRANSLATORS: max 3 chars: bits per second and packets per
+         * second. */
+        snprintf(printline, printline_width, "%5s%-3s %5s%-3s ", bw_str,
+                gettext("bps"), pps_str, gettext("pps"));
+        wprintw(local_win, "%s", printline);
+    } else if (connreq->draw_acc_data == TRUE && acct == TRUE) {
         if (cd_ptr->use_acc == FALSE)
             snprintf(bw_str, sizeof(bw_str), "  n/a");
         else if (cd_ptr->to_src_bytes == 0)
@@ -401,8 +433,8 @@ void conn_free_ct(struct conntrack **ct, struct vrmr_zones *zones)
     /* cleanup */
     vrmr_list_cleanup(&(*ct)->network_list);
     /* destroy hashtables */
-    vrmr_hash_cleanup(&(*ct)->zone_hash);
-    vrmr_hash_cleanup(&(*ct)->service_hash);
+    vrmr_map_cleanup(&(*ct)->zone_hash);
+    vrmr_services_index_cleanup(&(*ct)->service_hash);
     free(*ct);
 }
 
@@ -422,15 +454,10 @@ struct conntrack *ATTR_RETURNS_NONNULL conn_init_ct(struct vrmr_zones *zones,
     vrmr_fatal_if(vrmr_add_broadcasts_zonelist(zones) < 0);
 
     /* create hashtables */
-    vrmr_fatal_if(vrmr_init_zonedata_hashtable(zones->list.len * 3,
-                          &zones->list, vrmr_hash_ipaddress,
-                          vrmr_compare_ipaddress, &ct->zone_hash) < 0);
-
-    /*  the hashtable size may seem very big, but some services have
-        really a lot items. e.g. 137->1024:65535 */
-    vrmr_fatal_if(vrmr_init_services_hashtable(services->list.len * 500,
-                          &services->list, vrmr_hash_port, vrmr_compare_ports,
-                          &ct->service_hash) < 0);
+    vrmr_fatal_if(
+            vrmr_init_zonedata_hashtable(&zones->list, &ct->zone_hash) < 0);
+    vrmr_fatal_if(vrmr_init_services_hashtable(
+                          &services->list, &ct->service_hash) < 0);
 
     /*  initialize this list with destroy is null, because it only
         points to zonedatalist nodes */
@@ -462,7 +489,7 @@ int conn_ct_get_connections(struct vrmr_config *cnf, struct conntrack *ct,
     ct->conn_stats.fromname_max = ct->conn_stats.toname_max =
             ct->conn_stats.sername_max = 0;
 
-    vrmr_list_setup(&ct->conn_list, NULL);
+    vrmr_vector_setup(&ct->conn_list, NULL);
 
 #ifdef IPV6_ENABLED
     req->ipv6 = 1;
@@ -479,22 +506,9 @@ int conn_ct_get_connections(struct vrmr_config *cnf, struct conntrack *ct,
     if (ct->conn_list.len == 0)
         return (0);
 
-    /* fill the array and sort it */
-
-    vrmr_fatal_if(ct->conn_array);
-    ct->conn_array =
-            calloc(ct->conn_list.len, sizeof(struct vrmr_conntrack_entry *));
-    vrmr_fatal_alloc("calloc", ct->conn_array);
-
-    struct vrmr_list_node *d_node;
-    unsigned int x = 0;
-    for (d_node = ct->conn_list.top; d_node != NULL; d_node = d_node->next) {
-        vrmr_fatal_if_null(d_node->data);
-        ct->conn_array[x] = d_node->data;
-        x++;
-    }
-    qsort(ct->conn_array, ct->conn_list.len,
-            sizeof(struct vrmr_conntrack_entry *), conn_sort_by_cnt);
+    /* sort the list */
+    qsort(ct->conn_list.data, ct->conn_list.len, sizeof(void *),
+            conn_sort_by_cnt);
 
     return (0);
 }
@@ -504,8 +518,6 @@ void conn_ct_clear_connections(struct conntrack *ct)
     /* store prev list size */
     ct->prev_list_size = ct->conn_list.len;
     vrmr_conn_list_cleanup(&ct->conn_list);
-    free(ct->conn_array);
-    ct->conn_array = NULL;
 }
 
 int connections_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
@@ -538,15 +550,17 @@ int connections_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
 
     /* top menu */
     const char *key_choices[] = {
-            "F12", "m", "i", "c", "g", "u", "f", "a", "d", "F10"};
-    int key_choices_n = 10;
+            "F12", "m", "i", "c", "r", "g", "u", "f", "a", "d", "F10"};
+    int key_choices_n = 11;
     const char *cmd_choices[] = {gettext("help"), gettext("manage"),
-            gettext("in/out/fw"), gettext("connect"), gettext("grp"),
-            gettext("unknown ip"), gettext("filter"), gettext("account"),
-            gettext("details"), gettext("back")};
-    int cmd_choices_n = 10;
+            gettext("in/out/fw"), gettext("connect"), gettext("rate"),
+            gettext("grp"), gettext("unknown ip"), gettext("filter"),
+            gettext("account"), gettext("details"), gettext("back")};
+    int cmd_choices_n = 11;
 
     struct conntrack *ct = NULL;
+    struct vrmr_conntrack_table table;
+    struct vrmr_conntrack_entry **top = NULL;
     struct vrmr_conntrack_request connreq;
     int printed = 0;
     int print_accounting = 0;
@@ -558,6 +572,7 @@ int connections_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
     /* sorting, relevant for grouping */
     connreq.sort_in_out_fwd = FALSE;
     connreq.sort_conn_status = FALSE;
+    connreq.sort_rate = FALSE;
     /* drawing */
     connreq.draw_acc_data = TRUE;
     connreq.draw_details = TRUE;
@@ -576,6 +591,9 @@ int connections_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
 
     ct = conn_init_ct(zones, interfaces, services);
     vrmr_fatal_if_null(ct);
+    vrmr_fatal_if(vrmr_conn_table_setup(&table) < 0);
+    top = calloc(MAX(max_onscreen, 1), sizeof(*top));
+    vrmr_fatal_alloc("calloc", top);
 
     draw_top_menu(top_win, gettext("Connections"), key_choices_n, key_choices,
             cmd_choices_n, cmd_choices);
@@ -597,16 +615,16 @@ int connections_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
             slept_so_far = 0;
 
             /* TODO retval */
-            conn_ct_get_connections(cnf, ct, &connreq);
+            (void)vrmr_conn_table_update(&table, &ct->service_hash,
+                    &ct->zone_hash, &ct->network_list, &connreq);
 
-            if (ct->conn_stats.accounting == 1)
+            if (table.stats.accounting == 1)
                 print_accounting = 1;
             else
                 print_accounting = 0;
 
-            update_draw_size(max_width - 2, ct->conn_stats.sername_max + 1,
-                    ct->conn_stats.fromname_max + 1,
-                    ct->conn_stats.toname_max + 1);
+            update_draw_size(max_width - 2, table.stats.sername_max + 1,
+                    table.stats.fromname_max + 1, table.stats.toname_max + 1);
 
             /* determine how many lines we can draw for each section */
             if (connreq.sort_conn_status) {
@@ -634,14 +652,25 @@ int connections_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
             if (control.print)
                 werase(conn_win);
 
+            /* dump the busiest connections to screen */
+            if (control.print && connreq.sort_rate) {
+                const unsigned int n = vrmr_conn_table_top_rate(
+                        &table, top, MAX(max_onscreen, 0));
+
+                for (printed = 0; printed < (int)n; printed++) {
+                    (void)print_connection(conn_win, top[printed], &connreq,
+                            max_onscreen, printed, max_width - 2,
+                            print_accounting);
+                }
+            }
             /* dump connections to screen */
-            if (control.print && ct->conn_array != NULL) {
-                const unsigned int array_size = ct->conn_list.len;
+            else if (control.print) {
+                const unsigned int array_size = table.list.len;
                 unsigned int idx = 0;
 
                 for (printed = 0; printed < max_onscreen && idx < array_size;
                         idx++) {
-                    struct vrmr_conntrack_entry *cd_ptr = ct->conn_array[idx];
+                    struct vrmr_conntrack_entry *cd_ptr = table.list.data[idx];
                     vrmr_fatal_if_null(cd_ptr);
 
                     if (connreq.sort_conn_status) {
@@ -746,11 +775,10 @@ int connections_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
                     mvwprintw(conn_win, 0, 64, "%s:", gettext("Forwarding"));
                     mvwprintw(conn_win, 1, 40, "%s:", gettext("Outgoing"));
 
-                    mvwprintw(
-                            conn_win, 0, 34, "%4d", ct->conn_stats.conn_total);
-                    mvwprintw(conn_win, 0, 58, "%4d", ct->conn_stats.conn_in);
-                    mvwprintw(conn_win, 0, 78, "%4d", ct->conn_stats.conn_fw);
-                    mvwprintw(conn_win, 1, 58, "%4d", ct->conn_stats.conn_out);
+                    mvwprintw(conn_win, 0, 34, "%4d", table.stats.conn_total);
+                    mvwprintw(conn_win, 0, 58, "%4d", table.stats.conn_in);
+                    mvwprintw(conn_win, 0, 78, "%4d", table.stats.conn_fw);
+                    mvwprintw(conn_win, 1, 58, "%4d", table.stats.conn_out);
 
                     wattroff(conn_win, vccnf.color_bgd_green | A_BOLD);
 
@@ -760,7 +788,7 @@ int connections_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
                     mvwprintw(conn_win, 2, 3, " %s ",
                             gettext("Established Connections"));
                     mvwprintw(conn_win, 2, max_width - 11, " (%d) ",
-                            ct->conn_stats.stat_estab);
+                            table.stats.stat_estab);
                     wattroff(conn_win, vccnf.color_bgd_yellow | A_BOLD);
 
                     // print at the half of the screen
@@ -770,7 +798,7 @@ int connections_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
                     mvwprintw(conn_win, (max_onscreen / 4) * 2, 3, " %s ",
                             gettext("Connections Initializing"));
                     mvwprintw(conn_win, (max_onscreen / 4) * 2, max_width - 11,
-                            " (%d) ", ct->conn_stats.stat_connect);
+                            " (%d) ", table.stats.stat_connect);
                     wattroff(conn_win, vccnf.color_bgd_green | A_BOLD);
 
                     mvwhline(conn_win, (max_onscreen / 4) * 3, 0, ACS_HLINE,
@@ -779,7 +807,7 @@ int connections_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
                     mvwprintw(conn_win, (max_onscreen / 4) * 3, 3, " %s ",
                             gettext("Connections Closing"));
                     mvwprintw(conn_win, (max_onscreen / 4) * 3, max_width - 11,
-                            " (%d) ", ct->conn_stats.stat_closing);
+                            " (%d) ", table.stats.stat_closing);
                     wattroff(conn_win, vccnf.color_bgd_red | A_BOLD);
 
                     // move the cursor a bit out of sight
@@ -794,14 +822,10 @@ int connections_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
                     mvwprintw(conn_win, 0, 64, "%s:", gettext("Established"));
                     mvwprintw(conn_win, 1, 40, "%s:", gettext("Disconnecting"));
 
-                    mvwprintw(
-                            conn_win, 0, 34, "%4d", ct->conn_stats.conn_total);
-                    mvwprintw(conn_win, 0, 58, "%4d",
-                            ct->conn_stats.stat_connect);
-                    mvwprintw(
-                            conn_win, 0, 78, "%4d", ct->conn_stats.stat_estab);
-                    mvwprintw(conn_win, 1, 58, "%4d",
-                            ct->conn_stats.stat_closing);
+                    mvwprintw(conn_win, 0, 34, "%4d", table.stats.conn_total);
+                    mvwprintw(conn_win, 0, 58, "%4d", table.stats.stat_connect);
+                    mvwprintw(conn_win, 0, 78, "%4d", table.stats.stat_estab);
+                    mvwprintw(conn_win, 1, 58, "%4d", table.stats.stat_closing);
                     wattroff(conn_win, vccnf.color_bgd_green | A_BOLD);
 
                     /* */
@@ -810,7 +834,7 @@ int connections_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
                     mvwprintw(conn_win, 2, 3, " %s ",
                             gettext("Forwarded Connections"));
                     mvwprintw(conn_win, 2, max_width - 11, " (%d) ",
-                            ct->conn_stats.conn_fw);
+                            table.stats.conn_fw);
                     wattroff(conn_win, vccnf.color_bgd_yellow | A_BOLD);
 
                     /* print at the one third of the screen */
@@ -820,7 +844,7 @@ int connections_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
                     mvwprintw(conn_win, (max_onscreen / 3) + 3, 3, " %s ",
                             gettext("Incoming Connections"));
                     mvwprintw(conn_win, (max_onscreen / 3) + 3, max_width - 11,
-                            " (%d) ", ct->conn_stats.conn_in);
+                            " (%d) ", table.stats.conn_in);
                     wattroff(conn_win, vccnf.color_bgd_green | A_BOLD);
 
                     mvwhline(conn_win, (max_onscreen / 3) * 2 + 2, 0, ACS_HLINE,
@@ -829,7 +853,7 @@ int connections_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
                     mvwprintw(conn_win, (max_onscreen / 3) * 2 + 2, 3, " %s ",
                             gettext("Outgoing Connections"));
                     mvwprintw(conn_win, (max_onscreen / 3) * 2 + 2,
-                            max_width - 11, " (%d) ", ct->conn_stats.conn_out);
+                            max_width - 11, " (%d) ", table.stats.conn_out);
                     wattroff(conn_win, vccnf.color_bgd_red | A_BOLD);
 
                     /* move the cursor a bit out of sight */
@@ -838,8 +862,6 @@ int connections_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
 
                 wrefresh(conn_win);
             }
-
-            conn_ct_clear_connections(ct);
         }
 
         /*
@@ -882,6 +904,7 @@ int connections_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
                 } else {
                     connreq.sort_conn_status = TRUE;
                     connreq.sort_in_out_fwd = FALSE;
+                    connreq.sort_rate = FALSE;
                 }
 
                 control.sleep = 0;
@@ -893,6 +916,19 @@ int connections_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
                 } else {
                     connreq.sort_in_out_fwd = TRUE;
                     connreq.sort_conn_status = FALSE;
+                    connreq.sort_rate = FALSE;
+                }
+
+                control.sleep = 0;
+                break;
+
+            case 'r':
+                if (connreq.sort_rate == TRUE) {
+                    connreq.sort_rate = FALSE;
+                } else {
+                    connreq.sort_rate = TRUE;
+                    connreq.sort_in_out_fwd = FALSE;
+                    connreq.sort_conn_status = FALSE;
                 }
 
                 control.sleep = 0;
@@ -944,14 +980,14 @@ int connections_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
                     vrmr_filter_cleanup(&connreq.filter);
                 }
 
-                if (connreq.filter.reg_active == TRUE) {
+                if (connreq.filter.expr != NULL) {
                     status_print(status_win,
                             gettext("Active filter: '%s' (press 'enter' to "
                                     "clear)."),
                             connreq.filter.str);
                     connreq.use_filter = TRUE;
                 } else if (connreq.use_filter == TRUE &&
-                           connreq.filter.reg_active == FALSE) {
+                           connreq.filter.expr == NULL) {
                     status_print(status_win, gettext("Filter removed."));
                     connreq.use_filter = FALSE;
                 }
@@ -964,7 +1000,7 @@ int connections_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
             case 'k':
 
                 conn_ct_get_connections(cnf, ct, &connreq);
-                statevent(vctx, cnf, STATEVENTTYPE_CONN, &ct->conn_list, ct,
+                statevent(vctx, cnf, STATEVENTTYPE_CONN, NULL, ct,
                         &connreq, zones, blocklist, interfaces, services);
                 conn_ct_clear_connections(ct);
 
@@ -992,6 +1028,8 @@ int connections_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
         }
     }
 
+    free(top);
+    vrmr_conn_table_cleanup(&table);
     conn_free_ct(&ct, zones);
 
     /* filter clean up */
@@ -1041,12 +1079,11 @@ int kill_connection(
 int kill_connections_by_name(struct conntrack *ct, char *srcname, char *dstname,
         char *sername, char connect_status)
 {
-    struct vrmr_list_node *d_node = NULL;
     int cnt = 0, failed = 0;
 
-    for (d_node = ct->conn_list.top; d_node; d_node = d_node->next) {
-        vrmr_fatal_if_null(d_node->data);
-        struct vrmr_conntrack_entry *cd_ptr = d_node->data;
+    for (unsigned int i = 0; i < ct->conn_list.len; i++) {
+        vrmr_fatal_if_null(ct->conn_list.data[i]);
+        struct vrmr_conntrack_entry *cd_ptr = ct->conn_list.data[i];
 
         vrmr_debug(LOW, "ct: s:%s d:%s s:%s (%d)", cd_ptr->fromname,
                 cd_ptr->toname, cd_ptr->sername, cd_ptr->cnt);
@@ -1093,12 +1130,11 @@ int kill_connections_by_name(struct conntrack *ct, char *srcname, char *dstname,
 int kill_connections_by_ip(struct conntrack *ct, char *srcip, char *dstip,
         char *sername, char connect_status)
 {
-    struct vrmr_list_node *d_node = NULL;
     int cnt = 0, failed = 0;
 
-    for (d_node = ct->conn_list.top; d_node; d_node = d_node->next) {
-        vrmr_fatal_if_null(d_node->data);
-        struct vrmr_conntrack_entry *cd_ptr = d_node->data;
+    for (unsigned int i = 0; i < ct->conn_list.len; i++) {
+        vrmr_fatal_if_null(ct->conn_list.data[i]);
+        struct vrmr_conntrack_entry *cd_ptr = ct->conn_list.data[i];
 
         if (srcip == NULL || strcmp(srcip, cd_ptr->src_ip) == 0) {
             if (dstip == NULL ||
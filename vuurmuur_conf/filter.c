@@ -29,7 +29,6 @@ struct {
 static int filter_save(struct vrmr_filter *filter)
 {
     size_t i = 0;
-    char filter_str[48] = "";
 
     /* safety */
     vrmr_fatal_if_null(filter);
@@ -47,42 +46,16 @@ static int filter_save(struct vrmr_filter *filter)
         }
         /* ipaddress field */
         else if (filter_fields.fields[i] == filter_fields.string_fld) {
-            copy_field2buf(filter->str,
-                    field_buffer(filter_fields.fields[i], 0),
-                    sizeof(filter->str));
-
-            vrmr_debug(MEDIUM, "filter field changed: %s.", filter->str);
-
-            /* new str */
-            if (StrLen(filter->str) > 0) {
-                if (filter->reg_active == TRUE) {
-                    /* first remove old regex */
-                    regfree(&filter->reg);
-                    /* set reg_active to false */
-                    filter->reg_active = FALSE;
-                }
-
-                snprintf(filter_str, sizeof(filter_str), ".*%s.*", filter->str);
-
-                /* create the new regex */
-                if (regcomp(&filter->reg, filter_str, REG_EXTENDED) != 0) {
-                    vrmr_error(-1, VR_INTERR,
-                            "setting up the regular expression with regcomp "
-                            "failed. Disabling filter.");
-                    return (-1);
-                }
-
-                /* set reg_active to true */
-                filter->reg_active = TRUE;
-            }
+            char str[sizeof(filter->str)];
+            copy_field2buf(str, field_buffer(filter_fields.fields[i], 0),
+                    sizeof(str));
 
-            /* empty field, remove regex */
-            if (StrLen(filter->str) == 0 && filter->reg_active == TRUE) {
-                /* first remove old regex */
-                regfree(&filter->reg);
+            vrmr_debug(MEDIUM, "filter field changed: %s.", str);
 
-                /* set reg_active to false */
-                filter->reg_active = FALSE;
+            /* compile the new filter, an empty field removes it */
+            if (vrmr_filter_compile(filter, str) < 0) {
+                (void)vrmr_filter_compile(filter, "");
+                return (-1);
             }
         } else {
             vrmr_fatal("unknown field");
@@ -107,7 +80,7 @@ int filter_input_box(struct vrmr_filter *filter)
     /* set the window size */
     getmaxyx(stdscr, max_height, max_width);
     height = 9;
-    width = 48;
+    width = 68;
     /* print on the center of the screen */
     starty = (max_height - height) / 2;
     startx = (max_width - width) / 2;
@@ -125,7 +98,7 @@ int filter_input_box(struct vrmr_filter *filter)
     vrmr_fatal_alloc("calloc", filter_fields.fields);
 
     filter_fields.string_fld =
-            (filter_fields.fields[0] = new_field_wrap(1, 31, 3, 4, 0, 0));
+            (filter_fields.fields[0] = new_field_wrap(1, 63, 3, 2, 0, 0));
     filter_fields.check_fld =
             (filter_fields.fields[1] = new_field_wrap(1, 1, 5, 5, 0, 0));
 
@@ -208,6 +181,11 @@ int filter_input_box(struct vrmr_filter *filter)
 
                     quit = 1;
                     break;
+
+                case KEY_F(12):
+
+                    print_help(":[VUURMUUR:FILTER]:");
+                    break;
             }
         }
 
@@ -796,7 +796,7 @@ void setup_statuslist(void)
     vuurmuur_status.services = 1;
     vuurmuur_status.rules = 1;
 
-    vuurmuur_status.shm = 1;
+    vuurmuur_status.daemons = 1;
     vuurmuur_status.backend = 1;
     vuurmuur_status.config = 1;
     vuurmuur_status.settings = 1;
@@ -1642,9 +1642,7 @@ static int rename_interface(struct vrmr_ctx *vctx,
         return (-1);
     }
 
-    if (strlcpy(iface_ptr->name, new_name_ptr, sizeof(iface_ptr->name)) >=
-            sizeof(iface_ptr->name)) {
-        vrmr_error(-1, VR_INTERR, "buffer overflow");
+    if (vrmr_interfaces_set_name(interfaces, iface_ptr, new_name_ptr) < 0) {
         return (-1);
     }
     iface_ptr = NULL;
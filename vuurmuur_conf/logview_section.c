@@ -87,7 +87,7 @@ static void logline2logrule(const char *logline, struct log_record *logrule)
 }
 
 static void logline2plainlogrule(
-        char *logline, struct plain_log_record *logrule)
+        const char *logline, struct plain_log_record *logrule)
 {
     vrmr_fatal_if_null(logline);
     vrmr_fatal_if_null(logrule);
@@ -95,6 +95,98 @@ static void logline2plainlogrule(
     (void)strlcpy(logrule->line, logline, sizeof(logrule->line));
 }
 
+/* fields that are only in the details of a log line */
+#define LOGRULE_DETAIL_FIELDS                                                  \
+    ((1U << VRMR_FILTER_SRC) | (1U << VRMR_FILTER_DST) |                       \
+            (1U << VRMR_FILTER_IP) | (1U << VRMR_FILTER_SPORT) |               \
+            (1U << VRMR_FILTER_DPORT) | (1U << VRMR_FILTER_PORT) |             \
+            (1U << VRMR_FILTER_PROTO) | (1U << VRMR_FILTER_IN) |               \
+            (1U << VRMR_FILTER_OUT))
+
+struct logrule_details {
+    char in[VRMR_MAX_INTERFACE];
+    char out[VRMR_MAX_INTERFACE];
+    char src_ip[46];
+    char dst_ip[46];
+};
+
+/* split an address from the details, like '10.0.0.1(00:11:22:33:44:55):80',
+ * into ip and port */
+static void logrule_details_addr(const char *str, size_t len, bool ports,
+        char *ip, size_t size, int *port)
+{
+    const char *end = str + len;
+
+    if (ports) {
+        const char *colon = memrchr(str, ':', len);
+        if (colon != NULL) {
+            *port = atoi(colon + 1);
+            end = colon;
+        }
+    }
+    /* strip the mac */
+    const char *mac = memchr(str, '(', (size_t)(end - str));
+    if (mac != NULL)
+        end = mac;
+
+    snprintf(ip, size, "%.*s", (int)(end - str), str);
+}
+
+/* get the interfaces, addresses, ports and protocol from the details:
+ * '(in: eth0 out: eth1 10.0.0.1:1024 -> 10.0.0.2:22 TCP flags: ...' */
+static void logrule_parse_details(const char *details,
+        struct logrule_details *d, struct vrmr_filter_record *rec)
+{
+    char word[64];
+    int n = 0;
+
+    if (*details == '(')
+        details++;
+
+    while (sscanf(details, "%63s%n", word, &n) == 1) {
+        details += n;
+        if (strcmp(word, "in:") == 0) {
+            if (sscanf(details, "%31s%n", d->in, &n) == 1) {
+                details += n;
+                rec->in = d->in;
+            }
+        } else if (strcmp(word, "out:") == 0) {
+            if (sscanf(details, "%31s%n", d->out, &n) == 1) {
+                details += n;
+                rec->out = d->out;
+            }
+        } else {
+            break;
+        }
+    }
+
+    /* word is the source now, followed by '-> dst proto' */
+    char dst[64], proto[16];
+    if (sscanf(details, " -> %63s %15s", dst, proto) != 2)
+        return;
+
+    const bool ports = (strcmp(proto, "TCP") == 0 || strcmp(proto, "UDP") == 0);
+    if (strcmp(proto, "TCP") == 0)
+        rec->protocol = 6;
+    else if (strcmp(proto, "UDP") == 0)
+        rec->protocol = 17;
+    else if (strcmp(proto, "ICMP") == 0)
+        rec->protocol = 1;
+    else if (strcmp(proto, "GRE") == 0)
+        rec->protocol = 47;
+    else if (strcmp(proto, "ESP") == 0)
+        rec->protocol = 50;
+    else if (strcmp(proto, "AH") == 0)
+        rec->protocol = 51;
+
+    logrule_details_addr(word, strlen(word), ports, d->src_ip,
+            sizeof(d->src_ip), &rec->src_port);
+    logrule_details_addr(dst, strlen(dst), ports, d->dst_ip,
+            sizeof(d->dst_ip), &rec->dst_port);
+    rec->src_ip = d->src_ip;
+    rec->dst_ip = d->dst_ip;
+}
+
 /*
 
     Returncodes:
@@ -104,32 +196,28 @@ static void logline2plainlogrule(
 static int logrule_filtered(
         struct log_record *log_record, struct vrmr_filter *filter)
 {
-    char line[1024];
+    struct logrule_details details;
 
     vrmr_fatal_if_null(log_record);
     vrmr_fatal_if_null(filter);
 
-    /*                            mo da ti  ac se fr to   pr  de */
-    snprintf(line, sizeof(line), "%s %s %s: %s %s %s %s, '%s' %s",
-            log_record->month, log_record->date, log_record->time,
-            log_record->action, log_record->service, log_record->from,
-            log_record->to, log_record->prefix, log_record->details);
-
-    /*  check the regex
-
-        If the regex matches, the line is not filtered, so we return 0.
-    */
-    if (regexec(&filter->reg, line, 0, NULL, 0) == 0) {
-        if (filter->neg == FALSE)
-            return (0);
-        else
-            return (1);
-    } else {
-        if (filter->neg == FALSE)
-            return (1);
-        else
-            return (0);
-    }
+    struct vrmr_filter_record rec = {
+            .service = log_record->service,
+            .from = log_record->from,
+            .to = log_record->to,
+            .action = log_record->action,
+            .prefix = log_record->prefix,
+            .src_port = -1,
+            .dst_port = -1,
+            .protocol = -1,
+            .line = log_record->details,
+    };
+
+    /* only parse the details if the filter needs them */
+    if (filter->fields & LOGRULE_DETAIL_FIELDS)
+        logrule_parse_details(log_record->details, &details, &rec);
+
+    return (vrmr_filter_match(filter, &rec) ? 0 : 1);
 }
 
 /*
@@ -142,21 +230,14 @@ static int plainlogrule_filtered(char *line, struct vrmr_filter *filter)
     vrmr_fatal_if_null(line);
     vrmr_fatal_if_null(filter);
 
-    /*  check the regex
+    const struct vrmr_filter_record rec = {
+            .src_port = -1,
+            .dst_port = -1,
+            .protocol = -1,
+            .line = line,
+    };
 
-        If the regex matches, the line is not filtered, so we return 0.
-    */
-    if (regexec(&filter->reg, line, 0, NULL, 0) == 0) {
-        if (filter->neg == FALSE)
-            return (0);
-        else
-            return (1);
-    } else {
-        if (filter->neg == FALSE)
-            return (1);
-        else
-            return (0);
-    }
+    return (vrmr_filter_match(filter, &rec) ? 0 : 1);
 }
 
 static void draw_filter(PANEL *pan, WINDOW *win, char *filter)
@@ -185,59 +266,6 @@ static void draw_search(PANEL *pan, WINDOW *win, char *search)
     doupdate();
 }
 
-static int check_search_script(const char *script)
-{
-    struct stat stat_buf;
-
-    vrmr_fatal_if_null(script);
-
-    if (lstat(script, &stat_buf) == -1) {
-        vrmr_error(-1, VR_ERR, gettext("checking failed for '%s': %s."), script,
-                strerror(errno));
-        return (0);
-    }
-
-    /* we wont open symbolic links */
-    if (S_ISLNK(stat_buf.st_mode) == 1) {
-        vrmr_error(-1, VR_ERR,
-                gettext("opening file '%s': For security reasons Vuurmuur will "
-                        "not allow following symbolic-links."),
-                script);
-        return (0);
-    }
-
-    /* only allow files and dirs */
-    if (!S_ISREG(stat_buf.st_mode) && !S_ISDIR(stat_buf.st_mode)) {
-        vrmr_error(-1, VR_ERR,
-                gettext("opening file '%s': For security reasons Vuurmuur will "
-                        "not allow opening anything other than a file or a "
-                        "directory."),
-                script);
-        return (0);
-    }
-
-    /* if a file is writable by someone other than root, we refuse to open it */
-    if (stat_buf.st_mode & S_IWGRP || stat_buf.st_mode & S_IWOTH) {
-        vrmr_error(-1, VR_ERR,
-                gettext("opening file '%s': For security reasons Vuurmuur will "
-                        "not open files that are writable by 'group' or "
-                        "'other'. Check the file content & permissions."),
-                script);
-        return (0);
-    }
-
-    /* we demand that all files are owned by root */
-    if (stat_buf.st_uid != 0) {
-        vrmr_error(-1, VR_ERR,
-                gettext("opening file '%s': For security reasons Vuurmuur will "
-                        "not open files that are not owned by root."),
-                script);
-        return (0);
-    }
-
-    return (1);
-}
-
 static void print_logrule(WINDOW *log_win, struct log_record *log_record,
         size_t max_logrule_length, size_t cur_logrule_length, char hide_date,
         char hide_action, char hide_service, char hide_from, char hide_to,
@@ -509,18 +537,6 @@ static void print_plainlogrule(WINDOW *log_win, char *line,
     }
 }
 
-static void sanitize_search_str(char *str, size_t size)
-{
-    size_t i = 0;
-
-    for (i = 0; i < size; i++) {
-        if (str[i] == '\'')
-            str[i] = '_';
-        else if (str[i] == '\"')
-            str[i] = '_';
-    }
-}
-
 struct logview_control {
     bool print; // do we print to screen this run?
     bool sleep; // do we sleep this run
@@ -529,15 +545,72 @@ struct logview_control {
 
     bool use_filter;
 
-    bool search_mode;
-    bool search_stop;
-    bool search_error;
     bool search_completed;
     uint32_t search_results;
+
+    bool browse; // viewing older lines of the log using the index
 };
 
 #define READLINE_LEN 512
 
+/* insert a line into the buffer list, at the bottom or at the top */
+static void add_log_line(const char *line, const bool traffic_log,
+        struct vrmr_filter *vfilter, struct logview_control *ctl,
+        struct vrmr_list *logs, const uint32_t max_logs, const bool at_top)
+{
+    void *record = NULL;
+
+    if (traffic_log) {
+        /* here we can analyse the rule */
+        struct log_record *log_record = malloc(sizeof(struct log_record));
+        vrmr_fatal_alloc("malloc", log_record);
+
+        /* we asume unfiltered (was filtered) */
+        log_record->filtered = 0;
+
+        /* convert the raw line to our data structure */
+        logline2logrule(line, log_record);
+
+        /* if we have a filter check it now */
+        if (ctl->use_filter) {
+            log_record->filtered = logrule_filtered(log_record, vfilter);
+        }
+        record = log_record;
+    } else {
+        /* here we can analyse the rule */
+        struct plain_log_record *plainlog_record =
+                malloc(sizeof(struct plain_log_record));
+        vrmr_fatal_alloc("malloc", plainlog_record);
+
+        /* we asume unfiltered (was filtered) */
+        plainlog_record->filtered = 0;
+
+        logline2plainlogrule(line, plainlog_record);
+
+        /* if we have a filter check it now */
+        if (ctl->use_filter) {
+            plainlog_record->filtered =
+                    plainlogrule_filtered(plainlog_record->line, vfilter);
+        }
+        record = plainlog_record;
+    }
+
+    /* now really insert the rule into the buffer. If the bufferlist is
+     * full, remove the item at the other end from it. */
+    if (at_top) {
+        vrmr_fatal_if(vrmr_list_prepend(logs, record) == NULL);
+        if (logs->len > max_logs) {
+            vrmr_fatal_if(vrmr_list_remove_bot(logs) < 0);
+        }
+    } else {
+        vrmr_fatal_if(vrmr_list_append(logs, record) == NULL);
+        if (logs->len > max_logs) {
+            vrmr_fatal_if(vrmr_list_remove_top(logs) < 0);
+        }
+    }
+    ctl->queue++;
+}
+
 static int read_log_line(FILE *fp, const bool traffic_log,
         struct vrmr_filter *vfilter, struct logview_control *ctl,
         struct vrmr_list *logs, const uint32_t max_logs)
@@ -568,75 +641,202 @@ static int read_log_line(FILE *fp, const bool traffic_log,
         return 0;
     }
 
-    if (ctl->search_mode) {
-        if (strncmp(line, "SL:EOF:", 7) == 0) {
-            ctl->search_completed = true;
-        } else if (strncmp(line, "SL:ERROR:", 9) == 0) {
-            ctl->search_error = true;
-            ctl->search_completed = true;
-            line[StrMemLen(line) - 2] = '\0';
-            vrmr_error(-1, VR_ERR, "%s", line);
-        } else {
-            ctl->search_results++;
-        }
+    add_log_line(line, traffic_log, vfilter, ctl, logs, max_logs, false);
+
+    /* free the line string, we don't need it anymore */
+    free(line);
+    return 1;
+}
+
+/*  load_log_lines
+
+    Loads 'n' lines starting at line 'first' of the log, using the index
+    to find the line. The lines are added at the top or at the bottom of
+    'logs'.
+
+    Returns the number of lines loaded.
+*/
+static unsigned int load_log_lines(struct vrmr_logindex *idx, uint64_t first,
+        unsigned int n, const bool traffic_log, struct vrmr_filter *vfilter,
+        struct logview_control *ctl, struct vrmr_list *logs,
+        const uint32_t max_logs, const bool at_top)
+{
+    uint64_t offset = 0;
+    unsigned int loaded = 0;
+    FILE *fp = NULL;
+
+    if (n == 0 || vrmr_logindex_line_offset(idx, first, &offset) < 0)
+        return (0);
+
+    if (!(fp = fopen(idx->logfile, "r"))) {
+        vrmr_error(-1, VR_ERR, gettext("opening logfile '%s' failed: %s."),
+                idx->logfile, strerror(errno));
+        return (0);
+    }
+    if (fseeko(fp, (off_t)offset, SEEK_SET) != 0) {
+        vrmr_error(-1, VR_ERR, gettext("fseek failed: %s."), strerror(errno));
+        fclose(fp);
+        return (0);
+    }
+
+    char **lines = calloc(n, sizeof(char *));
+    vrmr_fatal_alloc("calloc", lines);
+
+    for (loaded = 0; loaded < n; loaded++) {
+        char *line = malloc(READLINE_LEN);
+        vrmr_fatal_alloc("malloc", line);
 
-        if (ctl->search_completed) {
-            /* if we bail out here it's because of an EOF or ERROR
-               and we are not interested in the line. So free it. */
+        if (fgets(line, READLINE_LEN, fp) == NULL) {
             free(line);
-            return 0;
+            break;
+        }
+        size_t linelen = StrMemLen(line);
+        if (line[linelen - 1] != '\n') {
+            /* a line that is still being written */
+            if (linelen < READLINE_LEN - 1) {
+                free(line);
+                break;
+            }
+            /* a line that is too long: skip the rest of it, so we stay
+             * in line with the index */
+            int c;
+            while ((c = fgetc(fp)) != EOF && c != '\n')
+                ;
         }
+        lines[loaded] = line;
     }
+    fclose(fp);
 
-    /* insert the line into the buffer list */
-    if (traffic_log) {
-        /* here we can analyse the rule */
-        struct log_record *log_record = malloc(sizeof(struct log_record));
-        vrmr_fatal_alloc("malloc", log_record);
+    /* at the top the lines are added last first */
+    for (unsigned int i = 0; i < loaded; i++) {
+        const char *line = lines[at_top ? loaded - i - 1 : i];
+        add_log_line(line, traffic_log, vfilter, ctl, logs, max_logs, at_top);
+    }
+    for (unsigned int i = 0; i < loaded; i++)
+        free(lines[i]);
+    free(lines);
+    return (loaded);
+}
 
-        /* we asume unfiltered (was filtered) */
-        log_record->filtered = 0;
+struct search_results {
+    bool traffic_log;
+    struct vrmr_filter *vfilter;
+    struct logview_control *ctl;
+    struct vrmr_list *logs;
+    uint32_t max_logs;
+};
 
-        /* convert the raw line to our data structure */
-        logline2logrule(line, log_record);
+static void search_result_line(const char *line, size_t len, void *ctx)
+{
+    struct search_results *res = ctx;
+    char buf[READLINE_LEN];
 
-        /* if we have a filter check it now */
-        if (ctl->use_filter) {
-            log_record->filtered = logrule_filtered(log_record, vfilter);
-        }
+    /* make it look like a line read by fgets */
+    snprintf(buf, sizeof(buf), "%.*s\n", (int)MIN(len, sizeof(buf) - 2), line);
+    add_log_line(buf, res->traffic_log, res->vfilter, res->ctl, res->logs,
+            res->max_logs, false);
+}
 
-        /* now really insert the rule into the buffer */
-        vrmr_fatal_if(vrmr_list_append(logs, log_record) == NULL);
-    } else {
-        /* here we can analyse the rule */
-        struct plain_log_record *plainlog_record =
-                malloc(sizeof(struct plain_log_record));
-        vrmr_fatal_alloc("malloc", plainlog_record);
+static int rotated_cmp(const void *a, const void *b)
+{
+    unsigned long x = *(const unsigned long *)a;
+    unsigned long y = *(const unsigned long *)b;
 
-        /* we asume unfiltered (was filtered) */
-        plainlog_record->filtered = 0;
+    /* highest number, so oldest, first */
+    return (x < y) - (x > y);
+}
 
-        logline2plainlogrule(line, plainlog_record);
+/*  search_logs
 
-        /* if we have a filter check it now */
-        if (ctl->use_filter) {
-            plainlog_record->filtered =
-                    plainlogrule_filtered(plainlog_record->line, vfilter);
-        }
+    Searches the log and its rotated versions '<log>.N', oldest first.
+    Compressed rotated logs are not searched. The last matches end up in
+    res->logs. A term query on the traffic log is answered using the term
+    index, see vrmr_logterms_query().
 
-        /* now insert the rule */
-        vrmr_fatal_if(vrmr_list_append(logs, plainlog_record) == NULL);
+    Returns the number of matches, or -1 on error.
+*/
+static int64_t search_logs(
+        const char *logfile, const char *pattern, struct search_results *res)
+{
+    char dir[PATH_MAX] = ".", path[PATH_MAX];
+    const char *base = logfile;
+    unsigned long *nums = NULL;
+    size_t nums_len = 0;
+    int64_t matches = 0;
+
+    /* "action:DROP from:..." queries use the term index of the traffic log */
+    const bool query = res->traffic_log && vrmr_logterms_is_query(pattern);
+
+    const char *slash = strrchr(logfile, '/');
+    if (slash != NULL) {
+        base = slash + 1;
+        snprintf(dir, sizeof(dir), "%.*s", (int)(slash - logfile), logfile);
+        if (dir[0] == '\0')
+            (void)strlcpy(dir, "/", sizeof(dir));
     }
-    /* if the bufferlist is full, remove the oldest item from it
-     */
-    if (logs->len > max_logs) {
-        vrmr_fatal_if(vrmr_list_remove_top(logs) < 0);
+    const size_t base_len = strlen(base);
+
+    DIR *d = opendir(dir);
+    if (d != NULL) {
+        struct dirent *de;
+        while ((de = readdir(d)) != NULL) {
+            if (strncmp(de->d_name, base, base_len) != 0 ||
+                    de->d_name[base_len] != '.')
+                continue;
+
+            const char *num = de->d_name + base_len + 1;
+            char *end = NULL;
+            unsigned long n = strtoul(num, &end, 10);
+            if (!isdigit((unsigned char)*num) || *end != '\0')
+                continue;
+
+            nums = realloc(nums, (nums_len + 1) * sizeof(*nums));
+            vrmr_fatal_alloc("realloc", nums);
+            nums[nums_len++] = n;
+        }
+        closedir(d);
     }
-    ctl->queue++;
+    if (nums_len > 0)
+        qsort(nums, nums_len, sizeof(*nums), rotated_cmp);
+
+    for (size_t i = 0; i <= nums_len; i++) {
+        if (i < nums_len) {
+            if (snprintf(path, sizeof(path), "%s.%lu", logfile, nums[i]) >=
+                    (int)sizeof(path))
+                continue;
+        } else {
+            (void)strlcpy(path, logfile, sizeof(path));
+        }
 
-    /* free the line string, we don't need it anymore */
-    free(line);
-    return 1;
+        int64_t r;
+        if (query)
+            r = vrmr_logterms_query(
+                    path, pattern, res->max_logs, search_result_line, res);
+        else
+            r = vrmr_log_search(
+                    path, pattern, res->max_logs, search_result_line, res);
+        if (r < 0) {
+            matches = -1;
+            break;
+        }
+        matches += r;
+    }
+    free(nums);
+    return (matches);
+}
+
+/* switch the view to the browse buffer */
+static void start_browse(struct vrmr_list *browse,
+        struct vrmr_list **buffer_ptr, struct logview_control *ctl)
+{
+    if (ctl->browse) {
+        vrmr_fatal_if(vrmr_list_cleanup(browse) < 0);
+    }
+    vrmr_list_setup(browse, free);
+    *buffer_ptr = browse;
+    ctl->browse = true;
+    ctl->pause = true;
+    ctl->print = true;
 }
 
 int logview_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
@@ -649,17 +849,16 @@ int logview_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
 
     PANEL *my_panels[1], *wait_panels[1], *info_bar_panels[2];
 
-    struct vrmr_list LogBufferList, SearchBufferList, *buffer_ptr = NULL;
+    struct vrmr_list LogBufferList, SearchBufferList, BrowseBufferList,
+            *buffer_ptr = NULL;
     unsigned int max_buffer_size = vccnf.logview_bufsize; // default
 
     unsigned int i = 0;
     int quit = 0, ch = 0;
 
-    FILE *fp = NULL, *traffic_fp = NULL, *search_pipe = NULL;
+    FILE *fp = NULL;
 
-    char *line = NULL,
-
-         *logfile = NULL,
+    char *logfile = NULL,
 
          /* infobar stuff */
             search[32] = "none";
@@ -667,55 +866,56 @@ int logview_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
     struct vrmr_list_node *d_node = NULL;
 
     int max_onscreen = 0;
-    unsigned int offset = 0, buffer_size = 0, start_print = 0, page = 0;
+    unsigned int offset = 0, buffer_size = 0, start_print = 0;
     int max_height = 0, max_width = 0;
 
     char hide_date = 0, hide_action = 0, hide_service = 0, hide_from = 0,
          hide_to = 0, hide_prefix = 0, hide_details = 0;
 
-    struct logview_control control = {
-            0, 0, 0, 0, false, false, false, false, false, 0};
+    struct logview_control control = {0, 0, 0, 0, false, false, 0, false};
 
     size_t max_logrule_length = 0, cur_logrule_length = 0;
 
     struct vrmr_filter vfilter;
 
-    int first_logline_done = 0, filtered_lines = 0;
+    int filtered_lines = 0;
 
     unsigned int run_count = 0;
     int delta = 0;
     unsigned int first_draw = 0;
     int drawn_lines = 0;
 
-    off_t logfile_size = 0;
-    long logfile_fseek_offset = 0;
-
-    char *search_ptr = NULL, search_string[PATH_MAX] = "";
+    /* the index of the log, for starting with the last lines and for
+     * browsing back in the log */
+    struct vrmr_logindex logidx;
+    bool logidx_ok = false;
+    uint64_t browse_first = 0, start_line = 0, start_offset = 0;
+    unsigned int step = 0, n = 0;
+    int top = 0;
 
-    char search_script_checked = 0, search_script_ok = 0;
+    char *search_ptr = NULL, *time_ptr = NULL;
 
     /* is the current log the trafficlog? */
     char traffic_log = FALSE;
 
     /* top menu */
-    const char *key_choices[] = {"F12", "m", "s", "f", "p", "c", "1-7", "F10"};
-    int key_choices_n = 8;
+    const char *key_choices[] = {
+            "F12", "m", "s", "g", "f", "p", "c", "1-7", "F10"};
+    int key_choices_n = 9;
     const char *cmd_choices[] = {gettext("help"), gettext("manage"),
-            gettext("search"), gettext("filter"), gettext("pause"),
-            gettext("clear"), gettext("hide"), gettext("back")};
-    int cmd_choices_n = 8;
+            gettext("search"), gettext("goto"), gettext("filter"),
+            gettext("pause"), gettext("clear"), gettext("hide"),
+            gettext("back")};
+    int cmd_choices_n = 9;
 
     /* nt = no trafficlog: hide "1-7 hide" and manage options for
      * non-trafficlogs */
-    const char *nt_key_choices[] = {"F12", "s", "f", "p", "c", "F10"};
-    int nt_key_choices_n = 6;
+    const char *nt_key_choices[] = {"F12", "s", "g", "f", "p", "c", "F10"};
+    int nt_key_choices_n = 7;
     const char *nt_cmd_choices[] = {gettext("help"), gettext("search"),
-            gettext("filter"), gettext("pause"), gettext("clear"),
-            gettext("back")};
-    int nt_cmd_choices_n = 6;
-
-    /* stat buffer, for checking the file size of the traffic-log */
-    struct stat stat_buf;
+            gettext("goto"), gettext("filter"), gettext("pause"),
+            gettext("clear"), gettext("back")};
+    int nt_cmd_choices_n = 7;
 
     /* safety */
     vrmr_fatal_if_null(zones);
@@ -758,17 +958,15 @@ int logview_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
     buffer_ptr = &LogBufferList;
 
     /* begin with the selected log file */
-    traffic_fp = fopen(logfile, "r");
-    if (traffic_fp == NULL) {
+    fp = fopen(logfile, "r");
+    if (fp == NULL) {
         vrmr_error(-1, VR_ERR, gettext("opening logfile '%s' failed: %s."),
                 logfile, strerror(errno));
         vrmr_list_cleanup(buffer_ptr);
         return (-1);
     }
-    /* point it to the fp */
-    fp = traffic_fp;
 
-    vrmr_debug(LOW, "opening '%s' successful.", vctx->conf.trafficlog_location);
+    vrmr_debug(LOW, "opening '%s' successful.", logfile);
 
     /* set up the logwin */
     getmaxyx(stdscr, max_height, max_width);
@@ -778,30 +976,6 @@ int logview_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
     if (max_buffer_size < (unsigned int)max_onscreen)
         max_buffer_size = (unsigned int)max_onscreen;
 
-    /*  get the size of the logfile and check if were asking to much of
-        fseek. If so, ask less. */
-    if (stat(logfile, &stat_buf) == -1) {
-        vrmr_error(-1, VR_ERR, gettext("could not examine the logfile: %s."),
-                strerror(errno));
-        vrmr_list_cleanup(buffer_ptr);
-        fclose(fp);
-        return (-1);
-    }
-
-    logfile_size = stat_buf.st_size;
-    logfile_fseek_offset = (int)max_buffer_size * READLINE_LEN * -1;
-    if (logfile_fseek_offset < (logfile_size * -1))
-        logfile_fseek_offset = logfile_size * -1;
-
-    /* listen at the logfile_fseek_offset point in the file, so we start with a
-     * populated buffer */
-    if (fseek(fp, logfile_fseek_offset, SEEK_END) < 0) {
-        vrmr_error(-1, VR_ERR, gettext("fseek failed: %s."), strerror(errno));
-        vrmr_list_cleanup(buffer_ptr);
-        fclose(fp);
-        return (-1);
-    }
-
     status_print(status_win,
             gettext("Loading loglines into memory (trying to load %u "
                     "lines)..."),
@@ -826,93 +1000,45 @@ int logview_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
     update_panels();
     doupdate();
 
+    /* index the log so we can start at the last lines. Only the part that
+     * was added since the last time has to be read. Without an index we
+     * start at the end of the log. */
+    if (vrmr_logindex_open(&logidx, logfile) == 0) {
+        if (vrmr_logindex_update(&logidx) == 0)
+            logidx_ok = true;
+        else
+            vrmr_logindex_close(&logidx);
+    }
+    if (logidx_ok) {
+        if (logidx.lines > max_buffer_size)
+            start_line = logidx.lines - max_buffer_size;
+        if (vrmr_logindex_line_offset(&logidx, start_line, &start_offset) < 0)
+            start_offset = logidx.size;
+    } else {
+        vrmr_warning(VR_WARN,
+                gettext("indexing logfile '%s' failed, only new lines will "
+                        "be shown."),
+                logfile);
+    }
+
+    if ((logidx_ok && fseeko(fp, (off_t)start_offset, SEEK_SET) < 0) ||
+            (!logidx_ok && fseeko(fp, 0, SEEK_END) < 0)) {
+        vrmr_error(-1, VR_ERR, gettext("fseek failed: %s."), strerror(errno));
+        del_panel(wait_panels[0]);
+        destroy_win(wait_win);
+        vrmr_list_cleanup(buffer_ptr);
+        if (logidx_ok)
+            vrmr_logindex_close(&logidx);
+        fclose(fp);
+        return (-1);
+    }
+
     /*
         load the initial lines
     */
-    while (1) {
-        /* read line from log */
-        line = malloc(READLINE_LEN);
-        vrmr_fatal_alloc("malloc", line);
-
-        if (fgets(line, READLINE_LEN, fp) == NULL) {
-            /* free the alloced line */
-            free(line);
-            clearerr(fp);
-            break;
-        }
-
-        /*  ignore the first line we read for it shall almost certainly be
-           broken because of fseek. */
-        if (!first_logline_done) {
-            first_logline_done = 1;
-            free(line);
-            continue;
-        }
-
-        /*
-           if the line doesn't end with a newline character we rewind and try
-           again.
-         */
-        long linelen = (long)StrMemLen(line);
-        if (linelen < READLINE_LEN - 1 && line[linelen - 1] != '\n') {
-            (void)fseek(fp, -linelen, SEEK_CUR);
-            free(line);
-            /* done because we reached the end of the file which does not have a
-             * newline */
-            break;
-        }
-
-        /*
-           insert the line into the buffer list
-         */
-        if (traffic_log) {
-            /* here we can analyse the rule */
-            struct log_record *log_record = malloc(sizeof(struct log_record));
-            vrmr_fatal_alloc("malloc", log_record);
-
-            /* start not filtered (was filtered) */
-            log_record->filtered = 0;
-
-            logline2logrule(line, log_record);
-
-            /* now insert the rule */
-            vrmr_fatal_if(vrmr_list_append(buffer_ptr, log_record) == NULL);
-
-            /* if the bufferlist is full, remove the oldest item from it */
-            if (buffer_ptr->len > max_buffer_size) {
-                vrmr_fatal_if(vrmr_list_remove_top(buffer_ptr) < 0);
-            }
-
-            log_record = NULL;
-            control.queue++;
-
-        } else {
-            /* here we can analyse the rule */
-            struct plain_log_record *plainlog_record =
-                    malloc(sizeof(struct plain_log_record));
-            vrmr_fatal_alloc("malloc", plainlog_record);
-
-            /* start not filtered (was filtered) */
-            plainlog_record->filtered = 0;
-
-            logline2plainlogrule(line, plainlog_record);
-
-            /* now insert the rule */
-            vrmr_fatal_if(
-                    vrmr_list_append(buffer_ptr, plainlog_record) == NULL);
-
-            /* if the bufferlist is full, remove the oldest item from it */
-            if (buffer_ptr->len > max_buffer_size) {
-                vrmr_fatal_if(vrmr_list_remove_top(buffer_ptr) < 0);
-            }
-
-            plainlog_record = NULL;
-            control.queue++;
-        }
-
-        /* free the line string, we don't need it anymore */
-        free(line);
-    }
+    while (read_log_line(fp, traffic_log, &vfilter, &control, buffer_ptr,
+                   max_buffer_size) == 1)
+        ;
     status_print(status_win,
             gettext("Loading loglines into memory... loaded %d lines."),
             buffer_ptr->len);
@@ -965,101 +1091,87 @@ int logview_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
             if (control.queue > 0)
                 control.print = true;
         }
-        /* handle the search mode */
-        if (control.search_mode) {
-            /* emergengy search stop */
-            if (control.search_stop) {
-                control.search_completed = true;
-            }
-
-            /*  if the search is completed we have to do two things:
-                1. cleanup search stuff so we can return to normal logging
-                2. inform the user
-
-                One thing is not done here: we don't clean the buffer and
-                we dont restore the bufferpointer to the LogBufferList
-                This is done only after the user disables the pause mode.
-
-                The reason for this is that we want to be able to scroll
-                through the search results.
-            */
-            if (control.search_completed) {
-                /* close the pipe */
-                if (search_pipe != NULL && pclose(search_pipe) < 0) {
-                    vrmr_error(-1, VR_ERR,
-                            gettext("closing search pipe failed: %s."),
-                            strerror(errno));
-                }
-                search_pipe = NULL;
-
-                /* restore file pointer */
-                fp = traffic_fp;
-
-                /* disable search_mode */
-                control.search_mode = false;
-
-                /* print the result */
-                if (control.search_stop) {
-                    status_print(status_win,
-                            gettext("Search canceled. Press SPACE to return to "
-                                    "normal logging."));
-                    control.search_stop = false;
-                } else if (control.search_error) {
-                    status_print(
-                            status_win, gettext("Search ERROR. Press SPACE to "
-                                                "return to normal logging."));
-                    control.search_error = false;
-                } else {
-                    status_print(status_win,
-                            gettext("Search done: %u matches. Press SPACE to "
-                                    "return to normal logging."),
-                            control.search_results);
-                }
-
-                /* pause to leave the results on screen */
-                control.pause = true;
-
-                /* finally free the search ptr */
-                free(search_ptr);
-                search_ptr = NULL;
-
-                /* reset counter */
-                control.search_results = 0;
-
-                /* clear for the infobar */
-                (void)strlcpy(search, "none", sizeof(search));
-
-                /* hide the search panel */
-                draw_search(info_bar_panels[1], search_ib_win, search);
-            }
-        }
-
         /* get the users input */
         ch = wgetch(log_win);
         switch (ch) {
             /* scrolling */
             case KEY_UP:
-                offset++;
-                control.print = true;
-                break;
-
-            case KEY_DOWN:
-                if (offset)
-                    offset--;
-                control.print = true;
-                break;
-
             case KEY_PPAGE:
-                offset = offset + max_onscreen - 1;
+                step = (ch == KEY_UP) ? 1 : (unsigned int)max_onscreen - 1;
+
+                /* scrolling past the top of the buffer: load the lines
+                 * before it from the log */
+                if (logidx_ok && !control.use_filter &&
+                        !control.search_completed &&
+                        buffer_ptr->len > (unsigned int)max_onscreen &&
+                        offset + step > buffer_ptr->len - max_onscreen) {
+                    if (!control.browse) {
+                        start_browse(&BrowseBufferList, &buffer_ptr, &control);
+                        (void)vrmr_logindex_update(&logidx);
+                        browse_first = 0;
+                        if (logidx.lines > max_buffer_size)
+                            browse_first = logidx.lines - max_buffer_size;
+                        (void)load_log_lines(&logidx, browse_first,
+                                max_buffer_size, traffic_log, &vfilter,
+                                &control, buffer_ptr, max_buffer_size, false);
+                        offset = 0;
+                        if (buffer_ptr->len > (unsigned int)max_onscreen)
+                            offset = buffer_ptr->len - max_onscreen;
+                        status_print(status_win,
+                                gettext("Browsing the log. Press SPACE to "
+                                        "return to the live log."));
+                    }
+
+                    /* the first line on screen */
+                    top = (int)buffer_ptr->len - max_onscreen - (int)offset;
+                    if (top < 0)
+                        top = 0;
+
+                    n = (unsigned int)MIN(
+                            browse_first, (uint64_t)max_onscreen - 1);
+                    if (n > 0) {
+                        browse_first -= n;
+                        n = load_log_lines(&logidx, browse_first, n,
+                                traffic_log, &vfilter, &control, buffer_ptr,
+                                max_buffer_size, true);
+
+                        /* keep the same lines on screen, the step below
+                         * moves up */
+                        top = (int)buffer_ptr->len - max_onscreen - top -
+                              (int)n;
+                        offset = top > 0 ? (unsigned int)top : 0;
+                    }
+                }
+                offset += step;
                 control.print = true;
                 break;
 
+            case KEY_DOWN:
             case KEY_NPAGE:
-                page = max_onscreen - 1;
-                if (page > offset)
+                step = (ch == KEY_DOWN) ? 1 : (unsigned int)max_onscreen - 1;
+
+                /* scrolling past the bottom while browsing: load the lines
+                 * after the buffer from the log */
+                if (control.browse && offset < step) {
+                    (void)vrmr_logindex_update(&logidx);
+
+                    uint64_t next = browse_first + buffer_ptr->len;
+                    if (next < logidx.lines) {
+                        unsigned int len = buffer_ptr->len;
+
+                        n = (unsigned int)MIN(logidx.lines - next,
+                                (uint64_t)max_onscreen - 1);
+                        n = load_log_lines(&logidx, next, n, traffic_log,
+                                &vfilter, &control, buffer_ptr,
+                                max_buffer_size, false);
+                        browse_first += len + n - buffer_ptr->len;
+                        offset += n;
+                    }
+                }
+                if (step > offset)
                     offset = 0;
                 else
-                    offset = offset - page;
+                    offset = offset - step;
                 control.print = true;
                 break;
 
@@ -1084,13 +1196,13 @@ int logview_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
                     vrmr_filter_cleanup(&vfilter);
                 }
 
-                if (vfilter.reg_active == TRUE) {
+                if (vfilter.expr != NULL) {
                     status_print(status_win,
                             gettext("Active filter: '%s' (press 'enter' to "
                                     "clear)."),
                             vfilter.str);
                     control.use_filter = true;
-                } else if (control.use_filter && vfilter.reg_active == FALSE) {
+                } else if (control.use_filter && vfilter.expr == NULL) {
                     status_print(status_win, gettext("Filter removed."));
                     control.use_filter = false;
                 }
@@ -1160,12 +1272,7 @@ int logview_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
             case 'Q':
             case KEY_F(10):
 
-                if (control.search_mode) {
-                    status_print(
-                            status_win, gettext("Search in progress. Press 'S' "
-                                                "to stop current search."));
-                    usleep(600000);
-                } else if (control.search_completed) {
+                if (control.search_completed) {
                     status_print(status_win,
                             gettext("Please first close the current search by "
                                     "pressing SPACE."));
@@ -1175,41 +1282,39 @@ int logview_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
                 }
                 break;
 
-            /* pause the logging or searching */
+            /* pause the logging */
             case 'p':
             case 32: /* spacebar */
 
                 if (control.pause) {
-                    /* here we do the final cleanup for the search mode. */
-                    if (control.search_completed) {
+                    /* here we do the final cleanup for the search and browse
+                     * modes. */
+                    if (control.search_completed || control.browse) {
                         /* cleanup the buffer */
                         vrmr_fatal_if(vrmr_list_cleanup(buffer_ptr) < 0);
 
                         /* restore buffer pointer */
                         buffer_ptr = &LogBufferList;
                         control.search_completed = false;
+                        control.search_results = 0;
+                        control.browse = false;
                         control.print = true;
-                        control.pause = false;
-                    }
+                        offset = 0;
 
-                    if (!control.search_mode)
-                        status_print(status_win,
-                                gettext("Continue viewing the log."));
-                    else
-                        status_print(
-                                status_win, gettext("Continue searching."));
+                        /* hide the search panel */
+                        (void)strlcpy(search, "none", sizeof(search));
+                        draw_search(info_bar_panels[1], search_ib_win, search);
+                    }
 
+                    status_print(
+                            status_win, gettext("Continue viewing the log."));
                     control.pause = false;
                 } else {
                     control.pause = true;
                     control.sleep = true;
 
-                    /* search_mode has it's own way of letting the user know
-                       that a search is paused. */
-                    if (!control.search_mode)
-                        status_print(
-                                status_win, gettext("*** PAUSED *** (press 'p' "
-                                                    "to continue)"));
+                    status_print(status_win,
+                            gettext("*** PAUSED *** (press 'p' to continue)"));
                 }
                 break;
 
@@ -1325,114 +1430,123 @@ int logview_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
 
             /* search */
             case 's':
+            case 'S':
 
-                if (control.search_mode) {
-                    status_print(
-                            status_win, gettext("Already searching. Press 'S' "
-                                                "to stop current search."));
-                    usleep(600000);
-                } else if (control.search_completed) {
+                if (control.search_completed) {
                     status_print(status_win,
                             gettext("Please first close the current search by "
                                     "pressing SPACE."));
                     usleep(600000);
-                } else {
-                    if (!search_script_checked) {
-                        /* check if the search script exists */
-                        if (snprintf(search_string, sizeof(search_string),
-                                    "%s/vuurmuur-searchlog.sh",
-                                    vccnf.scripts_location) >=
-                                (int)sizeof(search_string)) {
-                            vrmr_error(-1, VR_ERR,
-                                    gettext("opening pipe failed: %s."),
-                                    strerror(errno));
-                            search_script_ok = 0;
-                        } else {
-                            if (check_search_script(search_string) != 1) {
-                                search_script_ok = 0;
-                            } else {
-                                search_script_ok = 1;
-                            }
-                            search_script_checked = 1;
-                        }
-                    }
-
-                    /* search already checked */
-                    if (search_script_ok) {
-                        if ((search_ptr = input_box(32, gettext("Search"),
-                                     gettext("What do you want to search "
-                                             "for?")))) {
-                            /* regex check the search-string */
-                            sanitize_search_str(search_ptr, strlen(search_ptr));
-
-                            /* setup the search-buffer */
-                            vrmr_list_setup(&SearchBufferList, free);
-
-                            /* point the buffer-pointer to the SearchBufferList
-                             */
-                            buffer_ptr = &SearchBufferList;
-
-                            /* temp store the traffic pointer */
-                            traffic_fp = fp;
-
-                            /* assemble search string => ignore stderr because
-                             * it messes up the screen */
-                            if (snprintf(search_string, sizeof(search_string),
-                                        "/bin/bash %s/vuurmuur-searchlog.sh %s "
-                                        "%s/ '%s' 2>/dev/null",
-                                        vccnf.scripts_location, logname,
-                                        vctx->conf.vuurmuur_logdir_location,
-                                        search_ptr) >=
-                                    (int)sizeof(search_string)) {
-                                vrmr_error(-1, VR_ERR,
-                                        gettext("opening pipe failed: %s."),
-                                        strerror(errno));
-                                return (-1);
-                            }
-                            vrmr_debug(NONE, "search_string: '%s'.",
-                                    search_string);
-
-                            /* open the pipe */
-                            if (!(search_pipe = popen(search_string, "r"))) {
-                                vrmr_error(-1, VR_ERR,
-                                        gettext("opening pipe failed: %s."),
-                                        strerror(errno));
-                                return (-1);
-                            }
-
-                            /* set the file pointer to the search_pipe */
-                            fp = search_pipe;
-
-                            /* we are in search-mode */
-                            control.search_mode = true;
-
-                            status_print(status_win,
-                                    gettext("Search started. Press 'S' to stop "
-                                            "searching."));
-                            control.print = 1;
-
-                            /* copy the search term for the infobar */
-                            (void)strlcpy(search, search_ptr, sizeof(search));
-
-                            /* draw the search panel */
-                            draw_search(
-                                    info_bar_panels[1], search_ib_win, search);
-                        }
+                } else if (control.browse) {
+                    status_print(status_win,
+                            gettext("Please first return to the live log by "
+                                    "pressing SPACE."));
+                    usleep(600000);
+                } else if ((search_ptr = input_box(64, gettext("Search"),
+                                    gettext("What do you want to search "
+                                            "for?")))) {
+                    /* setup the search-buffer */
+                    vrmr_list_setup(&SearchBufferList, free);
+
+                    /* point the buffer-pointer to the SearchBufferList */
+                    buffer_ptr = &SearchBufferList;
+
+                    /* copy the search term for the infobar */
+                    (void)strlcpy(search, search_ptr, sizeof(search));
+
+                    /* draw the search panel */
+                    draw_search(info_bar_panels[1], search_ib_win, search);
+
+                    /* create a little wait dialog */
+                    wait_win = create_newwin(5, 40, (max_height - 5) / 2,
+                            (max_width - 40) / 2,
+                            gettext("One moment please..."), vccnf.color_win);
+                    vrmr_fatal_if_null(wait_win);
+                    wait_panels[0] = new_panel(wait_win);
+                    mvwprintw(wait_win, 2, 4, gettext("Searching ..."));
+                    update_panels();
+                    doupdate();
+
+                    struct search_results res = {traffic_log, &vfilter,
+                            &control, buffer_ptr, max_buffer_size};
+                    int64_t matches = search_logs(logfile, search_ptr, &res);
+
+                    /* destroy the wait dialog */
+                    del_panel(wait_panels[0]);
+                    destroy_win(wait_win);
+
+                    if (matches < 0) {
+                        status_print(
+                                status_win, gettext("Search ERROR. Press SPACE "
+                                                    "to return to normal "
+                                                    "logging."));
                     } else {
-                        vrmr_error(-1, VR_ERR,
-                                gettext("search script was not ok, search is "
-                                        "disabled."));
+                        control.search_results =
+                                (uint32_t)MIN(matches, (int64_t)UINT32_MAX);
+                        status_print(status_win,
+                                gettext("Search done: %u matches. Press SPACE "
+                                        "to return to normal logging."),
+                                control.search_results);
                     }
+
+                    /* pause to leave the results on screen */
+                    control.search_completed = true;
+                    control.pause = true;
+                    control.print = true;
+                    offset = 0;
+
+                    free(search_ptr);
+                    search_ptr = NULL;
                 }
                 break;
 
-            /* emergency search stop */
-            case 'S':
+            /* go to a time in the log */
+            case 'g':
+            case 'G':
 
-                if (control.search_mode)
-                    control.search_stop = true;
-                else
-                    status_print(status_win, gettext("No search in progress."));
+                if (!logidx_ok) {
+                    vrmr_error(-1, VR_ERR,
+                            gettext("the log could not be indexed, going to a "
+                                    "time is not possible."));
+                } else if (control.search_completed) {
+                    status_print(status_win,
+                            gettext("Please first close the current search by "
+                                    "pressing SPACE."));
+                    usleep(600000);
+                } else if ((time_ptr = input_box(32, gettext("Go to time"),
+                                    gettext("Go to which time? (e.g. 'Jan 31 "
+                                            "12:00')")))) {
+                    struct tm tm;
+                    uint64_t line = 0;
+
+                    if (vrmr_logindex_parse_time(time_ptr, &tm) < 0) {
+                        vrmr_error(-1, VR_ERR,
+                                gettext("'%s' is not a valid time."), time_ptr);
+                    } else if (vrmr_logindex_update(&logidx) < 0 ||
+                               vrmr_logindex_find_time(&logidx, &tm, &line) <
+                                       0) {
+                        vrmr_error(-1, VR_ERR,
+                                gettext("searching the log index failed."));
+                    } else {
+                        start_browse(&BrowseBufferList, &buffer_ptr, &control);
+                        browse_first = line;
+                        (void)load_log_lines(&logidx, line, max_buffer_size,
+                                traffic_log, &vfilter, &control, buffer_ptr,
+                                max_buffer_size, false);
+
+                        /* put the line at the top of the screen */
+                        offset = 0;
+                        if (buffer_ptr->len > (unsigned int)max_onscreen)
+                            offset = buffer_ptr->len - max_onscreen;
+
+                        status_print(status_win,
+                                gettext("Showing the log from '%s'. Press "
+                                        "SPACE to return to the live log."),
+                                time_ptr);
+                    }
+                    free(time_ptr);
+                    time_ptr = NULL;
+                }
                 break;
 
             /* blocklist add */
@@ -1543,20 +1657,6 @@ int logview_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
 
         /* print the list to the screen */
         if (control.print) {
-            /* update the results printer if in search_mode - we do this here
-               because we come here less often because of the queue. */
-            if (control.search_mode) {
-                if (!control.pause)
-                    status_print(status_win,
-                            gettext("Search in progress: %u matches so far. "
-                                    "SPACE to pause, 'S' to stop."),
-                            control.search_results);
-                else
-                    status_print(status_win,
-                            gettext("Search PAUSED: %u matches so far. SPACE "
-                                    "to continue, 'S' to stop."),
-                            control.search_results);
-            }
             /* clear the screen */
             werase(log_win);
 
@@ -1605,16 +1705,6 @@ int logview_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
             control.print = false;
             control.queue = 0;
             control.sleep = false;
-
-            /* if we are in search mode, there is no need to keep up with the
-               log in real-time. So we take some time to draw the screen. It
-               will slow down the printing and thereby the searching, but it
-               will keep the log better readable
-
-               furthermore it will decrease the load on the system during a
-               search */
-            if (control.search_mode)
-                usleep(90000);
         }
 
         /* sleep for 1 tenth of a second if we want to sleep */
@@ -1631,12 +1721,14 @@ int logview_section(struct vrmr_ctx *vctx, struct vrmr_config *cnf,
     /* filter clean up */
     vrmr_filter_cleanup(&vfilter);
     nodelay(log_win, FALSE);
-    vrmr_fatal_if(vrmr_list_cleanup(buffer_ptr) < 0);
+    if (buffer_ptr != &LogBufferList)
+        vrmr_fatal_if(vrmr_list_cleanup(buffer_ptr) < 0);
+    vrmr_fatal_if(vrmr_list_cleanup(&LogBufferList) < 0);
     (void)fclose(fp);
 
-    if (search_pipe) {
-        (void)pclose(search_pipe);
-    }
+    /* save the index for the next time */
+    if (logidx_ok)
+        vrmr_logindex_close(&logidx);
 
     /* info bar stuff */
     show_panel(info_bar_panels[0]);
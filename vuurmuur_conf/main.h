@@ -26,9 +26,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/types.h>
-#include <sys/ipc.h>
-#include <sys/sem.h>
-#include <sys/shm.h>
+#include <poll.h>
 #include <sys/utsname.h> /* for uname -> stat_sec */
 #include <signal.h>
 #include <string.h>
@@ -134,7 +132,6 @@ struct vrmr_gui_conf {
 
     char draw_status; /* draw the status stuff in the main_menu? */
 
-    char iptrafvol_location[128];
 
     /*
         colors
@@ -196,7 +193,6 @@ extern struct vrmr_gui_conf vccnf;
 /* default print mainmenu_status */
 #define VRMR_DEFAULT_MAINMENU_STATUS 1
 
-#define VRMR_DEFAULT_IPTRAFVOL_LOCATION "/usr/bin/iptrafvol.pl"
 
 struct vrmr_status {
     struct vrmr_list StatusList;
@@ -210,7 +206,7 @@ struct vrmr_status {
     int rules;
 
     /* connections with vuurmuur and vuurmuur_log */
-    int shm;
+    int daemons;
     /* backend data */
     int backend;
     /* vuurmuur config */
@@ -233,24 +229,10 @@ extern struct vrmr_status vuurmuur_status;
 extern WINDOW *status_frame_win, *status_win, *top_win, *main_win, *mainlog_win;
 
 /*
-    shared memory id and semaphore id
+    connections with the control sockets of vuurmuur and vuurmuur_log
 */
-
-/* vuurmuur */
-extern int vuurmuur_shmid;
-extern int vuurmuur_semid;
-/*@null@*/
-extern struct vrmr_shm_table *vuurmuur_shmtable;
-extern char *vuurmuur_shmp;
-extern pid_t vuurmuur_pid;
-
-/* vuurmuur_log */
-extern int vuurmuurlog_shmid;
-extern int vuurmuurlog_semid;
-extern char *vuurmuurlog_shmp;
-/*@null@*/
-extern struct vrmr_shm_table *vuurmuurlog_shmtable;
-extern pid_t vuurmuurlog_pid;
+extern struct vrmr_control_client vuurmuur_ctl;
+extern struct vrmr_control_client vuurmuurlog_ctl;
 
 extern char version_string[128];
 
@@ -415,6 +397,8 @@ void mm_status_checkall(struct vrmr_ctx *, struct vrmr_list *,
         struct vrmr_rules *, struct vrmr_zones *, struct vrmr_interfaces *,
         struct vrmr_services *);
 int vc_apply_changes(struct vrmr_ctx *);
+int vc_control_connect(struct vrmr_ctx *, struct vrmr_control_client *,
+        const char *path);
 
 /*
     bandwidth
@@ -451,14 +435,13 @@ struct log_record {
 
 struct conntrack {
     /* hashes for the vuurmuur names */
-    struct vrmr_hash_table zone_hash;
-    struct vrmr_hash_table service_hash;
+    struct vrmr_map zone_hash;
+    struct vrmr_services_index service_hash;
 
     struct vrmr_list network_list;
 
-    struct vrmr_list conn_list;
-    /* sorted array of entries. Sorted by cnt */
-    struct vrmr_conntrack_entry **conn_array;
+    /* struct vrmr_conntrack_entry, sorted by cnt */
+    struct vrmr_vector conn_list;
 
     struct vrmr_conntrack_stats conn_stats;
 
@@ -188,85 +188,26 @@ set_colors(vc_cnf *cnf)
 }
 #endif
 
-static void mm_shm_connect_vuurmuur(void)
-{
-    /* first try to detach */
-    if (vuurmuur_shmp != NULL)
-        (void)shmdt(vuurmuur_shmp);
-
-    /* reset */
-    vuurmuur_shmid = -1;
-    vuurmuur_semid = -1;
-    vuurmuur_shmtable = NULL;
-    vuurmuur_shmp = NULL;
-
-    /* reconnect */
-    vuurmuur_pid = get_vuurmuur_pid("/var/run/vuurmuur.pid", &vuurmuur_shmid);
-    if (vuurmuur_shmid > 0) {
-        /* attach to shared memory */
-        vuurmuur_shmp = shmat(vuurmuur_shmid, 0, 0);
-        if (vuurmuur_shmp == (char *)(-1)) {
-            vrmr_error(-1, VR_ERR,
-                    gettext("attaching to shared memory failed: %s."),
-                    strerror(errno));
-            vuurmuur_shmp = NULL;
-        } else {
-            vuurmuur_shmtable = (struct vrmr_shm_table *)vuurmuur_shmp;
-            vuurmuur_semid = vuurmuur_shmtable->sem_id;
-
-            /* now try to connect to the shared memory */
-            if (vrmr_lock(vuurmuur_semid)) {
-                vuurmuur_shmtable->configtool.connected = 1;
-                snprintf(vuurmuur_shmtable->configtool.name,
-                        sizeof(vuurmuur_shmtable->configtool.name),
-                        "Vuurmuur_conf %s", version_string);
-                vrmr_unlock(vuurmuur_semid);
-            } else {
-                // TODO: no detach here?
-                vuurmuur_shmp = NULL;
-            }
-        }
-    }
-}
+/*  vc_control_connect
+
+    (Re)connects 'client' to the control socket 'path' of Vuurmuur or
+    Vuurmuur_log.
 
-static void mm_shm_connect_vuurmuurlog(void)
+    Returncodes:
+         0: ok
+        -1: error
+*/
+int vc_control_connect(struct vrmr_ctx *vctx,
+        struct vrmr_control_client *client, const char *path)
 {
-    /* first try to detach */
-    if (vuurmuurlog_shmp != NULL)
-        (void)shmdt(vuurmuurlog_shmp);
-
-    /* reset */
-    vuurmuurlog_shmid = -1;
-    vuurmuurlog_semid = -1;
-    vuurmuurlog_shmtable = NULL;
-    vuurmuurlog_shmp = NULL;
-
-    vuurmuurlog_pid =
-            get_vuurmuur_pid("/var/run/vuurmuur_log.pid", &vuurmuurlog_shmid);
-    if (vuurmuurlog_shmid > 0) {
-        /* attach to shared memory */
-        vuurmuurlog_shmp = shmat(vuurmuurlog_shmid, 0, 0);
-        if (vuurmuurlog_shmp == (char *)(-1)) {
-            vrmr_error(-1, VR_ERR,
-                    gettext("attaching to shared memory failed: %s."),
-                    strerror(errno));
-            vuurmuurlog_shmp = NULL;
-        } else {
-            vuurmuurlog_shmtable = (struct vrmr_shm_table *)vuurmuurlog_shmp;
-            vuurmuurlog_semid = vuurmuurlog_shmtable->sem_id;
-
-            /* now try to connect to the shared memory */
-            if (vrmr_lock(vuurmuurlog_semid)) {
-                vuurmuurlog_shmtable->configtool.connected = 1;
-                snprintf(vuurmuurlog_shmtable->configtool.name,
-                        sizeof(vuurmuurlog_shmtable->configtool.name),
-                        "Vuurmuur_conf %s", version_string);
-                vrmr_unlock(vuurmuurlog_semid);
-            } else {
-                vuurmuurlog_shmp = NULL;
-            }
-        }
-    }
+    char name[256];
+
+    vrmr_control_disconnect(client);
+
+    snprintf(name, sizeof(name), "Vuurmuur_conf %s (user: %s)",
+            version_string, vctx->user_data.realusername);
+    return (vrmr_control_connect(
+            client, path, vctx->user_data.realusername, name));
 }
 
 ATTR_FMT_PRINTF(3, 4)
@@ -324,7 +265,8 @@ static void mm_check_status_settings(/*@null@*/ struct vrmr_list *status_list)
     }
 }
 
-static void mm_check_status_shm(/*@null@*/ struct vrmr_list *status_list)
+static void mm_check_status_daemons(
+        /*@null@*/ struct vrmr_list *status_list)
 {
     /* asume ok */
     vuurmuur_status.vuurmuur = 1;
@@ -345,36 +287,30 @@ static void mm_check_status_shm(/*@null@*/ struct vrmr_list *status_list)
                         "Error.log\n"));
     }
 
-    /* shm connection with Vuurmuur */
-    if (!vuurmuur_shmp) {
+    /* connection with Vuurmuur */
+    if (vuurmuur_ctl.fd < 0) {
         vuurmuur_status.vuurmuur = -1;
         queue_status_msg(status_list, vuurmuur_status.vuurmuur,
                 gettext("- No connection could be established with Vuurmuur. "
                         "Please make sure that it is running\n"));
-    } else {
-        if (!(vrmr_lock(vuurmuur_semid))) {
-            vuurmuur_status.vuurmuur = -1;
-            queue_status_msg(status_list, vuurmuur_status.vuurmuur,
-                    gettext("- The connection with Vuurmuur seems to be lost. "
-                            "Please make sure that it is running\n"));
-        } else
-            vrmr_unlock(vuurmuur_semid);
+    } else if (vrmr_control_ping(&vuurmuur_ctl) < 0) {
+        vuurmuur_status.vuurmuur = -1;
+        queue_status_msg(status_list, vuurmuur_status.vuurmuur,
+                gettext("- The connection with Vuurmuur seems to be lost. "
+                        "Please make sure that it is running\n"));
     }
 
-    /* shm connection with Vuurmuur_log */
-    if (!vuurmuurlog_shmp) {
+    /* connection with Vuurmuur_log */
+    if (vuurmuurlog_ctl.fd < 0) {
         vuurmuur_status.vuurmuur_log = 0;
         queue_status_msg(status_list, vuurmuur_status.vuurmuur_log,
                 gettext("- No connection could be established with "
                         "Vuurmuur_log. Please make sure that it is running\n"));
-    } else {
-        if (!(vrmr_lock(vuurmuurlog_semid))) {
-            vuurmuur_status.vuurmuur_log = 0;
-            queue_status_msg(status_list, vuurmuur_status.vuurmuur_log,
-                    gettext("- The connection with Vuurmuur_log seems to be "
-                            "lost. Please make sure that it is running\n"));
-        } else
-            vrmr_unlock(vuurmuurlog_semid);
+    } else if (vrmr_control_ping(&vuurmuurlog_ctl) < 0) {
+        vuurmuur_status.vuurmuur_log = 0;
+        queue_status_msg(status_list, vuurmuur_status.vuurmuur_log,
+                gettext("- The connection with Vuurmuur_log seems to be "
+                        "lost. Please make sure that it is running\n"));
     }
 }
 
@@ -834,7 +770,7 @@ static void mm_check_status_zones(
 static void mm_update_overall_status(void)
 {
     /* asume all ok */
-    vuurmuur_status.shm = 1;
+    vuurmuur_status.daemons = 1;
     vuurmuur_status.backend = 1;
     vuurmuur_status.overall = 1;
 
@@ -848,21 +784,21 @@ static void mm_update_overall_status(void)
         vuurmuur_status.backend = -1;
     }
 
-    /* shm */
+    /* daemons */
     if (vuurmuur_status.vuurmuur == 0 || vuurmuur_status.vuurmuur_log == 0) {
-        vuurmuur_status.shm = 0;
+        vuurmuur_status.daemons = 0;
     }
     if (vuurmuur_status.vuurmuur == -1 || vuurmuur_status.vuurmuur_log == -1) {
-        vuurmuur_status.shm = -1;
+        vuurmuur_status.daemons = -1;
     }
 
     /* overall */
-    if (vuurmuur_status.shm == 0 || vuurmuur_status.backend == 0 ||
+    if (vuurmuur_status.daemons == 0 || vuurmuur_status.backend == 0 ||
             //        vuurmuur_status.settings == 0    ||
             vuurmuur_status.config == 0 || vuurmuur_status.system == 0) {
         vuurmuur_status.overall = 0;
     }
-    if (vuurmuur_status.shm == -1 || vuurmuur_status.backend == -1 ||
+    if (vuurmuur_status.daemons == -1 || vuurmuur_status.backend == -1 ||
             vuurmuur_status.config == -1 ||
             //        vuurmuur_status.settings == -1   ||
             vuurmuur_status.system == -1) {
@@ -872,13 +808,57 @@ static void mm_update_overall_status(void)
     vrmr_debug(LOW, "vuurmuur_status.all: %d.", vuurmuur_status.overall);
 }
 
-static int mm_reload_shm(struct vrmr_ctx *vctx)
+/* the reload of one of the daemons in the apply changes dialog */
+struct mm_reload {
+    struct vrmr_control_client *client;
+    FIELD *fld;
+    int row;         /* of the result in the dialog */
+    char *last;      /* last_vuurmuur_result or last_vuurmuur_log_result */
+    bool required;   /* failing to notify it is an error */
+    bool connected;
+    unsigned int id; /* of the reload, given by the daemon */
+    int progress;
+    int result;
+    char error[256];
+};
+
+static void mm_reload_event(
+        struct mm_reload *r, const struct vrmr_control_event *ev)
+{
+    char str[4] = "";
+
+    if (ev->type == VRMR_CONTROL_EV_RELOAD) {
+        r->id = ev->id;
+    } else if (ev->type == VRMR_CONTROL_EV_ERROR) {
+        r->result = VRMR_RR_ERROR;
+        (void)strlcpy(r->error, ev->text, sizeof(r->error));
+    } else if ((ev->type == VRMR_CONTROL_EV_PROGRESS ||
+                       ev->type == VRMR_CONTROL_EV_DONE) &&
+               ev->id == r->id) {
+        r->progress = ev->progress;
+        (void)snprintf(str, sizeof(str), "%3d", r->progress);
+        set_field_buffer_wrap(r->fld, 0, str);
+
+        if (ev->type == VRMR_CONTROL_EV_DONE) {
+            r->result = ev->result;
+            (void)strlcpy(r->error, ev->text, sizeof(r->error));
+            vrmr_debug(LOW, "reload %u done in %" PRIu64 "ms.", r->id, ev->ms);
+        }
+    }
+}
+
+/*  mm_reload_daemons
+
+    Asks Vuurmuur and Vuurmuur_log to reload and shows their progress as
+    they send it.
+*/
+static int mm_reload_daemons(void)
 {
-#define SHM_REL_NOT_CONN gettext("Not connected")
-#define SHM_REL_SUCCESS gettext("Success")
-#define SHM_REL_NO_CHANGES gettext("No changes")
-#define SHM_REL_ERROR gettext("Error")
-#define SHM_REL_TIMEOUT gettext("Timed out")
+#define MM_REL_NOT_CONN gettext("Not connected")
+#define MM_REL_SUCCESS gettext("Success")
+#define MM_REL_NO_CHANGES gettext("No changes")
+#define MM_REL_ERROR gettext("Error")
+#define MM_REL_TIMEOUT gettext("Timed out")
     WINDOW *wait_win = NULL;
     PANEL *panel[1];
     FORM *form = NULL;
@@ -887,11 +867,9 @@ static int mm_reload_shm(struct vrmr_ctx *vctx)
     int cols = 0, rows = 0;
     size_t n_fields = 0, i = 0;
     int max_height = 0, max_width = 0;
-    int vuurmuur_result = 0, vuurmuurlog_result = 0;
-    int waittime = 0;
-    int vuurmuur_progress = 0, vuurmuurlog_progress = 0;
-    char str[4] = "";
+    struct vrmr_control_event ev;
     char failed = 0;
+    const char *error = NULL;
 
     /* reset the last reload result */
     last_vuurmuur_result = 1;
@@ -933,165 +911,116 @@ static int mm_reload_shm(struct vrmr_ctx *vctx)
 
     vrmr_audit(gettext("Applying changes ..."));
 
-    /* notify both vuurmuur and vuurmuurlog */
-    if (vuurmuur_semid != -1) {
-        if (vrmr_lock(vuurmuur_semid)) {
-            vuurmuur_shmtable->backend_changed = 1;
-            (void)strlcpy(vuurmuur_shmtable->configtool.username,
-                    vctx->user_data.realusername,
-                    sizeof(vuurmuur_shmtable->configtool.username));
-            vrmr_unlock(vuurmuur_semid);
-
-            vuurmuur_result = VRMR_RR_NO_RESULT_YET;
+    struct mm_reload reloads[2] = {
+            {.client = &vuurmuur_ctl,
+                    .fld = vuurmuurfld,
+                    .row = 4,
+                    .last = &last_vuurmuur_result,
+                    .required = true},
+            {.client = &vuurmuurlog_ctl,
+                    .fld = vuurmuurlogfld,
+                    .row = 5,
+                    .last = &last_vuurmuur_log_result,
+                    .required = false},
+    };
+
+    /* notify both vuurmuur and vuurmuurlog, they reload at the same time */
+    for (i = 0; i < 2; i++) {
+        struct mm_reload *r = &reloads[i];
+
+        r->result = VRMR_RR_NO_RESULT_YET;
+        r->connected = (vrmr_control_send(r->client, "reload") == 0);
+        if (!r->connected) {
+            r->result = VRMR_RR_READY;
+            set_field_buffer_wrap(r->fld, 0, " - ");
         }
-    } else {
-        vuurmuur_result = VRMR_RR_READY;
-        vuurmuur_progress = 100;
-
-        (void)snprintf(str, sizeof(str), " - ");
-        set_field_buffer_wrap(vuurmuurfld, 0, str);
-    }
-    if (vuurmuurlog_semid != -1) {
-        if (vrmr_lock(vuurmuurlog_semid)) {
-            vuurmuurlog_shmtable->backend_changed = 1;
-            (void)strlcpy(vuurmuurlog_shmtable->configtool.username,
-                    vctx->user_data.realusername,
-                    sizeof(vuurmuurlog_shmtable->configtool.username));
-            vrmr_unlock(vuurmuurlog_semid);
-
-            vuurmuurlog_result = VRMR_RR_NO_RESULT_YET;
-        }
-    } else {
-        vuurmuurlog_result = VRMR_RR_READY;
-        vuurmuurlog_progress = 100;
-
-        (void)snprintf(str, sizeof(str), " - ");
-        set_field_buffer_wrap(vuurmuurlogfld, 0, str);
     }
 
-    /* wait max 60 seconds */
-    while (((vuurmuur_result == VRMR_RR_NO_RESULT_YET ||
-                    vuurmuur_result == VRMR_RR_RESULT_ACK) ||
-                   (vuurmuurlog_result == VRMR_RR_NO_RESULT_YET ||
-                           vuurmuurlog_result == VRMR_RR_RESULT_ACK)) &&
-            waittime < 60000000) {
-        if (vuurmuur_progress < 100) {
-            if (vrmr_lock(vuurmuur_semid)) {
-                if (vuurmuur_shmtable->reload_result != VRMR_RR_READY) {
-                    vuurmuur_result = vuurmuur_shmtable->reload_result;
-                }
-                vuurmuur_progress = vuurmuur_shmtable->reload_progress;
-                vrmr_unlock(vuurmuur_semid);
+    /* the daemons send their progress as they go. Give up if they are
+     * silent for 60 seconds. */
+    while (1) {
+        struct pollfd pfds[2];
+        nfds_t n = 0;
+
+        for (i = 0; i < 2; i++) {
+            struct mm_reload *r = &reloads[i];
+            int result;
+
+            if (r->result != VRMR_RR_NO_RESULT_YET)
+                continue;
+
+            while ((result = vrmr_control_read(r->client, &ev, 0)) == 1)
+                mm_reload_event(r, &ev);
+            if (result < 0) {
+                r->result = VRMR_RR_ERROR;
+                (void)strlcpy(r->error, gettext("connection lost"),
+                        sizeof(r->error));
             }
-
-            (void)snprintf(str, sizeof(str), "%3d", vuurmuur_progress);
-            set_field_buffer_wrap(vuurmuurfld, 0, str);
-        }
-
-        if (vuurmuur_progress == 100) {
-            if (vuurmuur_semid == -1) {
-                wattron(wait_win, vccnf.color_win_red);
-                mvwprintw(wait_win, 4, 29, SHM_REL_NOT_CONN);
-                wattroff(wait_win, vccnf.color_win_red);
-                last_vuurmuur_result = 0;
-                failed = 1;
-            } else if (vrmr_lock(vuurmuur_semid)) {
-                vuurmuur_shmtable->reload_result = VRMR_RR_RESULT_ACK;
-                vrmr_unlock(vuurmuur_semid);
-
-                if (vuurmuur_result == VRMR_RR_SUCCES) {
-                    wattron(wait_win, vccnf.color_win_green);
-                    mvwprintw(wait_win, 4, 29, SHM_REL_SUCCESS);
-                    wattroff(wait_win, vccnf.color_win_green);
-                } else if (vuurmuur_result == VRMR_RR_NOCHANGES) {
-                    mvwprintw(wait_win, 4, 29, SHM_REL_NO_CHANGES);
-                } else {
-                    wattron(wait_win, vccnf.color_win_red);
-                    mvwprintw(wait_win, 4, 29, SHM_REL_ERROR);
-                    wattroff(wait_win, vccnf.color_win_red);
-
-                    last_vuurmuur_result = 0;
-                    failed = 1;
-                }
-            }
-        }
-
-        if (vuurmuurlog_progress < 100) {
-            if (vrmr_lock(vuurmuurlog_semid)) {
-                if (vuurmuurlog_shmtable->reload_result != VRMR_RR_READY) {
-                    vuurmuurlog_result = vuurmuurlog_shmtable->reload_result;
-                }
-                vuurmuurlog_progress = vuurmuurlog_shmtable->reload_progress;
-                vrmr_unlock(vuurmuurlog_semid);
-            }
-
-            (void)snprintf(str, sizeof(str), "%3d", vuurmuurlog_progress);
-            set_field_buffer_wrap(vuurmuurlogfld, 0, str);
-        }
-
-        if (vuurmuurlog_progress == 100) {
-            if (vuurmuurlog_semid == -1) {
-                wattron(wait_win, vccnf.color_win_red);
-                mvwprintw(wait_win, 5, 29, SHM_REL_NOT_CONN);
-                wattroff(wait_win, vccnf.color_win_red);
-                last_vuurmuur_log_result = 0;
-            } else if (vrmr_lock(vuurmuurlog_semid)) {
-                vuurmuurlog_shmtable->reload_result = VRMR_RR_RESULT_ACK;
-                vrmr_unlock(vuurmuurlog_semid);
-
-                if (vuurmuurlog_result == VRMR_RR_SUCCES) {
-                    wattron(wait_win, vccnf.color_win_green);
-                    mvwprintw(wait_win, 5, 29, SHM_REL_SUCCESS);
-                    wattroff(wait_win, vccnf.color_win_green);
-                } else if (vuurmuurlog_result == VRMR_RR_NOCHANGES) {
-                    mvwprintw(wait_win, 5, 29, SHM_REL_NO_CHANGES);
-                } else {
-                    wattron(wait_win, vccnf.color_win_red);
-                    mvwprintw(wait_win, 5, 29, SHM_REL_ERROR);
-                    wattroff(wait_win, vccnf.color_win_red);
-                    last_vuurmuur_log_result = 0;
-                    failed = 1;
-                }
+            if (r->result == VRMR_RR_NO_RESULT_YET) {
+                pfds[n].fd = r->client->fd;
+                pfds[n].events = POLLIN;
+                n++;
             }
         }
         update_panels();
         doupdate();
 
-        /* no result yet, sleep 1 sec, or if the server didn't have a chance to
-         * do anything */
-        if ((vuurmuur_result == VRMR_RR_NO_RESULT_YET ||
-                    vuurmuur_result == VRMR_RR_RESULT_ACK) ||
-                (vuurmuurlog_result == VRMR_RR_NO_RESULT_YET ||
-                        vuurmuurlog_result == VRMR_RR_RESULT_ACK)) {
-            waittime += 1000;
-            usleep(1000);
-        }
+        if (n == 0)
+            break;
+        int result = poll(pfds, n, 60000);
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result <= 0)
+            break;
     }
 
-    /* timed out */
-    if (vuurmuur_progress < 100) {
-        wattron(wait_win, vccnf.color_win_red);
-        mvwprintw(wait_win, 4, 29, SHM_REL_TIMEOUT);
-        wattroff(wait_win, vccnf.color_win_red);
+    for (i = 0; i < 2; i++) {
+        struct mm_reload *r = &reloads[i];
 
-        last_vuurmuur_result = 0;
-        failed = 1;
-    }
-    /* timed out */
-    if (vuurmuurlog_progress < 100) {
-        wattron(wait_win, vccnf.color_win_red);
-        mvwprintw(wait_win, 5, 29, SHM_REL_TIMEOUT);
-        wattroff(wait_win, vccnf.color_win_red);
-
-        last_vuurmuur_log_result = 0;
-        failed = 1;
+        if (!r->connected) {
+            wattron(wait_win, vccnf.color_win_red);
+            mvwprintw(wait_win, r->row, 29, MM_REL_NOT_CONN);
+            wattroff(wait_win, vccnf.color_win_red);
+            *r->last = 0;
+            if (r->required)
+                failed = 1;
+        } else if (r->result == VRMR_RR_NO_RESULT_YET) {
+            /* timed out */
+            wattron(wait_win, vccnf.color_win_red);
+            mvwprintw(wait_win, r->row, 29, MM_REL_TIMEOUT);
+            wattroff(wait_win, vccnf.color_win_red);
+            *r->last = 0;
+            failed = 1;
+        } else if (r->result == VRMR_RR_SUCCES) {
+            wattron(wait_win, vccnf.color_win_green);
+            mvwprintw(wait_win, r->row, 29, MM_REL_SUCCESS);
+            wattroff(wait_win, vccnf.color_win_green);
+        } else if (r->result == VRMR_RR_NOCHANGES) {
+            mvwprintw(wait_win, r->row, 29, MM_REL_NO_CHANGES);
+        } else {
+            wattron(wait_win, vccnf.color_win_red);
+            mvwprintw(wait_win, r->row, 29, MM_REL_ERROR);
+            wattroff(wait_win, vccnf.color_win_red);
+            *r->last = 0;
+            failed = 1;
+            if (error == NULL && r->error[0] != '\0')
+                error = r->error;
+        }
     }
     update_panels();
     doupdate();
 
     if (failed == 1) {
-        vrmr_error(-1, VR_ERR,
-                gettext("applying changes failed. Please check error.log."));
+        if (error != NULL) {
+            vrmr_error(-1, VR_ERR,
+                    gettext("applying changes failed: %s. Please check "
+                            "error.log."),
+                    error);
+        } else {
+            vrmr_error(-1, VR_ERR,
+                    gettext("applying changes failed. Please check "
+                            "error.log."));
+        }
     } else {
         sleep(1);
     }
@@ -1115,7 +1044,7 @@ struct {
 
             *backendfld, *configfld, *settingsfld,
 
-            *shmfld,
+            *daemonsfld,
 
             *systemfld;
 
@@ -1160,7 +1089,7 @@ static void mm_update_status_fields(void)
     mm_set_status_field(vuurmuur_status.backend, StatusFlds.backendfld);
     mm_set_status_field(vuurmuur_status.config, StatusFlds.configfld);
     mm_set_status_field(vuurmuur_status.settings, StatusFlds.settingsfld);
-    mm_set_status_field(vuurmuur_status.shm, StatusFlds.shmfld);
+    mm_set_status_field(vuurmuur_status.daemons, StatusFlds.daemonsfld);
     mm_set_status_field(vuurmuur_status.system, StatusFlds.systemfld);
 }
 
@@ -1168,25 +1097,26 @@ int vc_apply_changes(struct vrmr_ctx *vctx)
 {
     int reload_result = 0;
 
-    /* check shm one last time, and don't write to status list */
-    mm_check_status_shm(NULL);
+    /* check the connections one last time, and don't write to status list */
+    mm_check_status_daemons(NULL);
     /* hmm vuurmuur not connected, try to do that now */
     if (vuurmuur_status.vuurmuur != 1) {
-        mm_shm_connect_vuurmuur();
-        mm_check_status_shm(NULL);
+        (void)vc_control_connect(vctx, &vuurmuur_ctl, VRMR_CONTROL_VUURMUUR);
+        mm_check_status_daemons(NULL);
     }
     /* hmm vuurmuur_log not connected, try to do that now */
     if (vuurmuur_status.vuurmuur_log != 1) {
-        mm_shm_connect_vuurmuurlog();
-        mm_check_status_shm(NULL);
+        (void)vc_control_connect(
+                vctx, &vuurmuurlog_ctl, VRMR_CONTROL_VUURMUUR_LOG);
+        mm_check_status_daemons(NULL);
     }
     /* update the status */
     mm_update_overall_status();
 
     /* now see if we can apply */
     if (vuurmuur_status.overall == 1) {
-        /* reload the shm */
-        reload_result = mm_reload_shm(vctx);
+        /* reload the daemons */
+        reload_result = mm_reload_daemons();
         /* update the vuurmuurlognames because the logs might
            have moved after applying the changes because of
            configuration changes made by the user */
@@ -1201,8 +1131,8 @@ int vc_apply_changes(struct vrmr_ctx *vctx)
                      gettext("The overall status is not OK. Apply anyway?"),
                      vccnf.color_win_note, vccnf.color_win_note_rev | A_BOLD,
                      0) == 1)) {
-            /* reload the shm */
-            reload_result = mm_reload_shm(vctx);
+            /* reload the daemons */
+            reload_result = mm_reload_daemons();
             /* update the vuurmuurlognames because the logs might
                have moved after applying the changes because of
                configuration changes made by the user */
@@ -1216,7 +1146,7 @@ int vc_apply_changes(struct vrmr_ctx *vctx)
     }
 
     if (reload_result < 0) {
-        mm_check_status_shm(NULL);
+        mm_check_status_daemons(NULL);
         mm_update_overall_status();
     }
 
@@ -1355,8 +1285,8 @@ int main_menu(struct vrmr_ctx *vctx, struct vrmr_rules *rules,
         StatusFlds.settingsfld = (StatusFlds.fields[field_num] =
                                           new_field_wrap(1, 6, 10, 0, 0, 0));
         field_num++;
-        /* shm */
-        StatusFlds.shmfld = (StatusFlds.fields[field_num] =
+        /* daemons */
+        StatusFlds.daemonsfld = (StatusFlds.fields[field_num] =
                                      new_field_wrap(1, 6, 12, 0, 0, 0));
         field_num++;
         /* system */
@@ -1637,14 +1567,16 @@ int main_menu(struct vrmr_ctx *vctx, struct vrmr_rules *rules,
             choice_ptr = NULL;
 
             /* status checks */
-            mm_check_status_shm(NULL);
+            mm_check_status_daemons(NULL);
             if (vuurmuur_status.vuurmuur != 1) {
-                mm_shm_connect_vuurmuur();
-                mm_check_status_shm(NULL);
+                (void)vc_control_connect(
+                        vctx, &vuurmuur_ctl, VRMR_CONTROL_VUURMUUR);
+                mm_check_status_daemons(NULL);
             }
             if (vuurmuur_status.vuurmuur_log != 1) {
-                mm_shm_connect_vuurmuurlog();
-                mm_check_status_shm(NULL);
+                (void)vc_control_connect(
+                        vctx, &vuurmuurlog_ctl, VRMR_CONTROL_VUURMUUR_LOG);
+                mm_check_status_daemons(NULL);
             }
 
             mm_update_overall_status();
@@ -1719,8 +1651,8 @@ void mm_status_checkall(struct vrmr_ctx *vctx,
     /* check settings */
     mm_check_status_settings(status_list);
 
-    /* shm connections */
-    mm_check_status_shm(status_list);
+    /* connections with the daemons */
+    mm_check_status_daemons(status_list);
 
     /* update the status */
     mm_update_overall_status();
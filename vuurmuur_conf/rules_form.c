@@ -2246,6 +2246,10 @@ int edit_rule(struct vrmr_config *conf, struct vrmr_rules *rules,
         retval = -1;
     }
 
+    /* the rule was changed in place, so its index key may have changed */
+    if (retval == 1)
+        vrmr_fatal_if(vrmr_rules_reindex(rules) < 0);
+
     vrmr_debug(HIGH, "returning retval = %d.", retval);
     return (retval);
 }
@@ -76,11 +76,8 @@ struct {
 static int edit_serv_portranges_new_validate(struct vrmr_ctx *vctx,
         struct vrmr_service *ser_ptr, const struct vrmr_portdata *in_port_ptr)
 {
-    struct vrmr_list_node *d_node = NULL;
     struct vrmr_portdata *portlist_ptr = NULL;
     struct vrmr_portdata *port_ptr = NULL;
-    int insert_now = 0;
-    int insert_append = 0;
 
     /* safety */
     vrmr_fatal_if_null(in_port_ptr);
@@ -154,23 +151,15 @@ static int edit_serv_portranges_new_validate(struct vrmr_ctx *vctx,
         }
     }
 
-    /* in an empty list we insert now */
-    if (ser_ptr->PortrangeList.len == 0) {
-        insert_now = 1;
-    } else {
-        /* else set the initial d_node */
-        vrmr_fatal_if_null(ser_ptr->PortrangeList.top);
-        d_node = ser_ptr->PortrangeList.top;
-    }
-
-    /* now look for the place in the list to insert */
-    while (!insert_now) {
-        vrmr_fatal_if_null(d_node);
-        vrmr_fatal_if_null(d_node->data);
-        portlist_ptr = d_node->data;
+    /* now look for the place in the list to insert: the ranges are sorted
+     * on protocol */
+    unsigned int pos = 0;
+    for (; pos < ser_ptr->PortrangeList.len; pos++) {
+        vrmr_fatal_if_null(ser_ptr->PortrangeList.data[pos]);
+        portlist_ptr = ser_ptr->PortrangeList.data[pos];
 
         if (port_ptr->protocol < portlist_ptr->protocol)
-            insert_now = 1;
+            break;
 
         if (!(port_ptr->protocol == 1 || port_ptr->protocol == 6 ||
                     port_ptr->protocol == 17)) {
@@ -185,43 +174,22 @@ static int edit_serv_portranges_new_validate(struct vrmr_ctx *vctx,
             }
         }
 
-        if (!insert_now) {
-            vrmr_debug(HIGH, "don't insert at this run.");
-
-            if (vrmr_list_node_is_bot(d_node)) {
-                /* if we reach the bot, insert now */
-                insert_now = 1;
-                insert_append = 1;
-                break;
-            } else {
-                d_node = d_node->next;
-            }
-        }
+        vrmr_debug(HIGH, "don't insert at this run.");
     }
 
     /*
         insert now
     */
-    if (insert_now) {
-        /*  for appending at the bot we call vrmr_list_append because
-           vrmr_list_insert_before is unable to insert at the bot.
-        */
-        if (!insert_append) {
-            vrmr_fatal_if(vrmr_list_insert_before(&ser_ptr->PortrangeList,
-                                  d_node, port_ptr) == NULL);
-        } else {
-            vrmr_fatal_if(vrmr_list_append(&ser_ptr->PortrangeList, port_ptr) ==
-                          NULL);
-        }
-        port_ptr = NULL; /* now owned by ser_ptr->PortrangeList */
+    vrmr_fatal_if(
+            vrmr_vector_insert(&ser_ptr->PortrangeList, pos, port_ptr) < 0);
+    port_ptr = NULL; /* now owned by ser_ptr->PortrangeList */
 
-        ser_ptr->status = VRMR_ST_CHANGED;
+    ser_ptr->status = VRMR_ST_CHANGED;
 
-        /* save the portranges */
-        if (vrmr_services_save_portranges(vctx, ser_ptr) < 0) {
-            vrmr_error(-1, VR_ERR, gettext("saving the portranges failed"));
-            return (-1);
-        }
+    /* save the portranges */
+    if (vrmr_services_save_portranges(vctx, ser_ptr) < 0) {
+        vrmr_error(-1, VR_ERR, gettext("saving the portranges failed"));
+        return (-1);
     }
 
     return (0);
@@ -1112,21 +1080,15 @@ static int edit_serv_portranges_new(
 */
 static int edit_serv_portranges_edit(int place, struct vrmr_service *ser_ptr)
 {
-    int i = 0;
-    struct vrmr_list_node *d_node = NULL;
     struct vrmr_portdata *port_ptr = NULL;
 
     /* safety */
     vrmr_fatal_if_null(ser_ptr);
 
-    /* loop trough the list until we are at 'place'. */
-    for (i = 1, d_node = ser_ptr->PortrangeList.top; d_node;
-            d_node = d_node->next, i++) {
-        if (place != i)
-            continue;
-
-        vrmr_fatal_if_null(d_node->data);
-        port_ptr = d_node->data;
+    /* 'place' starts at 1 */
+    if (place >= 1 && place <= (int)ser_ptr->PortrangeList.len) {
+        vrmr_fatal_if_null(ser_ptr->PortrangeList.data[place - 1]);
+        port_ptr = ser_ptr->PortrangeList.data[place - 1];
 
         if (port_ptr->protocol == 6 || port_ptr->protocol == 17) {
             edit_tcpudp(port_ptr);
@@ -1163,8 +1125,6 @@ static int edit_serv_portranges_edit(int place, struct vrmr_service *ser_ptr)
 static int edit_serv_portranges_del(
         struct vrmr_ctx *vctx, int place, struct vrmr_service *ser_ptr)
 {
-    int i = 0;
-    struct vrmr_list_node *d_node = NULL;
     char str[64] = "";
     struct vrmr_portdata *portrange_ptr = NULL;
 
@@ -1177,21 +1137,16 @@ static int edit_serv_portranges_del(
                 0) == 0)
         return (0);
 
-    /* loop trough the list until we are at 'place'. */
-    for (i = 1, d_node = ser_ptr->PortrangeList.top; d_node;
-            d_node = d_node->next, i++) {
-        /* here we are */
-        if (place != i)
-            continue;
-
-        vrmr_fatal_if_null(d_node->data);
-        portrange_ptr = d_node->data;
+    /* 'place' starts at 1 */
+    if (place >= 1 && place <= (int)ser_ptr->PortrangeList.len) {
+        vrmr_fatal_if_null(ser_ptr->PortrangeList.data[place - 1]);
+        portrange_ptr = ser_ptr->PortrangeList.data[place - 1];
 
         create_portrange_string(portrange_ptr, str, sizeof(str));
 
         /* remove */
-        vrmr_fatal_if(
-                vrmr_list_remove_node(&ser_ptr->PortrangeList, d_node) < 0);
+        vrmr_fatal_if(vrmr_vector_remove(&ser_ptr->PortrangeList,
+                              (unsigned int)(place - 1)) < 0);
 
         /* save */
         if (vrmr_services_save_portranges(vctx, ser_ptr) < 0) {
@@ -1213,7 +1168,6 @@ static int edit_serv_portranges_del(
 
 static void edit_serv_portranges_init(struct vrmr_service *ser_ptr)
 {
-    struct vrmr_list_node *d_node = NULL;
     int i = 0;
     int height = 30,
         width = 64, // max width of host_name (32) + box (2) + 4 + 16
@@ -1251,10 +1205,9 @@ static void edit_serv_portranges_init(struct vrmr_service *ser_ptr)
     // number item list
     vrmr_list_setup(&sersec_ctx.edit_service_port.item_number_list, free);
 
-    for (i = 0, d_node = ser_ptr->PortrangeList.top; d_node;
-            d_node = d_node->next, i++) {
-        vrmr_fatal_if_null(d_node->data);
-        portrange_ptr = d_node->data;
+    for (i = 0; i < (int)ser_ptr->PortrangeList.len; i++) {
+        vrmr_fatal_if_null(ser_ptr->PortrangeList.data[i]);
+        portrange_ptr = ser_ptr->PortrangeList.data[i];
 
         /* item number */
         item_number_ptr = malloc(itemnr_size);
@@ -1684,7 +1637,6 @@ static int edit_service_save(
 static void edit_service_update_portrangesfld(struct vrmr_service *ser_ptr)
 {
     struct vrmr_portdata *portrange_ptr = NULL;
-    struct vrmr_list_node *d_node = NULL;
     int i;
     const int lines = ServiceSec.portranges_lines;
     int bsize = lines * 48;
@@ -1696,10 +1648,9 @@ static void edit_service_update_portrangesfld(struct vrmr_service *ser_ptr)
     char buffer[bsize];
     memset(buffer, 0, bsize);
 
-    for (d_node = ser_ptr->PortrangeList.top, i = 1; d_node;
-            d_node = d_node->next, i++) {
-        vrmr_fatal_if_null(d_node->data);
-        portrange_ptr = d_node->data;
+    for (i = 1; (unsigned int)i <= ser_ptr->PortrangeList.len; i++) {
+        vrmr_fatal_if_null(ser_ptr->PortrangeList.data[i - 1]);
+        portrange_ptr = ser_ptr->PortrangeList.data[i - 1];
 
         char line[49] = "";
         int size = 49;
@@ -2123,7 +2074,7 @@ static int rename_service(struct vrmr_ctx *vctx, struct vrmr_services *services,
 
     ser_ptr = vrmr_search_service(services, old_ser_name);
     vrmr_fatal_if_null(ser_ptr);
-    (void)strlcpy(ser_ptr->name, new_name_ptr, sizeof(ser_ptr->name));
+    vrmr_fatal_if(vrmr_services_set_name(services, ser_ptr, new_name_ptr) < 0);
     ser_ptr = NULL;
 
     /* update rules */
@@ -2147,6 +2098,8 @@ static int rename_service(struct vrmr_ctx *vctx, struct vrmr_services *services,
 
     /* if we have made changes we write the rulesfile */
     if (changed == 1) {
+        vrmr_fatal_if(vrmr_rules_reindex(rules) < 0);
+
         if (vrmr_rules_save_list(vctx, rules, &vctx->conf) < 0) {
             vrmr_error(-1, VR_ERR, gettext("saving rules failed."));
             return (-1);
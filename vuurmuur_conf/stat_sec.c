@@ -60,16 +60,15 @@ static int get_sys_load(float *load_s, float *load_m, float *load_l)
     return (0);
 }
 
-static int count_conntrack_conn(uint32_t *conntrack_count, uint32_t *tcp_count,
-        uint32_t *udp_count, uint32_t *other_count)
+static int count_conntrack_conn(struct vrmr_conntrack_counter *counter,
+        uint32_t *conntrack_count, uint32_t *tcp_count, uint32_t *udp_count,
+        uint32_t *other_count)
 {
     uint32_t tot = 0, tcp = 0, udp = 0, other = 0;
 
-    if (vrmr_conn_count_connections_api(&tcp, &udp, &other) < 0)
+    if (vrmr_conn_counter_get(counter, &tot, &tcp, &udp, &other) < 0)
         return (-1);
 
-    tot = tcp + udp + other;
-
     *conntrack_count = tot;
     *tcp_count = tcp;
     *udp_count = udp;
@@ -594,7 +593,8 @@ int status_section(struct vrmr_config *cnf, struct vrmr_interfaces *interfaces)
     struct utsname uts_name;
 
     /* the byte counters */
-    uint32_t recv_bytes = 0, trans_bytes = 0, delta_bytes = 0, speed_bytes = 0;
+    uint64_t recv_bytes = 0, trans_bytes = 0;
+    uint32_t delta_bytes = 0, speed_bytes = 0;
 
     /* load */
     float load_s = 0,   // 1 min
@@ -634,6 +634,12 @@ int status_section(struct vrmr_config *cnf, struct vrmr_interfaces *interfaces)
     // list which will hold the structs analog to the interfaces list
     struct vrmr_list shadow_list;
 
+    // link and iptables counters of all interfaces, fetched once per update
+    struct vrmr_counters counters;
+
+    // conntrack totals, kept current from the conntrack events
+    struct vrmr_conntrack_counter conn_counter;
+
     // we correct the speed with the time it takes to get all stats
     double elapse = 0;
     float correction = 0;
@@ -650,6 +656,8 @@ int status_section(struct vrmr_config *cnf, struct vrmr_interfaces *interfaces)
 
     // first create our shadow list
     vrmr_list_setup(&shadow_list, free);
+    vrmr_counters_setup(&counters);
+    (void)vrmr_conn_counter_setup(&conn_counter);
 
     for (unsigned int i = 0; i < interfaces->list.len; i++) {
         if (!(shadow_ptr = malloc(sizeof(struct shadow_ifac_))))
@@ -737,8 +745,9 @@ int status_section(struct vrmr_config *cnf, struct vrmr_interfaces *interfaces)
                 return (-1);
             }
 
-            if (count_conntrack_conn(&conntrack_conn_total, &conntrack_conn_tcp,
-                        &conntrack_conn_udp, &conntrack_conn_other) < 0) {
+            if (count_conntrack_conn(&conn_counter, &conntrack_conn_total,
+                        &conntrack_conn_tcp, &conntrack_conn_udp,
+                        &conntrack_conn_other) < 0) {
                 snprintf(conn_total, sizeof(conn_total), gettext("error"));
                 snprintf(conn_tcp, sizeof(conn_tcp), gettext("error"));
                 snprintf(conn_udp, sizeof(conn_udp), gettext("error"));
@@ -832,13 +841,15 @@ int status_section(struct vrmr_config *cnf, struct vrmr_interfaces *interfaces)
                 }
             }
 
+            /* fetch the counters of all interfaces at once */
+            (void)vrmr_counters_update_links(&counters, false);
+            (void)vrmr_counters_update_ipt(cnf, &counters, false);
+
             /* print interfaces, starting at line 13 */
             for (cur_interface = 0, y = 13, d_node = interfaces->list.top,
                 shadow_node = shadow_list.top;
                     d_node && y < height - 1 && shadow_node;
                     d_node = d_node->next, shadow_node = shadow_node->next) {
-                uint64_t tmp;
-
                 iface_ptr = d_node->data;
                 vrmr_fatal_if_null(iface_ptr);
                 shadow_ptr = shadow_node->data;
@@ -848,20 +859,27 @@ int status_section(struct vrmr_config *cnf, struct vrmr_interfaces *interfaces)
                 if (iface_ptr->device_virtual == TRUE) {
                     continue;
                 }
-                /* get the counters for determining speed */
-                vrmr_get_iface_stats(iface_ptr->device, &recv_bytes, NULL,
-                        &trans_bytes, NULL);
-
-                /* get the real counters from iptables */
-                vrmr_get_iface_stats_from_ipt(cnf, iface_ptr->device, "INPUT",
-                        &shadow_ptr->recv_host_packets, &shadow_ptr->recv_host,
-                        &tmp, &tmp);
-                vrmr_get_iface_stats_from_ipt(cnf, iface_ptr->device, "OUTPUT",
-                        &tmp, &tmp, &shadow_ptr->send_host_packets,
-                        &shadow_ptr->send_host);
-                vrmr_get_iface_stats_from_ipt(cnf, iface_ptr->device, "FORWARD",
-                        &shadow_ptr->recv_net_packets, &shadow_ptr->recv_net,
-                        &shadow_ptr->send_net_packets, &shadow_ptr->send_net);
+                /* get the counters for determining speed and the real
+                 * counters from iptables */
+                struct vrmr_counters_iface *cnt_ptr =
+                        vrmr_counters_get(&counters, iface_ptr->device);
+                if (cnt_ptr != NULL) {
+                    recv_bytes = cnt_ptr->rx_bytes;
+                    trans_bytes = cnt_ptr->tx_bytes;
+
+                    shadow_ptr->recv_host_packets = cnt_ptr->ipt.input_packets;
+                    shadow_ptr->recv_host = cnt_ptr->ipt.input_bytes;
+                    shadow_ptr->send_host_packets = cnt_ptr->ipt.output_packets;
+                    shadow_ptr->send_host = cnt_ptr->ipt.output_bytes;
+                    shadow_ptr->recv_net_packets =
+                            cnt_ptr->ipt.forwardin_packets;
+                    shadow_ptr->recv_net = cnt_ptr->ipt.forwardin_bytes;
+                    shadow_ptr->send_net_packets =
+                            cnt_ptr->ipt.forwardout_packets;
+                    shadow_ptr->send_net = cnt_ptr->ipt.forwardout_bytes;
+                } else {
+                    recv_bytes = trans_bytes = 0;
+                }
 
                 /* RECV host/firewall */
                 bytes_to_string(
@@ -1012,7 +1030,9 @@ int status_section(struct vrmr_config *cnf, struct vrmr_interfaces *interfaces)
         }
     }
 
-    /* destroy hashtables and the shadowlist */
+    /* destroy the counters and the shadowlist */
+    vrmr_conn_counter_cleanup(&conn_counter);
+    vrmr_counters_cleanup(&counters);
     vrmr_list_cleanup(&shadow_list);
 
     /* destroy the window and form */
@@ -186,7 +186,7 @@ static char statevent_convert_conn(struct stat_event_ctx *ctl)
 
     unsigned int array_size = ct->conn_list.len;
     for (unsigned int x = 0; x < array_size; x++) {
-        struct vrmr_conntrack_entry *cd_ptr = ct->conn_array[x];
+        struct vrmr_conntrack_entry *cd_ptr = ct->conn_list.data[x];
         struct stat_event_conn *conn = statevent_init_conn();
         vrmr_fatal_if_null(conn);
 
@@ -20,21 +20,9 @@
 
 #include "main.h"
 
-/* vuurmuur */
-int vuurmuur_shmid;
-int vuurmuur_semid;
-/*@null@*/
-struct vrmr_shm_table *vuurmuur_shmtable;
-char *vuurmuur_shmp;
-pid_t vuurmuur_pid;
-
-/* vuurmuur_log */
-int vuurmuurlog_shmid;
-int vuurmuurlog_semid;
-char *vuurmuurlog_shmp;
-/*@null@*/
-struct vrmr_shm_table *vuurmuurlog_shmtable;
-pid_t vuurmuurlog_pid;
+/* control sockets of vuurmuur and vuurmuur_log */
+struct vrmr_control_client vuurmuur_ctl = {.fd = -1};
+struct vrmr_control_client vuurmuurlog_ctl = {.fd = -1};
 
 char version_string[128];
 
@@ -179,12 +167,6 @@ int main(int argc, char *argv[])
     PANEL *main_panels[5];
     char *s = NULL;
 
-    /* some defaults */
-    vuurmuur_semid = -1;
-    vuurmuur_shmid = -1;
-    vuurmuurlog_semid = -1;
-    vuurmuurlog_shmid = -1;
-
     /* create the version string */
     snprintf(version_string, sizeof(version_string),
             "%s (using libvuurmuur %s)", VUURMUURCONF_VERSION,
@@ -399,23 +381,9 @@ int main(int argc, char *argv[])
     /* clean up the status list */
     vrmr_list_cleanup(&vuurmuur_status.StatusList);
 
-    /* detach from shared memory, if we were attached */
-    if (vuurmuur_shmp != NULL && vuurmuur_shmp != (char *)(-1) &&
-            vuurmuur_shmtable != 0) {
-        if (vrmr_lock(vuurmuur_semid)) {
-            vuurmuur_shmtable->configtool.connected = 3;
-            vrmr_unlock(vuurmuur_semid);
-        }
-        (void)shmdt(vuurmuur_shmp);
-    }
-    if (vuurmuurlog_shmp != NULL && vuurmuurlog_shmp != (char *)(-1) &&
-            vuurmuurlog_shmtable != 0) {
-        if (vrmr_lock(vuurmuurlog_semid)) {
-            vuurmuurlog_shmtable->configtool.connected = 3;
-            vrmr_unlock(vuurmuurlog_semid);
-        }
-        (void)shmdt(vuurmuurlog_shmp);
-    }
+    /* disconnect from the daemons */
+    vrmr_control_disconnect(&vuurmuur_ctl);
+    vrmr_control_disconnect(&vuurmuurlog_ctl);
 
     /* destroy the global busywin */
     VrBusyWinDelete();
@@ -866,118 +834,32 @@ int startup_screen(struct vrmr_ctx *vctx, struct vrmr_rules *rules,
     }
 
     /*
-        try to connect to vuurmuur trough shm
+        try to connect to vuurmuur and vuurmuur_log
     */
-    vuurmuur_shmtable = NULL;
     werase(startup_print_win);
     wprintw(startup_print_win, "%s Vuurmuur...", STR_CONNECTING_TO);
     update_panels();
     doupdate();
-    vuurmuur_pid = get_vuurmuur_pid("/var/run/vuurmuur.pid", &vuurmuur_shmid);
-    if (vuurmuur_shmid > 0) {
-        /* attach to shared memory */
-        vuurmuur_shmp = shmat(vuurmuur_shmid, 0, 0);
-        if (vuurmuur_shmp == (char *)(-1)) {
-            vrmr_error(-1, VR_ERR,
-                    gettext("attaching to shared memory failed: %s"),
-                    strerror(errno));
-        } else {
-            vuurmuur_shmtable = (struct vrmr_shm_table *)vuurmuur_shmp;
-            vuurmuur_semid = vuurmuur_shmtable->sem_id;
-
-            /* now try to connect to the shared memory */
-            if (vrmr_lock(vuurmuur_semid)) {
-                vuurmuur_shmtable->configtool.connected = 1;
-                (void)snprintf(vuurmuur_shmtable->configtool.name,
-                        sizeof(vuurmuur_shmtable->configtool.name),
-                        "Vuurmuur_conf %s (user: %s)", version_string,
-                        vctx->user_data.realusername);
-                (void)strlcpy(vuurmuur_shmtable->configtool.username,
-                        vctx->user_data.realusername,
-                        sizeof(vuurmuur_shmtable->configtool.username));
-                vrmr_unlock(vuurmuur_semid);
-
-                werase(startup_print_win);
-                wprintw(startup_print_win, "%s Vuurmuur... %s",
-                        STR_CONNECTING_TO, STR_COK);
-                update_panels();
-                doupdate();
-            } else {
-                werase(startup_print_win);
-                wprintw(startup_print_win, "%s Vuurmuur... %s",
-                        STR_CONNECTING_TO, STR_CFAILED);
-                update_panels();
-                doupdate();
-                vuurmuur_shmp = NULL;
-            }
-        }
-    } else {
-        /* TRANSLATORS: max 40 characters */
-        werase(startup_print_win);
-        wprintw(startup_print_win, "%s Vuurmuur... %s", STR_CONNECTING_TO,
-                STR_CFAILED);
-        update_panels();
-        doupdate();
-        vuurmuur_shmp = NULL;
-    }
+    result = vc_control_connect(vctx, &vuurmuur_ctl, VRMR_CONTROL_VUURMUUR);
+    /* TRANSLATORS: max 40 characters */
+    werase(startup_print_win);
+    wprintw(startup_print_win, "%s Vuurmuur... %s", STR_CONNECTING_TO,
+            result == 0 ? STR_COK : STR_CFAILED);
+    update_panels();
+    doupdate();
 
-    /*
-        try to connect to vuurmuur trough shm
-    */
-    vuurmuurlog_shmtable = NULL;
     /* TRANSLATORS: max 40 characters */
     werase(startup_print_win);
     wprintw(startup_print_win, "%s Vuurmuur_log...", STR_CONNECTING_TO);
     update_panels();
     doupdate();
-    vuurmuurlog_pid =
-            get_vuurmuur_pid("/var/run/vuurmuur_log.pid", &vuurmuurlog_shmid);
-    if (vuurmuurlog_shmid > 0) {
-        /* attach to shared memory */
-        vuurmuurlog_shmp = shmat(vuurmuurlog_shmid, 0, 0);
-        if (vuurmuurlog_shmp == (char *)(-1)) {
-            vrmr_error(-1, VR_ERR, "attaching to shared memory failed: %s",
-                    strerror(errno));
-        } else {
-            vuurmuurlog_shmtable = (struct vrmr_shm_table *)vuurmuurlog_shmp;
-            vuurmuurlog_semid = vuurmuurlog_shmtable->sem_id;
-
-            vrmr_debug(LOW, "vuurmuur_log: sem_id: %d.", vuurmuurlog_semid);
-
-            /* now try to connect to the shared memory */
-            if (vrmr_lock(vuurmuurlog_semid)) {
-                vuurmuurlog_shmtable->configtool.connected = 1;
-                (void)snprintf(vuurmuurlog_shmtable->configtool.name,
-                        sizeof(vuurmuurlog_shmtable->configtool.name),
-                        "Vuurmuur_conf %s (user: %s)", version_string,
-                        vctx->user_data.realusername);
-                (void)strlcpy(vuurmuurlog_shmtable->configtool.username,
-                        vctx->user_data.realusername,
-                        sizeof(vuurmuurlog_shmtable->configtool.username));
-                vrmr_unlock(vuurmuurlog_semid);
-
-                werase(startup_print_win);
-                wprintw(startup_print_win, "%s Vuurmuur_log... %s",
-                        STR_CONNECTING_TO, STR_COK);
-                update_panels();
-                doupdate();
-            } else {
-                werase(startup_print_win);
-                wprintw(startup_print_win, "%s Vuurmuur_log... %s",
-                        STR_CONNECTING_TO, STR_CFAILED);
-                update_panels();
-                doupdate();
-                vuurmuurlog_shmp = NULL;
-            }
-        }
-    } else {
-        werase(startup_print_win);
-        wprintw(startup_print_win, "%s Vuurmuur_log... %s", STR_CONNECTING_TO,
-                STR_CFAILED);
-        update_panels();
-        doupdate();
-        vuurmuurlog_shmp = NULL;
-    }
+    result = vc_control_connect(
+            vctx, &vuurmuurlog_ctl, VRMR_CONTROL_VUURMUUR_LOG);
+    werase(startup_print_win);
+    wprintw(startup_print_win, "%s Vuurmuur_log... %s", STR_CONNECTING_TO,
+            result == 0 ? STR_COK : STR_CFAILED);
+    update_panels();
+    doupdate();
 
     /* cleanup */
     del_panel(startup_panel[0]);
@@ -864,7 +864,7 @@ static int zones_rename_host_group(struct vrmr_ctx *vctx,
     zone_ptr = vrmr_search_zonedata(zones, old_host_name);
     vrmr_fatal_if_null(zone_ptr);
 
-    (void)strlcpy(zone_ptr->name, new_name_ptr, sizeof(zone_ptr->name));
+    vrmr_fatal_if(vrmr_zones_set_name(zones, zone_ptr, new_name_ptr) < 0);
     (void)strlcpy(zone_ptr->host_name, new_host, sizeof(zone_ptr->host_name));
     zone_ptr = NULL;
 
@@ -899,6 +899,8 @@ static int zones_rename_host_group(struct vrmr_ctx *vctx,
     }
     /* if we have made changes we write the rulesfile */
     if (rules_changed == 1) {
+        vrmr_fatal_if(vrmr_rules_reindex(rules) < 0);
+
         if (vrmr_rules_save_list(vctx, rules, &vctx->conf) < 0) {
             vrmr_error(-1, VR_ERR, gettext("saving rules failed."));
             return (-1);
@@ -2633,7 +2635,7 @@ static int zones_rename_network_zone(struct vrmr_ctx *vctx,
     zone_ptr = vrmr_search_zonedata(zones, old_name);
     vrmr_fatal_if_null(zone_ptr);
 
-    (void)strlcpy(zone_ptr->name, new_name_ptr, sizeof(zone_ptr->name));
+    vrmr_fatal_if(vrmr_zones_set_name(zones, zone_ptr, new_name_ptr) < 0);
 
     if (type == VRMR_TYPE_ZONE) {
         (void)strlcpy(zone_ptr->zone_name, vrmr_new_zone,
@@ -2696,6 +2698,8 @@ static int zones_rename_network_zone(struct vrmr_ctx *vctx,
 
     /* update all hosts, groups, networks */
     for (d_node = zones->list.top; d_node; d_node = d_node->next) {
+        char new_full_name[VRMR_MAX_HOST_NET_ZONE] = "";
+
         vrmr_fatal_if_null(d_node->data);
         zone_ptr = d_node->data;
 
@@ -2706,13 +2710,13 @@ static int zones_rename_network_zone(struct vrmr_ctx *vctx,
                         zone_ptr->type == VRMR_TYPE_GROUP) {
                     (void)strlcpy(zone_ptr->zone_name, vrmr_new_zone,
                             sizeof(zone_ptr->zone_name));
-                    snprintf(zone_ptr->name, sizeof(zone_ptr->name), "%s.%s.%s",
+                    snprintf(new_full_name, sizeof(new_full_name), "%s.%s.%s",
                             zone_ptr->host_name, zone_ptr->network_name,
                             zone_ptr->zone_name);
                 } else if (zone_ptr->type == VRMR_TYPE_NETWORK) {
                     (void)strlcpy(zone_ptr->zone_name, vrmr_new_zone,
                             sizeof(zone_ptr->zone_name));
-                    snprintf(zone_ptr->name, sizeof(zone_ptr->name), "%s.%s",
+                    snprintf(new_full_name, sizeof(new_full_name), "%s.%s",
                             zone_ptr->network_name, zone_ptr->zone_name);
                 }
             }
@@ -2722,12 +2726,17 @@ static int zones_rename_network_zone(struct vrmr_ctx *vctx,
                         zone_ptr->type == VRMR_TYPE_GROUP) {
                     (void)strlcpy(zone_ptr->network_name, new_net,
                             sizeof(zone_ptr->network_name));
-                    snprintf(zone_ptr->name, sizeof(zone_ptr->name), "%s.%s.%s",
+                    snprintf(new_full_name, sizeof(new_full_name), "%s.%s.%s",
                             zone_ptr->host_name, zone_ptr->network_name,
                             zone_ptr->zone_name);
                 }
             }
         }
+
+        if (new_full_name[0] != '\0') {
+            vrmr_fatal_if(
+                    vrmr_zones_set_name(zones, zone_ptr, new_full_name) < 0);
+        }
     }
 
     /* update rules */
@@ -2817,6 +2826,8 @@ static int zones_rename_network_zone(struct vrmr_ctx *vctx,
     }
     /* if we have made changes we write the rulesfile */
     if (rules_changed == 1) {
+        vrmr_fatal_if(vrmr_rules_reindex(rules) < 0);
+
         if (vrmr_rules_save_list(vctx, rules, &vctx->conf) < 0) {
             vrmr_error(-1, VR_ERR, gettext("saving rules failed."));
             return (-1);
@@ -29,10 +29,11 @@
 #include <linux/netfilter/nf_conntrack_tcp.h>
 
 #include "conntrack.h"
+#include "stats.h"
 
 static struct mnl_socket *nl = NULL;
-extern struct vrmr_hash_table zone_htbl;
-extern struct vrmr_hash_table service_htbl;
+extern struct vrmr_map zone_htbl;
+extern struct vrmr_services_index service_htbl;
 extern FILE *g_connections_log_fp;
 extern FILE *g_conn_new_log_fp;
 
@@ -80,7 +81,10 @@ static int process_connrecord(struct vrmr_log_record *lr)
     char line[1024] = "";
     FILE *fp;
 
-    int result = vrmr_log_record_get_names(lr, &zone_htbl, &service_htbl);
+    counters.conntrack_records++;
+
+    int result = vrmr_log_record_get_names(
+            lr, &zone_htbl, &service_htbl, &counters.lookups);
     if (result < 0) {
         vrmr_debug(NONE, "vrmr_log_record_get_names returned %d", result);
         exit(EXIT_FAILURE);
@@ -302,6 +306,12 @@ int conntrack_read(struct vrmr_log_record *lr)
     if (ret == -1) {
         if (errno == EAGAIN) {
             return 0;
+        } else if (errno == ENOBUFS) {
+            /* the kernel dropped events, the socket is still usable */
+            if (counters.conntrack_enobufs++ == 0)
+                vrmr_warning("Warning",
+                        "ENOBUFS on recv, conntrack events were lost");
+            return 0;
         }
         vrmr_warning(
                 "Warning", "mnl_socket_recvfrom failed: %s", strerror(errno));
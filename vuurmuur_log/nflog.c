@@ -363,10 +363,13 @@ int readnflog(void)
         if (errno == EAGAIN || errno == EWOULDBLOCK) {
             return 0;
         } else if (errno == ENOBUFS) {
-            vrmr_error(-1, "Error",
-                    "ENOBUFS on recv, may need to "
-                    "increase netlink_socket_buffer_size");
-            return -1;
+            /* the kernel dropped log records, the socket is still usable.
+             * Warn once, the metrics have the count. */
+            if (counters.nflog_enobufs++ == 0)
+                vrmr_warning("Warning",
+                        "ENOBUFS on recv, log records were lost. May need "
+                        "to increase netlink_socket_buffer_size");
+            return 0;
         } else {
             vrmr_error(
                     -1, "Internal Error", "cannot recv: %s", strerror(errno));
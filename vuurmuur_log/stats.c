@@ -23,6 +23,7 @@
 
 #include "vuurmuur_log.h"
 #include "stats.h"
+#include "vuurmuur_ipc.h"
 
 void show_stats(struct logcounters *c)
 {
@@ -61,3 +62,84 @@ void upd_action_ctrs(char *action, struct logcounters *c)
     else
         c->other_match++;
 }
+
+static void metrics_source(struct vrmr_metrics *m, const char *name,
+        const char *type, const char *help, uint64_t nflog, uint64_t conntrack)
+{
+    vrmr_metrics_u64(m, name, type, help, "source=\"nflog\"", nflog);
+    vrmr_metrics_u64(m, name, type, help, "source=\"conntrack\"", conntrack);
+}
+
+/** \brief write the log and reload metrics for prometheus
+ *
+ *  The records per second are over the time since the last call.
+ */
+void write_metrics(struct logcounters *c)
+{
+    static struct timespec last_ts;
+    static uint64_t last_nflog, last_conntrack;
+    struct vrmr_metrics m;
+    struct timespec now;
+    double nflog_rate = 0, conntrack_rate = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (last_ts.tv_sec != 0) {
+        double secs = (double)(now.tv_sec - last_ts.tv_sec) +
+                      (double)(now.tv_nsec - last_ts.tv_nsec) / 1e9;
+        if (secs > 0) {
+            nflog_rate = (double)(c->nflog_records - last_nflog) / secs;
+            conntrack_rate =
+                    (double)(c->conntrack_records - last_conntrack) / secs;
+        }
+    }
+    last_ts = now;
+    last_nflog = c->nflog_records;
+    last_conntrack = c->conntrack_records;
+
+    if (vrmr_metrics_open(&m, VRMR_METRICS_LOCATION, "vuurmuur_log") < 0)
+        return;
+
+    ipc_metrics(&m);
+
+    metrics_source(&m, "vuurmuur_log_records_total", "counter",
+            "Records read from the kernel.", c->nflog_records,
+            c->conntrack_records);
+    vrmr_metrics_double(&m, "vuurmuur_log_records_per_second", "gauge",
+            "Records read per second since the previous update.",
+            "source=\"nflog\"", nflog_rate);
+    vrmr_metrics_double(&m, "vuurmuur_log_records_per_second", "gauge",
+            "Records read per second since the previous update.",
+            "source=\"conntrack\"", conntrack_rate);
+    metrics_source(&m, "vuurmuur_log_enobufs_total", "counter",
+            "Times the kernel dropped records because the socket buffer "
+            "was full.",
+            c->nflog_enobufs, c->conntrack_enobufs);
+    vrmr_metrics_u64(&m, "vuurmuur_log_invalid_records_total", "counter",
+            "Log records that could not be handled.", NULL,
+            c->invalid_loglines);
+
+    const char *help = "Logged packets per action.";
+    vrmr_metrics_u64(&m, "vuurmuur_log_actions_total", "counter", help,
+            "action=\"accept\"", c->accept);
+    vrmr_metrics_u64(&m, "vuurmuur_log_actions_total", "counter", help,
+            "action=\"drop\"", c->drop);
+    vrmr_metrics_u64(&m, "vuurmuur_log_actions_total", "counter", help,
+            "action=\"reject\"", c->reject);
+    vrmr_metrics_u64(&m, "vuurmuur_log_actions_total", "counter", help,
+            "action=\"queue\"", c->queue);
+    vrmr_metrics_u64(&m, "vuurmuur_log_actions_total", "counter", help,
+            "action=\"other\"", c->other_match);
+
+    help = "Lookups of the zone and service names of the records.";
+    vrmr_metrics_u64(&m, "vuurmuur_log_lookups_total", "counter", help,
+            "map=\"zones\"", c->lookups.zones);
+    vrmr_metrics_u64(&m, "vuurmuur_log_lookups_total", "counter", help,
+            "map=\"services\"", c->lookups.services);
+    help = "Lookups that found a zone or service.";
+    vrmr_metrics_u64(&m, "vuurmuur_log_lookup_hits_total", "counter", help,
+            "map=\"zones\"", c->lookups.zone_hits);
+    vrmr_metrics_u64(&m, "vuurmuur_log_lookup_hits_total", "counter", help,
+            "map=\"services\"", c->lookups.service_hits);
+
+    (void)vrmr_metrics_close(&m);
+}
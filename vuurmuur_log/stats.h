@@ -39,9 +39,21 @@ struct logcounters {
     uint32_t invalid_loglines;
 
     uint32_t total;
+
+    /* records read from nflog and conntrack */
+    uint64_t nflog_records;
+    uint64_t conntrack_records;
+    /* times the kernel dropped records because we didn't read fast enough */
+    uint64_t nflog_enobufs;
+    uint64_t conntrack_enobufs;
+
+    struct vrmr_log_lookups lookups;
 };
 
+extern struct logcounters counters;
+
 void show_stats(struct logcounters *);
 void upd_action_ctrs(char *action, struct logcounters *c);
+void write_metrics(struct logcounters *c);
 
 #endif /* __STATS_H__ */
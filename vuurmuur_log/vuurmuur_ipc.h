@@ -20,9 +20,13 @@
 #ifndef __VUURMUURIPC_H__
 #define __VUURMUURIPC_H__
 
-int ipc_setup(int *, struct vrmr_shm_table **);
-int ipc_destroy(int);
-int ipc_check_reload(struct vrmr_shm_table *);
-int ipc_sync(int, int *, struct vrmr_shm_table *, int *);
+int ipc_setup(void);
+void ipc_destroy(void);
+int ipc_check_reload(void);
+void ipc_reload_start(void);
+void ipc_progress(int percent, const char *phase);
+void ipc_sync(int result);
+void ipc_set_info(const char *key, unsigned int value);
+void ipc_metrics(struct vrmr_metrics *m);
 
 #endif
@@ -30,27 +30,11 @@
 
 char version_string[128];
 
-/*@null@*/
-struct vrmr_shm_table *shm_table = 0;
-struct vrmr_hash_table zone_htbl;
-struct vrmr_hash_table service_htbl;
-static struct logcounters counters = {
-        0,
-        0,
-        0,
-        0,
-        0,
-        0,
-        0,
-        0,
-        0,
-
-        0,
-        0,
-        0,
-        0,
-};
+struct vrmr_map zone_htbl;
+struct vrmr_services_index service_htbl;
+struct logcounters counters;
 static FILE *g_traffic_log = NULL;
+static struct vrmr_logterms g_terms = {.fd = -1};
 FILE *g_conn_new_log_fp = NULL;
 FILE *g_connections_log_fp = NULL;
 
@@ -108,8 +92,10 @@ int process_logrecord(struct vrmr_log_record *log_record)
 {
     char line_out[1024] = "";
 
-    int result =
-            vrmr_log_record_get_names(log_record, &zone_htbl, &service_htbl);
+    counters.nflog_records++;
+
+    int result = vrmr_log_record_get_names(
+            log_record, &zone_htbl, &service_htbl, &counters.lookups);
     switch (result) {
         case -1:
             vrmr_debug(NONE, "vrmr_log_record_get_names returned -1");
@@ -125,8 +111,13 @@ int process_logrecord(struct vrmr_log_record *log_record)
             } else {
                 upd_action_ctrs(log_record->action, &counters);
 
+                off_t offset = ftello(g_traffic_log);
                 fprintf(g_traffic_log, "%s", line_out);
                 fflush(g_traffic_log);
+
+                if (g_terms.fd >= 0 && offset >= 0)
+                    (void)vrmr_logterms_add(&g_terms, (uint64_t)offset,
+                            strlen(line_out), log_record);
             }
             break;
     }
@@ -134,6 +125,35 @@ int process_logrecord(struct vrmr_log_record *log_record)
     return 0;
 }
 
+/** \internal
+ *
+ *  \brief (re)open the term index of the traffic log
+ *
+ *  Called after the traffic log was (re)opened, so a rotated log gets its
+ *  own index segment.
+ */
+static void open_term_index(const struct vrmr_config *cnf)
+{
+    vrmr_logterms_close(&g_terms);
+
+    if (cnf->log_term_index &&
+            vrmr_logterms_open(&g_terms, cnf->trafficlog_location) < 0) {
+        vrmr_warning("Warning", "opening the term index of '%s' failed",
+                cnf->trafficlog_location);
+    }
+}
+
+/** \internal
+ *
+ *  \brief what the config tools see with the 'status' command
+ */
+static void set_ipc_info(struct vrmr_ctx *vctx)
+{
+    ipc_set_info("zones", vctx->zones.list.len);
+    ipc_set_info("services", vctx->services.list.len);
+    ipc_set_info("interfaces", vctx->interfaces.list.len);
+}
+
 /** \internal
  *
  *  \brief open or reopen conntrack output logfiles
@@ -187,8 +207,6 @@ int main(int argc, char *argv[])
     struct vrmr_log_record logconn;
     int debug_level = NONE;
 
-    /* shm, sem stuff */
-    int shm_id;
     int reload = 0;
     char quit = 0;
 
@@ -326,6 +344,7 @@ int main(int argc, char *argv[])
         vrmr_error(-1, "Error", "opening logfiles failed.");
         exit(EXIT_FAILURE);
     }
+    open_term_index(&vctx.conf);
 
     /* load the services into memory */
     if (vrmr_services_load(&vctx, &vctx.services, &vctx.reg) == -1)
@@ -354,16 +373,13 @@ int main(int argc, char *argv[])
     }
 
     vrmr_info("Info", "Creating hash-table for the zones...");
-    if (vrmr_init_zonedata_hashtable(vctx.zones.list.len * 3, &vctx.zones.list,
-                vrmr_hash_ipaddress, vrmr_compare_ipaddress, &zone_htbl) < 0) {
+    if (vrmr_init_zonedata_hashtable(&vctx.zones.list, &zone_htbl) < 0) {
         vrmr_error(-1, "Error", "vrmr_init_zonedata_hashtable failed.");
         exit(EXIT_FAILURE);
     }
 
     vrmr_info("Info", "Creating hash-table for the services...");
-    if (vrmr_init_services_hashtable(vctx.services.list.len * 500,
-                &vctx.services.list, vrmr_hash_port, vrmr_compare_ports,
-                &service_htbl) < 0) {
+    if (vrmr_init_services_hashtable(&vctx.services.list, &service_htbl) < 0) {
         vrmr_error(-1, "Error", "vrmr_init_services_hashtable failed.");
         exit(EXIT_FAILURE);
     }
@@ -375,18 +391,20 @@ int main(int argc, char *argv[])
         }
     }
 
-    if (ipc_setup(&shm_id, &shm_table) == -1)
+    if (ipc_setup() == -1)
         exit(EXIT_FAILURE);
+    set_ipc_info(&vctx);
 
-    if (vrmr_create_pidfile(PIDFILE, shm_id) < 0)
+    if (vrmr_create_pidfile(PIDFILE) < 0)
         exit(EXIT_FAILURE);
 
     if (sigint_count || sigterm_count)
         quit = 1;
 
     /* enter the main loop */
+    time_t next_metrics = 0;
     while (quit == 0) {
-        reload = ipc_check_reload(shm_table);
+        reload = ipc_check_reload();
         if (reload == 0) {
             switch (conntrack_read(&logconn)) {
                 case 0:
@@ -403,6 +421,11 @@ int main(int argc, char *argv[])
                     usleep(100000);
                     break;
             }
+
+            if (vctx.conf.metrics && time(NULL) >= next_metrics) {
+                write_metrics(&counters);
+                next_metrics = time(NULL) + VRMR_METRICS_INTERVAL;
+            }
         }
 
         /*
@@ -411,13 +434,16 @@ int main(int argc, char *argv[])
         if (sighup_count || reload) {
             sighup_count = 0;
 
+            /* the config tools follow the progress of the reload */
+            ipc_reload_start();
+
             /*
                 clean up data
             */
 
             /* destroy hashtables */
-            vrmr_hash_cleanup(&zone_htbl);
-            vrmr_hash_cleanup(&service_htbl);
+            vrmr_map_cleanup(&zone_htbl);
+            vrmr_services_index_cleanup(&service_htbl);
 
             /* destroy the ServicesList */
             vrmr_destroy_serviceslist(&vctx.services);
@@ -433,7 +459,7 @@ int main(int argc, char *argv[])
                 exit(EXIT_FAILURE);
             }
 
-            vrmr_shm_update_progress(sem_id, &shm_table->reload_progress, 10);
+            ipc_progress(10, "unload");
 
             /* reload the config
 
@@ -444,7 +470,7 @@ int main(int argc, char *argv[])
                         "reloading config failed, using old config.");
             }
 
-            vrmr_shm_update_progress(sem_id, &shm_table->reload_progress, 20);
+            ipc_progress(20, "config");
 
             /* open backends */
             result = vrmr_backends_load(&vctx.conf, &vctx);
@@ -453,7 +479,7 @@ int main(int argc, char *argv[])
                 exit(EXIT_FAILURE);
             }
 
-            vrmr_shm_update_progress(sem_id, &shm_table->reload_progress, 30);
+            ipc_progress(30, "backends");
 
             /* re-initialize the data */
             vrmr_info("Info", "Initializing interfaces...");
@@ -462,7 +488,7 @@ int main(int argc, char *argv[])
                 exit(EXIT_FAILURE);
             }
 
-            vrmr_shm_update_progress(sem_id, &shm_table->reload_progress, 40);
+            ipc_progress(40, "interfaces");
 
             vrmr_info("Info", "Initializing zones...");
             if (vrmr_init_zonedata(
@@ -471,7 +497,7 @@ int main(int argc, char *argv[])
                 exit(EXIT_FAILURE);
             }
 
-            vrmr_shm_update_progress(sem_id, &shm_table->reload_progress, 50);
+            ipc_progress(50, "zones");
 
             vrmr_info("Info", "Initializing services...");
             if (vrmr_init_services(&vctx, &vctx.services, &vctx.reg) < 0) {
@@ -479,7 +505,7 @@ int main(int argc, char *argv[])
                 exit(EXIT_FAILURE);
             }
 
-            vrmr_shm_update_progress(sem_id, &shm_table->reload_progress, 60);
+            ipc_progress(60, "services");
 
             /* insert the interfaces as VRMR_TYPE_FIREWALL's into the zonelist
              * as 'firewall', so this appears in to log as 'firewall(interface)'
@@ -496,47 +522,48 @@ int main(int argc, char *argv[])
                 vrmr_error(-1, "Error", "unable to add broadcasts to list.");
                 exit(EXIT_FAILURE);
             }
-            vrmr_shm_update_progress(sem_id, &shm_table->reload_progress, 70);
+            ipc_progress(70, "zonelist");
 
             vrmr_info("Info", "Creating hash-table for the zones...");
-            if (vrmr_init_zonedata_hashtable(vctx.zones.list.len * 3,
-                        &vctx.zones.list, vrmr_hash_ipaddress,
-                        vrmr_compare_ipaddress, &zone_htbl) < 0) {
+            if (vrmr_init_zonedata_hashtable(&vctx.zones.list, &zone_htbl) <
+                    0) {
                 vrmr_error(result, "Error",
                         "vrmr_init_zonedata_hashtable failed.");
                 exit(EXIT_FAILURE);
             }
-            vrmr_shm_update_progress(sem_id, &shm_table->reload_progress, 80);
+            ipc_progress(80, "zones_hash");
 
             vrmr_info("Info", "Creating hash-table for the services...");
-            if (vrmr_init_services_hashtable(vctx.services.list.len * 500,
-                        &vctx.services.list, vrmr_hash_port, vrmr_compare_ports,
-                        &service_htbl) < 0) {
+            if (vrmr_init_services_hashtable(
+                        &vctx.services.list, &service_htbl) < 0) {
                 vrmr_error(result, "Error",
                         "vrmr_init_services_hashtable failed.");
                 exit(EXIT_FAILURE);
             }
-            vrmr_shm_update_progress(sem_id, &shm_table->reload_progress, 90);
+            ipc_progress(90, "services_hash");
 
             if (reopen_vuurmuurlog(&vctx.conf, &g_traffic_log) < 0) {
                 vrmr_error(-1, "Error", "re-opening logfiles failed.");
                 exit(EXIT_FAILURE);
             }
-            vrmr_shm_update_progress(sem_id, &shm_table->reload_progress, 92);
+            open_term_index(&vctx.conf);
+            ipc_progress(92, "logs");
             if (conntrack_open_logs(&vctx.conf) != 0) {
                 vrmr_error(
                         -1, "Error", "could not re-open connection log files");
                 exit(EXIT_FAILURE);
             }
-            vrmr_shm_update_progress(sem_id, &shm_table->reload_progress, 95);
+            ipc_progress(95, "connection_logs");
 
             /* only ok now */
             result = 0;
+            set_ipc_info(&vctx);
 
-            /* if we are reloading because of an IPC command, we need to
-             * communicate with the caller */
-            if (reload == 1)
-                ipc_sync(30, &result, shm_table, &reload);
+            /* tell the config tools about the result */
+            ipc_sync(result);
+
+            /* get the reload into the metrics right away */
+            next_metrics = 0;
         }
 
         /* check for a signal */
@@ -547,15 +574,13 @@ int main(int argc, char *argv[])
     /*
         cleanup
     */
-    if (ipc_destroy(shm_id) == -1) {
-        vrmr_error(-1, "Error", "Detach from VM IPC failed.");
-        /* fall through */
-    }
+    ipc_destroy();
 
     /* free the sscanf parser string */
     free(sscanf_str);
 
     /* close the logfiles */
+    vrmr_logterms_close(&g_terms);
     if (g_traffic_log != NULL)
         fclose(g_traffic_log);
     if (g_connections_log_fp != NULL)
@@ -568,8 +593,8 @@ int main(int argc, char *argv[])
     conntrack_disconnect();
 
     /* destroy hashtables */
-    vrmr_hash_cleanup(&zone_htbl);
-    vrmr_hash_cleanup(&service_htbl);
+    vrmr_map_cleanup(&zone_htbl);
+    vrmr_services_index_cleanup(&service_htbl);
 
     /* destroy the ServicesList */
     vrmr_destroy_serviceslist(&vctx.services);
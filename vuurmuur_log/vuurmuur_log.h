@@ -62,6 +62,5 @@ int open_logfiles(const struct vrmr_config *cnf, FILE **, FILE **);
 int process_logrecord(struct vrmr_log_record *log_record);
 
 extern char version_string[128];
-extern int sem_id;
 
 #endif /* __VUURMUUR_LOG_H__ */
@@ -20,228 +20,136 @@
 
 #include "vuurmuur_script.h"
 
-int script_apply(struct vuurmuur_script *vr_script)
-{
-    /* vuurmuur */
-    int vuurmuur_shmid = 0;
-    int vuurmuur_semid = -1;
-    /*@null@*/
-    struct vrmr_shm_table *vuurmuur_shmtable = NULL;
-    char *vuurmuur_shmp = NULL;
-
-    /* vuurmuur_log */
-    int vuurmuurlog_shmid = 0;
-    int vuurmuurlog_semid = -1;
-    char *vuurmuurlog_shmp = NULL;
-    /*@null@*/
-    struct vrmr_shm_table *vuurmuurlog_shmtable = NULL;
-    int vuurmuur_result = 0, vuurmuurlog_result = 0;
-    int waittime = 0;
-
-    int vuurmuur_progress = 0, vuurmuurlog_progress = 0;
+/*  script_apply_wait
 
-    char failed = FALSE;
-    int retval = 0;
+    Waits for the result of the reload we requested. Gives up if the daemon
+    is silent for 60 seconds.
+
+    Returncodes:
+         0: ok
+        -1: error
+*/
+static int script_apply_wait(
+        struct vrmr_control_client *client, const char *name)
+{
+    struct vrmr_control_event ev;
+    unsigned int id = 0;
 
-    /* try to connect to vuurmuur trough shm */
-    vuurmuur_shmtable = NULL;
-    get_vuurmuur_pid("/var/run/vuurmuur.pid", &vuurmuur_shmid);
-    if (vuurmuur_shmid > 0) {
-        /* attach to shared memory */
-        vuurmuur_shmp = shmat(vuurmuur_shmid, 0, 0);
-        if (vuurmuur_shmp == (char *)(-1)) {
+    while (1) {
+        int result = vrmr_control_read(client, &ev, 60000);
+        if (result == 0) {
             vrmr_error(VRS_ERR_COMMAND_FAILED, VR_ERR,
-                    "attaching to shared memory failed: %s", strerror(errno));
-        } else {
-            vuurmuur_shmtable = (struct vrmr_shm_table *)vuurmuur_shmp;
-            vuurmuur_semid = vuurmuur_shmtable->sem_id;
-
-            /* now try to connect to the shared memory */
-            if (vrmr_lock(vuurmuur_semid)) {
-                vuurmuur_shmtable->configtool.connected = 1;
-                (void)strlcpy(vuurmuur_shmtable->configtool.username,
-                        vr_script->vctx.user_data.realusername,
-                        sizeof(vuurmuur_shmtable->configtool.username));
-                snprintf(vuurmuur_shmtable->configtool.name,
-                        sizeof(vuurmuur_shmtable->configtool.name),
-                        "Vuurmuur_script %s (user: %s)", version_string,
-                        vr_script->vctx.user_data.realusername);
-                vrmr_unlock(vuurmuur_semid);
-            } else {
-                vrmr_error(VRS_ERR_COMMAND_FAILED, VR_ERR,
-                        "connecting to Vuurmuur failed: could not lock semid.");
-                vuurmuur_shmp = NULL;
-            }
+                    "%s: timed out waiting for the reload.", name);
+            return (-1);
+        } else if (result < 0) {
+            vrmr_error(VRS_ERR_COMMAND_FAILED, VR_ERR,
+                    "%s: connection lost during the reload.", name);
+            return (-1);
         }
-    } else {
-        vrmr_warning(
-                VR_WARN, "vuurmuur not notified: connecting failed: no shmid.");
-        vuurmuur_shmp = NULL;
-    }
 
-    /* try to connect to vuurmuur trough shm */
-    vuurmuurlog_shmtable = NULL;
-    get_vuurmuur_pid("/var/run/vuurmuur_log.pid", &vuurmuurlog_shmid);
-    if (vuurmuurlog_shmid > 0) {
-        /* attach to shared memory */
-        vuurmuurlog_shmp = shmat(vuurmuurlog_shmid, 0, 0);
-        if (vuurmuurlog_shmp == (char *)(-1)) {
-            vrmr_error(VRS_ERR_COMMAND_FAILED, VR_ERR,
-                    "attaching to shared memory failed: %s", strerror(errno));
-        } else {
-            vuurmuurlog_shmtable = (struct vrmr_shm_table *)vuurmuurlog_shmp;
-            vuurmuurlog_semid = vuurmuurlog_shmtable->sem_id;
-
-            /* now try to connect to the shared memory */
-            if (vrmr_lock(vuurmuurlog_semid)) {
-                vuurmuurlog_shmtable->configtool.connected = 1;
-                (void)strlcpy(vuurmuurlog_shmtable->configtool.username,
-                        vr_script->vctx.user_data.realusername,
-                        sizeof(vuurmuurlog_shmtable->configtool.username));
-                snprintf(vuurmuurlog_shmtable->configtool.name,
-                        sizeof(vuurmuurlog_shmtable->configtool.name),
-                        "Vuurmuur_script %s (user: %s)", version_string,
-                        vr_script->vctx.user_data.realusername);
-                vrmr_unlock(vuurmuurlog_semid);
-            } else {
+        if (ev.type == VRMR_CONTROL_EV_RELOAD) {
+            id = ev.id;
+        } else if (ev.type == VRMR_CONTROL_EV_ERROR) {
+            vrmr_error(VRS_ERR_COMMAND_FAILED, VR_ERR, "%s: %s", name, ev.text);
+            return (-1);
+        } else if (ev.type == VRMR_CONTROL_EV_DONE && ev.id == id) {
+            if (ev.result == VRMR_RR_ERROR) {
                 vrmr_error(VRS_ERR_COMMAND_FAILED, VR_ERR,
-                        "connecting to Vuurmuur_log failed: could not lock "
-                        "semid.");
-                vuurmuurlog_shmp = NULL;
+                        "%s: applying changes failed: %s.", name, ev.text);
+                return (-1);
             }
+            vrmr_debug(LOW, "%s: reload %u took %" PRIu64 "ms.", name, id,
+                    ev.ms);
+            return (0);
         }
-    } else {
-        vrmr_warning(VR_WARN,
-                "vuurmuur_log not notified: connecting failed: no shmid.");
-        vuurmuurlog_shmp = NULL;
     }
+}
 
-    /* handle no vuurmuur connection */
-    if (vuurmuur_shmtable != NULL && vuurmuur_semid != -1) {
-        if (vrmr_lock(vuurmuur_semid)) {
-            vuurmuur_shmtable->backend_changed = 1;
-            vrmr_unlock(vuurmuur_semid);
+/*  script_block_now
 
-            vuurmuur_result = VRMR_RR_NO_RESULT_YET;
-        }
-    } else {
-        vuurmuur_result = VRMR_RR_READY;
-    }
+    Asks vuurmuur to 'cmd' (block or unblock) 'item' right away. Vuurmuur
+    updates the blocklist in the backend and the running ruleset itself,
+    so no reload is needed.
 
-    /* handle no vuurmuur_log connection */
-    if (vuurmuurlog_shmtable != NULL && vuurmuurlog_semid != -1) {
-        if (vrmr_lock(vuurmuurlog_semid)) {
-            vuurmuurlog_shmtable->backend_changed = 1;
-            vrmr_unlock(vuurmuurlog_semid);
+    Returncodes:
+        VRS_SUCCESS: done
+        VRS_ERR_COMMAND_FAILED: vuurmuur refused
+        -1: vuurmuur can't do it, do it the old way
+*/
+int script_block_now(
+        struct vuurmuur_script *vr_script, const char *cmd, const char *item)
+{
+    struct vrmr_control_client vuurmuur = {.fd = -1};
+    const char *user = vr_script->vctx.user_data.realusername;
+    char line[sizeof(vr_script->set) + 16];
+    char name[256];
+    char err[256] = "";
+    int retval = VRS_SUCCESS;
+
+    snprintf(name, sizeof(name), "Vuurmuur_script %s (user: %s)",
+            version_string, user);
+    snprintf(line, sizeof(line), "%s %s", cmd, item);
+
+    if (vrmr_control_connect(&vuurmuur, VRMR_CONTROL_VUURMUUR, user, name) <
+            0) {
+        vrmr_debug(LOW, "vuurmuur not running, %s through the backend.", cmd);
+        return (-1);
+    }
 
-            vuurmuurlog_result = VRMR_RR_NO_RESULT_YET;
+    if (vrmr_control_command(&vuurmuur, line, 60000, err, sizeof(err)) < 0) {
+        /* older vuurmuur or lost connection */
+        if (strncmp(err, "unknown command", 15) == 0 ||
+                strcmp(err, "connection lost") == 0 ||
+                strcmp(err, "sending the command failed") == 0) {
+            vrmr_debug(LOW, "vuurmuur: %s, %s through the backend.", err, cmd);
+            retval = -1;
+        } else {
+            vrmr_error(VRS_ERR_COMMAND_FAILED, VR_ERR,
+                    "vuurmuur: %s failed: %s", cmd, err);
+            retval = VRS_ERR_COMMAND_FAILED;
         }
     } else {
-        vuurmuurlog_result = VRMR_RR_READY;
+        logchange(vr_script, "item '%s' %sed.", item, cmd);
     }
 
-    /* wait max 60 seconds */
-    while (((vuurmuur_result == VRMR_RR_NO_RESULT_YET ||
-                    vuurmuur_result == VRMR_RR_RESULT_ACK) ||
-                   (vuurmuurlog_result == VRMR_RR_NO_RESULT_YET ||
-                           vuurmuurlog_result == VRMR_RR_RESULT_ACK)) &&
-            waittime < 60000000) {
-        if (vuurmuur_shmtable != NULL && vuurmuur_semid != -1) {
-            if (vuurmuur_progress < 100) {
-                if (vrmr_lock(vuurmuur_semid)) {
-                    if (vuurmuur_shmtable->reload_result != VRMR_RR_READY) {
-                        vuurmuur_result = vuurmuur_shmtable->reload_result;
-                    }
-                    vuurmuur_progress = vuurmuur_shmtable->reload_progress;
-                    vrmr_unlock(vuurmuur_semid);
-                }
-            }
-
-            if (vuurmuur_progress == 100) {
-                if (vrmr_lock(vuurmuur_semid)) {
-                    vuurmuur_shmtable->reload_result = VRMR_RR_RESULT_ACK;
-                    vrmr_unlock(vuurmuur_semid);
-
-                    if (vuurmuur_result != VRMR_RR_SUCCES &&
-                            vuurmuur_result != VRMR_RR_NOCHANGES) {
-                        vuurmuur_result = VRMR_RR_READY;
-                        failed = 1;
-                    }
-                }
-            }
-        } else {
-            vuurmuur_result = VRMR_RR_READY;
-            failed = 1;
-        }
+    vrmr_control_disconnect(&vuurmuur);
+    return (retval);
+}
 
-        if (vuurmuurlog_shmtable != NULL && vuurmuurlog_semid != -1) {
-            if (vuurmuurlog_progress < 100) {
-                if (vrmr_lock(vuurmuurlog_semid)) {
-                    if (vuurmuurlog_shmtable->reload_result != VRMR_RR_READY) {
-                        vuurmuurlog_result =
-                                vuurmuurlog_shmtable->reload_result;
-                    }
-                    vuurmuurlog_progress =
-                            vuurmuurlog_shmtable->reload_progress;
-                    vrmr_unlock(vuurmuurlog_semid);
-                }
-            }
+int script_apply(struct vuurmuur_script *vr_script)
+{
+    struct vrmr_control_client vuurmuur = {.fd = -1};
+    struct vrmr_control_client vuurmuurlog = {.fd = -1};
+    const char *user = vr_script->vctx.user_data.realusername;
+    char name[256];
+    char failed = FALSE;
+    int retval = 0;
 
-            if (vuurmuurlog_progress == 100) {
-                if (vrmr_lock(vuurmuurlog_semid)) {
-                    vuurmuurlog_shmtable->reload_result = VRMR_RR_RESULT_ACK;
-                    vrmr_unlock(vuurmuurlog_semid);
-
-                    if (vuurmuurlog_result != VRMR_RR_SUCCES &&
-                            vuurmuurlog_result != VRMR_RR_NOCHANGES) {
-                        vuurmuurlog_result = VRMR_RR_READY;
-                        failed = 1;
-                    }
-                }
-            } else {
-                vuurmuurlog_result = VRMR_RR_READY;
-                failed = 1;
-            }
-        }
+    snprintf(name, sizeof(name), "Vuurmuur_script %s (user: %s)",
+            version_string, user);
 
-        /* no result yet, sleep 1 sec, or if the server didn't have a chance to
-         * do anything */
-        if ((vuurmuur_result == VRMR_RR_NO_RESULT_YET ||
-                    vuurmuur_result == VRMR_RR_RESULT_ACK) ||
-                (vuurmuurlog_result == VRMR_RR_NO_RESULT_YET ||
-                        vuurmuurlog_result == VRMR_RR_RESULT_ACK)) {
-            waittime += 1000;
-            usleep(1000);
-        }
+    /* request the reload from both first, so they reload at the same time */
+    if (vrmr_control_connect(&vuurmuur, VRMR_CONTROL_VUURMUUR, user, name) <
+                    0 ||
+            vrmr_control_send(&vuurmuur, "reload") < 0) {
+        vrmr_warning(VR_WARN, "vuurmuur not notified: connecting failed.");
+        failed = TRUE;
     }
-
-    /* timed out */
-    if (vuurmuur_progress < 100) {
-        failed = 1;
+    if (vrmr_control_connect(&vuurmuurlog, VRMR_CONTROL_VUURMUUR_LOG, user,
+                name) < 0 ||
+            vrmr_control_send(&vuurmuurlog, "reload") < 0) {
+        vrmr_warning(VR_WARN, "vuurmuur_log not notified: connecting failed.");
+        failed = TRUE;
     }
 
-    /* timed out */
-    if (vuurmuurlog_progress < 100) {
-        failed = 1;
-    }
+    if (vuurmuur.fd >= 0 && script_apply_wait(&vuurmuur, "vuurmuur") < 0)
+        failed = TRUE;
+    if (vuurmuurlog.fd >= 0 &&
+            script_apply_wait(&vuurmuurlog, "vuurmuur_log") < 0)
+        failed = TRUE;
 
-    /* detach from shared memory, if we were attached */
-    if (vuurmuur_shmp != NULL && vuurmuur_shmp != (char *)(-1) &&
-            vuurmuur_shmtable != 0) {
-        if (vrmr_lock(vuurmuur_semid)) {
-            vuurmuur_shmtable->configtool.connected = 3;
-            vrmr_unlock(vuurmuur_semid);
-        }
-        (void)shmdt(vuurmuur_shmp);
-    }
-    if (vuurmuurlog_shmp != NULL && vuurmuurlog_shmp != (char *)(-1) &&
-            vuurmuurlog_shmtable != 0) {
-        if (vrmr_lock(vuurmuurlog_semid)) {
-            vuurmuurlog_shmtable->configtool.connected = 3;
-            vrmr_unlock(vuurmuurlog_semid);
-        }
-        (void)shmdt(vuurmuurlog_shmp);
-    }
+    vrmr_control_disconnect(&vuurmuur);
+    vrmr_control_disconnect(&vuurmuurlog);
 
     if (failed == TRUE)
         retval = VRS_ERR_COMMAND_FAILED;
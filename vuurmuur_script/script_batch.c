@@ -0,0 +1,244 @@
+/***************************************************************************
+ *   Copyright (C) 2002-2019 by Victor Julien                              *
+ *   victor@vuurmuur.org                                                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <stddef.h>
+#include <ctype.h>
+
+#include "vuurmuur_script.h"
+
+/*
+    Batch mode: vuurmuur_script --batch <file>
+
+    Each line of the file (or stdin for '-') holds the options of one
+    command, like on the commandline:
+
+        --create --host web1.dmz.ext
+        --modify --host web1.dmz.ext --variable IPADDRESS --set 10.0.0.1
+        --modify --host web1.dmz.ext --variable COMMENT --set "web server"
+
+    Empty lines and lines starting with '#' are skipped. The backends are
+    loaded once for all lines and vuurmuur and vuurmuur_log reload once at
+    the end, if a line asked for it with --apply or --reload, or --apply
+    was given on the commandline.
+
+    All lines are checked before the first one runs, so a typo doesn't
+    leave half of the batch done. A command that fails stops the batch
+    without a reload.
+*/
+
+#define BATCH_MAX_ARGS 64
+
+/* splits 'line' in place into options. Quotes group words, like
+ * --set "block 1.2.3.4". Returns the number of args or -1 on error. */
+static int batch_split(char *line, char *argv[], int max)
+{
+    static char progname[] = "vuurmuur_script";
+    char *s = line;
+    int argc = 0;
+
+    argv[argc++] = progname;
+
+    while (1) {
+        while (isspace((unsigned char)*s))
+            s++;
+        if (*s == '\0' || (argc == 1 && *s == '#'))
+            break;
+        if (argc == max - 1)
+            return (-1);
+
+        char *out = s;
+        char quote = '\0';
+
+        argv[argc++] = out;
+        while (*s != '\0' && (quote || !isspace((unsigned char)*s))) {
+            if (quote && *s == quote) {
+                quote = '\0';
+                s++;
+            } else if (!quote && (*s == '"' || *s == '\'')) {
+                quote = *s++;
+            } else {
+                *out++ = *s++;
+            }
+        }
+        if (quote)
+            return (-1);
+        if (*s != '\0')
+            s++;
+        *out = '\0';
+    }
+    argv[argc] = NULL;
+    return (argc);
+}
+
+/* reads all lines first, so stdin can be checked before anything runs */
+static int batch_read(const char *path, struct vrmr_list *lines)
+{
+    char line[4096];
+    FILE *fp = stdin;
+
+    if (strcmp(path, "-") != 0 && !(fp = fopen(path, "r"))) {
+        vrmr_error(VRS_ERR_COMMANDLINE, VR_ERR, "opening '%s' failed: %s",
+                path, strerror(errno));
+        return (-1);
+    }
+
+    while (fgets(line, (int)sizeof(line), fp) != NULL) {
+        size_t len = strlen(line);
+        if (len > 0 && line[len - 1] == '\n') {
+            line[len - 1] = '\0';
+        } else if (!feof(fp)) {
+            vrmr_error(VRS_ERR_COMMANDLINE, VR_ERR,
+                    "line %u of '%s' too long (max: %d).", lines->len + 1,
+                    path, (int)sizeof(line) - 2);
+            goto error;
+        }
+
+        char *str = strdup(line);
+        if (str == NULL || vrmr_list_append(lines, str) == NULL) {
+            vrmr_error(VRS_ERR_MALLOC, VR_ERR, "out of memory");
+            free(str);
+            goto error;
+        }
+    }
+
+    if (fp != stdin)
+        fclose(fp);
+    return (0);
+error:
+    if (fp != stdin)
+        fclose(fp);
+    return (-1);
+}
+
+/* parses line 'num' into 'vr_script'. 'buf' is overwritten. A line without
+ * options leaves vr_script->cmd CMD_UNSET. */
+static int batch_parse(struct vuurmuur_script *vr_script, const char *line,
+        unsigned int num, char *buf, size_t size)
+{
+    char *argv[BATCH_MAX_ARGS + 1];
+    int argc, result;
+
+    memset(vr_script, 0, offsetof(struct vuurmuur_script, vctx));
+    vr_script->overwrite = TRUE;
+
+    (void)strlcpy(buf, line, size);
+    if ((argc = batch_split(buf, argv, BATCH_MAX_ARGS)) < 0) {
+        vrmr_error(VRS_ERR_COMMANDLINE, VR_ERR,
+                "line %u: unbalanced quotes or too many options.", num);
+        return (VRS_ERR_COMMANDLINE);
+    }
+    if (argc == 1)
+        return (VRS_SUCCESS);
+
+    if (script_options(vr_script, argc, argv) != VRS_SUCCESS) {
+        vrmr_error(VRS_ERR_COMMANDLINE, VR_ERR, "line %u: invalid options.",
+                num);
+        return (VRS_ERR_COMMANDLINE);
+    }
+    if (vr_script->batch != NULL) {
+        vrmr_error(VRS_ERR_COMMANDLINE, VR_ERR,
+                "line %u: --batch can't be used in a batch.", num);
+        return (VRS_ERR_COMMANDLINE);
+    }
+    if ((result = script_check(vr_script)) != VRS_SUCCESS) {
+        vrmr_error(result, VR_ERR, "line %u: invalid command.", num);
+        return (result);
+    }
+    return (VRS_SUCCESS);
+}
+
+/*  script_batch_load
+
+    Reads the commands from the file vr_script->batch into 'lines' and
+    checks them. Done before the backends are loaded, so the errors go to
+    the screen.
+
+    Returncodes:
+        VRS_SUCCESS: ok
+        otherwise the VRS_ERR_* code of the first invalid line
+*/
+int script_batch_load(
+        struct vuurmuur_script *vr_script, struct vrmr_list *lines)
+{
+    struct vrmr_list_node *d_node = NULL;
+    char buf[4096];
+    unsigned int num;
+    int result = VRS_SUCCESS;
+
+    assert(vr_script && vr_script->batch && lines);
+
+    vrmr_list_setup(lines, free);
+    if (batch_read(vr_script->batch, lines) < 0)
+        return (VRS_ERR_COMMANDLINE);
+
+    for (d_node = lines->top, num = 1; d_node && result == VRS_SUCCESS;
+            d_node = d_node->next, num++)
+        result = batch_parse(vr_script, d_node->data, num, buf, sizeof(buf));
+
+    memset(vr_script, 0, offsetof(struct vuurmuur_script, vctx));
+    return (result);
+}
+
+/*  script_batch_run
+
+    Runs the commands in 'lines', checked by script_batch_load(). Sets
+    vr_script->apply if a command asked for a reload.
+
+    Returncodes:
+        VRS_SUCCESS: all commands ran
+        otherwise the VRS_ERR_* code of the command that failed
+*/
+int script_batch_run(
+        struct vuurmuur_script *vr_script, struct vrmr_list *lines)
+{
+    struct vrmr_list_node *d_node = NULL;
+    char buf[4096];
+    char apply = FALSE;
+    unsigned int num, done = 0;
+    int retval = VRS_SUCCESS;
+
+    assert(vr_script && lines);
+
+    for (d_node = lines->top, num = 1; d_node; d_node = d_node->next, num++) {
+        if (batch_parse(vr_script, d_node->data, num, buf, sizeof(buf)) !=
+                        VRS_SUCCESS ||
+                vr_script->cmd == CMD_UNSET)
+            continue;
+
+        vrmr_debug(LOW, "line %u: '%s'.", num, (char *)d_node->data);
+
+        retval = script_run(vr_script);
+        if (retval != VRS_SUCCESS) {
+            vrmr_error(retval, VR_ERR,
+                    "line %u failed, %u commands done, not applying.", num,
+                    done);
+            goto end;
+        }
+        if (vr_script->apply == TRUE)
+            apply = TRUE;
+        done++;
+    }
+    if (vr_script->vctx.conf.verbose_out == TRUE)
+        vrmr_info(VR_INFO, "batch: %u commands done.", done);
+end:
+    memset(vr_script, 0, offsetof(struct vuurmuur_script, vctx));
+    vr_script->apply = apply;
+    return (retval);
+}
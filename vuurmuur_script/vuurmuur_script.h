@@ -32,9 +32,6 @@
 #include <signal.h> /* for catching signals */
 #include <time.h>   /* included for logging */
 #include <errno.h>  /* error handling */
-#include <sys/ipc.h>
-#include <sys/sem.h>
-#include <sys/shm.h>
 #include <sys/wait.h>
 
 #ifndef _GNU_SOURCE
@@ -57,11 +54,6 @@
 #define EXIT_SUCCESS 0
 #define EXIT_COMMANDLINE_ERROR 1
 
-extern struct vrmr_shm_table *shm_table;
-
-/* semaphore id */
-extern int sem_id;
-
 /* pointer to the environment */
 extern char **environ;
 
@@ -120,12 +112,22 @@ struct vuurmuur_script {
     /* print rule numbers? */
     char print_rule_numbers;
 
-    /* library ctx */
+    /* file with the commands to run, '-' for stdin */
+    const char *batch;
+
+    /* library ctx. Keep it last: a batch clears everything before it
+     * for each command. */
     struct vrmr_ctx vctx;
 };
 
 void logchange(struct vuurmuur_script *, char *fmt, ...) ATTR_FMT_PRINTF(2, 3);
 
+int script_options(struct vuurmuur_script *, int argc, char *argv[]);
+int script_check(struct vuurmuur_script *);
+int script_run(struct vuurmuur_script *);
+int script_batch_load(struct vuurmuur_script *, struct vrmr_list *lines);
+int script_batch_run(struct vuurmuur_script *, struct vrmr_list *lines);
+
 int script_print(struct vuurmuur_script *);
 int script_list(struct vuurmuur_script *);
 int script_add(struct vuurmuur_script *);
@@ -133,6 +135,8 @@ int script_delete(struct vuurmuur_script *);
 int script_modify(struct vuurmuur_script *);
 int script_rename(struct vuurmuur_script *);
 int script_apply(struct vuurmuur_script *vr_script);
+int script_block_now(
+        struct vuurmuur_script *vr_script, const char *cmd, const char *item);
 int script_unblock(struct vuurmuur_script *vr_script);
 int script_list_devices(void);
 